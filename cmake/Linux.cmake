@@ -21,6 +21,30 @@ if (USE_SCHED_FIFO)
   add_compile_definitions(USE_SCHED_FIFO)
 endif()
 
+option (USE_PACKET_MMAP
+  "Use memory mapped rings (PACKET_MMAP) for raw Ethernet frames"
+  OFF)
+
+if (USE_PACKET_MMAP)
+  add_compile_definitions(USE_PACKET_MMAP)
+endif()
+
+option (USE_LOCKFREE_MBOX
+  "Use a lock-free ring buffer for os_mbox"
+  OFF)
+
+if (USE_LOCKFREE_MBOX)
+  add_compile_definitions(USE_LOCKFREE_MBOX)
+endif()
+
+option (USE_ASYNC_LOG
+  "Write log messages from a low priority thread instead of the caller"
+  OFF)
+
+if (USE_ASYNC_LOG)
+  add_compile_definitions(USE_ASYNC_LOG)
+endif()
+
 target_include_directories(profinet
   PRIVATE
   src/osal/linux
@@ -61,6 +85,45 @@ target_sources(pn_dev
   sample_app/main_linux.c
   )
 
+add_executable(pn_eth_bench
+  sample_app/eth_bench_linux.c
+  )
+
+target_include_directories(pn_eth_bench
+  PRIVATE
+  src
+  src/osal/linux
+  ${PROFINET_BINARY_DIR}/src
+  )
+
+target_link_libraries(pn_eth_bench PUBLIC profinet)
+
+add_executable(pn_mbox_bench
+  sample_app/mbox_bench_linux.c
+  )
+
+target_include_directories(pn_mbox_bench
+  PRIVATE
+  src
+  src/osal/linux
+  ${PROFINET_BINARY_DIR}/src
+  )
+
+target_link_libraries(pn_mbox_bench PUBLIC profinet)
+
+add_executable(pn_tick_bench
+  sample_app/tick_bench_linux.c
+  )
+
+target_include_directories(pn_tick_bench
+  PRIVATE
+  src
+  src/osal/linux
+  ${PROFINET_BINARY_DIR}/src
+  )
+
+target_link_libraries(pn_tick_bench PUBLIC profinet)
+
 if (BUILD_TESTING)
   set(GOOGLE_TEST_INDIVIDUAL TRUE)
   target_sources(pf_test
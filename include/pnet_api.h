@@ -72,6 +72,12 @@ extern "C"
  * Memory usage is controlled by the `PNET_MAX_*` defines.
  * Define the required number of supported items.
  *
+ * The tables for ARs, slots, subslots, submodules and diagnosis items are
+ * allocated by pnet_init(). Their sizes are taken from the resource fields
+ * of pnet_cfg_t, and the defines below are only used when a field is 0
+ * (zero). PNET_MAX_AR is also the upper limit of max_ar.
+ * See pnet_get_footprint().
+ *
  * These values directly affect the memory usage of the implementation.
  * Sometimes in complicated ways.
  *
@@ -87,8 +93,11 @@ extern "C"
 #define PNET_MAX_DFP_IOCR                                      2     /**< Allowed values are 0 (zero) or 2. */
 #define PNET_MAX_PORT                                          1     /**< 2 for media redundancy. Currently only 1 is supported. */
 #define PNET_MAX_LOG_BOOK_ENTRIES                              16
-#define PNET_MAX_ALARMS                                        3     /**< Per AR and queue. One queue for hi and one for lo alarms. */
+#define PNET_MAX_ALARMS                                        8     /**< Per AR and queue. One queue for hi and one for lo alarms. */
+#define PNET_MAX_ALARM_DRAIN                                   PNET_MAX_ALARMS /**< Received alarm PDUs handled per queue in each periodic call. Must be > 0. */
 #define PNET_MAX_DIAG_ITEMS                                    200   /**< Total, per device. Max is 65534 items. */
+#define PNET_MAX_DCP_RESPONSES                                 4     /**< Delayed DCP Identify responses pending at the same time. Must be > 0. */
+#define PNET_MAX_LLDP_PEERS                                    2     /**< Per port. Neighbours learned from received LLDP frames. Must be > 0. */
 
 #if PNET_OPTION_MC_CR
 #define PNET_MAX_MC_CR                                         1     /**< Par AR. */
@@ -447,6 +456,12 @@ typedef enum pnet_data_status_bits
  /** Network handle */
 typedef struct pnet pnet_t;
 
+/**
+ * Handle to the cyclic data of one sub-slot, see pnet_io_handle_get().
+ * The value 0 is never a valid handle.
+ */
+typedef uint32_t pnet_io_handle_t;
+
 /**
  * Profinet stack detailed error information.
  */
@@ -1031,6 +1046,13 @@ typedef struct pnet_cfg
    pnet_cfg_ip_addr_t      ip_mask;
    pnet_cfg_ip_addr_t      ip_gateway;
    pnet_ethaddr_t          eth_addr;
+
+   /** Resources */
+   uint16_t                max_ar;                 /**< Connections. At most PNET_MAX_AR. 0 (zero) means PNET_MAX_AR. */
+   uint16_t                max_slots;              /**< Slots per API. 0 (zero) means PNET_MAX_MODULES. */
+   uint16_t                max_subslots;           /**< Subslots per slot. 0 (zero) means PNET_MAX_SUBMODULES. */
+   uint16_t                max_submodules;         /**< Submodules per AR. Sizes the expected configuration, the IOCR tables and the IO index of each AR. At most 4096. 0 (zero) means PNET_MAX_API * max_slots * max_subslots. */
+   uint16_t                max_diag_items;         /**< Diagnosis items, per device. At most 65534. 0 (zero) means PNET_MAX_DIAG_ITEMS. */
 } pnet_cfg_t;
 
 /**
@@ -1296,6 +1318,101 @@ PNET_EXPORT int pnet_output_set_iocs(
    uint16_t                subslot,
    uint8_t                 iocs);
 
+/**
+ * Resolve a sub-slot to a handle for fast access to its cyclic data.
+ *
+ * The sub-slot is looked up once in the AR that owns it. The handle can then
+ * be used with pnet_io_input_set_data_and_iops(), pnet_io_input_get_iocs(),
+ * pnet_io_output_get_data_and_iops() and pnet_io_output_set_iocs() without
+ * any further search.
+ *
+ * The handle is valid until the AR is released or re-connected, or the
+ * sub-module is pulled. After that the handle functions return -1 and the
+ * application should resolve the sub-slot again, typically at the next
+ * PNET_EVENT_PRMEND or PNET_EVENT_DATA event.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param api              In:  The API.
+ * @param slot             In:  The slot.
+ * @param subslot          In:  The sub-slot.
+ * @param p_handle         Out: The handle.
+ * @return  0  if the sub-slot is part of a connected AR.
+ *          -1 if an error occurred.
+ */
+PNET_EXPORT int pnet_io_handle_get(
+   pnet_t                  *net,
+   uint32_t                api,
+   uint16_t                slot,
+   uint16_t                subslot,
+   pnet_io_handle_t        *p_handle);
+
+/**
+ * Same as pnet_input_set_data_and_iops(), for a sub-slot handle.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param handle           In:  Handle from pnet_io_handle_get().
+ * @param p_data           In:  Data buffer.
+ * @param data_len         In:  Bytes in data buffer.
+ * @param iops             In:  The device provider status.
+ * @return  0  if a sub-module data and IOPS was set.
+ *          -1 if an error occurred or the handle is no longer valid.
+ */
+PNET_EXPORT int pnet_io_input_set_data_and_iops(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_data,
+   uint16_t                data_len,
+   uint8_t                 iops);
+
+/**
+ * Same as pnet_input_get_iocs(), for a sub-slot handle.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param handle           In:  Handle from pnet_io_handle_get().
+ * @param p_iocs           Out: The controller consumer status.
+ * @return  0  if a sub-module IOCS was retrieved.
+ *          -1 if an error occurred or the handle is no longer valid.
+ */
+PNET_EXPORT int pnet_io_input_get_iocs(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_iocs);
+
+/**
+ * Same as pnet_output_get_data_and_iops(), for a sub-slot handle.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param handle           In:  Handle from pnet_io_handle_get().
+ * @param p_new_flag       Out: true if new data.
+ * @param p_data           Out: The received data.
+ * @param p_data_len       In:  Size of receive buffer.
+ *                         Out: Received number of data bytes.
+ * @param p_iops           Out: The controller provider status (IOPS).
+ * @return  0  if a sub-module data and IOPS is retrieved.
+ *          -1 if an error occurred or the handle is no longer valid.
+ */
+PNET_EXPORT int pnet_io_output_get_data_and_iops(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   bool                    *p_new_flag,
+   uint8_t                 *p_data,
+   uint16_t                *p_data_len,
+   uint8_t                 *p_iops);
+
+/**
+ * Same as pnet_output_set_iocs(), for a sub-slot handle.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param handle           In:  Handle from pnet_io_handle_get().
+ * @param iocs             In:  The device consumer status.
+ * @return  0  if a sub-module IOCS was set.
+ *          -1 if an error occurred or the handle is no longer valid.
+ */
+PNET_EXPORT int pnet_io_output_set_iocs(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 iocs);
+
 /**
  * Implements the "Local Set State" primitive.
  *
@@ -1646,6 +1763,17 @@ PNET_EXPORT void pnet_show(
    pnet_t                  *net,
    unsigned                level);
 
+/**
+ * Get the memory footprint of the stack instance.
+ *
+ * The stack instance and its tables are allocated in one block by
+ * pnet_init(). Tables sized from the configuration are included.
+ * @param net              In:   The p-net stack instance
+ * @return  the number of bytes allocated for the stack instance.
+ */
+PNET_EXPORT size_t pnet_get_footprint(
+   pnet_t                  *net);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,261 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Measure latency and CPU load of the Linux raw Ethernet OSAL
+ *
+ * Sends cyclic Profinet frames on one interface and receives them on
+ * another, typically the two ends of a veth pair. The frames carry a
+ * sequence number and a send timestamp.
+ *
+ * Build once with and once without USE_PACKET_MMAP to compare the
+ * socket and the ring implementations. See doc/linuxtiming.rst.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "options.h"
+#include "osal.h"
+
+#define BENCH_FRAME_ID        0x8000
+#define BENCH_FRAME_SIZE      64
+#define BENCH_MAGIC           0x504e4254     /* "PNBT" */
+
+typedef struct bench_data
+{
+   uint32_t                frames;
+   uint32_t                received;
+   uint32_t                out_of_order;
+   uint32_t                next_seq;
+   uint32_t                *p_latency;    /* ns, indexed by sequence number */
+} bench_data_t;
+
+static uint64_t bench_now_ns(
+   clockid_t               clock)
+{
+   struct timespec         ts;
+
+   clock_gettime(clock, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t bench_thread_cpu_ns(
+   os_thread_t             *thread)
+{
+   clockid_t               clock;
+
+   if (pthread_getcpuclockid(*thread, &clock) != 0)
+   {
+      return 0;
+   }
+   return bench_now_ns(clock);
+}
+
+static int bench_recv(
+   void                    *arg,
+   os_buf_t                *p_buf)
+{
+   bench_data_t            *p_bench = arg;
+   uint8_t                 *p_data = p_buf->payload;
+   uint64_t                now = bench_now_ns(CLOCK_MONOTONIC);
+   uint32_t                magic;
+   uint32_t                seq;
+   uint64_t                sent;
+
+   if (p_buf->len < BENCH_FRAME_SIZE)
+   {
+      return 0;
+   }
+   memcpy(&magic, &p_data[16], sizeof(magic));
+   memcpy(&seq, &p_data[20], sizeof(seq));
+   memcpy(&sent, &p_data[24], sizeof(sent));
+   if ((magic != BENCH_MAGIC) || (seq >= p_bench->frames))
+   {
+      return 0;
+   }
+
+   if (seq != p_bench->next_seq)
+   {
+      p_bench->out_of_order++;
+   }
+   p_bench->next_seq = seq + 1;
+   p_bench->p_latency[seq] = (uint32_t)(now - sent);
+   p_bench->received++;
+
+   return 0;   /* Keep the buffer */
+}
+
+static int bench_compare(
+   const void              *p_a,
+   const void              *p_b)
+{
+   uint32_t                a = *(const uint32_t *)p_a;
+   uint32_t                b = *(const uint32_t *)p_b;
+
+   return (a > b) - (a < b);
+}
+
+static void bench_usage(
+   const char              *name)
+{
+   printf("Usage: %s [-n frames] [-p period_us] <tx interface> <rx interface>\n", name);
+   printf("Example (as root):\n");
+   printf("  ip link add pnb0 type veth peer name pnb1\n");
+   printf("  ip link set pnb0 up; ip link set pnb1 up\n");
+   printf("  %s pnb0 pnb1\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+   bench_data_t            bench;
+   os_eth_handle_t         *p_tx;
+   os_eth_handle_t         *p_rx;
+   os_eth_stats_t          stats;
+   os_buf_t                *p_buf;
+   uint8_t                 *p_data;
+   uint32_t                period_us = 100;
+   uint32_t                seq;
+   uint32_t                cnt;
+   uint64_t                sent;
+   uint64_t                cpu_start;
+   uint64_t                cpu_end;
+   uint64_t                sum = 0;
+   struct timespec         next;
+   struct rusage           usage;
+   int                     option;
+
+   memset(&bench, 0, sizeof(bench));
+   bench.frames = 100000;
+
+   while ((option = getopt(argc, argv, "hn:p:")) != -1)
+   {
+      switch (option)
+      {
+      case 'n':
+         bench.frames = strtoul(optarg, NULL, 0);
+         break;
+      case 'p':
+         period_us = strtoul(optarg, NULL, 0);
+         break;
+      case 'h':
+         /* FALL-THRU */
+      default:
+         bench_usage(argv[0]);
+         exit(EXIT_FAILURE);
+      }
+   }
+   if ((argc - optind != 2) || (bench.frames == 0))
+   {
+      bench_usage(argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   bench.p_latency = calloc(bench.frames, sizeof(uint32_t));
+   p_buf = os_buf_alloc(BENCH_FRAME_SIZE);
+   if ((bench.p_latency == NULL) || (p_buf == NULL))
+   {
+      printf("Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   p_rx = os_eth_init(argv[optind + 1], bench_recv, &bench);
+   p_tx = os_eth_init(argv[optind], NULL, NULL);
+   if ((p_rx == NULL) || (p_tx == NULL))
+   {
+      printf("Failed to open %s or %s\n", argv[optind], argv[optind + 1]);
+      exit(EXIT_FAILURE);
+   }
+
+#if defined (USE_PACKET_MMAP)
+   printf("Backend: PACKET_MMAP rings\n");
+#else
+   printf("Backend: socket, batch size %u\n", (unsigned)OS_ETH_RX_BATCH);
+#endif
+   printf("Sending %u frames, period %u us\n", (unsigned)bench.frames, (unsigned)period_us);
+
+   /* Broadcast Profinet RT frame */
+   p_data = p_buf->payload;
+   memset(p_data, 0, BENCH_FRAME_SIZE);
+   memset(&p_data[0], 0xff, 6);
+   p_data[12] = OS_ETHTYPE_PROFINET >> 8;
+   p_data[13] = OS_ETHTYPE_PROFINET & 0xff;
+   p_data[14] = BENCH_FRAME_ID >> 8;
+   p_data[15] = BENCH_FRAME_ID & 0xff;
+   seq = BENCH_MAGIC;
+   memcpy(&p_data[16], &seq, sizeof(seq));
+
+   os_usleep(100 * 1000);
+   cpu_start = bench_thread_cpu_ns(p_rx->thread);
+   clock_gettime(CLOCK_MONOTONIC, &next);
+   for (seq = 0; seq < bench.frames; seq++)
+   {
+      next.tv_nsec += period_us * 1000;
+      while (next.tv_nsec >= 1000000000)
+      {
+         next.tv_nsec -= 1000000000;
+         next.tv_sec++;
+      }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+      sent = bench_now_ns(CLOCK_MONOTONIC);
+      memcpy(&p_data[20], &seq, sizeof(seq));
+      memcpy(&p_data[24], &sent, sizeof(sent));
+      (void)os_eth_send(p_tx, p_buf);
+   }
+   os_usleep(100 * 1000);
+   cpu_end = bench_thread_cpu_ns(p_rx->thread);
+   getrusage(RUSAGE_SELF, &usage);
+
+   /* Sort the latencies of the received frames */
+   cnt = 0;
+   for (seq = 0; seq < bench.frames; seq++)
+   {
+      if (bench.p_latency[seq] != 0)
+      {
+         bench.p_latency[cnt++] = bench.p_latency[seq];
+         sum += bench.p_latency[seq];
+      }
+   }
+   qsort(bench.p_latency, cnt, sizeof(uint32_t), bench_compare);
+
+   os_eth_get_stats(p_rx, &stats);
+   printf("Received:      %u (lost %u, out of order %u)\n", (unsigned)bench.received,
+      (unsigned)(bench.frames - bench.received), (unsigned)bench.out_of_order);
+   if (cnt > 0)
+   {
+      printf("Latency (us):  min %.1f  avg %.1f  p50 %.1f  p99 %.1f  max %.1f\n",
+         bench.p_latency[0] / 1000.0, (double)sum / cnt / 1000.0,
+         bench.p_latency[cnt / 2] / 1000.0, bench.p_latency[(cnt * 99) / 100] / 1000.0,
+         bench.p_latency[cnt - 1] / 1000.0);
+      printf("RX thread CPU: %.2f us/frame\n", (double)(cpu_end - cpu_start) / cnt / 1000.0);
+   }
+   printf("Process CPU:   user %ld ms  system %ld ms\n",
+      usage.ru_utime.tv_sec * 1000 + usage.ru_utime.tv_usec / 1000,
+      usage.ru_stime.tv_sec * 1000 + usage.ru_stime.tv_usec / 1000);
+   printf("RX stats:      calls %u  frames %u  max batch %u  errors %u  dropped %u\n",
+      (unsigned)stats.rx_calls, (unsigned)stats.rx_frames, (unsigned)stats.rx_batch_max,
+      (unsigned)stats.rx_errors, (unsigned)stats.rx_dropped);
+
+   return 0;
+}
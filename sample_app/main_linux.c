@@ -122,7 +122,7 @@ struct cmd_args {
 
 typedef struct app_data_obj
 {
-   os_timer_t                *main_timer;
+   os_loop_t                 *main_loop;
    os_event_t                *main_events;
    uint32_t                  main_arep;
    bool                      alarm_allowed;
@@ -797,7 +797,6 @@ static int app_alarm_ack_cnf(
 /************************* Utilities ******************************************/
 
 static void main_timer_tick(
-   os_timer_t              *timer,
    void                    *arg)
 {
    app_data_t              *p_appdata = (app_data_t*)arg;
@@ -1155,8 +1154,15 @@ void pn_main (void * arg)
    /* Main loop */
    for (;;)
    {
-      os_event_wait(p_appdata->main_events, mask, &flags, OS_WAIT_FOREVER);
-      if (flags & EVENT_READY_FOR_DATA)
+      /* Sleep in the loop until the next tick, unless an event is pending.
+       * Events set by other threads are handled at the next tick at the latest.
+       */
+      os_event_wait(p_appdata->main_events, mask, &flags, 0);
+      if (flags == 0)
+      {
+         (void)os_loop_run_once(p_appdata->main_loop, OS_WAIT_FOREVER);
+      }
+      else if (flags & EVENT_READY_FOR_DATA)
       {
          os_event_clr(p_appdata->main_events, EVENT_READY_FOR_DATA); /* Re-arm */
 
@@ -1324,7 +1330,8 @@ void pn_main (void * arg)
          }
       }
    }
-   os_timer_destroy(p_appdata->main_timer);
+   os_udp_set_loop(NULL);
+   os_loop_destroy(p_appdata->main_loop);
    os_event_destroy(p_appdata->main_events);
    printf("Ending the application\n");
 }
@@ -1342,7 +1349,7 @@ int main(int argc, char *argv[])
    appdata.alarm_allowed = true;
    appdata.main_arep = UINT32_MAX;
    appdata.main_events = NULL;
-   appdata.main_timer = NULL;
+   appdata.main_loop = NULL;
    memset(appdata.inputdata, 0, sizeof(appdata.inputdata));
    memset(appdata.custom_input_slots, 0, sizeof(appdata.custom_input_slots));
    memset(appdata.custom_output_slots, 0, sizeof(appdata.custom_output_slots));
@@ -1461,6 +1468,16 @@ int main(int argc, char *argv[])
       }
    }
 
+   /* The main loop also signals when the RPC sockets of the stack receive data */
+   appdata.main_events = os_event_create();
+   appdata.main_loop   = os_loop_create();
+   if (appdata.main_loop == NULL)
+   {
+      printf("Failed to create the main loop\n");
+      exit(EXIT_CODE_ERROR);
+   }
+   os_udp_set_loop(appdata.main_loop);
+
    /* Initialize profinet stack */
    net = pnet_init(appdata.arguments.eth_interface, TICK_INTERVAL_US, &pnet_default_cfg);
    if (net == NULL)
@@ -1471,12 +1488,8 @@ int main(int argc, char *argv[])
    appdata_and_stack.appdata = &appdata;
    appdata_and_stack.net = net;
 
-   /* Initialize timer and Profinet stack */
-   appdata.main_events = os_event_create();
-   appdata.main_timer  = os_timer_create(TICK_INTERVAL_US, main_timer_tick, (void*)&appdata, false);
-
+   os_loop_set_tick(appdata.main_loop, TICK_INTERVAL_US, main_timer_tick, (void*)&appdata);
    os_thread_create("pn_main", APP_PRIORITY, APP_STACKSIZE, pn_main, (void*)&appdata_and_stack);
-   os_timer_start(appdata.main_timer);
 
    for(;;)
       os_usleep(APP_MAIN_SLEEPTIME_US);
@@ -0,0 +1,197 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Measure throughput and CPU load of the Linux os_mbox
+ *
+ * One or more producer threads post messages as fast as they can and one
+ * consumer thread fetches them, blocking when the mailbox is empty. In the
+ * paced mode each producer sleeps between posts, like the Ethernet RX thread
+ * posting alarms, so that the consumer parks between messages. With zero
+ * producers the main thread posts and fetches itself, which measures the
+ * uncontended cost of one post and one fetch.
+ *
+ * Build once with and once without USE_LOCKFREE_MBOX to compare the
+ * condition variable and the lock-free implementations.
+ * See doc/linuxtiming.rst.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "osal.h"
+
+#define BENCH_MAX_PRODUCERS   8
+
+typedef struct bench_producer
+{
+   os_mbox_t               *mbox;
+   uint32_t                msgs;
+   uint32_t                period_us;
+   volatile bool           done;
+} bench_producer_t;
+
+static uint64_t bench_now_ns(void)
+{
+   struct timespec         ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void bench_producer(
+   void                    *arg)
+{
+   bench_producer_t        *p_prod = arg;
+   uint32_t                ix;
+
+   for (ix = 0; ix < p_prod->msgs; ix++)
+   {
+      if (p_prod->period_us > 0)
+      {
+         os_usleep(p_prod->period_us);
+      }
+      (void)os_mbox_post(p_prod->mbox, (void *)(uintptr_t)(ix + 1), OS_WAIT_FOREVER);
+   }
+   p_prod->done = true;
+}
+
+static void bench_usage(
+   const char              *name)
+{
+   printf("Usage: %s [-n messages] [-p producers] [-s mbox size] [-d period_us]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+   bench_producer_t        prod[BENCH_MAX_PRODUCERS];
+   os_mbox_t               *mbox;
+   uint32_t                msgs = 1000000;
+   uint32_t                producers = 1;
+   uint32_t                size = 16;
+   uint32_t                period_us = 0;
+   uint32_t                ix;
+   uint32_t                received = 0;
+   uint64_t                start;
+   uint64_t                end;
+   struct rusage           usage;
+   void                    *msg;
+   int                     option;
+
+   while ((option = getopt(argc, argv, "hn:p:s:d:")) != -1)
+   {
+      switch (option)
+      {
+      case 'n':
+         msgs = strtoul(optarg, NULL, 0);
+         break;
+      case 'p':
+         producers = strtoul(optarg, NULL, 0);
+         break;
+      case 's':
+         size = strtoul(optarg, NULL, 0);
+         break;
+      case 'd':
+         period_us = strtoul(optarg, NULL, 0);
+         break;
+      case 'h':
+         /* FALL-THRU */
+      default:
+         bench_usage(argv[0]);
+         exit(EXIT_FAILURE);
+      }
+   }
+   if ((producers > BENCH_MAX_PRODUCERS) || (size == 0) || (msgs == 0))
+   {
+      bench_usage(argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   mbox = os_mbox_create(size);
+   if (mbox == NULL)
+   {
+      printf("Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+#if defined (USE_LOCKFREE_MBOX)
+   printf("Mailbox: lock-free\n");
+#else
+   printf("Mailbox: mutex and condition variable\n");
+#endif
+   printf("%u producer(s), %u messages each, mailbox size %u, period %u us\n",
+      (unsigned)producers, (unsigned)msgs, (unsigned)size, (unsigned)period_us);
+
+   start = bench_now_ns();
+   if (producers == 0)
+   {
+      for (ix = 0; ix < msgs; ix++)
+      {
+         (void)os_mbox_post(mbox, (void *)(uintptr_t)(ix + 1), 0);
+         if (os_mbox_fetch(mbox, &msg, 0) == 0)
+         {
+            received++;
+         }
+      }
+   }
+   else
+   {
+      for (ix = 0; ix < producers; ix++)
+      {
+         prod[ix].mbox = mbox;
+         prod[ix].msgs = msgs;
+         prod[ix].period_us = period_us;
+         prod[ix].done = false;
+         os_thread_create("bench", 5, 4096, bench_producer, &prod[ix]);
+      }
+
+      while (received < producers * msgs)
+      {
+         if (os_mbox_fetch(mbox, &msg, OS_WAIT_FOREVER) == 0)
+         {
+            received++;
+         }
+      }
+   }
+   end = bench_now_ns();
+
+   for (ix = 0; ix < producers; ix++)
+   {
+      while (prod[ix].done == false)
+      {
+         os_usleep(1000);
+      }
+   }
+   getrusage(RUSAGE_SELF, &usage);
+
+   printf("Received:      %u in %.1f ms\n", (unsigned)received, (end - start) / 1000000.0);
+   printf("Throughput:    %.2f Mmsg/s, %.0f ns/msg\n",
+      received * 1000.0 / (end - start), (double)(end - start) / received);
+   printf("Process CPU:   user %ld ms  system %ld ms  (%.0f ns/msg)\n",
+      usage.ru_utime.tv_sec * 1000 + usage.ru_utime.tv_usec / 1000,
+      usage.ru_stime.tv_sec * 1000 + usage.ru_stime.tv_usec / 1000,
+      ((usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e9 +
+       (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e3) / received);
+   printf("Context sw:    voluntary %ld  involuntary %ld\n", usage.ru_nvcsw, usage.ru_nivcsw);
+
+   os_mbox_destroy(mbox);
+   return 0;
+}
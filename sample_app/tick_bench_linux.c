@@ -0,0 +1,224 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Measure the jitter of the periodic tick on Linux
+ *
+ * Compares the two ways of driving pnet_handle_periodic() from a main
+ * thread: an os_timer whose thread sets an os_event for the main thread,
+ * and an os_loop tick that runs in the main thread itself. For each tick
+ * the delay from the ideal deadline to the tick handler is recorded.
+ * See doc/linuxtiming.rst.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "osal.h"
+
+#define EVENT_TIMER           BIT(0)
+
+typedef struct bench_data
+{
+   uint32_t                ticks;
+   uint32_t                period_us;
+   uint32_t                cnt;
+   uint32_t                missed;        /* Deadlines without a tick */
+   uint64_t                last;          /* Index of last deadline */
+   uint64_t                start;
+   uint32_t                *p_delay;      /* ns, indexed by tick */
+   os_event_t              *event;
+} bench_data_t;
+
+static uint64_t bench_now_ns(void)
+{
+   struct timespec         ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Called in the main thread for each tick. The delay is measured from the
+ * latest deadline, so a stall is counted as missed ticks and not as a delay
+ * for every tick after it. */
+static void bench_handle_tick(
+   bench_data_t            *p_bench)
+{
+   uint64_t                period = (uint64_t)p_bench->period_us * 1000;
+   uint64_t                elapsed = bench_now_ns() - p_bench->start;
+   uint64_t                ix = elapsed / period;
+
+   if ((p_bench->cnt < p_bench->ticks) && (ix > 0))
+   {
+      if (ix > p_bench->last + 1)
+      {
+         p_bench->missed += (uint32_t)(ix - p_bench->last - 1);
+      }
+      p_bench->last = ix;
+      p_bench->p_delay[p_bench->cnt++] = (uint32_t)(elapsed - ix * period);
+   }
+}
+
+static void bench_timer_expired(
+   os_timer_t              *timer,
+   void                    *arg)
+{
+   bench_data_t            *p_bench = arg;
+
+   os_event_set(p_bench->event, EVENT_TIMER);
+}
+
+static void bench_loop_tick(
+   void                    *arg)
+{
+   bench_handle_tick(arg);
+}
+
+static int bench_compare(
+   const void              *p_a,
+   const void              *p_b)
+{
+   uint32_t                a = *(const uint32_t *)p_a;
+   uint32_t                b = *(const uint32_t *)p_b;
+
+   return (a > b) - (a < b);
+}
+
+static void bench_usage(
+   const char              *name)
+{
+   printf("Usage: %s [-n ticks] [-p period_us] [-t]\n", name);
+   printf("  -t  Use an os_timer and an os_event instead of an os_loop\n");
+}
+
+int main(int argc, char *argv[])
+{
+   bench_data_t            bench;
+   os_timer_t              *timer = NULL;
+   os_loop_t               *loop = NULL;
+   bool                    use_timer = false;
+   uint32_t                flags;
+   uint64_t                sum = 0;
+   struct rusage           start;
+   struct rusage           end;
+   long                    switches;
+   int                     option;
+
+   memset(&bench, 0, sizeof(bench));
+   bench.ticks = 5000;
+   bench.period_us = 1000;
+
+   while ((option = getopt(argc, argv, "hn:p:t")) != -1)
+   {
+      switch (option)
+      {
+      case 'n':
+         bench.ticks = strtoul(optarg, NULL, 0);
+         break;
+      case 'p':
+         bench.period_us = strtoul(optarg, NULL, 0);
+         break;
+      case 't':
+         use_timer = true;
+         break;
+      case 'h':
+         /* FALL-THRU */
+      default:
+         bench_usage(argv[0]);
+         exit(EXIT_FAILURE);
+      }
+   }
+   if ((bench.ticks == 0) || (bench.period_us == 0))
+   {
+      bench_usage(argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   bench.p_delay = calloc(bench.ticks, sizeof(uint32_t));
+   if (bench.p_delay == NULL)
+   {
+      printf("Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   printf("Tick source: %s\n", use_timer ? "os_timer + os_event" : "os_loop");
+   printf("Running %u ticks, period %u us\n", (unsigned)bench.ticks, (unsigned)bench.period_us);
+
+   getrusage(RUSAGE_SELF, &start);
+   if (use_timer)
+   {
+      bench.event = os_event_create();
+      timer = os_timer_create(bench.period_us, bench_timer_expired, &bench, false);
+      bench.start = bench_now_ns();
+      os_timer_start(timer);
+      while (bench.cnt < bench.ticks)
+      {
+         os_event_wait(bench.event, EVENT_TIMER, &flags, OS_WAIT_FOREVER);
+         os_event_clr(bench.event, EVENT_TIMER);
+         bench_handle_tick(&bench);
+      }
+      os_timer_stop(timer);
+   }
+   else
+   {
+      loop = os_loop_create();
+      bench.start = bench_now_ns();
+      os_loop_set_tick(loop, bench.period_us, bench_loop_tick, &bench);
+      while (bench.cnt < bench.ticks)
+      {
+         (void)os_loop_run_once(loop, OS_WAIT_FOREVER);
+      }
+      os_loop_set_tick(loop, 0, NULL, NULL);
+   }
+   getrusage(RUSAGE_SELF, &end);
+
+   for (bench.cnt = 0; bench.cnt < bench.ticks; bench.cnt++)
+   {
+      sum += bench.p_delay[bench.cnt];
+   }
+   qsort(bench.p_delay, bench.ticks, sizeof(uint32_t), bench_compare);
+
+   switches = (end.ru_nvcsw - start.ru_nvcsw) + (end.ru_nivcsw - start.ru_nivcsw);
+   printf("Delay (us):    min %.1f  avg %.1f  p50 %.1f  p99 %.1f  max %.1f\n",
+      bench.p_delay[0] / 1000.0, (double)sum / bench.ticks / 1000.0,
+      bench.p_delay[bench.ticks / 2] / 1000.0,
+      bench.p_delay[(bench.ticks * 99) / 100] / 1000.0,
+      bench.p_delay[bench.ticks - 1] / 1000.0);
+   printf("Missed ticks:  %u\n", (unsigned)bench.missed);
+   printf("Ctx switches:  %.2f per tick\n", (double)switches / bench.ticks);
+   printf("Process CPU:   user %ld ms  system %ld ms\n",
+      (end.ru_utime.tv_sec - start.ru_utime.tv_sec) * 1000 +
+         (end.ru_utime.tv_usec - start.ru_utime.tv_usec) / 1000,
+      (end.ru_stime.tv_sec - start.ru_stime.tv_sec) * 1000 +
+         (end.ru_stime.tv_usec - start.ru_stime.tv_usec) / 1000);
+   if (loop != NULL)
+   {
+      os_loop_destroy(loop);
+   }
+   if (timer != NULL)
+   {
+      os_timer_destroy(timer);
+      os_event_destroy(bench.event);
+   }
+
+   return 0;
+}
@@ -33,6 +33,9 @@
 #define ALARM_VLAN_PRIO_LOW         (5<<12)
 #define ALARM_VLAN_PRIO_HIGH        (6<<12)
 
+#define PF_ALARM_FRAME_SIZE         1500
+#define PF_ALARM_HEADER_SIZE        20    /* DA, SA, VLAN tag, LT and FrameID */
+
 
 /* The scheduler identifier */
 static const char *apmx_sync_name = "apmx";
@@ -135,6 +138,9 @@ void pf_alarm_show(
    printf("  send_seq_count      = 0x%x\n", (unsigned)p_ar->apmx[0].send_seq_count);
    printf("  send_seq_count_o    = 0x%x\n", (unsigned)p_ar->apmx[0].send_seq_count_o);
    printf("  sequence_number     = %u\n", (unsigned)p_ar->alpmx[0].sequence_number);
+   printf("  queue drops         = %u\n", (unsigned)p_ar->apmx[0].apmr_drop_cnt);
+   printf("  round trips         = %u (last %u us, max %u us)\n", (unsigned)p_ar->apmx[0].rtt_cnt,
+      (unsigned)p_ar->apmx[0].rtt_last, (unsigned)p_ar->apmx[0].rtt_max);
    printf("\n");
    printf("Alarms   (high)\n");
    printf("  alpmi_state         = %s\n", pf_alarm_alpmi_state_to_string(p_ar->alpmx[1].alpmi_state));
@@ -146,6 +152,9 @@ void pf_alarm_show(
    printf("  send_seq_count      = 0x%x\n", (unsigned)p_ar->apmx[1].send_seq_count);
    printf("  send_seq_count_o    = 0x%x\n", (unsigned)p_ar->apmx[1].send_seq_count_o);
    printf("  sequence_number     = %u\n", (unsigned)p_ar->alpmx[1].sequence_number);
+   printf("  queue drops         = %u\n", (unsigned)p_ar->apmx[1].apmr_drop_cnt);
+   printf("  round trips         = %u (last %u us, max %u us)\n", (unsigned)p_ar->apmx[1].rtt_cnt,
+      (unsigned)p_ar->apmx[1].rtt_last, (unsigned)p_ar->apmx[1].rtt_max);
    printf("\n");
 }
 
@@ -440,6 +449,28 @@ static int pf_alarm_alpmr_apmr_a_data_ind(
 
 /* ===== APMS - Acyclic sender ===== */
 
+/**
+ * @internal
+ * Put a received alarm PDU in the receive queue of an APMR.
+ *
+ * The buffer itself is posted, so nothing is shared with the consumer
+ * until the post has succeeded. If the queue is full then the PDU is lost
+ * and its buffer is freed. The controller re-sends it after a timeout.
+ * @param p_apmx           In:   The APMX instance.
+ * @param p_buf            In:   The Ethernet frame buffer.
+ */
+static void pf_alarm_apmr_post(
+   pf_apmx_t               *p_apmx,
+   os_buf_t                *p_buf)
+{
+   if (os_mbox_post(p_apmx->p_alarm_q, (void *)p_buf, 0) != 0)
+   {
+      p_apmx->apmr_drop_cnt++;
+      LOG_ERROR(PF_ALARM_LOG, "Alarm(%d): Lost one alarm\n", __LINE__);
+      os_buf_free(p_buf);
+   }
+}
+
 /**
  * @internal
  * Handle high-priority alarm PDUs from the controller.
@@ -463,26 +494,10 @@ static int pf_alarm_apmr_high_handler(
 {
    int                     ret = 1;       /* Means "handled" */
    pf_apmx_t               *p_apmx = (pf_apmx_t *)p_arg;
-   pf_apmr_msg_t           *p_apmr_msg;
-   uint16_t                nbr;
 
-   if (ret != 0)
+   if (p_buf != NULL)
    {
-      if (p_buf != NULL)
-      {
-         nbr = p_apmx->apmr_msg_nbr++;    /* ToDo: Make atomic */
-         if (p_apmx->apmr_msg_nbr >= NELEMENTS(p_apmx->apmr_msg))
-         {
-            p_apmx->apmr_msg_nbr = 0;
-         }
-         p_apmr_msg = &p_apmx->apmr_msg[nbr];
-         p_apmr_msg->p_buf = p_buf;
-         p_apmr_msg->frame_id_pos = frame_id_pos;
-         if (os_mbox_post(p_apmx->p_alarm_q, (void *)p_apmr_msg, 0) != 0)
-         {
-            LOG_ERROR(PF_ALARM_LOG, "Alarm(%d): Lost one alarm\n", __LINE__);
-         }
-      }
+      pf_alarm_apmr_post(p_apmx, p_buf);
    }
 
    return ret;
@@ -511,26 +526,10 @@ static int pf_alarm_apmr_low_handler(
 {
    int                     ret = 1;       /* Means "handled" */
    pf_apmx_t               *p_apmx = (pf_apmx_t *)p_arg;
-   pf_apmr_msg_t           *p_apmr_msg;
-   uint16_t                nbr;
 
-   if (ret != 0)
+   if (p_buf != NULL)
    {
-      if (p_buf != NULL)
-      {
-         nbr = p_apmx->apmr_msg_nbr++;    /* ToDo: Make atomic */
-         if (p_apmx->apmr_msg_nbr >= NELEMENTS(p_apmx->apmr_msg))
-         {
-            p_apmx->apmr_msg_nbr = 0;
-         }
-         p_apmr_msg = &p_apmx->apmr_msg[nbr];
-         p_apmr_msg->p_buf = p_buf;
-         p_apmr_msg->frame_id_pos = frame_id_pos;
-         if (os_mbox_post(p_apmx->p_alarm_q, (void *)p_apmr_msg, 0) != 0)
-         {
-            LOG_ERROR(PF_ALARM_LOG, "Alarm(%d): Lost one alarm\n", __LINE__);
-         }
-      }
+      pf_alarm_apmr_post(p_apmx, p_buf);
    }
 
    return ret;
@@ -556,7 +555,6 @@ static void pf_alarm_apms_timeout(
    uint32_t                current_time)
 {
    pf_apmx_t               *p_apmx = (pf_apmx_t *)arg;
-   os_buf_t                *p_rta;
 
    p_apmx->timeout_id = UINT32_MAX;
    if (p_apmx->apms_state == PF_APMS_STATE_WTACK)
@@ -580,12 +578,9 @@ static void pf_alarm_apms_timeout(
 
          if (pf_scheduler_add(net, p_apmx->timeout_us,
             apmx_sync_name, pf_alarm_apms_timeout, p_apmx, &p_apmx->timeout_id) != 0)
-         {
-            LOG_ERROR(PF_ALARM_LOG, "pf_alarm(%d): Error from pf_scheduler_add\n", __LINE__);
-         }
-         else
          {
             p_apmx->timeout_id = UINT32_MAX;
+            LOG_ERROR(PF_ALARM_LOG, "pf_alarm(%d): Error from pf_scheduler_add\n", __LINE__);
          }
       }
       else
@@ -597,13 +592,8 @@ static void pf_alarm_apms_timeout(
           *
           * There is no need to do anything more here!!!
           */
-         LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Free saved RTA buffer %p\n", __LINE__, p_apmx->p_rta);
-         if (p_apmx->p_rta != NULL)
-         {
-            p_rta = p_apmx->p_rta;
-            p_apmx->p_rta = NULL;
-            os_buf_free(p_rta);
-         }
+         LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Release saved RTA buffer %p\n", __LINE__, p_apmx->p_rta);
+         p_apmx->p_rta = NULL;
 
          pf_alarm_alpmi_apms_a_data_cnf(net, p_apmx, -1);
          pf_alarm_alpmr_apms_a_data_cnf(net, p_apmx, -1);
@@ -619,14 +609,57 @@ static void pf_alarm_apms_timeout(
    else
    {
       LOG_DEBUG(PF_ALARM_LOG, "pf_alarm(%d): Timeout in state %s\n", __LINE__, pf_alarm_apms_state_to_string(p_apmx->apms_state));
-      LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Free saved RTA buffer %p\n", __LINE__, p_apmx->p_rta);
-      if (p_apmx->p_rta != NULL)
-      {
-         p_rta = p_apmx->p_rta;
-         p_apmx->p_rta = NULL;
-         os_buf_free(p_rta);
-      }
+      LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Release saved RTA buffer %p\n", __LINE__, p_apmx->p_rta);
+      p_apmx->p_rta = NULL;
+   }
+}
+
+/**
+ * @internal
+ * Allocate a transmit frame for an APMX instance.
+ *
+ * The Ethernet header does not change while the AR is open, so it is
+ * inserted here once. Each RTA-PDU is then written after it.
+ * @param net              InOut: The p-net stack instance
+ * @param p_apmx           In:   The APMX instance.
+ * @return  The frame, or NULL if out of memory.
+ */
+static os_buf_t *pf_alarm_frame_alloc(
+   pnet_t                  *net,
+   pf_apmx_t               *p_apmx)
+{
+   os_buf_t                *p_frame;
+   uint8_t                 *p_buf;
+   uint16_t                pos = 0;
+   const pnet_cfg_t        *p_cfg = NULL;
+
+   pf_fspm_get_default_cfg(net, &p_cfg);
+
+   LOG_DEBUG(PF_AL_BUF_LOG, "Alarm(%d): Allocate RTA buffer\n", __LINE__);
+   p_frame = os_buf_alloc(PF_ALARM_FRAME_SIZE);
+   if (p_frame == NULL)
+   {
+      LOG_ERROR(PF_ALARM_LOG, "Alarm(%d): No buffer for alarm frames\n", __LINE__);
+   }
+   else
+   {
+      p_buf = p_frame->payload;
+
+      /* Add Ethernet header */
+      pf_put_mem(&p_apmx->da, sizeof(p_apmx->da), PF_ALARM_FRAME_SIZE, p_buf, &pos);
+      pf_put_mem(p_cfg->eth_addr.addr, sizeof(pnet_ethaddr_t), PF_ALARM_FRAME_SIZE, p_buf, &pos); /* Interface MAC address */
+
+      /* Add VLAN */
+      pf_put_uint16(true, OS_ETHTYPE_VLAN, PF_ALARM_FRAME_SIZE, p_buf, &pos);       /* VLAN LT */
+      pf_put_uint16(true, p_apmx->vlan_prio, PF_ALARM_FRAME_SIZE, p_buf, &pos);
+
+      pf_put_uint16(true, OS_ETHTYPE_PROFINET, PF_ALARM_FRAME_SIZE, p_buf, &pos);   /* Real LT */
+      pf_put_uint16(true, p_apmx->frame_id, PF_ALARM_FRAME_SIZE, p_buf, &pos);      /* FrameID */
+
+      p_frame->len = pos;
    }
+
+   return p_frame;
 }
 
 /**
@@ -696,8 +729,21 @@ static int pf_alarm_apmx_activate(
          {
             p_ar->apmx[ix].p_alarm_q = os_mbox_create(PNET_MAX_ALARMS);
          }
-         memset(p_ar->apmx[ix].apmr_msg, 0, sizeof(p_ar->apmx[ix].apmr_msg));
-         p_ar->apmx[ix].apmr_msg_nbr = 0;
+         p_ar->apmx[ix].apmr_drop_cnt = 0;
+         p_ar->apmx[ix].rtt_cnt = 0;
+         p_ar->apmx[ix].rtt_last = 0;
+         p_ar->apmx[ix].rtt_max = 0;
+
+         /* Transmit frames, with the header for this AR */
+         if (p_ar->apmx[ix].p_tack_frame == NULL)
+         {
+            p_ar->apmx[ix].p_tack_frame = pf_alarm_frame_alloc(net, &p_ar->apmx[ix]);
+         }
+         if (p_ar->apmx[ix].p_frame == NULL)
+         {
+            p_ar->apmx[ix].p_frame = pf_alarm_frame_alloc(net, &p_ar->apmx[ix]);
+         }
+         p_ar->apmx[ix].p_rta = NULL;
 
          p_ar->apmx[ix].timeout_us = 100*1000*p_ar->alarm_cr_request.rta_timeout_factor;
 
@@ -732,7 +778,6 @@ static int pf_alarm_apms_a_data_ind(
    pf_alarm_fixed_t        *p_fixed)
 {
    int                     ret = -1;
-   os_buf_t                *p_rta;
 
    if ((p_fixed->pdu_type.type == PF_RTA_PDU_TYPE_ACK) ||
        (p_fixed->pdu_type.type == PF_RTA_PDU_TYPE_DATA))
@@ -745,13 +790,15 @@ static int pf_alarm_apms_a_data_ind(
             p_apmx->send_seq_count_o = p_apmx->send_seq_count;
             p_apmx->send_seq_count = (p_apmx->send_seq_count + 1) & 0x7fff;
 
-            LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Free saved RTA buffer %p\n", __LINE__, p_apmx->p_rta);
-            if (p_apmx->p_rta != NULL)
+            p_apmx->rtt_last = os_get_current_time_us() - p_apmx->rta_send_time;
+            if (p_apmx->rtt_last > p_apmx->rtt_max)
             {
-               p_rta = p_apmx->p_rta;
-               p_apmx->p_rta = NULL;
-               os_buf_free(p_rta);
+               p_apmx->rtt_max = p_apmx->rtt_last;
             }
+            p_apmx->rtt_cnt++;
+
+            LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Release saved RTA buffer %p\n", __LINE__, p_apmx->p_rta);
+            p_apmx->p_rta = NULL;
 
             pf_alarm_alpmi_apms_a_data_cnf(net, p_apmx, 0);
             pf_alarm_alpmr_apms_a_data_cnf(net, p_apmx, 0);
@@ -828,10 +875,7 @@ static int pf_alarm_apms_a_data_req(
    uint16_t                var_part_len;
    os_buf_t                *p_rta;
    uint8_t                 *p_buf = NULL;
-   uint16_t                pos = 0;
-   const pnet_cfg_t        *p_cfg = NULL;
-
-   pf_fspm_get_default_cfg(net, &p_cfg);
+   uint16_t                pos = PF_ALARM_HEADER_SIZE;
 
    if (p_apmx->p_ar->alarm_cr_request.alarm_cr_properties.transport_udp == true)
    {
@@ -839,70 +883,68 @@ static int pf_alarm_apms_a_data_req(
    }
    else
    {
-      LOG_DEBUG(PF_AL_BUF_LOG, "Alarm(%d): Allocate RTA buffer\n", __LINE__);
-      p_rta = os_buf_alloc(1500);
+      /* A PDU with TACK is kept in its frame until it is ACKed */
+      if ((p_fixed->add_flags.tack == true) && (p_apmx->p_rta == NULL))
+      {
+         p_rta = p_apmx->p_tack_frame;
+      }
+      else
+      {
+         p_rta = p_apmx->p_frame;
+      }
+
       if (p_rta == NULL)
       {
          LOG_ERROR(PF_ALARM_LOG, "Alarm(%d): No buffer for alarm notification\n", __LINE__);
       }
       else
       {
+         /* The Ethernet header is already in place */
          p_buf = p_rta->payload;
-         if (p_buf == NULL)
-         {
-            LOG_ERROR(PF_ALARM_LOG, "Alarm(%d): No payload buffer for alarm notification\n", __LINE__);
-         }
-         else
-         {
-            /* Add Ethernet header */
-            pf_put_mem(&p_apmx->da, sizeof(p_apmx->da), 1500, p_buf, &pos);
-            memcpy(&p_buf[pos], p_cfg->eth_addr.addr, sizeof(pnet_ethaddr_t)); /* Interface MAC address */
-            pos += sizeof(pnet_ethaddr_t);
 
-            /* Add VLAN */
-            pf_put_uint16(true, OS_ETHTYPE_VLAN, 1500, p_buf, &pos);       /* VLAN LT */
-            pf_put_uint16(true, p_apmx->vlan_prio, 1500, p_buf, &pos);
+         pf_put_alarm_fixed(true, p_fixed, PF_ALARM_FRAME_SIZE, p_buf, &pos);
 
-            pf_put_uint16(true, OS_ETHTYPE_PROFINET, 1500, p_buf, &pos);   /* Real LT */
-            pf_put_uint16(true, p_apmx->frame_id, 1500, p_buf, &pos); /* FrameID */
+         var_part_len_pos = pos;
+         pf_put_uint16(true, 0, PF_ALARM_FRAME_SIZE, p_buf, &pos);      /* var_part_len is unknown here */
 
-            pf_put_alarm_fixed(true, p_fixed, 1500, p_buf, &pos);
-
-            var_part_len_pos = pos;
-            pf_put_uint16(true, 0, 1500, p_buf, &pos);                     /* var_part_len is unknown here */
-
-            if (p_fixed->pdu_type.type == PF_RTA_PDU_TYPE_DATA)
+         if (p_fixed->pdu_type.type == PF_RTA_PDU_TYPE_DATA)
+         {
+            if (p_pnio_status != NULL)
             {
-               if (p_pnio_status != NULL)
-               {
-                  /* Send an AlarmAck DATA message */
-                  pf_put_alarm_block(true, p_apmx->block_type_alarm_ack,
-                     p_alarm_data, maint_status,
-                     0, 0, NULL, 1500, p_buf, &pos);
+               /* Send an AlarmAck DATA message */
+               pf_put_alarm_block(true, p_apmx->block_type_alarm_ack,
+                  p_alarm_data, maint_status,
+                  0, 0, NULL, PF_ALARM_FRAME_SIZE, p_buf, &pos);
 
-                  /* Append the PNIO status */
-                  pf_put_pnet_status(true, p_pnio_status, 1500, p_buf, &pos);
-               }
-               else
-               {
-                  /* Send an AlarmNotification DATA message */
-                  pf_put_alarm_block(true, p_apmx->block_type_alarm_notify,
-                     p_alarm_data, maint_status,
-                     payload_usi, payload_len, p_payload, 1500, p_buf, &pos);
-               }
-            }
-            else if (p_fixed->pdu_type.type == PF_RTA_PDU_TYPE_ERR)
-            {
-               pf_put_pnet_status(true, p_pnio_status, 1500, p_buf, &pos);
+               /* Append the PNIO status */
+               pf_put_pnet_status(true, p_pnio_status, PF_ALARM_FRAME_SIZE, p_buf, &pos);
             }
             else
             {
-               /* NACK or ACk does not take any var part. */
+               /* Send an AlarmNotification DATA message */
+               pf_put_alarm_block(true, p_apmx->block_type_alarm_notify,
+                  p_alarm_data, maint_status,
+                  payload_usi, payload_len, p_payload, PF_ALARM_FRAME_SIZE, p_buf, &pos);
             }
+         }
+         else if (p_fixed->pdu_type.type == PF_RTA_PDU_TYPE_ERR)
+         {
+            pf_put_pnet_status(true, p_pnio_status, PF_ALARM_FRAME_SIZE, p_buf, &pos);
+         }
+         else
+         {
+            /* NACK or ACk does not take any var part. */
+         }
 
+         if (pf_put_overflow(PF_ALARM_FRAME_SIZE, pos))
+         {
+            LOG_ERROR(PF_ALARM_LOG, "pf_alarm(%d): RTA-PDU does not fit in frame\n", __LINE__);
+         }
+         else
+         {
             /* Finally insert the correct VarPartLen */
             var_part_len = pos - (var_part_len_pos + sizeof(var_part_len));
-            pf_put_uint16(true, var_part_len, 1500, p_buf, &var_part_len_pos);
+            pf_put_uint16(true, var_part_len, PF_ALARM_FRAME_SIZE, p_buf, &var_part_len_pos);
 
             p_rta->len = pos;
             if (os_eth_send(p_apmx->p_ar->p_sess->eth_handle, p_rta) <= 0)
@@ -913,27 +955,25 @@ static int pf_alarm_apms_a_data_req(
             {
                ret = 0;
             }
-         }
 
-         if (p_fixed->add_flags.tack == true)
-         {
-            if (p_apmx->p_rta == NULL)
+            if (p_fixed->add_flags.tack == true)
             {
-               LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Save RTA buffer\n", __LINE__);
-               p_apmx->p_rta = p_rta;
+               if (p_rta == p_apmx->p_tack_frame)
+               {
+                  LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Save RTA buffer\n", __LINE__);
+                  p_apmx->p_rta = p_rta;
+                  p_apmx->rta_send_time = os_get_current_time_us();
+               }
+               else
+               {
+                  LOG_ERROR(PF_ALARM_LOG, "pf_alarm(%d): RTA buffer with TACK lost!!\n", __LINE__);
+               }
             }
             else
             {
-               LOG_ERROR(PF_ALARM_LOG, "pf_alarm(%d): RTA buffer with TACK lost!!\n", __LINE__);
-               os_buf_free(p_rta);
+               /* ACK, NAK and ERR buffers are not saved for retransmission. */
             }
          }
-         else
-         {
-            /* ACK, NAK and ERR buffers are not saved for retransmission. */
-            LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Free unsaved RTA buffer\n", __LINE__);
-            os_buf_free(p_rta);
-         }
       }
    }
 
@@ -1019,7 +1059,7 @@ static int pf_alarm_apmx_close(
 {
    uint16_t                ix;
    pnet_pnio_status_t      pnio_status;
-   os_buf_t                *p_rta;
+   os_buf_t                *p_buf;
 
    /* Send low prio CLOSE alarm first */
    if (p_ar->apmx[0].apms_state != PF_APMS_STATE_CLOSED)
@@ -1057,12 +1097,17 @@ static int pf_alarm_apmx_close(
          p_ar->apmx[ix].p_ar = NULL;
          p_ar->apmx[ix].apms_state = PF_APMS_STATE_CLOSED;
       }
-      LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Free saved RTA buffer %p\n", __LINE__, p_ar->apmx[ix].p_rta);
-      if (p_ar->apmx[ix].p_rta != NULL)
+      LOG_DEBUG(PF_AL_BUF_LOG, "pf_alarm(%d): Free RTA buffers\n", __LINE__);
+      p_ar->apmx[ix].p_rta = NULL;
+      if (p_ar->apmx[ix].p_tack_frame != NULL)
       {
-         p_rta = p_ar->apmx[ix].p_rta;
-         p_ar->apmx[ix].p_rta = NULL;
-         os_buf_free(p_rta);
+         os_buf_free(p_ar->apmx[ix].p_tack_frame);
+         p_ar->apmx[ix].p_tack_frame = NULL;
+      }
+      if (p_ar->apmx[ix].p_frame != NULL)
+      {
+         os_buf_free(p_ar->apmx[ix].p_frame);
+         p_ar->apmx[ix].p_frame = NULL;
       }
 
       if (p_ar->apmx[ix].apmr_state != PF_APMR_STATE_CLOSED)
@@ -1071,7 +1116,16 @@ static int pf_alarm_apmx_close(
 
          if (p_ar->apmx[ix].p_alarm_q != NULL)
          {
+            /* Free the PDUs that were never handled */
+            while (os_mbox_fetch(p_ar->apmx[ix].p_alarm_q, (void **)&p_buf, 0) == 0)
+            {
+               if (p_buf != NULL)
+               {
+                  os_buf_free(p_buf);
+               }
+            }
             os_mbox_destroy(p_ar->apmx[ix].p_alarm_q);
+            p_ar->apmx[ix].p_alarm_q = NULL;
          }
       }
    }
@@ -1291,7 +1345,8 @@ static int pf_alarm_apmr_a_data_ind(
 /**
  * Handle the reception of ALARM messages for one AR instance.
  *
- * When called this function reads max 1 alarm message from its input queue.
+ * When called this function reads max PNET_MAX_ALARM_DRAIN alarm messages
+ * from each of its input queues.
  * The message is processed in APMR/ALPMR and indications may be sent to the
  * application.
  *
@@ -1307,13 +1362,13 @@ static int pf_alarm_apmr_periodic(
    int                     ret = 0;
    pf_apmx_t               *p_apmx;
    uint16_t                ix;
-   pf_apmr_msg_t           *p_alarm_msg;
    os_buf_t                *p_buf;
    pf_alarm_fixed_t        fixed;
    uint16_t                var_part_len;
    pnet_pnio_status_t      pnio_status;
    pf_get_info_t           get_info;
    uint16_t                pos;
+   uint16_t                cnt;
 
    /*
     * Periodic is run cyclically. It may run for some time.
@@ -1325,15 +1380,16 @@ static int pf_alarm_apmr_periodic(
    {
       p_apmx = &p_ar->apmx[ix];
       p_buf = NULL;
+      cnt = 0;
       while ((ret == 0) &&
+             (cnt++ < PNET_MAX_ALARM_DRAIN) &&
              (p_apmx->apmr_state != PF_APMR_STATE_CLOSED) &&
-             (os_mbox_fetch(p_apmx->p_alarm_q, (void **)&p_alarm_msg, 0) == 0))
+             (os_mbox_fetch(p_apmx->p_alarm_q, (void **)&p_buf, 0) == 0))
       {
-         if (p_alarm_msg != NULL)
+         if (p_buf != NULL)
          {
             /* Got something - extract! */
-            p_buf = p_alarm_msg->p_buf;
-            pos = p_alarm_msg->frame_id_pos + sizeof(uint16_t); /* Skip frame_id */
+            pos = pf_eth_frame_id_pos(p_buf) + sizeof(uint16_t); /* Skip frame_id */
 
             get_info.result = PF_PARSE_OK;
             get_info.is_big_endian = true;
@@ -1607,7 +1663,7 @@ int pf_alarm_periodic(
 
    if (net->global_alarm_enable == true)
    {
-      for (ix = 0; ix < PNET_MAX_AR; ix++)
+      for (ix = 0; ix < net->cmrpc_max_ar; ix++)
       {
          p_ar = pf_ar_find_by_index(net, ix);
          if ((p_ar != NULL) && (p_ar->in_use == true))
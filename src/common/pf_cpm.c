@@ -17,8 +17,12 @@
  * @file
  * @brief Implements the Cyclic Consumer Provider Protocol Machine (CPM)
  *
- * A global mutex is used instead of a per-instance mutex.
- * The locking time is very low so it should not be very congested.
+ * Received frames are handed over to the application by atomically
+ * exchanging a buffer pointer per CPM instance. The receiver never waits
+ * for the application.
+ *
+ * A global mutex serializes the application calls, which read the
+ * application buffer. It is never taken by the receiver.
  * The mutex is created on the first call to pf_cpm_create and deleted on
  * the last call to pf_cpm_close.
  * Keep track of how many instances exist and delete the mutex when the
@@ -118,7 +122,6 @@ static void pf_cpm_control_interval_expired(
    uint32_t                start = os_get_current_time_us();
    uint32_t                exec;
 
-   p_iocr->cpm.ci_timer = UINT32_MAX;
    if (p_iocr->cpm.ci_running == true) /* Timer running */
    {
       switch (p_iocr->cpm.state)
@@ -144,21 +147,13 @@ static void pf_cpm_control_interval_expired(
          }
          break;
       }
+   }
 
-      if (p_iocr->cpm.ci_running == true)
-      {
-         /* Timer auto-reload */
-         if (pf_scheduler_add(net, p_iocr->cpm.control_interval, cpm_sync_name,
-            pf_cpm_control_interval_expired, arg, &p_iocr->cpm.ci_timer) != 0)
-         {
-            p_iocr->cpm.ci_timer = UINT32_MAX;
-
-            LOG_ERROR(PNET_LOG, "CPM(%d): Timeout not started\n", __LINE__);
-            p_iocr->p_ar->err_cls = PNET_ERROR_CODE_1_CPM;
-            p_iocr->p_ar->err_code = PNET_ERROR_CODE_2_CPM_INVALID;
-            pf_cmsu_cpm_error_ind(net, p_iocr->p_ar, p_iocr->p_ar->err_cls, p_iocr->p_ar->err_code);
-         }
-      }
+   /* The timer auto-reloads until stopped */
+   if ((p_iocr->cpm.ci_running == false) && (p_iocr->cpm.ci_timer != UINT32_MAX))
+   {
+      pf_scheduler_remove(net, cpm_sync_name, p_iocr->cpm.ci_timer);
+      p_iocr->cpm.ci_timer = UINT32_MAX;
    }
    exec = os_get_current_time_us() - start;
    if (exec > p_iocr->cpm.max_exec)
@@ -236,10 +231,12 @@ int pf_cpm_close_req(
    if (p_cpm->p_buffer_cpm != NULL)
    {
       os_buf_free(p_cpm->p_buffer_cpm);
+      p_cpm->p_buffer_cpm = NULL;
    }
    if (p_cpm->p_buffer_app != NULL)
    {
       os_buf_free(p_cpm->p_buffer_app);
+      p_cpm->p_buffer_app = NULL;
    }
 
    cnt = atomic_fetch_sub(&net->cpm_instance_cnt, 1);
@@ -306,30 +303,30 @@ static int pf_cpm_check_src_addr(
 
 /**
  * @internal
- * Replace the current buffer with a newer one and set the new_buf flag.
+ * Hand over a received buffer to the application.
+ * Called by the receiver. Never blocks.
  * @param net              InOut: The p-net stack instance
  * @param p_cpm            In:   The CPM instance.
  * @param pp_buf           In:   The new buffer.
- *                         Out:  The previous buffer.
+ *                         Out:  The previous unread buffer, or NULL.
  */
 static void pf_cpm_put_buf(
    pnet_t                  *net,
    pf_cpm_t                *p_cpm,
    os_buf_t                **pp_buf)
 {
-   void *p;
-
-   os_mutex_lock(net->cpm_buf_lock);
-   p = p_cpm->p_buffer_cpm;
-   p_cpm->p_buffer_cpm = *pp_buf;
-   *pp_buf = p;
-   p_cpm->new_buf = true;
-   os_mutex_unlock(net->cpm_buf_lock);
+   *pp_buf = CC_ATOMIC_XCHG_PTR(&p_cpm->p_buffer_cpm, *pp_buf);
+   p_cpm->put_cnt++;
+   if (*pp_buf != NULL)
+   {
+      p_cpm->put_overwrite_cnt++;
+   }
 }
 
 /**
  * @internal
  * Make sure that p_buffer_app points to the newest received buffer.
+ * Must be called with cpm_buf_lock held.
  * @param net              InOut: The p-net stack instance
  * @param p_cpm            In:  The CPM instance.
  * @param p_new_flag       Out: true if new data has been received.
@@ -343,20 +340,22 @@ static void pf_cpm_get_buf(
 {
    void *p;
 
-   os_mutex_lock(net->cpm_buf_lock);
-   if (p_cpm->new_buf == true)
+   p = CC_ATOMIC_XCHG_PTR(&p_cpm->p_buffer_cpm, NULL);
+   if (p != NULL)
    {
       *p_new_flag = true;
-      p = p_cpm->p_buffer_app;
-      p_cpm->p_buffer_app = p_cpm->p_buffer_cpm;
-      p_cpm->p_buffer_cpm = p;
-      p_cpm->new_buf = false;
+      p_cpm->get_new_cnt++;
+      if (p_cpm->p_buffer_app != NULL)
+      {
+         os_buf_free(p_cpm->p_buffer_app);
+      }
+      p_cpm->p_buffer_app = p;
    }
    else
    {
       *p_new_flag = false;
+      p_cpm->get_old_cnt++;
    }
-   os_mutex_unlock(net->cpm_buf_lock);
 
    if (p_cpm->p_buffer_app != NULL)
    {
@@ -549,6 +548,10 @@ int pf_cpm_activate_req(
 
       p_cpm->dht = 0;
       p_cpm->recv_cnt = 0;
+      p_cpm->put_cnt = 0;
+      p_cpm->put_overwrite_cnt = 0;
+      p_cpm->get_new_cnt = 0;
+      p_cpm->get_old_cnt = 0;
 
       memcpy(&p_cpm->sa, &p_ar->ar_param.cm_initiator_mac_add, sizeof(p_cpm->sa));
 
@@ -576,7 +579,7 @@ int pf_cpm_activate_req(
       /* ToDo: Shall be aligned with local send clock or PTCP (Does it matter for RTClass1/2?) */
       pf_cpm_set_state(p_cpm, PF_CPM_STATE_FRUN);
       p_cpm->ci_running = true;
-      ret = pf_scheduler_add(net, p_cpm->control_interval, cpm_sync_name,
+      ret = pf_scheduler_add_periodic(net, p_cpm->control_interval, cpm_sync_name,
          pf_cpm_control_interval_expired, p_iocr, &p_cpm->ci_timer);
       if (ret != 0)
       {
@@ -606,75 +609,82 @@ int pf_cpm_activate_req(
 
 /**
  * @internal
- * Find the AR, input IOCR and IODATA object instances for the specified sub-slot.
+ * Get the data and IOPS of a sub-module from the CPM buffer.
  * @param net              InOut: The p-net stack instance
- * @param api_id           In:   The API id.
- * @param slot_nbr         In:   The slot number.
- * @param subslot_nbr      In:   The sub-slot number.
- * @param pp_ar            Out:  The AR instance.
- * @param pp_iocr          Out:  The IOCR instance.
- * @param pp_iodata        Out:  The IODATA object instance.
- * @return  0  If the information has been found.
- *          -1 If the information was not found.
+ * @param p_ar             In:   The AR instance.
+ * @param p_iocr           In:   The IOCR instance.
+ * @param p_iodata         In:   The IODATA object instance.
+ * @param p_new_flag       Out:  true if new data was received.
+ * @param p_data           Out:  The received data.
+ * @param p_data_len       In:   Size of the buffer at p_data.
+ *                         Out:  Actual length of the data.
+ * @param p_iops           Out:  The received IOPS.
+ * @param p_iops_len       In:   Size of the buffer at p_iops.
+ *                         Out:  Actual length of the IOPS.
+ * @return  0  on success.
+ *          -1 if an error occurred.
  */
-static int pf_cpm_get_ar_iocr_desc(
+static int pf_cpm_get_data_and_iops_desc(
    pnet_t                  *net,
-   uint32_t                api_id,
-   uint16_t                slot_nbr,
-   uint16_t                subslot_nbr,
-   pf_ar_t                 **pp_ar,
-   pf_iocr_t               **pp_iocr,
-   pf_iodata_object_t      **pp_iodata)
+   pf_ar_t                 *p_ar,
+   pf_iocr_t               *p_iocr,
+   pf_iodata_object_t      *p_iodata,
+   bool                    *p_new_flag,
+   uint8_t                 *p_data,
+   uint16_t                *p_data_len,
+   uint8_t                 *p_iops,
+   uint8_t                 *p_iops_len)
 {
    int                     ret = -1;
-   uint32_t                crep;
-   uint16_t                iodata_ix;
-   pf_subslot_t            *p_subslot = NULL;
-   pf_ar_t                 *p_ar = NULL;
-   pf_iocr_t               *p_iocr = NULL;
-   bool                    found = false;
-
-   if (pf_cmdev_get_subslot_full(net, api_id, slot_nbr, subslot_nbr, &p_subslot) == 0)
-   {
-      p_ar = p_subslot->p_ar;
-   }
+   uint8_t                 *p_buffer = NULL;
 
-   if (p_ar == NULL)
-   {
-      LOG_DEBUG(PF_PPM_LOG, "CPM(%d): No AR set in sub-slot\n", __LINE__);
-   }
-   else
+   switch (p_iocr->cpm.state)
    {
-      /*
-       * Search the AR for an INPUT CR or an MC provider CR containing the
-       * sub-slot.
-       */
-      for (crep = 0; ((found == false) && (crep < p_ar->nbr_iocrs)); crep++)
+   case PF_CPM_STATE_W_START:
+      p_ar->err_cls = PNET_ERROR_CODE_1_CPM;
+      p_ar->err_code = PNET_ERROR_CODE_2_CPM_INVALID_STATE;
+      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Get data in wrong state: %u\n", __LINE__, p_iocr->cpm.state);
+      break;
+   case PF_CPM_STATE_FRUN:
+   case PF_CPM_STATE_RUN:
+      if (*p_data_len < p_iodata->data_length)
       {
-         if ((p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_OUTPUT) ||
-             (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_CONSUMER))
+         *p_data_len = 0;
+         *p_new_flag = false;
+         LOG_ERROR(PF_CPM_LOG, "CPM(%d): Buffer too small in get data\n", __LINE__);
+      }
+      else
+      {
+         os_mutex_lock(net->cpm_buf_lock);
+         pf_cpm_get_buf(net, &p_iocr->cpm, p_new_flag, &p_buffer);
+
+         if (p_buffer != NULL)
          {
-            p_iocr = &p_ar->iocrs[crep];
-            for (iodata_ix = 0; ((found == false) && (iodata_ix < p_iocr->nbr_data_desc)); iodata_ix++)
+            if (p_iodata->data_length > 0)
             {
-               if ((p_iocr->data_desc[iodata_ix].in_use == true) &&
-                   (p_iocr->data_desc[iodata_ix].api_id == api_id) &&
-                   (p_iocr->data_desc[iodata_ix].slot_nbr == slot_nbr) &&
-                   (p_iocr->data_desc[iodata_ix].subslot_nbr == subslot_nbr))
-               {
-                  *pp_iodata = &p_iocr->data_desc[iodata_ix];
-                  *pp_iocr = p_iocr;
-                  *pp_ar = p_ar;
-                  found = true;
-               }
+               memcpy(p_data, &p_buffer[p_iodata->data_offset], p_iodata->data_length);
             }
+            if (p_iodata->iops_length > 0)
+            {
+               memcpy(p_iops, &p_buffer[p_iodata->data_offset + p_iodata->data_length], p_iodata->iops_length);
+            }
+
+            *p_data_len = p_iodata->data_length;
+            *p_iops_len = (uint8_t)p_iodata->iops_length,
+            ret = 0;
+         }
+         else
+         {
+            *p_data_len = 0;
+            *p_new_flag = false;
+            LOG_DEBUG(PF_CPM_LOG, "CPM(%d): No data received in get data\n", __LINE__);
          }
+         os_mutex_unlock(net->cpm_buf_lock);
       }
-   }
-
-   if (found == true)
-   {
-      ret = 0;
+      break;
+   default:
+      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Set data in wrong state: %u\n", __LINE__, p_iocr->cpm.state);
+      break;
    }
 
    return ret;
@@ -695,63 +705,107 @@ int pf_cpm_get_data_and_iops(
    pf_iocr_t               *p_iocr = NULL;
    pf_iodata_object_t      *p_iodata = NULL;
    pf_ar_t                 *p_ar = NULL;
+
+   if (pf_cmdev_get_io_desc(net, api_id, slot_nbr, subslot_nbr, PF_DIRECTION_OUTPUT, &p_ar, &p_iocr, &p_iodata) == 0)
+   {
+      ret = pf_cpm_get_data_and_iops_desc(net, p_ar, p_iocr, p_iodata, p_new_flag, p_data, p_data_len, p_iops, p_iops_len);
+   }
+   else
+   {
+      /* May happen after an ABORT */
+      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): No data descriptor found in set data\n", __LINE__);
+   }
+
+   return ret;
+}
+
+int pf_cpm_io_get_data_and_iops(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   bool                    *p_new_flag,
+   uint8_t                 *p_data,
+   uint16_t                *p_data_len,
+   uint8_t                 *p_iops,
+   uint8_t                 *p_iops_len)
+{
+   int                     ret = -1;
+   pf_iocr_t               *p_iocr = NULL;
+   pf_iodata_object_t      *p_iodata = NULL;
+   pf_ar_t                 *p_ar = NULL;
+
+   if (pf_cmdev_get_io_desc_by_handle(net, handle, PF_DIRECTION_OUTPUT, &p_ar, &p_iocr, &p_iodata) == 0)
+   {
+      ret = pf_cpm_get_data_and_iops_desc(net, p_ar, p_iocr, p_iodata, p_new_flag, p_data, p_data_len, p_iops, p_iops_len);
+   }
+   else
+   {
+      /* May happen after an ABORT */
+      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Invalid IO handle 0x%08x\n", __LINE__, (unsigned)handle);
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Get the IOCS of a sub-module from the CPM buffer.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             In:   The AR instance.
+ * @param p_iocr           In:   The IOCR instance.
+ * @param p_iodata         In:   The IODATA object instance.
+ * @param p_iocs           Out:  The received IOCS.
+ * @param p_iocs_len       In:   Size of the buffer at p_iocs.
+ *                         Out:  Actual length of the IOCS.
+ * @return  0  on success.
+ *          -1 if an error occurred.
+ */
+static int pf_cpm_get_iocs_desc(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar,
+   pf_iocr_t               *p_iocr,
+   pf_iodata_object_t      *p_iodata,
+   uint8_t                 *p_iocs,
+   uint8_t                 *p_iocs_len)
+{
+   int                     ret = -1;
    uint8_t                 *p_buffer = NULL;
+   bool                    new_flag = false;
 
-   if (pf_cpm_get_ar_iocr_desc(net, api_id, slot_nbr, subslot_nbr, &p_ar, &p_iocr, &p_iodata) == 0)
+   switch (p_iocr->cpm.state)
    {
-      switch (p_iocr->cpm.state)
+   case PF_CPM_STATE_W_START:
+      p_ar->err_cls = PNET_ERROR_CODE_1_CPM;
+      p_ar->err_code = PNET_ERROR_CODE_2_CPM_INVALID_STATE;
+      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Get iocs in wrong state: %u\n", __LINE__, p_iocr->cpm.state);
+      break;
+   case PF_CPM_STATE_FRUN:
+   case PF_CPM_STATE_RUN:
+      if (p_iodata->iocs_length == 0)
       {
-      case PF_CPM_STATE_W_START:
-         p_ar->err_cls = PNET_ERROR_CODE_1_CPM;
-         p_ar->err_code = PNET_ERROR_CODE_2_CPM_INVALID_STATE;
-         LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Get data in wrong state: %u\n", __LINE__, p_iocr->cpm.state);
-         break;
-      case PF_CPM_STATE_FRUN:
-      case PF_CPM_STATE_RUN:
-         if (*p_data_len < p_iodata->data_length)
+         LOG_DEBUG(PF_CPM_LOG, "CPM(%d): iocs_length is zero in get iocs\n", __LINE__);
+      }
+      else
+      {
+         os_mutex_lock(net->cpm_buf_lock);
+         pf_cpm_get_buf(net, &p_iocr->cpm, &new_flag, &p_buffer);
+
+         if (p_buffer != NULL)
          {
-            *p_data_len = 0;
-            *p_new_flag = false;
-            LOG_ERROR(PF_CPM_LOG, "CPM(%d): Buffer too small in get data\n", __LINE__);
+            memcpy(p_iocs, &p_buffer[p_iodata->iocs_offset], p_iodata->iocs_length);
+
+            *p_iocs_len = (uint8_t)p_iodata->iocs_length,
+            ret = 0;
          }
          else
          {
-            pf_cpm_get_buf(net, &p_iocr->cpm, p_new_flag, &p_buffer);
-
-            if (p_buffer != NULL)
-            {
-               os_mutex_lock(net->cpm_buf_lock);
-               if (p_iodata->data_length > 0)
-               {
-                  memcpy(p_data, &p_buffer[p_iodata->data_offset], p_iodata->data_length);
-               }
-               if (p_iodata->iops_length > 0)
-               {
-                  memcpy(p_iops, &p_buffer[p_iodata->data_offset + p_iodata->data_length], p_iodata->iops_length);
-               }
-               os_mutex_unlock(net->cpm_buf_lock);
-
-               *p_data_len = p_iodata->data_length;
-               *p_iops_len = (uint8_t)p_iodata->iops_length,
-               ret = 0;
-            }
-            else
-            {
-               *p_data_len = 0;
-               *p_new_flag = false;
-               LOG_DEBUG(PF_CPM_LOG, "CPM(%d): No data received in get data\n", __LINE__);
-            }
+            LOG_DEBUG(PF_CPM_LOG, "CPM(%d): No data received in get iocs\n", __LINE__);
          }
-         break;
-      default:
-         LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Set data in wrong state: %u\n", __LINE__, p_iocr->cpm.state);
-         break;
+         os_mutex_unlock(net->cpm_buf_lock);
       }
-   }
-   else
-   {
-      /* May happen after an ABORT */
-      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): No data descriptor found in set data\n", __LINE__);
+      break;
+   default:
+      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Get iocs in wrong state: %u\n", __LINE__, (unsigned)p_iocr->cpm.state);
+      break;
    }
 
    return ret;
@@ -769,52 +823,39 @@ int pf_cpm_get_iocs(
    pf_iocr_t               *p_iocr = NULL;
    pf_iodata_object_t      *p_iodata = NULL;
    pf_ar_t                 *p_ar = NULL;
-   uint8_t                 *p_buffer = NULL;
-   bool                    new_flag = false;
 
-   if (pf_cpm_get_ar_iocr_desc(net, api_id, slot_nbr, subslot_nbr, &p_ar, &p_iocr, &p_iodata) == 0)
+   if (pf_cmdev_get_io_desc(net, api_id, slot_nbr, subslot_nbr, PF_DIRECTION_OUTPUT, &p_ar, &p_iocr, &p_iodata) == 0)
    {
-      switch (p_iocr->cpm.state)
-      {
-      case PF_CPM_STATE_W_START:
-         p_ar->err_cls = PNET_ERROR_CODE_1_CPM;
-         p_ar->err_code = PNET_ERROR_CODE_2_CPM_INVALID_STATE;
-         LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Get iocs in wrong state: %u\n", __LINE__, p_iocr->cpm.state);
-         break;
-      case PF_CPM_STATE_FRUN:
-      case PF_CPM_STATE_RUN:
-         if (p_iodata->iocs_length == 0)
-         {
-            LOG_DEBUG(PF_CPM_LOG, "CPM(%d): iocs_length is zero in get iocs\n", __LINE__);
-         }
-         else
-         {
-            pf_cpm_get_buf(net, &p_iocr->cpm, &new_flag, &p_buffer);
+      ret = pf_cpm_get_iocs_desc(net, p_ar, p_iocr, p_iodata, p_iocs, p_iocs_len);
+   }
+   else
+   {
+      /* May happen after an ABORT */
+      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): No data descriptor found in get iocs\n", __LINE__);
+   }
 
-            if (p_buffer != NULL)
-            {
-               os_mutex_lock(net->cpm_buf_lock);
-               memcpy(p_iocs, &p_buffer[p_iodata->iocs_offset], p_iodata->iocs_length);
-               os_mutex_unlock(net->cpm_buf_lock);
+   return ret;
+}
 
-               *p_iocs_len = (uint8_t)p_iodata->iocs_length,
-               ret = 0;
-            }
-            else
-            {
-               LOG_DEBUG(PF_CPM_LOG, "CPM(%d): No data received in get iocs\n", __LINE__);
-            }
-         }
-         break;
-      default:
-         LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Get iocs in wrong state: %u\n", __LINE__, (unsigned)p_iocr->cpm.state);
-         break;
-      }
+int pf_cpm_io_get_iocs(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_iocs,
+   uint8_t                 *p_iocs_len)
+{
+   int                     ret = -1;
+   pf_iocr_t               *p_iocr = NULL;
+   pf_iodata_object_t      *p_iodata = NULL;
+   pf_ar_t                 *p_ar = NULL;
+
+   if (pf_cmdev_get_io_desc_by_handle(net, handle, PF_DIRECTION_OUTPUT, &p_ar, &p_iocr, &p_iodata) == 0)
+   {
+      ret = pf_cpm_get_iocs_desc(net, p_ar, p_iocr, p_iodata, p_iocs, p_iocs_len);
    }
    else
    {
       /* May happen after an ABORT */
-      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): No data descriptor found in get iocs\n", __LINE__);
+      LOG_DEBUG(PF_CPM_LOG, "CPM(%d): Invalid IO handle 0x%08x\n", __LINE__, (unsigned)handle);
    }
 
    return ret;
@@ -848,8 +889,11 @@ void pf_cpm_show(
    printf("   free_cnt           = %u\n", (unsigned)p_cpm->free_cnt);
    printf("   p_buffer_app       = %p\n", p_cpm->p_buffer_app);
    printf("   p_buffer_cpm       = %p\n", p_cpm->p_buffer_cpm);
-   printf("   p_buffer->len      = %u\n", p_cpm->p_buffer_cpm ? ((os_buf_t *)(p_cpm->p_buffer_cpm))->len : 0);
-   printf("   new_buf            = %u\n", (unsigned)p_cpm->new_buf);
+   printf("   p_buffer->len      = %u\n", p_cpm->p_buffer_app ? ((os_buf_t *)(p_cpm->p_buffer_app))->len : 0);
+   printf("   put_cnt            = %u\n", (unsigned)p_cpm->put_cnt);
+   printf("   put_overwrite_cnt  = %u\n", (unsigned)p_cpm->put_overwrite_cnt);
+   printf("   get_new_cnt        = %u\n", (unsigned)p_cpm->get_new_cnt);
+   printf("   get_old_cnt        = %u\n", (unsigned)p_cpm->get_old_cnt);
    printf("   ci_running         = %u\n", (unsigned)p_cpm->ci_running);
    printf("   ci_timer           = %u\n", (unsigned)p_cpm->ci_timer);
    printf("   buffer_status      = %x\n", (unsigned)p_cpm->data_status);
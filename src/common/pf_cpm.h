@@ -98,6 +98,22 @@ int pf_cpm_get_iocs(
    uint8_t                 *p_iocs,
    uint8_t                 *p_iocs_len);
 
+/**
+ * Same as pf_cpm_get_iocs(), for a sub-slot handle.
+ * @param net              InOut: The p-net stack instance
+ * @param handle           In:   Handle from pf_cmdev_get_io_handle().
+ * @param p_iocs           Out:  The IOCS of the application data.
+ * @param p_iocs_len       In:   Size of buffer at p_iocs.
+ *                         Out:  Actual length of IOCS data.
+ * @return  0  if the IOCS could be retrieved.
+ *          -1 if an error occurred.
+ */
+int pf_cpm_io_get_iocs(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_iocs,
+   uint8_t                 *p_iocs_len);
+
 /**
  * Retrieve the specified sub-slot data and IOPS received from the controller.
  * User must supply a buffer large enough to hold the received data.
@@ -130,6 +146,29 @@ int pf_cpm_get_data_and_iops(
    uint8_t                 *p_iops,
    uint8_t                 *p_iops_len);
 
+/**
+ * Same as pf_cpm_get_data_and_iops(), for a sub-slot handle.
+ * @param net              InOut: The p-net stack instance
+ * @param handle           In:   Handle from pf_cmdev_get_io_handle().
+ * @param p_new_flag       Out:  true if new data was received.
+ * @param p_data           Out:  The received data.
+ * @param p_data_len       In:   Size of the buffer at p_data.
+ *                         Out:  Actual length of the data.
+ * @param p_iops           Out:  The received IOPS.
+ * @param p_iops_len       In:   Size of the buffer at p_iops.
+ *                         Out:  Actual length of the IOPS.
+ * @return  0  if the data and IOPS could be retrieved.
+ *          -1 if an error occurred.
+ */
+int pf_cpm_io_get_data_and_iops(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   bool                    *p_new_flag,
+   uint8_t                 *p_data,
+   uint16_t                *p_data_len,
+   uint8_t                 *p_iops,
+   uint8_t                 *p_iops_len);
+
 /**
  * Handle new UDP layer frames.
  *
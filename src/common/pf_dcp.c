@@ -131,12 +131,12 @@ static const pf_dcp_opt_sub_t device_options[] =
 
 /**
  * @internal
- * Send a DCP response (to a GET).
+ * Send a delayed DCP response (to an IDENTIFY).
  *
  * This is a callback for the scheduler. Arguments should fulfill pf_scheduler_timeout_ftn_t
  *
  * @param net                 InOut: The p-net stack instance
- * @param arg                 In:   DCP responder data.
+ * @param arg                 In:   The pending response.
  * @param current_time        In:   The current time.
  */
 static void pf_dcp_responder(
@@ -144,17 +144,83 @@ static void pf_dcp_responder(
    void                    *arg,
    uint32_t                current_time)
 {
-   os_buf_t                *p_buf = (os_buf_t *)arg;
-   if (p_buf != NULL)
+   pf_dcp_response_t       *p_response = (pf_dcp_response_t *)arg;
+
+   if ((p_response != NULL) && (p_response->in_use == true))
    {
-      if (net->dcp_delayed_response_waiting == true)
+      if (os_eth_send(net->eth_handle, p_response->p_buf) <= 0)
       {
-         if (os_eth_send(net->eth_handle, p_buf) <= 0)
+         LOG_ERROR(PNET_LOG, "pf_dcp(%d): Error from os_eth_send(dcp)\n", __LINE__);
+      }
+      os_buf_free(p_response->p_buf);
+      p_response->p_buf = NULL;
+      p_response->timeout = 0;
+      p_response->in_use = false;
+   }
+}
+
+/**
+ * @internal
+ * Queue a DCP response to be sent after the response delay.
+ *
+ * A repeated request (same requester and xid) that is already waiting
+ * for its delay is not queued again.
+ *
+ * @param net                 InOut: The p-net stack instance
+ * @param p_dest              In:   The requester MAC address.
+ * @param xid                 In:   The xid of the request, as in the frame.
+ * @param delay               In:   The response delay in microseconds.
+ * @param p_rsp               In:   The response. Owned by DCP after the call.
+ */
+static void pf_dcp_response_add(
+   pnet_t                  *net,
+   const pnet_ethaddr_t    *p_dest,
+   uint32_t                xid,
+   uint32_t                delay,
+   os_buf_t                *p_rsp)
+{
+   uint16_t                ix;
+   pf_dcp_response_t       *p_free = NULL;
+   pf_dcp_response_t       *p_response;
+
+   for (ix = 0; ix < NELEMENTS(net->dcp_responses); ix++)
+   {
+      p_response = &net->dcp_responses[ix];
+      if (p_response->in_use == false)
+      {
+         if (p_free == NULL)
          {
-            LOG_ERROR(PNET_LOG, "pf_dcp(%d): Error from os_eth_send(dcp)\n", __LINE__);
+            p_free = p_response;
          }
-         os_buf_free(p_buf);
-         net->dcp_delayed_response_waiting = false;
+      }
+      else if ((p_response->xid == xid) &&
+               (memcmp(p_response->dest.addr, p_dest->addr, sizeof(pnet_ethaddr_t)) == 0))
+      {
+         LOG_DEBUG(PF_DCP_LOG, "DCP(%d): Repeated request already queued\n", __LINE__);
+         os_buf_free(p_rsp);
+         return;
+      }
+   }
+
+   if (p_free == NULL)
+   {
+      LOG_DEBUG(PF_DCP_LOG, "DCP(%d): No free response slot\n", __LINE__);
+      net->dcp_response_drop_cnt++;
+      os_buf_free(p_rsp);
+   }
+   else
+   {
+      p_free->dest = *p_dest;
+      p_free->xid = xid;
+      p_free->p_buf = p_rsp;
+      p_free->in_use = true;
+      if (pf_scheduler_add(net, delay, "dcp", pf_dcp_responder, p_free, &p_free->timeout) != 0)
+      {
+         LOG_ERROR(PNET_LOG, "pf_dcp(%d): Could not schedule the response\n", __LINE__);
+         net->dcp_response_drop_cnt++;
+         p_free->in_use = false;
+         p_free->p_buf = NULL;
+         os_buf_free(p_rsp);
       }
    }
 }
@@ -205,15 +271,20 @@ static int pf_dcp_put_block(
 {
    int                     ret = -1;
    uint16_t                b_len;
+   uint32_t                end_pos;
 
-   if ((*p_dst_pos + value_length) < dst_max)
+   /* Adjust written block length if block_info is included */
+   b_len = value_length;
+   if (with_block_info)
+   {
+      b_len += sizeof(b_len);
+   }
+
+   /* Only whole blocks are written, with header and padding */
+   end_pos = (uint32_t)*p_dst_pos + 4 + b_len;
+   end_pos += end_pos & 1;
+   if (end_pos <= dst_max)
    {
-      /* Adjust written block length if block_info is included */
-      b_len = value_length;
-      if (with_block_info)
-      {
-         b_len += sizeof(b_len);
-      }
 
       pf_put_byte(opt, dst_max, p_dst, p_dst_pos);
       pf_put_byte(sub, dst_max, p_dst, p_dst_pos);
@@ -228,7 +299,7 @@ static int pf_dcp_put_block(
       }
 
       /* Add padding to align on uint16_t */
-      while ((*p_dst_pos) & 1)
+      if ((*p_dst_pos) & 1)
       {
          pf_put_byte(0, dst_max, p_dst, p_dst_pos);
       }
@@ -951,6 +1022,110 @@ int pf_dcp_hello_req(
    return 0;
 }
 
+/**
+ * @internal
+ * Build the cached DCP Identify response.
+ *
+ * The complete response frame is serialized once from the CMINA data.
+ * Per request only the destination MAC address and the xid are patched
+ * into a copy of it.
+ *
+ * The name of station and the alias name used by the identify filter are
+ * cached as well.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+static void pf_dcp_identify_build(
+   pnet_t                  *net)
+{
+   uint16_t                ix;
+   uint8_t                 *p_dst = net->dcp_ident_frame;
+   uint16_t                dst_pos = 0;
+   uint16_t                dst_start = 0;
+   pf_ethhdr_t             *p_dst_ethhdr;
+   pf_dcp_header_t         *p_dst_dcphdr;
+   const pnet_cfg_t        *p_cfg = NULL;
+
+   pf_fspm_get_default_cfg(net, &p_cfg);
+
+   memset(p_dst, 0, sizeof(net->dcp_ident_frame));
+   p_dst_ethhdr = (pf_ethhdr_t *)p_dst;
+   dst_pos += sizeof(pf_ethhdr_t);
+   /* frame ID */
+   p_dst[dst_pos++] = ((PF_DCP_ID_RES_FRAME_ID & 0xff00) >> 8);
+   p_dst[dst_pos++] = PF_DCP_ID_RES_FRAME_ID & 0xff;
+
+   p_dst_dcphdr = (pf_dcp_header_t *)&p_dst[dst_pos];
+   dst_pos += sizeof(pf_dcp_header_t);
+
+   /* Save position for later */
+   dst_start = dst_pos;
+
+   /* The destination MAC address is patched per request */
+   memcpy(p_dst_ethhdr->src.addr, p_cfg->eth_addr.addr, sizeof(pnet_ethaddr_t));
+   p_dst_ethhdr->type = htons(OS_ETHTYPE_PROFINET);
+
+   /* The xid is patched per request */
+   p_dst_dcphdr->service_id = PF_DCP_SERVICE_IDENTIFY;
+   p_dst_dcphdr->service_type = PF_DCP_SERVICE_TYPE_SUCCESS;
+   p_dst_dcphdr->response_delay_factor = htons(0);
+
+   for (ix = 0; ix < NELEMENTS(device_options); ix++)
+   {
+      pf_dcp_get_req(net, p_dst, &dst_pos, sizeof(net->dcp_ident_frame),
+         device_options[ix].opt, device_options[ix].sub);
+   }
+
+   p_dst_dcphdr->data_length = htons(dst_pos - dst_start);
+   net->dcp_ident_len = dst_pos;
+
+   /* Values used by the identify filter */
+   net->dcp_ident_name_len = (uint16_t)strlen(net->cmina_temp_dcp_ase.name_of_station);
+   if (strlen(p_cfg->lldp_cfg.chassis_id) > 0)
+   {
+      snprintf(net->dcp_ident_alias, sizeof(net->dcp_ident_alias), "%s.%s",
+         p_cfg->lldp_cfg.port_id, p_cfg->lldp_cfg.chassis_id);
+      net->dcp_ident_alias_len = (uint16_t)strlen(net->dcp_ident_alias);
+   }
+   else
+   {
+      /* The LLDP chassis id is the MAC address: No alias name */
+      net->dcp_ident_alias[0] = '\0';
+      net->dcp_ident_alias_len = 0;
+   }
+   net->dcp_ident_delay_seed = p_cfg->eth_addr.addr[4] * 256 + p_cfg->eth_addr.addr[5];
+
+   net->dcp_ident_valid = true;
+}
+
+/**
+ * @internal
+ * Compare an identify filter value with a cached name.
+ *
+ * @param p_name           In:   The cached name. Not terminated.
+ * @param name_len         In:   Length of the cached name.
+ * @param p_value          In:   The filter value from the request.
+ * @param value_len        In:   Length of the filter value.
+ * @return  true  if the filter value equals the name.
+ *          false otherwise.
+ */
+static bool pf_dcp_identify_name_match(
+   const char              *p_name,
+   uint16_t                name_len,
+   const uint8_t           *p_value,
+   uint16_t                value_len)
+{
+   return (name_len > 0) &&
+          (value_len == name_len) &&
+          (memcmp(p_name, p_value, name_len) == 0);
+}
+
+void pf_dcp_identify_invalidate(
+   pnet_t                  *net)
+{
+   net->dcp_ident_valid = false;
+}
+
 /**
  * @internal
  * Handle a DCP identify request.
@@ -976,7 +1151,6 @@ static int pf_dcp_identify_req(
    void                    *p_arg)           /* Not used */
 {
    int                     ret = 0;          /* Assume all OK */
-   uint16_t                ix;
    bool                    first = true;
    bool                    match = false;    /* Is it for us? */
    bool                    filter = false;
@@ -991,18 +1165,13 @@ static int pf_dcp_identify_req(
 
    os_buf_t                *p_rsp;
    uint8_t                 *p_dst;
-   uint16_t                dst_pos = 0;
-   uint16_t                dst_start = 0;
-   pf_ethhdr_t             *p_dst_ethhdr;
    pf_dcp_header_t         *p_dst_dcphdr;
 
-   uint32_t                response_delay;
-   uint16_t                value_length;
-   uint8_t                 *p_value;
+   uint32_t                response_delay = 0;
+   uint16_t                response_delay_factor;
+   uint16_t                value_length = 0;
+   uint8_t                 *p_value = NULL;
    uint8_t                 block_error;
-   const pnet_cfg_t        *p_cfg = NULL;
-
-   pf_fspm_get_default_cfg(net, &p_cfg);
 
    LOG_DEBUG(PF_DCP_LOG,"DCP(%d): Ident req\n", __LINE__);
    /*
@@ -1010,8 +1179,12 @@ static int pf_dcp_identify_req(
     * DeviceOptionsBlock ^ OEMDeviceIDBlock ^ MACAddressBlock ^ IPParameterBlock ^
     * DHCPParameterBlock ^ ManufacturerSpecificParameterBlock
     */
-   p_rsp = os_buf_alloc(1500);        /* Get a transmit buffer for the response */
-   if ((p_buf != NULL) && (p_rsp != NULL))
+   if (net->dcp_ident_valid == false)
+   {
+      pf_dcp_identify_build(net);
+   }
+
+   if (p_buf != NULL)
    {
       /* Setup access to the request */
       p_src = (uint8_t *)p_buf->payload;
@@ -1022,30 +1195,6 @@ static int pf_dcp_identify_req(
       src_pos += sizeof(pf_dcp_header_t);
       src_dcplen = (src_pos + ntohs(p_src_dcphdr->data_length));
 
-      /* Prepare the response */
-      p_dst = (uint8_t *)p_rsp->payload;
-      dst_pos = 0;
-      p_dst_ethhdr = (pf_ethhdr_t *)p_dst;
-      dst_pos += sizeof(pf_ethhdr_t);
-      /* frame ID */
-      p_dst[dst_pos++] = ((PF_DCP_ID_RES_FRAME_ID & 0xff00) >> 8);
-      p_dst[dst_pos++] = PF_DCP_ID_RES_FRAME_ID & 0xff;
-
-      p_dst_dcphdr = (pf_dcp_header_t *)&p_dst[dst_pos];
-      dst_pos += sizeof(pf_dcp_header_t);
-
-      /* Save position for later */
-      dst_start = dst_pos;
-
-      memcpy(p_dst_ethhdr->dest.addr, p_src_ethhdr->src.addr, sizeof(pnet_ethaddr_t));
-      memcpy(p_dst_ethhdr->src.addr, p_cfg->eth_addr.addr, sizeof(pnet_ethaddr_t));
-      p_dst_ethhdr->type = htons(OS_ETHTYPE_PROFINET);
-
-      /* Start with the request header and modify what is needed. */
-      *p_dst_dcphdr = *p_src_dcphdr;
-      p_dst_dcphdr->service_type = PF_DCP_SERVICE_TYPE_SUCCESS;
-      p_dst_dcphdr->response_delay_factor = htons(0);
-
       /* The block header is expected to be 16-bit aligned */
       p_src_block_hdr = (pf_dcp_block_hdr_t *)&p_src[src_pos];
       src_pos += sizeof(*p_src_block_hdr);    /* Point to the block value */
@@ -1055,8 +1204,7 @@ static int pf_dcp_identify_req(
       match = true;     /* So far so good */
       while ((ret == 0) &&
              (first || (filter && match)) &&
-             (src_dcplen >= (src_pos + src_block_len)) &&
-             (dst_pos < 1500))
+             (src_dcplen >= (src_pos + src_block_len)))
       {
          /*
           * At the start of the loop p_src_block_hdr shall point to the source block header and
@@ -1075,8 +1223,21 @@ static int pf_dcp_identify_req(
           *    DeviceOptionsBlock ^ OEMDeviceIDBlock ^ MACAddressBlock ^ IPParameterBlock ^
           *    DHCPParameterBlock ^ ManufacturerSpecificParameterBlock
           */
-         if (pf_cmina_dcp_get_req(net, p_src_block_hdr->option, p_src_block_hdr->sub_option,
-            &value_length, &p_value, &block_error) == 0)
+         if ((p_src_block_hdr->option == PF_DCP_OPT_ALL) ||
+             ((p_src_block_hdr->option == PF_DCP_OPT_DEVICE_PROPERTIES) &&
+              ((p_src_block_hdr->sub_option == PF_DCP_SUB_DEV_PROP_NAME) ||
+               (p_src_block_hdr->sub_option == PF_DCP_SUB_DEV_PROP_ALIAS))))
+         {
+            /* Fast path: These are matched against the cached names */
+            block_error = PF_DCP_BLOCK_ERROR_NO_ERROR;
+         }
+         else if (pf_cmina_dcp_get_req(net, p_src_block_hdr->option, p_src_block_hdr->sub_option,
+            &value_length, &p_value, &block_error) != 0)
+         {
+            block_error = PF_DCP_BLOCK_ERROR_SUBOPTION_NOT_SUPPORTED;
+         }
+
+         if (block_error == PF_DCP_BLOCK_ERROR_NO_ERROR)
          {
             switch (p_src_block_hdr->option)
             {
@@ -1161,8 +1322,8 @@ static int pf_dcp_identify_req(
                   }
                   break;
                case PF_DCP_SUB_DEV_PROP_NAME:
-                  if ((memcmp(p_value, &p_src[src_pos], src_block_len) == 0) &&
-                      (p_value[src_block_len] == '\0'))
+                  if (pf_dcp_identify_name_match(net->cmina_temp_dcp_ase.name_of_station,
+                     net->dcp_ident_name_len, &p_src[src_pos], src_block_len) == true)
                   {
                      if (first == true)
                      {
@@ -1231,11 +1392,9 @@ static int pf_dcp_identify_req(
                      ret = -1;
                   }
                   break;
-   #if 0
-               /* Currently we do not support alias names */
                case PF_DCP_SUB_DEV_PROP_ALIAS:
-                  if ((memcmp(p_value, &p_src[src_pos], value_length) != 0) ||
-                      (src_block_len != value_length))
+                  if (pf_dcp_identify_name_match(net->dcp_ident_alias,
+                     net->dcp_ident_alias_len, &p_src[src_pos], src_block_len) == true)
                   {
                      if (first == true)
                      {
@@ -1246,7 +1405,6 @@ static int pf_dcp_identify_req(
                   {
                      match = false;
                   }
-   #endif
                   break;
                case PF_DCP_SUB_DEV_PROP_INSTANCE:
                   if (filter == true)
@@ -1321,25 +1479,27 @@ static int pf_dcp_identify_req(
 
       if ((ret == 0) && (match == true))
       {
-         /* Build the response */
-         for (ix = 0; ix < NELEMENTS(device_options); ix++)
+         /* Copy the cached response and patch the destination and xid */
+         p_rsp = os_buf_alloc(net->dcp_ident_len);
+         if (p_rsp != NULL)
          {
-            pf_dcp_get_req(net, p_dst, &dst_pos, 1500,
-               device_options[ix].opt, device_options[ix].sub);
-         }
-
-         /* Insert final response length and ship it! */
-         p_dst_dcphdr->data_length = htons(dst_pos - dst_start);
-         p_rsp->len = dst_pos;
+            p_dst = (uint8_t *)p_rsp->payload;
+            memcpy(p_dst, net->dcp_ident_frame, net->dcp_ident_len);
+            memcpy(((pf_ethhdr_t *)p_dst)->dest.addr, p_src_ethhdr->src.addr, sizeof(pnet_ethaddr_t));
+            p_dst_dcphdr = (pf_dcp_header_t *)&p_dst[sizeof(pf_ethhdr_t) + sizeof(uint16_t)];
+            p_dst_dcphdr->xid = p_src_dcphdr->xid;
+            p_rsp->len = net->dcp_ident_len;
+
+            /* Spread the responses from many devices over time */
+            response_delay_factor = ntohs(p_src_dcphdr->response_delay_factor);
+            if (response_delay_factor > 1)
+            {
+               response_delay = (net->dcp_ident_delay_seed % response_delay_factor) * 10;
+            }
 
-         net->dcp_delayed_response_waiting = true;
-         response_delay = ((p_cfg->eth_addr.addr[4] * 256 + p_cfg->eth_addr.addr[5]) % ntohs(p_src_dcphdr->response_delay_factor)) * 10;
-         pf_scheduler_add(net, response_delay*1000,
-            "dcp", pf_dcp_responder, p_rsp, &net->dcp_timeout);
-      }
-      else
-      {
-         os_buf_free(p_rsp);
+            pf_dcp_response_add(net, &p_src_ethhdr->src, p_src_dcphdr->xid,
+               response_delay*1000, p_rsp);
+         }
       }
    }
 
@@ -1354,6 +1514,19 @@ static int pf_dcp_identify_req(
 void pf_dcp_exit(
    pnet_t                  *net)
 {
+   uint16_t                ix;
+
+   for (ix = 0; ix < NELEMENTS(net->dcp_responses); ix++)
+   {
+      if (net->dcp_responses[ix].in_use == true)
+      {
+         pf_scheduler_remove(net, "dcp", net->dcp_responses[ix].timeout);
+         os_buf_free(net->dcp_responses[ix].p_buf);
+         net->dcp_responses[ix].p_buf = NULL;
+         net->dcp_responses[ix].in_use = false;
+      }
+   }
+
    pf_eth_frame_id_map_remove(net, PF_DCP_HELLO_FRAME_ID);
    pf_eth_frame_id_map_remove(net, PF_DCP_GET_SET_FRAME_ID);
    pf_eth_frame_id_map_remove(net, PF_DCP_ID_REQ_FRAME_ID);
@@ -1363,10 +1536,12 @@ void pf_dcp_init(
    pnet_t                  *net)
 {
    net->dcp_global_block_qualifier = 0;
-   net->dcp_delayed_response_waiting = false;
+   memset(net->dcp_responses, 0, sizeof(net->dcp_responses));
+   net->dcp_response_drop_cnt = 0;
    net->dcp_sam_timeout = 0;
    net->dcp_timeout = 0;
    net->dcp_sam = mac_nil;
+   net->dcp_ident_valid = false;
 
    /* Insert handlers for our specific frame_ids */
    pf_eth_frame_id_map_add(net, PF_DCP_HELLO_FRAME_ID, pf_dcp_hello_ind, NULL);
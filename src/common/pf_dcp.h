@@ -126,6 +126,17 @@ void pf_dcp_exit(
 int pf_dcp_hello_req(
    pnet_t                  *net);
 
+/**
+ * Discard the cached DCP Identify response.
+ *
+ * Must be called whenever the CMINA data reported in the response
+ * (name of station, IP suite, device properties) is changed.
+ * The response is rebuilt when the next Identify request arrives.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_dcp_identify_invalidate(
+   pnet_t                  *net);
+
 #ifdef __cplusplus
 }
 #endif
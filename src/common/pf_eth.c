@@ -19,9 +19,21 @@
  *
  * The frame id map is used to quickly find the function responsible for
  * handling a frame with a specific frame id.
- * Clients may add or remove entries on the fly, but there is no locking of the table.
- * ToDo: This may be a problem in the future.
- * Note that frames may arrive at any time.
+ *
+ * Frame ids are looked up in an open addressed hash table (linear probing)
+ * holding the frame id and the index of its entry in the map. When an entry
+ * is removed, the later entries of its probe sequence are moved back into
+ * the hole. There are no deleted markers, so a lookup never probes further
+ * than to the end of the sequence of its frame id.
+ *
+ * Clients may add or remove entries on the fly from one thread, while frames
+ * arrive in another thread at any time. There is no locking. Instead each
+ * map entry has a generation counter which is odd while the entry is
+ * changed. The receiver re-checks the counter and the hash slot after
+ * reading the entry, and looks up the frame id again if any of them changed.
+ * The hash table has a generation counter of its own, which is odd while
+ * entries are moved. A frame id that is not found is looked up again if the
+ * table changed meanwhile.
  */
 
 #ifdef UNIT_TEST
@@ -31,6 +43,13 @@
 #include <string.h>
 #include "pf_includes.h"
 
+/* Hash slot contents: Frame id in the upper half, map index + 1 in the lower half */
+#define PF_ETH_HASH_EMPTY           0x00000000
+#define PF_ETH_HASH_SLOT(id, ix)    (((uint32_t)(id) << 16) | ((ix) + 1))
+#define PF_ETH_HASH_ID(slot)        ((uint16_t)((slot) >> 16))
+#define PF_ETH_HASH_IX(slot)        (((slot) & 0xffff) - 1)
+
+CC_STATIC_ASSERT (PF_ETH_MAX_MAP < 0xffff);
 
 int pf_eth_init(
    pnet_t                  *net)
@@ -38,21 +57,115 @@ int pf_eth_init(
    int ret = 0;
 
    memset(net->eth_id_map, 0, sizeof(net->eth_id_map));
+   memset(net->eth_id_hash, 0, sizeof(net->eth_id_hash));
+   net->eth_id_hash_gen = 0;
 
    return ret;
 }
 
-int pf_eth_recv(
-   void                    *arg,
-   os_buf_t                *p_buf)
+/**
+ * @internal
+ * Find the hash slot of a frame id.
+ * @param net              InOut: The p-net stack instance
+ * @param frame_id         In:   The frame id to look for.
+ * @param p_slot           Out:  The slot contents.
+ * @return  The slot position, or PF_ETH_HASH_SIZE if not found.
+ */
+static uint16_t pf_eth_hash_find(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   uint32_t                *p_slot)
+{
+   uint16_t                pos = frame_id % PF_ETH_HASH_SIZE;
+   uint16_t                cnt;
+   uint32_t                slot;
+
+   for (cnt = 0; cnt < PF_ETH_HASH_SIZE; cnt++)
+   {
+      slot = CC_ATOMIC_GET32(&net->eth_id_hash[pos]);
+      if (slot == PF_ETH_HASH_EMPTY)
+      {
+         break;
+      }
+      if (PF_ETH_HASH_ID(slot) == frame_id)
+      {
+         *p_slot = slot;
+         return pos;
+      }
+      pos++;
+      if (pos == PF_ETH_HASH_SIZE)
+      {
+         pos = 0;
+      }
+   }
+
+   return PF_ETH_HASH_SIZE;
+}
+
+/**
+ * @internal
+ * Get a consistent copy of the frame handler of a frame id.
+ * @param net              InOut: The p-net stack instance
+ * @param frame_id         In:   The frame id to look for.
+ * @param p_handler        Out:  The frame handler.
+ * @param pp_arg           Out:  The frame handler argument.
+ * @return  0  if the frame id was found.
+ *          -1 if the frame id is not in the map.
+ */
+static int pf_eth_lookup(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   pf_eth_frame_handler_t  *p_handler,
+   void                    **pp_arg)
+{
+   pf_eth_frame_id_map_t   *p_map;
+   uint16_t                pos;
+   uint32_t                slot = PF_ETH_HASH_EMPTY;
+   uint32_t                gen;
+   uint32_t                hash_gen;
+
+   while (true)
+   {
+      hash_gen = CC_ATOMIC_GET32(&net->eth_id_hash_gen);
+      if ((hash_gen & 1) != 0)
+      {
+         /* Entries are being moved */
+         continue;
+      }
+
+      pos = pf_eth_hash_find(net, frame_id, &slot);
+      if (pos >= PF_ETH_HASH_SIZE)
+      {
+         if (CC_ATOMIC_GET32(&net->eth_id_hash_gen) == hash_gen)
+         {
+            return -1;
+         }
+         /* It may have been moved past us - try again */
+         continue;
+      }
+
+      p_map = &net->eth_id_map[PF_ETH_HASH_IX(slot)];
+      gen = CC_ATOMIC_GET32(&p_map->gen);
+      if ((gen & 1) == 0)
+      {
+         *p_handler = p_map->frame_handler;
+         *pp_arg = p_map->p_arg;
+         if ((CC_ATOMIC_GET32(&p_map->gen) == gen) &&
+             (CC_ATOMIC_GET32(&net->eth_id_hash[pos]) == slot))
+         {
+            return 0;
+         }
+      }
+      /* Changed while we looked at it - try again */
+   }
+}
+
+uint16_t pf_eth_frame_id_pos(
+   const os_buf_t          *p_buf)
 {
-   int         ret = 0;       /* Means: "Not handled" */
    uint16_t    type_pos = 2*sizeof(pnet_ethaddr_t);
    uint16_t    type;
-   uint16_t    frame_id;
    uint16_t    *p_data;
-   uint16_t    ix = 0;
-   pnet_t      *net = (pnet_t*)arg;
 
    /* Skip ALL VLAN tags */
    p_data = (uint16_t *)(&((uint8_t *)p_buf->payload)[type_pos]);
@@ -64,28 +177,40 @@ int pf_eth_recv(
       p_data = (uint16_t *)(&((uint8_t *)p_buf->payload)[type_pos]);
       type = ntohs(p_data[0]);
    }
-   frame_id = ntohs(p_data[1]);
+
+   return type_pos + sizeof(uint16_t);
+}
+
+int pf_eth_recv(
+   void                    *arg,
+   os_buf_t                *p_buf)
+{
+   int         ret = 0;       /* Means: "Not handled" */
+   uint16_t    frame_id_pos;
+   uint16_t    type;
+   uint16_t    frame_id;
+   uint16_t    *p_data;
+   pnet_t      *net = (pnet_t*)arg;
+   pf_eth_frame_handler_t  frame_handler;
+   void        *p_arg;
+
+   frame_id_pos = pf_eth_frame_id_pos(p_buf);
+   p_data = (uint16_t *)(&((uint8_t *)p_buf->payload)[frame_id_pos]);
+   type = ntohs(p_data[-1]);     /* Right before the frame id */
+   frame_id = ntohs(p_data[0]);
 
    switch (type)
    {
    case OS_ETHTYPE_PROFINET:
       /* Find the associated frame handler */
-      ix = 0;
-      while ((ix < NELEMENTS(net->eth_id_map)) &&
-             ((net->eth_id_map[ix].in_use == false) ||
-              (net->eth_id_map[ix].frame_id != frame_id)))
-      {
-         ix++;
-      }
-      if (ix < NELEMENTS(net->eth_id_map))
+      if (pf_eth_lookup(net, frame_id, &frame_handler, &p_arg) == 0)
       {
          /* Call the frame handler */
-         ret = net->eth_id_map[ix].frame_handler(net, frame_id, p_buf,
-            type_pos + sizeof(uint16_t), net->eth_id_map[ix].p_arg);
+         ret = frame_handler(net, frame_id, p_buf, frame_id_pos, p_arg);
       }
       break;
    case OS_ETHTYPE_LLDP:
-      /* ToDo: */
+      ret = pf_lldp_recv(net, p_buf, frame_id_pos);
       break;
    default:
       /* Not a profinet packet. */
@@ -103,6 +228,9 @@ void pf_eth_frame_id_map_add(
    void                    *p_arg)
 {
    uint16_t                ix = 0;
+   uint16_t                pos;
+   uint32_t                slot;
+   pf_eth_frame_id_map_t   *p_map;
 
    while ((ix < NELEMENTS(net->eth_id_map)) &&
           (net->eth_id_map[ix].in_use == true))
@@ -114,10 +242,27 @@ void pf_eth_frame_id_map_add(
    {
       LOG_DEBUG(PF_ETH_LOG, "ETH(%d): Add FrameIds %#x at index %u\n", __LINE__,
          (unsigned)frame_id, (unsigned)ix);
-      net->eth_id_map[ix].frame_id = frame_id;
-      net->eth_id_map[ix].frame_handler = frame_handler;
-      net->eth_id_map[ix].p_arg = p_arg;
-      net->eth_id_map[ix].in_use = true;
+      p_map = &net->eth_id_map[ix];
+      CC_ATOMIC_SET32(&p_map->gen, p_map->gen + 1);
+      p_map->frame_id = frame_id;
+      p_map->frame_handler = frame_handler;
+      p_map->p_arg = p_arg;
+      p_map->in_use = true;
+      CC_ATOMIC_SET32(&p_map->gen, p_map->gen + 1);
+
+      /* Publish in the first free slot. There is always one as the table is larger than the map. */
+      pos = frame_id % PF_ETH_HASH_SIZE;
+      slot = net->eth_id_hash[pos];
+      while (slot != PF_ETH_HASH_EMPTY)
+      {
+         pos++;
+         if (pos == PF_ETH_HASH_SIZE)
+         {
+            pos = 0;
+         }
+         slot = net->eth_id_hash[pos];
+      }
+      CC_ATOMIC_SET32(&net->eth_id_hash[pos], PF_ETH_HASH_SLOT(frame_id, ix));
    }
    else
    {
@@ -125,22 +270,76 @@ void pf_eth_frame_id_map_add(
    }
 }
 
+/**
+ * @internal
+ * Remove a slot from the hash table.
+ *
+ * The later slots of the probe sequence are moved back into the hole,
+ * unless their home position is after it. The hole then moves on to the
+ * slot that was moved, until an empty slot ends the sequence.
+ * @param net              InOut: The p-net stack instance
+ * @param pos              In:   The slot position.
+ */
+static void pf_eth_hash_remove(
+   pnet_t                  *net,
+   uint16_t                pos)
+{
+   uint16_t                hole = pos;
+   uint16_t                next = pos;
+   uint16_t                home;
+   uint32_t                slot;
+
+   while (true)
+   {
+      next++;
+      if (next == PF_ETH_HASH_SIZE)
+      {
+         next = 0;
+      }
+      slot = net->eth_id_hash[next];
+      if (slot == PF_ETH_HASH_EMPTY)
+      {
+         break;
+      }
+
+      /* Keep the slot if its home is cyclically in (hole, next] */
+      home = PF_ETH_HASH_ID(slot) % PF_ETH_HASH_SIZE;
+      if ((hole <= next) ?
+          ((hole < home) && (home <= next)) :
+          ((hole < home) || (home <= next)))
+      {
+         continue;
+      }
+
+      /* Copy first, so the entry is always in the table */
+      CC_ATOMIC_SET32(&net->eth_id_hash[hole], slot);
+      hole = next;
+   }
+   CC_ATOMIC_SET32(&net->eth_id_hash[hole], PF_ETH_HASH_EMPTY);
+}
+
 void pf_eth_frame_id_map_remove(
    pnet_t                  *net,
    uint16_t                frame_id)
 {
    uint16_t                ix = 0;
+   uint16_t                pos;
+   uint32_t                slot = PF_ETH_HASH_EMPTY;
+   pf_eth_frame_id_map_t   *p_map;
 
-   while ((ix < NELEMENTS(net->eth_id_map)) &&
-          ((net->eth_id_map[ix].in_use == false) ||
-           (net->eth_id_map[ix].frame_id != frame_id)))
+   pos = pf_eth_hash_find(net, frame_id, &slot);
+   if (pos < PF_ETH_HASH_SIZE)
    {
-      ix++;
-   }
+      ix = PF_ETH_HASH_IX(slot);
+      p_map = &net->eth_id_map[ix];
 
-   if (ix < NELEMENTS(net->eth_id_map))
-   {
-      net->eth_id_map[ix].in_use = false;
+      CC_ATOMIC_SET32(&net->eth_id_hash_gen, net->eth_id_hash_gen + 1);
+      pf_eth_hash_remove(net, pos);
+      CC_ATOMIC_SET32(&net->eth_id_hash_gen, net->eth_id_hash_gen + 1);
+
+      CC_ATOMIC_SET32(&p_map->gen, p_map->gen + 1);
+      p_map->in_use = false;
+      CC_ATOMIC_SET32(&p_map->gen, p_map->gen + 1);
       LOG_DEBUG(PF_ETH_LOG, "ETH(%d): Free room for FrameIds %#x at index %u\n", __LINE__,
          (unsigned)frame_id, (unsigned)ix);
    }
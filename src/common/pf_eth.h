@@ -59,6 +59,17 @@ void pf_eth_frame_id_map_remove(
    pnet_t                  *net,
    uint16_t                frame_id);
 
+/**
+ * Find the position of the frame id in an Ethernet frame.
+ *
+ * All VLAN tags are skipped. The frame id is located right after the
+ * packet type.
+ * @param p_buf            In:   The Ethernet frame.
+ * @return  The position in the buffer of the frame id.
+ */
+uint16_t pf_eth_frame_id_pos(
+   const os_buf_t          *p_buf);
+
 /**
  * Inspect and possibly handle Ethernet frames:
  *
@@ -19,8 +19,7 @@
 
 /*
  * ToDo: Differentiate between device and port MAC addresses.
- * ToDo: Handle PNET_MAX_PORT ports.
- * ToDo: Receive LLDP and build a per-port peer DB.
+ * ToDo: Map received frames to the port they arrived on.
  */
 
 #include <string.h>
@@ -36,11 +35,41 @@
 #define LLDP_TYPE_ORG_SPEC                127
 
 #define LLDP_SUBTYPE_CHASSIS_ID_MAC       4
-#define LLDP_SUBTYPE_CHASSIS_ID_NAME      7
+#define LLDP_SUBTYPE_CHASSIS_ID_NAME      PF_LLDP_SUBTYPE_CHASSIS_ID_NAME
 #define LLDP_SUBTYPE_PORT_ID_LOCAL        7
 
 #define LLDP_IEEE_SUBTYPE_MAC_PHY         1
 
+/*
+ * The frame is sent every TTL / LLDP_TX_HOLD seconds, i.e. the
+ * msgTxInterval and msgTxHold of IEEE 802.1AB.
+ */
+#define LLDP_TX_HOLD                      4
+#define LLDP_TX_INTERVAL_MIN              (1000*1000)    /* us */
+#define LLDP_TX_INTERVAL_MAX              0x80000000     /* us, scheduler limit */
+
+#define LLDP_AGE_INTERVAL                 (1000*1000)    /* us */
+
+#define LLDP_MGMT_ADDR_SUBTYPE_IPV4       1
+
+/*
+ * The TLVs of a received LLDP-PDU.
+ * The pointers point into the received frame.
+ */
+typedef struct pf_lldp_pdu
+{
+   uint8_t                 chassis_id_subtype;
+   uint8_t                 chassis_id_len;
+   const uint8_t           *p_chassis_id;
+   uint8_t                 port_id_subtype;
+   uint8_t                 port_id_len;
+   const uint8_t           *p_port_id;
+   uint16_t                ttl;
+   const uint8_t           *p_mac_address;      /* NULL if not present */
+   bool                    has_ip_address;
+   os_ipaddr_t             ip_address;
+} pf_lldp_pdu_t;
+
 typedef enum lldp_pnio_subtype_values
 {
    LLDP_PNIO_SUBTYPE_RESERVED = 0,
@@ -281,15 +310,21 @@ static void lldp_add_management(
    pf_put_byte(0, 1500, p_buf, p_pos);       /* OID string length: 0 => Not supported */
 }
 
-void pf_lldp_send(
-   pnet_t                  *net)
+/**
+ * @internal
+ * Serialize the LLDP frame of a port.
+ * @param net              InOut: The p-net stack instance
+ * @param p_lldp_buffer    InOut:The frame buffer of the port.
+ */
+static void pf_lldp_build_frame(
+   pnet_t                  *net,
+   os_buf_t                *p_lldp_buffer)
 {
-   os_buf_t                *p_lldp_buffer = os_buf_alloc(1500);
    uint8_t                 *p_buf = NULL;
    uint16_t                pos = 0;
    pnet_cfg_t              *p_cfg = NULL;
 
-   LOG_INFO(PF_ETH_LOG, "LLDP: Sending LLDP frame\n");
+   LOG_DEBUG(PF_ETH_LOG, "LLDP(%d): Building LLDP frame\n", __LINE__);
 
    pf_fspm_get_cfg(net, &p_cfg);
    /*
@@ -368,20 +403,402 @@ void pf_lldp_send(
          /* Add end of LLDP-PDU marker */
          pf_lldp_tlv_header(p_buf, &pos, LLDP_TYPE_END, 0);
 
+         if (pf_put_overflow(1500, pos))
+         {
+            LOG_ERROR(PNET_LOG, "LLDP(%d): LLDP-PDU does not fit in frame\n", __LINE__);
+            pos = 0;
+         }
          p_lldp_buffer->len = pos;
+      }
+   }
+}
+
+void pf_lldp_invalidate(
+   pnet_t                  *net)
+{
+   net->lldp_frame_valid = false;
+}
+
+void pf_lldp_send(
+   pnet_t                  *net)
+{
+   uint16_t                port;
 
-        if (os_eth_send(net->eth_handle, p_lldp_buffer) <= 0)
+   os_mutex_lock(net->lldp_mutex);
+   if (net->lldp_frame_valid == false)
+   {
+      for (port = 0; port < NELEMENTS(net->lldp_frame); port++)
+      {
+         pf_lldp_build_frame(net, net->lldp_frame[port]);
+      }
+      net->lldp_frame_valid = true;
+   }
+
+   for (port = 0; port < NELEMENTS(net->lldp_frame); port++)
+   {
+      if ((net->lldp_frame[port] != NULL) && (net->lldp_frame[port]->len > 0))
+      {
+         if (os_eth_send(net->eth_handle, net->lldp_frame[port]) <= 0)
          {
             LOG_ERROR(PNET_LOG, "LLDP(%d): Error from os_eth_send(lldp)\n", __LINE__);
          }
       }
+   }
+   os_mutex_unlock(net->lldp_mutex);
+}
 
-      os_buf_free(p_lldp_buffer);
+/**
+ * @internal
+ * Parse a received LLDP-PDU.
+ *
+ * The TLVs are parsed in place. The result points into the frame.
+ * @param p_frame          In:   The received frame.
+ * @param pos              In:   Position of the first TLV.
+ * @param len              In:   Length of the frame.
+ * @param p_pdu            Out:  The parsed LLDP-PDU.
+ * @return  0  if the LLDP-PDU is valid.
+ *          -1 if the LLDP-PDU is malformed.
+ */
+static int pf_lldp_parse(
+   const uint8_t           *p_frame,
+   uint16_t                pos,
+   uint16_t                len,
+   pf_lldp_pdu_t           *p_pdu)
+{
+   uint16_t                nbr_tlv = 0;
+   uint16_t                tlv_type;
+   uint16_t                tlv_len;
+   const uint8_t           *p_value;
+   bool                    end = false;
+
+   memset(p_pdu, 0, sizeof(*p_pdu));
+
+   while ((end == false) && ((uint32_t)pos + 2 <= len))
+   {
+      tlv_type = p_frame[pos] >> 1;
+      tlv_len = ((p_frame[pos] & 0x01) << 8) | p_frame[pos + 1];
+      pos += 2;
+      if ((uint32_t)pos + tlv_len > len)
+      {
+         return -1;
+      }
+      p_value = &p_frame[pos];
+
+      /* Chassis id, port id and TTL are mandatory and come first, in order */
+      if ((nbr_tlv < 3) && (tlv_type != nbr_tlv + 1))
+      {
+         return -1;
+      }
+
+      switch (tlv_type)
+      {
+      case LLDP_TYPE_END:
+         end = true;
+         break;
+      case LLDP_TYPE_CHASSIS_ID:
+         if ((tlv_len < 2) || (tlv_len > 1 + PF_LLDP_ID_SIZE))
+         {
+            return -1;
+         }
+         p_pdu->chassis_id_subtype = p_value[0];
+         p_pdu->chassis_id_len = (uint8_t)(tlv_len - 1);
+         p_pdu->p_chassis_id = &p_value[1];
+         break;
+      case LLDP_TYPE_PORT_ID:
+         if ((tlv_len < 2) || (tlv_len > 1 + PF_LLDP_ID_SIZE))
+         {
+            return -1;
+         }
+         p_pdu->port_id_subtype = p_value[0];
+         p_pdu->port_id_len = (uint8_t)(tlv_len - 1);
+         p_pdu->p_port_id = &p_value[1];
+         break;
+      case LLDP_TYPE_TTL:
+         if (tlv_len < 2)
+         {
+            return -1;
+         }
+         p_pdu->ttl = (p_value[0] << 8) | p_value[1];
+         break;
+      case LLDP_TYPE_MANAGEMENT:
+         /* Address string length (incl type), type, address */
+         if ((tlv_len >= 6) && (p_value[0] == 1 + 4) &&
+             (p_value[1] == LLDP_MGMT_ADDR_SUBTYPE_IPV4))
+         {
+            p_pdu->has_ip_address = true;
+            p_pdu->ip_address = ((uint32_t)p_value[2] << 24) | ((uint32_t)p_value[3] << 16) |
+                                ((uint32_t)p_value[4] << 8) | p_value[5];
+         }
+         break;
+      case LLDP_TYPE_ORG_SPEC:
+         if ((tlv_len >= 4 + sizeof(pnet_ethaddr_t)) &&
+             (p_value[0] == 0x00) && (p_value[1] == 0x0e) && (p_value[2] == 0xcf) &&
+             (p_value[3] == LLDP_PNIO_SUBTYPE_INTERFACE_MAC))
+         {
+            p_pdu->p_mac_address = &p_value[4];
+         }
+         break;
+      default:
+         break;
+      }
+
+      pos += tlv_len;
+      nbr_tlv++;
    }
+
+   return (nbr_tlv >= 3) ? 0 : -1;
+}
+
+/**
+ * @internal
+ * Insert, refresh or remove a peer in the neighbour table of a port.
+ *
+ * A peer is identified by its chassis id and port id.
+ * A TTL of zero means that the peer is shutting down.
+ * @param net              InOut: The p-net stack instance
+ * @param port             In:   The port the frame was received on.
+ * @param p_pdu            In:   The received LLDP-PDU.
+ */
+static void pf_lldp_peer_update(
+   pnet_t                  *net,
+   uint16_t                port,
+   const pf_lldp_pdu_t     *p_pdu)
+{
+   uint16_t                ix;
+   pf_lldp_peer_t          *p_entry;
+   pf_lldp_peer_t          *p_peer = NULL;
+   pf_lldp_peer_t          *p_free = NULL;
+
+   os_mutex_lock(net->lldp_mutex);
+   for (ix = 0; ix < NELEMENTS(net->lldp_peers[port]); ix++)
+   {
+      p_entry = &net->lldp_peers[port][ix];
+      if (p_entry->in_use == false)
+      {
+         if (p_free == NULL)
+         {
+            p_free = p_entry;
+         }
+      }
+      else if ((p_entry->chassis_id_subtype == p_pdu->chassis_id_subtype) &&
+               (p_entry->chassis_id_len == p_pdu->chassis_id_len) &&
+               (memcmp(p_entry->chassis_id, p_pdu->p_chassis_id, p_pdu->chassis_id_len) == 0) &&
+               (p_entry->port_id_subtype == p_pdu->port_id_subtype) &&
+               (p_entry->port_id_len == p_pdu->port_id_len) &&
+               (memcmp(p_entry->port_id, p_pdu->p_port_id, p_pdu->port_id_len) == 0))
+      {
+         p_peer = p_entry;
+      }
+   }
+
+   if (p_pdu->ttl == 0)
+   {
+      if (p_peer != NULL)
+      {
+         p_peer->in_use = false;
+      }
+   }
+   else
+   {
+      if (p_peer == NULL)
+      {
+         p_peer = p_free;
+         if (p_peer != NULL)
+         {
+            p_peer->chassis_id_subtype = p_pdu->chassis_id_subtype;
+            p_peer->chassis_id_len = p_pdu->chassis_id_len;
+            memcpy(p_peer->chassis_id, p_pdu->p_chassis_id, p_pdu->chassis_id_len);
+            p_peer->port_id_subtype = p_pdu->port_id_subtype;
+            p_peer->port_id_len = p_pdu->port_id_len;
+            memcpy(p_peer->port_id, p_pdu->p_port_id, p_pdu->port_id_len);
+            p_peer->in_use = true;
+         }
+         else
+         {
+            LOG_DEBUG(PF_ETH_LOG, "LLDP(%d): Neighbour table of port %u is full\n", __LINE__, (unsigned)port);
+            net->lldp_rx_drop_cnt++;
+         }
+      }
+
+      if (p_peer != NULL)
+      {
+         p_peer->ttl_left = p_pdu->ttl;
+         memcpy(p_peer->mac_address.addr, p_pdu->p_mac_address, sizeof(pnet_ethaddr_t));
+         p_peer->has_ip_address = p_pdu->has_ip_address;
+         p_peer->ip_address = p_pdu->ip_address;
+      }
+   }
+   os_mutex_unlock(net->lldp_mutex);
+}
+
+int pf_lldp_recv(
+   pnet_t                  *net,
+   os_buf_t                *p_buf,
+   uint16_t                offset)
+{
+   const uint8_t           *p_frame = (const uint8_t *)p_buf->payload;
+   pf_lldp_pdu_t           pdu;
+   pnet_cfg_t              *p_cfg = NULL;
+
+   pf_fspm_get_cfg(net, &p_cfg);
+
+   /* Our own frames may be looped back */
+   if (memcmp(&p_frame[sizeof(pnet_ethaddr_t)], p_cfg->eth_addr.addr, sizeof(pnet_ethaddr_t)) != 0)
+   {
+      if (pf_lldp_parse(p_frame, offset, p_buf->len, &pdu) == 0)
+      {
+         if (pdu.p_mac_address == NULL)
+         {
+            /* No PNIO chassis MAC TLV: Use the source address */
+            pdu.p_mac_address = &p_frame[sizeof(pnet_ethaddr_t)];
+         }
+         pf_lldp_peer_update(net, 0, &pdu);
+      }
+      else
+      {
+         LOG_DEBUG(PF_ETH_LOG, "LLDP(%d): Malformed LLDP-PDU\n", __LINE__);
+         net->lldp_rx_drop_cnt++;
+      }
+   }
+
+   os_buf_free(p_buf);
+
+   return 1;
+}
+
+uint16_t pf_lldp_get_peers(
+   pnet_t                  *net,
+   uint16_t                port,
+   pf_lldp_peer_t          *p_peers,
+   uint16_t                max_peers)
+{
+   uint16_t                ix;
+   uint16_t                nbr_peers = 0;
+
+   if (port < NELEMENTS(net->lldp_peers))
+   {
+      os_mutex_lock(net->lldp_mutex);
+      for (ix = 0; (ix < NELEMENTS(net->lldp_peers[port])) && (nbr_peers < max_peers); ix++)
+      {
+         if (net->lldp_peers[port][ix].in_use == true)
+         {
+            p_peers[nbr_peers++] = net->lldp_peers[port][ix];
+         }
+      }
+      os_mutex_unlock(net->lldp_mutex);
+   }
+
+   return nbr_peers;
+}
+
+/**
+ * @internal
+ * Remove neighbours that have not been refreshed within their TTL.
+ *
+ * This is a callback for the scheduler. Arguments should fulfill pf_scheduler_timeout_ftn_t
+ *
+ * @param net                 InOut: The p-net stack instance
+ * @param arg                 In:   Not used.
+ * @param current_time        In:   Not used.
+ */
+static void pf_lldp_age(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                current_time)
+{
+   uint16_t                port;
+   uint16_t                ix;
+   pf_lldp_peer_t          *p_peer;
+
+   os_mutex_lock(net->lldp_mutex);
+   for (port = 0; port < NELEMENTS(net->lldp_peers); port++)
+   {
+      for (ix = 0; ix < NELEMENTS(net->lldp_peers[port]); ix++)
+      {
+         p_peer = &net->lldp_peers[port][ix];
+         if (p_peer->in_use == true)
+         {
+            if (p_peer->ttl_left <= 1)
+            {
+               p_peer->in_use = false;
+            }
+            else
+            {
+               p_peer->ttl_left--;
+            }
+         }
+      }
+   }
+   os_mutex_unlock(net->lldp_mutex);
+}
+
+/**
+ * @internal
+ * Send the LLDP frames at the transmit interval.
+ *
+ * This is a callback for the scheduler. Arguments should fulfill pf_scheduler_timeout_ftn_t
+ *
+ * @param net                 InOut: The p-net stack instance
+ * @param arg                 In:   Not used.
+ * @param current_time        In:   Not used.
+ */
+static void pf_lldp_periodic(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                current_time)
+{
+   pf_lldp_send(net);
+}
+
+void pf_lldp_rx_init(
+   pnet_t                  *net)
+{
+   net->lldp_mutex = os_mutex_create();
+   memset(net->lldp_peers, 0, sizeof(net->lldp_peers));
+   net->lldp_rx_drop_cnt = 0;
 }
 
 void pf_lldp_init(
    pnet_t                  *net)
 {
+   uint16_t                port;
+   uint64_t                interval;
+   pnet_cfg_t              *p_cfg = NULL;
+
+   pf_fspm_get_cfg(net, &p_cfg);
+
+   for (port = 0; port < NELEMENTS(net->lldp_frame); port++)
+   {
+      net->lldp_frame[port] = os_buf_alloc(1500);
+   }
+   net->lldp_frame_valid = false;
+   net->lldp_timeout = 0;
+
    pf_lldp_send(net);
+
+   if (p_cfg->lldp_cfg.ttl > 0)
+   {
+      interval = (uint64_t)p_cfg->lldp_cfg.ttl * 1000 * 1000 / LLDP_TX_HOLD;
+      if (interval < LLDP_TX_INTERVAL_MIN)
+      {
+         interval = LLDP_TX_INTERVAL_MIN;
+      }
+      else if (interval > LLDP_TX_INTERVAL_MAX)
+      {
+         interval = LLDP_TX_INTERVAL_MAX;
+      }
+
+      if (pf_scheduler_add_periodic(net, (uint32_t)interval, "lldp",
+         pf_lldp_periodic, NULL, &net->lldp_timeout) != 0)
+      {
+         LOG_ERROR(PNET_LOG, "LLDP(%d): Could not schedule LLDP transmission\n", __LINE__);
+      }
+   }
+
+   net->lldp_age_timeout = 0;
+   if (pf_scheduler_add_periodic(net, LLDP_AGE_INTERVAL, "lldp_age",
+      pf_lldp_age, NULL, &net->lldp_age_timeout) != 0)
+   {
+      LOG_ERROR(PNET_LOG, "LLDP(%d): Could not schedule LLDP neighbour aging\n", __LINE__);
+   }
 }
@@ -15,7 +15,8 @@
 
 /**
  * @file
- * @brief Send LLDP frame on startup.
+ * @brief Send LLDP frames on startup and at the LLDP transmit interval.
+ *        Keep a table of the neighbours seen in received LLDP frames.
  */
 
 #ifndef PF_LLDP_H
@@ -26,11 +27,23 @@ extern "C"
 {
 #endif
 
+/**
+ * Prepare the LLDP component for received frames.
+ *
+ * This function creates the lock of the neighbour table and clears
+ * the table. It must be called before the Ethernet receive thread is
+ * started, as LLDP frames may arrive at once.
+ * @param net               InOut: The p-net stack instance
+ */
+void pf_lldp_rx_init(
+   pnet_t                  *net);
+
 /**
  * Initialize the LLDP component.
  *
- * This function initializes the LLDP component and
- * sends the initial LLDP message.
+ * This function initializes the LLDP component,
+ * sends the initial LLDP message and starts sending it
+ * periodically every TTL / 4 seconds.
  * @param net               InOut: The p-net stack instance
  */
 void pf_lldp_init(
@@ -38,11 +51,54 @@ void pf_lldp_init(
 
 /**
  * Send an LLDP message.
+ *
+ * The frames are serialized once and sent as they are until
+ * pf_lldp_invalidate() is called.
  * @param net              InOut: The p-net stack instance
  */
 void pf_lldp_send(
    pnet_t                  *net);
 
+/**
+ * Discard the serialized LLDP frames.
+ *
+ * Must be called whenever data reported in the frames (name of station,
+ * IP address, port status) is changed. The frames are rebuilt when they
+ * are sent next time.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_lldp_invalidate(
+   pnet_t                  *net);
+
+/**
+ * Handle a received LLDP frame.
+ *
+ * The neighbour in the frame is inserted or refreshed in the
+ * neighbour table. It is removed when its TTL expires.
+ * @param net              InOut: The p-net stack instance
+ * @param p_buf            In:   The received frame. Freed by this function.
+ * @param offset           In:   Position of the LLDP-PDU in the frame.
+ * @return  1 (handled).
+ */
+int pf_lldp_recv(
+   pnet_t                  *net,
+   os_buf_t                *p_buf,
+   uint16_t                offset);
+
+/**
+ * Get a copy of the neighbours seen on a port.
+ * @param net              InOut: The p-net stack instance
+ * @param port             In:   The port index, starting at 0.
+ * @param p_peers          Out:  The neighbours.
+ * @param max_peers        In:   Size of p_peers.
+ * @return  the number of neighbours copied to p_peers.
+ */
+uint16_t pf_lldp_get_peers(
+   pnet_t                  *net,
+   uint16_t                port,
+   pf_lldp_peer_t          *p_peers,
+   uint16_t                max_peers);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,8 +22,23 @@
  * There are functions used by the application (via pnet_api.c) to set and get
  * data, IOCS and IOPS.
  *
- * A global mutex is used instead of a per-instance mutex.
- * The locking time is very low so it should not be very congested.
+ * The data of each PPM instance is triple buffered. The application
+ * writes to one buffer and publishes it by exchanging it with the "ready"
+ * buffer. The sender exchanges its own buffer with the "ready" buffer when
+ * a new one has been published, and copies it to the frame. Neither side
+ * ever waits for the other.
+ *
+ * Each published buffer carries the range of bytes changed since the buffer
+ * published before it. If the sender skips a buffer then its range is
+ * merged into the next one. So the sender only copies the changed range
+ * into the frame, which otherwise keeps the data it was last sent with.
+ *
+ * The application side also tracks, for each buffer, the range where it
+ * lags the latest data. When a buffer comes back to the application it is
+ * brought up to date by copying only that range.
+ *
+ * A global mutex serializes the application calls (writers and readers of
+ * the application buffer). It is never taken by the sender.
  * The mutex is created on the first call to pf_ppm_create and deleted on
  * the last call to pf_ppm_close.
  * Keep track of how many instances exist and delete the mutex when the
@@ -42,6 +57,10 @@
 
 static const char          *ppm_sync_name = "ppm";
 
+/* buffer_ready: Index of the buffer, and a flag telling it is not yet sent */
+#define PF_PPM_BUFFER_IX_MASK    0x00000003
+#define PF_PPM_BUFFER_NEW        0x80000000
+
 void pf_ppm_init(
    pnet_t                  *net)
 {
@@ -129,34 +148,172 @@ static void pf_ppm_init_buf(
    pos += sizeof(u16);
 }
 
+/**
+ * @internal
+ * Extend the changed range of the application buffer.
+ * Must be called with ppm_buf_lock held.
+ * @param p_ppm            In:   The PPM instance.
+ * @param offset           In:   Offset of the changed bytes.
+ * @param len              In:   Number of changed bytes.
+ */
+static void pf_ppm_mark_dirty(
+   pf_ppm_t                *p_ppm,
+   uint16_t                offset,
+   uint16_t                len)
+{
+   if (offset < p_ppm->write_start)
+   {
+      p_ppm->write_start = offset;
+   }
+   if (offset + len > p_ppm->write_end)
+   {
+      p_ppm->write_end = offset + len;
+   }
+}
+
 /**
  * @internal
  * Finalize a PPM transmit message.
+ *
+ * The cycle counter is derived from the deadline of the send. It normally
+ * advances by the send interval, and is only re-computed from the deadline
+ * after missed deadlines.
  * @param net              InOut: The p-net stack instance
  * @param p_ppm            In:   The PPM instance.
  * @param data_length      In:   The length of the message.
+ * @param deadline         In:   The scheduled time of the send, in us.
  */
 static void pf_ppm_finish_buffer(
    pnet_t                  *net,
    pf_ppm_t                *p_ppm,
-   uint16_t                data_length)
+   uint16_t                data_length,
+   uint32_t                deadline)
 {
    uint8_t                 *p_payload = ((os_buf_t*)p_ppm->p_send_buffer)->payload;
    uint16_t                u16;
-   int32_t                 cycle_tmp = os_get_current_time_us()*4;
+   uint32_t                ready;
+   uint16_t                start;
+   uint16_t                end;
 
-   p_ppm->cycle = cycle_tmp/125;           /* Get 4/125 = 31.25us tics */
+   if ((p_ppm->first_transmit == true) &&
+       ((deadline - p_ppm->cycle_deadline) == p_ppm->control_interval))
+   {
+      p_ppm->cycle += p_ppm->cycle_step;
+   }
+   else
+   {
+      p_ppm->cycle = (uint16_t)(((uint64_t)deadline * 4) / 125);  /* Get 4/125 = 31.25us tics */
+   }
+   p_ppm->cycle_deadline = deadline;
    u16 = htons(p_ppm->cycle);
 
-   os_mutex_lock(net->ppm_buf_lock);
-   memcpy(&p_payload[p_ppm->buffer_pos], p_ppm->buffer_data, data_length);
-   os_mutex_unlock(net->ppm_buf_lock);
+   /* Take the latest published buffer, if any. Otherwise resend the current one. */
+   if ((CC_ATOMIC_GET32(&p_ppm->buffer_ready) & PF_PPM_BUFFER_NEW) != 0)
+   {
+      do
+      {
+         ready = CC_ATOMIC_GET32(&p_ppm->buffer_ready);
+      } while (CC_ATOMIC_CAS32(&p_ppm->buffer_ready, ready, p_ppm->buffer_send) == false);
+      p_ppm->buffer_send = ready & PF_PPM_BUFFER_IX_MASK;
+
+      /* Refresh only what changed since the data in the frame */
+      start = p_ppm->dirty_start[p_ppm->buffer_send];
+      end = p_ppm->dirty_end[p_ppm->buffer_send];
+      if (end > data_length)
+      {
+         end = data_length;
+      }
+      if (start < end)
+      {
+         memcpy(&p_payload[p_ppm->buffer_pos + start],
+            &p_ppm->buffer_data[p_ppm->buffer_send][start], end - start);
+      }
+   }
 
    memcpy(&p_payload[p_ppm->cycle_counter_offset], &u16, sizeof(u16));
    memcpy(&p_payload[p_ppm->data_status_offset], &p_ppm->data_status, sizeof(p_ppm->data_status));
    memcpy(&p_payload[p_ppm->transfer_status_offset], &p_ppm->transfer_status, sizeof(p_ppm->transfer_status));
 }
 
+/**
+ * @internal
+ * Publish the application buffer of a PPM instance to the sender.
+ *
+ * The application buffer is exchanged with the ready buffer. The new
+ * application buffer is then brought up to date, so it holds the data of
+ * all earlier calls. Only the range changed since the buffer was last up
+ * to date is copied.
+ * Must be called with ppm_buf_lock held.
+ * @param p_ppm            In:   The PPM instance.
+ * @param data_length      In:   The length of the PROFINET data.
+ */
+static void pf_ppm_publish_buffer(
+   pf_ppm_t                *p_ppm,
+   uint16_t                data_length)
+{
+   uint32_t                published = p_ppm->buffer_write;
+   uint32_t                ready;
+   uint32_t                ix;
+
+   do
+   {
+      ready = CC_ATOMIC_GET32(&p_ppm->buffer_ready);
+      p_ppm->dirty_start[published] = p_ppm->write_start;
+      p_ppm->dirty_end[published] = p_ppm->write_end;
+      if ((ready & PF_PPM_BUFFER_NEW) != 0)
+      {
+         /* The sender will skip the unsent buffer, so include its changes */
+         ix = ready & PF_PPM_BUFFER_IX_MASK;
+         if (p_ppm->dirty_start[ix] < p_ppm->dirty_start[published])
+         {
+            p_ppm->dirty_start[published] = p_ppm->dirty_start[ix];
+         }
+         if (p_ppm->dirty_end[ix] > p_ppm->dirty_end[published])
+         {
+            p_ppm->dirty_end[published] = p_ppm->dirty_end[ix];
+         }
+      }
+   } while (CC_ATOMIC_CAS32(&p_ppm->buffer_ready, ready, published | PF_PPM_BUFFER_NEW) == false);
+   p_ppm->buffer_write = ready & PF_PPM_BUFFER_IX_MASK;
+
+   /* The other buffers now lag the published one by the written range */
+   for (ix = 0; ix < NELEMENTS(p_ppm->stale_start); ix++)
+   {
+      if (ix == published)
+      {
+         p_ppm->stale_start[ix] = UINT16_MAX;
+         p_ppm->stale_end[ix] = 0;
+      }
+      else
+      {
+         if (p_ppm->write_start < p_ppm->stale_start[ix])
+         {
+            p_ppm->stale_start[ix] = p_ppm->write_start;
+         }
+         if (p_ppm->write_end > p_ppm->stale_end[ix])
+         {
+            p_ppm->stale_end[ix] = p_ppm->write_end;
+         }
+      }
+   }
+   p_ppm->write_start = UINT16_MAX;
+   p_ppm->write_end = 0;
+
+   ix = p_ppm->buffer_write;
+   if (p_ppm->stale_end[ix] > data_length)
+   {
+      p_ppm->stale_end[ix] = data_length;
+   }
+   if (p_ppm->stale_start[ix] < p_ppm->stale_end[ix])
+   {
+      memcpy(&p_ppm->buffer_data[ix][p_ppm->stale_start[ix]],
+         &p_ppm->buffer_data[published][p_ppm->stale_start[ix]],
+         p_ppm->stale_end[ix] - p_ppm->stale_start[ix]);
+   }
+   p_ppm->stale_start[ix] = UINT16_MAX;
+   p_ppm->stale_end[ix] = 0;
+}
+
 /**
  * @internal
  * Send the PPM data message to the controller.
@@ -164,7 +321,7 @@ static void pf_ppm_finish_buffer(
  * This is a callback for the scheduler. Arguments should fulfill pf_scheduler_timeout_ftn_t
  *
  * If the PPM has not been stopped during the wait then a data message
- * is sent and the function is rescheduled.
+ * is sent. The function is called periodically by the scheduler.
  *
  * @param net              InOut: The p-net stack instance
  * @param arg              In:   The IOCR instance.
@@ -178,36 +335,33 @@ static void pf_ppm_send(
    pf_iocr_t               *p_arg = (pf_iocr_t *)arg;
    uint32_t                start = os_get_current_time_us();
 
-   p_arg->ppm.ci_timer = UINT32_MAX;
    if (p_arg->ppm.ci_running == true)
    {
       /* in_length is size of input to the controller */
-      pf_ppm_finish_buffer(net, &p_arg->ppm, p_arg->in_length);
+      pf_ppm_finish_buffer(net, &p_arg->ppm, p_arg->in_length, current_time);
       /* Now send it */
       /* ToDo: Handle RT_CLASS_UDP */
       if (os_eth_send(p_arg->p_ar->p_sess->eth_handle, p_arg->ppm.p_send_buffer) <= 0)
       {
          LOG_ERROR(PF_PPM_LOG, "PPM(%d): Error from os_eth_send(ppm)\n", __LINE__);
+         pf_scheduler_remove(net, ppm_sync_name, p_arg->ppm.ci_timer);
+         p_arg->ppm.ci_timer = UINT32_MAX;
       }
       else
       {
-         /* Compensate for the execution delay variations */
-         if (pf_scheduler_add(net, p_arg->ppm.control_interval, ppm_sync_name, pf_ppm_send, arg, &p_arg->ppm.ci_timer) == 0)
+         p_arg->ppm.trx_cnt++;
+         if (p_arg->ppm.first_transmit == false)
          {
-            p_arg->ppm.trx_cnt++;
-            if (p_arg->ppm.first_transmit == false)
-            {
-               pf_ppm_state_ind(net, p_arg->p_ar, &p_arg->ppm, false);   /* No error */
-               p_arg->ppm.first_transmit = true;
-            }
-         }
-         else
-         {
-            p_arg->ppm.ci_timer = UINT32_MAX;
-            pf_ppm_state_ind(net, p_arg->p_ar, &p_arg->ppm, true);       /* Error */
+            pf_ppm_state_ind(net, p_arg->p_ar, &p_arg->ppm, false);   /* No error */
+            p_arg->ppm.first_transmit = true;
          }
       }
    }
+   else if (p_arg->ppm.ci_timer != UINT32_MAX)
+   {
+      pf_scheduler_remove(net, ppm_sync_name, p_arg->ppm.ci_timer);
+      p_arg->ppm.ci_timer = UINT32_MAX;
+   }
    p_arg->ppm.exec = os_get_current_time_us() - start;
 }
 
@@ -249,8 +403,21 @@ int pf_ppm_activate_req(
       p_ppm->buffer_pos = 2*sizeof(pnet_ethaddr_t) + vlan_size + sizeof(uint16_t) + sizeof(uint16_t);
 
       p_ppm->cycle = 0;
+      p_ppm->cycle_step = p_iocr->param.send_clock_factor * p_iocr->param.reduction_ratio;
+      p_ppm->cycle_deadline = 0;
       p_ppm->transfer_status = 0;
 
+      memset(p_ppm->buffer_data, 0, sizeof(p_ppm->buffer_data));
+      p_ppm->buffer_write = 0;
+      p_ppm->buffer_send = 1;
+      p_ppm->buffer_ready = 2;
+      p_ppm->write_start = UINT16_MAX;
+      p_ppm->write_end = 0;
+      memset(p_ppm->dirty_start, 0, sizeof(p_ppm->dirty_start));
+      memset(p_ppm->dirty_end, 0, sizeof(p_ppm->dirty_end));
+      memset(p_ppm->stale_start, 0xff, sizeof(p_ppm->stale_start));
+      memset(p_ppm->stale_end, 0, sizeof(p_ppm->stale_end));
+
       /* Pre-compute some offsets into the send buffer */
       p_ppm->cycle_counter_offset = p_ppm->buffer_pos +           /* ETH frame header */
             p_iocr->param.c_sdu_length;                           /* Profinet data length */
@@ -286,7 +453,7 @@ int pf_ppm_activate_req(
       pf_ppm_set_state(p_ppm, PF_PPM_STATE_RUN);
 
       p_ppm->ci_running = true;
-      ret = pf_scheduler_add(net, p_ppm->control_interval,
+      ret = pf_scheduler_add_periodic(net, p_ppm->control_interval,
          ppm_sync_name, pf_ppm_send, p_iocr, &p_ppm->ci_timer);
       if (ret != 0)
       {
@@ -330,84 +497,75 @@ int pf_ppm_close_req(
    return 0;
 }
 
+/**************** Set and get data, IOPS and IOCS ****************************/
+
 /**
  * @internal
- * Find the AR, input IOCR and IODATA object instances for the specified sub-slot.
+ * Set the data and IOPS of a sub-module in the PPM buffer.
  * @param net              InOut: The p-net stack instance
- * @param api_id           In:   The API id.
- * @param slot_nbr         In:   The slot number.
- * @param subslot_nbr      In:   The sub-slot number.
- * @param pp_ar            Out:  The AR instance.
- * @param pp_iocr          Out:  The IOCR instance.
- * @param pp_iodata        Out:  The IODATA object instance.
- * @return  0  If the information has been found.
- *          -1 If the information was not found.
+ * @param p_ar             In:   The AR instance.
+ * @param p_iocr           In:   The IOCR instance.
+ * @param p_iodata         In:   The IODATA object instance.
+ * @param p_data           In:   The application data.
+ * @param data_len         In:   The length of the application data.
+ * @param p_iops           In:   The IOPS of the application data.
+ * @param iops_len         In:   The length of the IOPS.
+ * @return  0  on success.
+ *          -1 if an error occurred.
  */
-static int pf_ppm_get_ar_iocr_desc(
+static int pf_ppm_set_data_and_iops_desc(
    pnet_t                  *net,
-   uint32_t                api_id,
-   uint16_t                slot_nbr,
-   uint16_t                subslot_nbr,
-   pf_ar_t                 **pp_ar,
-   pf_iocr_t               **pp_iocr,
-   pf_iodata_object_t      **pp_iodata)
+   pf_ar_t                 *p_ar,
+   pf_iocr_t               *p_iocr,
+   pf_iodata_object_t      *p_iodata,
+   uint8_t                 *p_data,
+   uint16_t                data_len,
+   uint8_t                 *p_iops,
+   uint8_t                 iops_len)
 {
    int                     ret = -1;
-   uint32_t                crep;
-   uint16_t                iodata_ix;
-   pf_subslot_t            *p_subslot = NULL;
-   pf_ar_t                 *p_ar = NULL;
-   pf_iocr_t               *p_iocr = NULL;
-   bool                    found = false;
-
-   if (pf_cmdev_get_subslot_full(net, api_id, slot_nbr, subslot_nbr, &p_subslot) == 0)
-   {
-      p_ar = p_subslot->p_ar;
-   }
 
-   if (p_ar == NULL)
-   {
-      LOG_DEBUG(PF_PPM_LOG, "PPM(%d): No AR set in sub-slot\n", __LINE__);
-   }
-   else
+   switch (p_iocr->ppm.state)
    {
-      /*
-       * Search the AR for an INPUT CR or an MC provider CR containing the
-       * sub-slot.
-       */
-      for (crep = 0; ((found == false) && (crep < p_ar->nbr_iocrs)); crep++)
+   case PF_PPM_STATE_W_START:
+      p_ar->err_cls = PNET_ERROR_CODE_1_PPM;
+      p_ar->err_code = PNET_ERROR_CODE_2_PPM_INVALID_STATE;
+      LOG_DEBUG(PF_PPM_LOG, "PPM(%d): Set data in wrong state: %u\n", __LINE__, p_iocr->ppm.state);
+      break;
+   case PF_PPM_STATE_RUN:
+      if ((data_len == p_iodata->data_length) && (iops_len == p_iodata->iops_length))
       {
-         if ((p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_INPUT) ||
-             (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_PROVIDER))
+         os_mutex_lock(net->ppm_buf_lock);
+         if (data_len > 0)
          {
-            p_iocr = &p_ar->iocrs[crep];
-            for (iodata_ix = 0; ((found == false) && (iodata_ix < p_iocr->nbr_data_desc)); iodata_ix++)
-            {
-               if ((p_iocr->data_desc[iodata_ix].in_use == true) &&
-                   (p_iocr->data_desc[iodata_ix].api_id == api_id) &&
-                   (p_iocr->data_desc[iodata_ix].slot_nbr == slot_nbr) &&
-                   (p_iocr->data_desc[iodata_ix].subslot_nbr == subslot_nbr))
-               {
-                  *pp_iodata = &p_iocr->data_desc[iodata_ix];
-                  *pp_iocr = p_iocr;
-                  *pp_ar = p_ar;
-                  found = true;
-               }
-            }
+            memcpy(&p_iocr->ppm.buffer_data[p_iocr->ppm.buffer_write][p_iodata->data_offset], p_data, data_len);
+            pf_ppm_mark_dirty(&p_iocr->ppm, p_iodata->data_offset, data_len);
          }
-      }
-   }
+         if (iops_len > 0)
+         {
+            memcpy(&p_iocr->ppm.buffer_data[p_iocr->ppm.buffer_write][p_iodata->iops_offset], p_iops, iops_len);
+            pf_ppm_mark_dirty(&p_iocr->ppm, p_iodata->iops_offset, iops_len);
+         }
+         pf_ppm_publish_buffer(&p_iocr->ppm, p_iocr->in_length);
+         os_mutex_unlock(net->ppm_buf_lock);
 
-   if (found == true)
-   {
-      ret = 0;
+         p_iodata->data_avail = true;
+         ret = 0;
+      }
+      else
+      {
+         LOG_ERROR(PF_PPM_LOG, "PPM(%d): data_len, iops_len %u %u expected lengths %u %u\n", __LINE__,
+            data_len, iops_len, p_iodata->data_length, p_iodata->iops_length);
+      }
+      break;
+   default:
+      LOG_ERROR(PF_PPM_LOG, "PPM(%d): Set data in wrong state: %u\n", __LINE__, p_iocr->ppm.state);
+      break;
    }
 
    return ret;
 }
 
-/**************** Set and get data, IOPS and IOCS ****************************/
-
 int pf_ppm_set_data_and_iops(
    pnet_t                  *net,
    uint32_t                api_id,
@@ -423,42 +581,9 @@ int pf_ppm_set_data_and_iops(
    pf_iodata_object_t      *p_iodata = NULL;
    pf_ar_t                 *p_ar = NULL;
 
-   if (pf_ppm_get_ar_iocr_desc(net, api_id, slot_nbr, subslot_nbr, &p_ar, &p_iocr, &p_iodata) == 0)
+   if (pf_cmdev_get_io_desc(net, api_id, slot_nbr, subslot_nbr, PF_DIRECTION_INPUT, &p_ar, &p_iocr, &p_iodata) == 0)
    {
-      switch (p_iocr->ppm.state)
-      {
-      case PF_PPM_STATE_W_START:
-         p_ar->err_cls = PNET_ERROR_CODE_1_PPM;
-         p_ar->err_code = PNET_ERROR_CODE_2_PPM_INVALID_STATE;
-         LOG_DEBUG(PF_PPM_LOG, "PPM(%d): Set data in wrong state: %u\n", __LINE__, p_iocr->ppm.state);
-         break;
-      case PF_PPM_STATE_RUN:
-         if ((data_len == p_iodata->data_length) && (iops_len == p_iodata->iops_length))
-         {
-            os_mutex_lock(net->ppm_buf_lock);
-            if (data_len > 0)
-            {
-               memcpy(&p_iocr->ppm.buffer_data[p_iodata->data_offset], p_data, data_len);
-            }
-            if (iops_len > 0)
-            {
-               memcpy(&p_iocr->ppm.buffer_data[p_iodata->iops_offset], p_iops, iops_len);
-            }
-            os_mutex_unlock(net->ppm_buf_lock);
-
-            p_iodata->data_avail = true;
-            ret = 0;
-         }
-         else
-         {
-            LOG_ERROR(PF_PPM_LOG, "PPM(%d): data_len, iops_len %u %u expected lengths %u %u\n", __LINE__,
-               data_len, iops_len, p_iodata->data_length, p_iodata->iops_length);
-         }
-         break;
-      default:
-         LOG_ERROR(PF_PPM_LOG, "PPM(%d): Set data in wrong state: %u\n", __LINE__, p_iocr->ppm.state);
-         break;
-      }
+      ret = pf_ppm_set_data_and_iops_desc(net, p_ar, p_iocr, p_iodata, p_data, data_len, p_iops, iops_len);
    }
    else
    {
@@ -469,6 +594,91 @@ int pf_ppm_set_data_and_iops(
    return ret;
 }
 
+int pf_ppm_io_set_data_and_iops(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_data,
+   uint16_t                data_len,
+   uint8_t                 *p_iops,
+   uint8_t                 iops_len)
+{
+   int                     ret = -1;
+   pf_iocr_t               *p_iocr = NULL;
+   pf_iodata_object_t      *p_iodata = NULL;
+   pf_ar_t                 *p_ar = NULL;
+
+   if (pf_cmdev_get_io_desc_by_handle(net, handle, PF_DIRECTION_INPUT, &p_ar, &p_iocr, &p_iodata) == 0)
+   {
+      ret = pf_ppm_set_data_and_iops_desc(net, p_ar, p_iocr, p_iodata, p_data, data_len, p_iops, iops_len);
+   }
+   else
+   {
+      /* May happen after an ABORT */
+      LOG_DEBUG(PF_PPM_LOG, "PPM(%d): Invalid IO handle 0x%08x\n", __LINE__, (unsigned)handle);
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Set the IOCS of a sub-module in the PPM buffer.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             In:   The AR instance.
+ * @param p_iocr           In:   The IOCR instance.
+ * @param p_iodata         In:   The IODATA object instance.
+ * @param p_iocs           In:   The IOCS of the application data.
+ * @param iocs_len         In:   The length of the IOCS data.
+ * @return  0  on success.
+ *          -1 if an error occurred.
+ */
+static int pf_ppm_set_iocs_desc(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar,
+   pf_iocr_t               *p_iocr,
+   pf_iodata_object_t      *p_iodata,
+   uint8_t                 *p_iocs,
+   uint8_t                 iocs_len)
+{
+   int                     ret = -1;
+
+   switch (p_iocr->ppm.state)
+   {
+   case PF_PPM_STATE_W_START:
+      p_ar->err_cls = PNET_ERROR_CODE_1_PPM;
+      p_ar->err_code = PNET_ERROR_CODE_2_PPM_INVALID_STATE;
+      LOG_DEBUG(PF_PPM_LOG, "PPM(%d): Set iocs in wrong state: %u\n", __LINE__, p_iocr->ppm.state);
+      break;
+   case PF_PPM_STATE_RUN:
+      if (iocs_len == p_iodata->iocs_length)
+      {
+         os_mutex_lock(net->ppm_buf_lock);
+         memcpy(&p_iocr->ppm.buffer_data[p_iocr->ppm.buffer_write][p_iodata->iocs_offset], p_iocs, iocs_len);
+         pf_ppm_mark_dirty(&p_iocr->ppm, p_iodata->iocs_offset, iocs_len);
+         pf_ppm_publish_buffer(&p_iocr->ppm, p_iocr->in_length);
+         os_mutex_unlock(net->ppm_buf_lock);
+
+         ret = 0;
+      }
+      else if (p_iodata->iocs_length == 0)
+      {
+         /* ToDo: What does the spec say about this case? */
+         LOG_DEBUG(PF_PPM_LOG, "PPM(%d): iocs_len is zero\n", __LINE__);
+         ret = 0;
+      }
+      else
+      {
+         LOG_ERROR(PF_PPM_LOG, "PPM(%d): iocs_len %u expected length %u\n", __LINE__, (unsigned)p_iodata->iocs_length, (unsigned)sizeof(uint8_t));
+      }
+      break;
+   default:
+      LOG_ERROR(PF_PPM_LOG, "PPM(%d): Set data in wrong state: %u\n", __LINE__, (unsigned)p_iocr->ppm.state);
+      break;
+   }
+
+   return ret;
+}
+
 int pf_ppm_set_iocs(
    pnet_t                  *net,
    uint32_t                api_id,
@@ -482,39 +692,9 @@ int pf_ppm_set_iocs(
    pf_iodata_object_t      *p_iodata = NULL;
    pf_ar_t                 *p_ar = NULL;
 
-   if (pf_ppm_get_ar_iocr_desc(net, api_id, slot_nbr, subslot_nbr, &p_ar, &p_iocr, &p_iodata) == 0)
+   if (pf_cmdev_get_io_desc(net, api_id, slot_nbr, subslot_nbr, PF_DIRECTION_INPUT, &p_ar, &p_iocr, &p_iodata) == 0)
    {
-      switch (p_iocr->ppm.state)
-      {
-      case PF_PPM_STATE_W_START:
-         p_ar->err_cls = PNET_ERROR_CODE_1_PPM;
-         p_ar->err_code = PNET_ERROR_CODE_2_PPM_INVALID_STATE;
-         LOG_DEBUG(PF_PPM_LOG, "PPM(%d): Set iocs in wrong state: %u\n", __LINE__, p_iocr->ppm.state);
-         break;
-      case PF_PPM_STATE_RUN:
-         if (iocs_len == p_iodata->iocs_length)
-         {
-            os_mutex_lock(net->ppm_buf_lock);
-            memcpy(&p_iocr->ppm.buffer_data[p_iodata->iocs_offset], p_iocs, iocs_len);
-            os_mutex_unlock(net->ppm_buf_lock);
-
-            ret = 0;
-         }
-         else if (p_iodata->iocs_length == 0)
-         {
-            /* ToDo: What does the spec say about this case? */
-            LOG_DEBUG(PF_PPM_LOG, "PPM(%d): iocs_len is zero\n", __LINE__);
-            ret = 0;
-         }
-         else
-         {
-            LOG_ERROR(PF_PPM_LOG, "PPM(%d): iocs_len %u expected length %u\n", __LINE__, (unsigned)p_iodata->iocs_length, (unsigned)sizeof(uint8_t));
-         }
-         break;
-      default:
-         LOG_ERROR(PF_PPM_LOG, "PPM(%d): Set data in wrong state: %u\n", __LINE__, (unsigned)p_iocr->ppm.state);
-         break;
-      }
+      ret = pf_ppm_set_iocs_desc(net, p_ar, p_iocr, p_iodata, p_iocs, iocs_len);
    }
    else
    {
@@ -525,6 +705,30 @@ int pf_ppm_set_iocs(
    return ret;
 }
 
+int pf_ppm_io_set_iocs(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_iocs,
+   uint8_t                 iocs_len)
+{
+   int                     ret = -1;
+   pf_iocr_t               *p_iocr = NULL;
+   pf_iodata_object_t      *p_iodata = NULL;
+   pf_ar_t                 *p_ar = NULL;
+
+   if (pf_cmdev_get_io_desc_by_handle(net, handle, PF_DIRECTION_INPUT, &p_ar, &p_iocr, &p_iodata) == 0)
+   {
+      ret = pf_ppm_set_iocs_desc(net, p_ar, p_iocr, p_iodata, p_iocs, iocs_len);
+   }
+   else
+   {
+      /* May happen after an ABORT */
+      LOG_DEBUG(PF_PPM_LOG, "PPM(%d): Invalid IO handle 0x%08x\n", __LINE__, (unsigned)handle);
+   }
+
+   return ret;
+}
+
 int pf_ppm_get_data_and_iops(
    pnet_t                  *net,
    uint32_t                api_id,
@@ -540,7 +744,7 @@ int pf_ppm_get_data_and_iops(
    pf_iodata_object_t      *p_iodata = NULL;
    pf_ar_t                 *p_ar = NULL;
 
-   if (pf_ppm_get_ar_iocr_desc(net, api_id, slot_nbr, subslot_nbr, &p_ar, &p_iocr, &p_iodata) == 0)
+   if (pf_cmdev_get_io_desc(net, api_id, slot_nbr, subslot_nbr, PF_DIRECTION_INPUT, &p_ar, &p_iocr, &p_iodata) == 0)
    {
       switch (p_iocr->ppm.state)
       {
@@ -553,8 +757,8 @@ int pf_ppm_get_data_and_iops(
          if ((*p_data_len >= p_iodata->data_length) && (*p_iops_len >= p_iodata->iops_length))
          {
             os_mutex_lock(net->ppm_buf_lock);
-            memcpy(p_data, &p_iocr->ppm.buffer_data[p_iodata->data_offset], p_iodata->data_length);
-            memcpy(p_iops, &p_iocr->ppm.buffer_data[p_iodata->iops_offset], p_iodata->iops_length);
+            memcpy(p_data, &p_iocr->ppm.buffer_data[p_iocr->ppm.buffer_write][p_iodata->data_offset], p_iodata->data_length);
+            memcpy(p_iops, &p_iocr->ppm.buffer_data[p_iocr->ppm.buffer_write][p_iodata->iops_offset], p_iodata->iops_length);
             os_mutex_unlock(net->ppm_buf_lock);
 
             *p_data_len = p_iodata->data_length;
@@ -606,7 +810,7 @@ int pf_ppm_get_iocs(
    pf_iodata_object_t      *p_iodata = NULL;
    pf_ar_t                 *p_ar = NULL;
 
-   if (pf_ppm_get_ar_iocr_desc(net, api_id, slot_nbr, subslot_nbr, &p_ar, &p_iocr, &p_iodata) == 0)
+   if (pf_cmdev_get_io_desc(net, api_id, slot_nbr, subslot_nbr, PF_DIRECTION_INPUT, &p_ar, &p_iocr, &p_iodata) == 0)
    {
       switch (p_iocr->ppm.state)
       {
@@ -619,7 +823,7 @@ int pf_ppm_get_iocs(
          if (*p_iocs_len >= p_iodata->iocs_length)
          {
             os_mutex_lock(net->ppm_buf_lock);
-            memcpy(p_iocs, &p_iocr->ppm.buffer_data[p_iodata->iocs_offset], p_iodata->iocs_length);
+            memcpy(p_iocs, &p_iocr->ppm.buffer_data[p_iocr->ppm.buffer_write][p_iodata->iocs_offset], p_iodata->iocs_length);
             os_mutex_unlock(net->ppm_buf_lock);
 
             *p_iocs_len = (uint8_t)p_iodata->iocs_length;
@@ -775,9 +979,10 @@ void pf_ppm_show(
    printf("   trx_cnt            = %u\n", (unsigned)p_ppm->trx_cnt);
    printf("   p_send_buffer      = %p\n", p_ppm->p_send_buffer);
    printf("   p_send_buffer->len = %u\n", p_ppm->p_send_buffer ? ((os_buf_t *)(p_ppm->p_send_buffer))->len : 0);
-   printf("   new_buf            = %u\n", (unsigned)p_ppm->new_buf);
+   printf("   buffer_ready       = 0x%08x\n", (unsigned)p_ppm->buffer_ready);
    printf("   control_interval   = %u\n", (unsigned)p_ppm->control_interval);
    printf("   cycle              = %u\n", (unsigned)p_ppm->cycle);
+   printf("   cycle_step         = %u\n", (unsigned)p_ppm->cycle_step);
    printf("   cycle_counter_off  = %u\n", (unsigned)p_ppm->cycle_counter_offset);
    printf("   data_status_offset = %u\n", (unsigned)p_ppm->data_status_offset);
    printf("   transfer_status_of = %u\n", (unsigned)p_ppm->transfer_status_offset);
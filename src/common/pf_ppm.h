@@ -78,6 +78,25 @@ int pf_ppm_set_data_and_iops(
    uint8_t                 *p_iops,
    uint8_t                 iops_len);
 
+/**
+ * Same as pf_ppm_set_data_and_iops(), for a sub-slot handle.
+ * @param net              InOut: The p-net stack instance
+ * @param handle           In:   Handle from pf_cmdev_get_io_handle().
+ * @param p_data           In:   The application data.
+ * @param data_len         In:   The length of the application data.
+ * @param p_iops           In:   The IOPS of the application data.
+ * @param iops_len         In:   The length of the IOPS.
+ * @return  0  if the input data and IOPS was set.
+ *          -1 if an error occurred.
+ */
+int pf_ppm_io_set_data_and_iops(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_data,
+   uint16_t                data_len,
+   uint8_t                 *p_iops,
+   uint8_t                 iops_len);
+
 /**
  * Set IOCS for a sub-module.
  * @param net              InOut: The p-net stack instance
@@ -97,6 +116,21 @@ int pf_ppm_set_iocs(
    uint8_t                 *p_iocs,
    uint8_t                 iocs_len);
 
+/**
+ * Same as pf_ppm_set_iocs(), for a sub-slot handle.
+ * @param net              InOut: The p-net stack instance
+ * @param handle           In:   Handle from pf_cmdev_get_io_handle().
+ * @param p_iocs           In:   The IOCS of the application data.
+ * @param iocs_len         In:   The length of the IOCS data.
+ * @return  0  if the IOCS was set.
+ *          -1 if an error occurred.
+ */
+int pf_ppm_io_set_iocs(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_iocs,
+   uint8_t                 iocs_len);
+
 /**
  * Retrieve the data and IOPS for a sub-module.
  * @param net              InOut: The p-net stack instance
@@ -21,6 +21,7 @@
 #include "pf_includes.h"
 
 
+#ifndef NDEBUG
 static bool pf_scheduler_is_linked(
    pnet_t                  *net,
    uint32_t                first,
@@ -44,6 +45,7 @@ static bool pf_scheduler_is_linked(
 
    return ret;
 }
+#endif
 
 static void pf_scheduler_unlink(
    pnet_t                  *net,
@@ -58,10 +60,12 @@ static void pf_scheduler_unlink(
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): ix (%u) is invalid\n", __LINE__, (unsigned)ix);
    }
+#ifndef NDEBUG
    else if (pf_scheduler_is_linked(net, *p_q, ix) == false)
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): %s is not in Q\n", __LINE__, net->scheduler_timeouts[ix].p_name);
    }
+#endif
    else
    {
       prev_ix = net->scheduler_timeouts[ix].prev;
@@ -81,6 +85,7 @@ static void pf_scheduler_unlink(
    }
 }
 
+#if PF_SCHEDULER_BACKEND == PF_SCHEDULER_BACKEND_LIST
 static void pf_scheduler_link_after(
    pnet_t                  *net,
    volatile uint32_t       *p_q,
@@ -93,10 +98,12 @@ static void pf_scheduler_link_after(
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): ix (%u) is invalid\n", __LINE__, (unsigned)ix);
    }
+#ifndef NDEBUG
    else if (pf_scheduler_is_linked(net, *p_q, ix) == true)
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): %s is already in Q\n", __LINE__, net->scheduler_timeouts[ix].p_name);
    }
+#endif
    else if (pos >= PF_MAX_TIMEOUTS)
    {
       /* Put first in possible non-empty Q */
@@ -132,6 +139,8 @@ static void pf_scheduler_link_after(
    }
 }
 
+#endif
+
 static void pf_scheduler_link_before(
    pnet_t                  *net,
    volatile uint32_t       *p_q,
@@ -144,10 +153,12 @@ static void pf_scheduler_link_before(
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): ix (%u) is invalid\n", __LINE__, (unsigned)ix);
    }
+#ifndef NDEBUG
    else if (pf_scheduler_is_linked(net, *p_q, ix) == true)
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): %s is already in Q\n", __LINE__, net->scheduler_timeouts[ix].p_name);
    }
+#endif
    else if (pos >= PF_MAX_TIMEOUTS)
    {
       /* Put first in possible non-empty Q */
@@ -189,6 +200,481 @@ static void pf_scheduler_link_before(
    }
 }
 
+#if PF_SCHEDULER_BACKEND == PF_SCHEDULER_BACKEND_HEAP
+/**
+ * @internal
+ * Check if timeout ix_a expires before timeout ix_b.
+ * @param net              InOut: The p-net stack instance
+ * @param ix_a             In:   Timeout index.
+ * @param ix_b             In:   Timeout index.
+ * @return  true  if ix_a expires before ix_b.
+ *          false otherwise.
+ */
+static bool pf_scheduler_heap_before(
+   pnet_t                  *net,
+   uint32_t                ix_a,
+   uint32_t                ix_b)
+{
+   return ((int32_t)(net->scheduler_timeouts[ix_a].when - net->scheduler_timeouts[ix_b].when)) < 0;
+}
+
+/**
+ * @internal
+ * Put a timeout at a specific position in the busy heap.
+ * @param net              InOut: The p-net stack instance
+ * @param pos              In:   Heap position.
+ * @param ix               In:   Timeout index.
+ */
+static void pf_scheduler_heap_set(
+   pnet_t                  *net,
+   uint32_t                pos,
+   uint32_t                ix)
+{
+   net->scheduler_heap[pos] = ix;
+   net->scheduler_timeouts[ix].heap_pos = pos;
+}
+
+/**
+ * @internal
+ * Move the timeout at pos towards the root until the heap order is restored.
+ * @param net              InOut: The p-net stack instance
+ * @param pos              In:   Heap position.
+ */
+static void pf_scheduler_heap_up(
+   pnet_t                  *net,
+   uint32_t                pos)
+{
+   uint32_t                ix = net->scheduler_heap[pos];
+   uint32_t                parent;
+
+   while (pos > 0)
+   {
+      parent = (pos - 1) / 2;
+      if (pf_scheduler_heap_before(net, ix, net->scheduler_heap[parent]) == false)
+      {
+         break;
+      }
+      pf_scheduler_heap_set(net, pos, net->scheduler_heap[parent]);
+      pos = parent;
+   }
+   pf_scheduler_heap_set(net, pos, ix);
+}
+
+/**
+ * @internal
+ * Move the timeout at pos towards the leaves until the heap order is restored.
+ * @param net              InOut: The p-net stack instance
+ * @param pos              In:   Heap position.
+ */
+static void pf_scheduler_heap_down(
+   pnet_t                  *net,
+   uint32_t                pos)
+{
+   uint32_t                ix = net->scheduler_heap[pos];
+   uint32_t                len = net->scheduler_heap_len;
+   uint32_t                child;
+
+   while ((2 * pos + 1) < len)
+   {
+      child = 2 * pos + 1;
+      if (((child + 1) < len) &&
+          (pf_scheduler_heap_before(net, net->scheduler_heap[child + 1], net->scheduler_heap[child]) == true))
+      {
+         child++;
+      }
+      if (pf_scheduler_heap_before(net, net->scheduler_heap[child], ix) == false)
+      {
+         break;
+      }
+      pf_scheduler_heap_set(net, pos, net->scheduler_heap[child]);
+      pos = child;
+   }
+   pf_scheduler_heap_set(net, pos, ix);
+}
+
+/**
+ * @internal
+ * Check if a timeout is in the busy heap.
+ * @param net              InOut: The p-net stack instance
+ * @param ix               In:   Timeout index.
+ * @return  true  if the timeout is in the heap.
+ *          false otherwise.
+ */
+static bool pf_scheduler_heap_contains(
+   pnet_t                  *net,
+   uint32_t                ix)
+{
+   uint32_t                pos = net->scheduler_timeouts[ix].heap_pos;
+
+   return (pos < net->scheduler_heap_len) && (net->scheduler_heap[pos] == ix);
+}
+#endif
+
+/**
+ * @internal
+ * Insert a timeout into the busy queue, ordered by expiry time.
+ * @param net              InOut: The p-net stack instance
+ * @param ix               In:   Timeout index.
+ */
+static void pf_scheduler_enqueue(
+   pnet_t                  *net,
+   uint32_t                ix)
+{
+#if PF_SCHEDULER_BACKEND == PF_SCHEDULER_BACKEND_HEAP
+   if (net->scheduler_heap_len >= PF_MAX_TIMEOUTS)
+   {
+      LOG_ERROR(PNET_LOG, "Sched(%d): Heap is full\n", __LINE__);
+   }
+   else
+   {
+      pf_scheduler_heap_set(net, net->scheduler_heap_len, ix);
+      net->scheduler_heap_len++;
+      pf_scheduler_heap_up(net, net->scheduler_heap_len - 1);
+   }
+#else
+   uint32_t                ix_this;
+   uint32_t                ix_prev;
+
+   if (net->scheduler_timeout_first >= PF_MAX_TIMEOUTS)
+   {
+      /* Put into empty q */
+      pf_scheduler_link_before(net, &net->scheduler_timeout_first, ix, PF_MAX_TIMEOUTS);
+   }
+   else if (((int32_t)(net->scheduler_timeouts[ix].when - net->scheduler_timeouts[net->scheduler_timeout_first].when)) <= 0)
+   {
+      /* Put first in non-empty q */
+      pf_scheduler_link_before(net, &net->scheduler_timeout_first, ix, net->scheduler_timeout_first);
+   }
+   else
+   {
+      /* Find pos in non-empty q */
+      ix_prev = net->scheduler_timeout_first;
+      ix_this = net->scheduler_timeouts[net->scheduler_timeout_first].next;
+      while ((ix_this < PF_MAX_TIMEOUTS) &&
+             (((int32_t)(net->scheduler_timeouts[ix].when - net->scheduler_timeouts[ix_this].when)) > 0))
+      {
+         ix_prev = ix_this;
+         ix_this = net->scheduler_timeouts[ix_this].next;
+      }
+
+      /* Put after ix_prev */
+      pf_scheduler_link_after(net, &net->scheduler_timeout_first, ix, ix_prev);
+   }
+#endif
+}
+
+/**
+ * @internal
+ * Remove a timeout from the busy queue.
+ * @param net              InOut: The p-net stack instance
+ * @param ix               In:   Timeout index.
+ */
+static void pf_scheduler_dequeue(
+   pnet_t                  *net,
+   uint32_t                ix)
+{
+#if PF_SCHEDULER_BACKEND == PF_SCHEDULER_BACKEND_HEAP
+   uint32_t                pos;
+   uint32_t                ix_last;
+
+   if (pf_scheduler_heap_contains(net, ix) == false)
+   {
+      LOG_ERROR(PNET_LOG, "Sched(%d): %s is not in Q\n", __LINE__, net->scheduler_timeouts[ix].p_name);
+   }
+   else
+   {
+      pos = net->scheduler_timeouts[ix].heap_pos;
+      net->scheduler_heap_len--;
+      net->scheduler_timeouts[ix].heap_pos = PF_MAX_TIMEOUTS;
+      if (pos < net->scheduler_heap_len)
+      {
+         /* Fill the hole with the last entry and restore heap order */
+         ix_last = net->scheduler_heap[net->scheduler_heap_len];
+         pf_scheduler_heap_set(net, pos, ix_last);
+         if ((pos > 0) &&
+             (pf_scheduler_heap_before(net, ix_last, net->scheduler_heap[(pos - 1) / 2]) == true))
+         {
+            pf_scheduler_heap_up(net, pos);
+         }
+         else
+         {
+            pf_scheduler_heap_down(net, pos);
+         }
+      }
+   }
+#else
+   pf_scheduler_unlink(net, &net->scheduler_timeout_first, ix);
+#endif
+}
+
+/**
+ * @internal
+ * Return the timeout that expires first.
+ * @param net              InOut: The p-net stack instance
+ * @return  The timeout index, or PF_MAX_TIMEOUTS if the busy queue is empty.
+ */
+static uint32_t pf_scheduler_first(
+   pnet_t                  *net)
+{
+#if PF_SCHEDULER_BACKEND == PF_SCHEDULER_BACKEND_HEAP
+   return (net->scheduler_heap_len > 0) ? net->scheduler_heap[0] : PF_MAX_TIMEOUTS;
+#else
+   return net->scheduler_timeout_first;
+#endif
+}
+
+/**
+ * @internal
+ * Lock the scheduler. Does nothing if PF_SCHEDULER_LOCKFREE is set.
+ * @param net              InOut: The p-net stack instance
+ */
+static void pf_scheduler_lock(
+   pnet_t                  *net)
+{
+#if !PF_SCHEDULER_LOCKFREE
+   os_mutex_lock(net->scheduler_timeout_mutex);
+#endif
+}
+
+/**
+ * @internal
+ * Unlock the scheduler. Does nothing if PF_SCHEDULER_LOCKFREE is set.
+ * @param net              InOut: The p-net stack instance
+ */
+static void pf_scheduler_unlock(
+   pnet_t                  *net)
+{
+#if !PF_SCHEDULER_LOCKFREE
+   os_mutex_unlock(net->scheduler_timeout_mutex);
+#endif
+}
+
+/**
+ * @internal
+ * Allocate a timeout from the free list.
+ * @param net              InOut: The p-net stack instance
+ * @return  The timeout index, or PF_MAX_TIMEOUTS if out of resources.
+ */
+static uint32_t pf_scheduler_alloc(
+   pnet_t                  *net)
+{
+   uint32_t                ix = net->scheduler_timeout_free;
+
+#if PF_SCHEDULER_LOCKFREE
+   /* Skip entries claimed by other threads, but not yet linked */
+   while ((ix < PF_MAX_TIMEOUTS) &&
+          (CC_ATOMIC_CAS32(&net->scheduler_timeouts[ix].claimed, 0, 1) == false))
+   {
+      ix = net->scheduler_timeouts[ix].next;
+   }
+#endif
+   if (ix < PF_MAX_TIMEOUTS)
+   {
+      pf_scheduler_unlink(net, &net->scheduler_timeout_free, ix);
+   }
+
+   return ix;
+}
+
+/**
+ * @internal
+ * Return a timeout to the free list.
+ * @param net              InOut: The p-net stack instance
+ * @param ix               In:   Timeout index.
+ */
+static void pf_scheduler_free(
+   pnet_t                  *net,
+   uint32_t                ix)
+{
+   net->scheduler_timeouts[ix].in_use = false;
+   pf_scheduler_link_before(net, &net->scheduler_timeout_free, ix, net->scheduler_timeout_free);
+#if PF_SCHEDULER_LOCKFREE
+   CC_ATOMIC_SET32(&net->scheduler_timeouts[ix].claimed, 0);
+#endif
+}
+
+/**
+ * @internal
+ * Remove a timeout. Must be called with the scheduler locked.
+ * @param net              InOut: The p-net stack instance
+ * @param p_name           In:   Must be exactly the same address as in the _add().
+ * @param timeout          In:   Time instance to remove (see pf_scheduler_add)
+ */
+static void pf_scheduler_remove_locked(
+   pnet_t                  *net,
+   const char              *p_name,
+   uint32_t                timeout)
+{
+   uint32_t                ix = timeout - 1;  /* Refer to _add() on how p_timeout is created */
+
+   if (net->scheduler_timeouts[ix].p_name != p_name)
+   {
+      LOG_ERROR(PNET_LOG, "SCHEDULER(%d): Expected %s but got %s\n", __LINE__, net->scheduler_timeouts[ix].p_name, p_name);
+   }
+   else if (net->scheduler_timeouts[ix].in_use == false)
+   {
+      /* Already expired (or removed) - it is in the free list */
+      LOG_DEBUG(PNET_LOG, "SCHEDULER(%d): %s is not in Q\n", __LINE__, p_name);
+   }
+   else
+   {
+      if (net->scheduler_timeout_running == ix)
+      {
+         /* Periodic call-back is executing - prevent the re-arm */
+         net->scheduler_timeout_running = PF_MAX_TIMEOUTS;
+      }
+      else
+      {
+         pf_scheduler_dequeue(net, ix);
+      }
+
+      /* Insert into free list. */
+      pf_scheduler_free(net, ix);
+   }
+}
+
+#if PF_SCHEDULER_LOCKFREE
+/**
+ * @internal
+ * Check if the calling thread may access the scheduler directly.
+ * This is the thread that last called pf_scheduler_tick(), or before that
+ * the thread that called pf_scheduler_init().
+ * @param net              InOut: The p-net stack instance
+ * @return  true  if the calling thread owns the scheduler.
+ *          false otherwise.
+ */
+static bool pf_scheduler_is_owner(
+   pnet_t                  *net)
+{
+   return net->scheduler_owner == os_thread_self();
+}
+
+/**
+ * @internal
+ * Post an add or remove request to the tick thread.
+ *
+ * Lock-free multiple producer queue. Each cell has a sequence number which
+ * tells if it is free for the producer with ticket put (seq == put) or
+ * holds a request for the consumer (seq == put + 1).
+ * @param net              InOut: The p-net stack instance
+ * @param add              In:   true for add, false for remove.
+ * @param timeout          In:   Timeout instance.
+ * @param p_name           In:   Owner (remove only).
+ * @return  0  if the request was posted.
+ *          -1 if the queue is full.
+ */
+static int pf_scheduler_post(
+   pnet_t                  *net,
+   bool                    add,
+   uint32_t                timeout,
+   const char              *p_name)
+{
+   pf_scheduler_request_t  *p_req;
+   uint32_t                put = CC_ATOMIC_GET32(&net->scheduler_request_put);
+   uint32_t                cnt;
+   int32_t                 diff;
+
+   while (true)
+   {
+      p_req = &net->scheduler_requests[put & (PF_SCHEDULER_MAX_REQUESTS - 1)];
+      diff = (int32_t)(CC_ATOMIC_GET32(&p_req->seq) - put);
+      if (diff == 0)
+      {
+         if (CC_ATOMIC_CAS32(&net->scheduler_request_put, put, put + 1) == true)
+         {
+            break;
+         }
+      }
+      else if (diff < 0)
+      {
+         /* Full */
+         do
+         {
+            cnt = CC_ATOMIC_GET32(&net->scheduler_request_drops);
+         } while (CC_ATOMIC_CAS32(&net->scheduler_request_drops, cnt, cnt + 1) == false);
+         LOG_ERROR(PNET_LOG, "SCHEDULER(%d): Request queue full\n", __LINE__);
+         return -1;
+      }
+      put = CC_ATOMIC_GET32(&net->scheduler_request_put);
+   }
+
+   p_req->add = add;
+   p_req->timeout = timeout;
+   p_req->p_name = p_name;
+   CC_ATOMIC_SET32(&p_req->seq, put + 1);
+
+   return 0;
+}
+
+/**
+ * @internal
+ * Handle all add and remove requests from other threads.
+ * Must be called by the owner thread.
+ * @param net              InOut: The p-net stack instance
+ */
+static void pf_scheduler_drain(
+   pnet_t                  *net)
+{
+   pf_scheduler_request_t  *p_req;
+   uint32_t                get = net->scheduler_request_get;
+   bool                    add;
+   uint32_t                timeout;
+   const char              *p_name;
+   uint32_t                ix;
+
+   while (true)
+   {
+      p_req = &net->scheduler_requests[get & (PF_SCHEDULER_MAX_REQUESTS - 1)];
+      if (CC_ATOMIC_GET32(&p_req->seq) != get + 1)
+      {
+         break;   /* Empty */
+      }
+      add = p_req->add;
+      timeout = p_req->timeout;
+      p_name = p_req->p_name;
+      CC_ATOMIC_SET32(&p_req->seq, get + PF_SCHEDULER_MAX_REQUESTS);
+      get++;
+
+      if (add == true)
+      {
+         /* The timeout is claimed and filled in, but still in the free list */
+         ix = timeout - 1;
+         pf_scheduler_unlink(net, &net->scheduler_timeout_free, ix);
+         net->scheduler_timeouts[ix].in_use = true;
+         pf_scheduler_enqueue(net, ix);
+      }
+      else
+      {
+         pf_scheduler_remove_locked(net, p_name, timeout);
+      }
+   }
+
+   net->scheduler_request_get = get;
+}
+
+/**
+ * @internal
+ * Claim a free timeout from another thread than the owner.
+ * @param net              InOut: The p-net stack instance
+ * @return  The timeout index, or PF_MAX_TIMEOUTS if out of resources.
+ */
+static uint32_t pf_scheduler_claim(
+   pnet_t                  *net)
+{
+   uint32_t                ix;
+
+   for (ix = 0; ix < PF_MAX_TIMEOUTS; ix++)
+   {
+      if (CC_ATOMIC_CAS32(&net->scheduler_timeouts[ix].claimed, 0, 1) == true)
+      {
+         break;
+      }
+   }
+
+   return ix;
+}
+#endif
+
 void pf_scheduler_init(
    pnet_t                  *net,
    uint32_t                tick_interval)
@@ -197,6 +683,10 @@ void pf_scheduler_init(
 
    net->scheduler_timeout_first = PF_MAX_TIMEOUTS; /* Nothing in queue */
    net->scheduler_timeout_free = PF_MAX_TIMEOUTS;  /* Nothing in queue. */
+   net->scheduler_timeout_running = PF_MAX_TIMEOUTS;  /* No periodic call-back executing */
+#if PF_SCHEDULER_BACKEND == PF_SCHEDULER_BACKEND_HEAP
+   net->scheduler_heap_len = 0;                    /* Nothing in heap */
+#endif
 
    if (net->scheduler_timeout_mutex == NULL)
    {
@@ -211,20 +701,45 @@ void pf_scheduler_init(
    {
       net->scheduler_timeouts[ix - 1].p_name = "<free>";
       net->scheduler_timeouts[ix - 1].in_use = false;
+      net->scheduler_timeouts[ix - 1].heap_pos = PF_MAX_TIMEOUTS;
       pf_scheduler_link_before(net, &net->scheduler_timeout_free, ix - 1, net->scheduler_timeout_free);
    }
+
+#if PF_SCHEDULER_LOCKFREE
+   memset(net->scheduler_requests, 0, sizeof(net->scheduler_requests));
+   for (ix = 0; ix < PF_SCHEDULER_MAX_REQUESTS; ix++)
+   {
+      net->scheduler_requests[ix].seq = ix;
+   }
+   net->scheduler_request_put = 0;
+   net->scheduler_request_get = 0;
+   net->scheduler_request_drops = 0;
+   net->scheduler_owner = os_thread_self();
+#endif
 }
 
-int pf_scheduler_add(
+/**
+ * @internal
+ * Schedule a one-shot or periodic call-back.
+ * @param net              InOut: The p-net stack instance
+ * @param delay            In:   The delay until the function shall be called.
+ * @param period           In:   The re-arm interval. 0 (zero) for one-shot.
+ * @param p_name           In:   Caller/owner (for debugging).
+ * @param cb               In:   The call-back.
+ * @param arg              In:   Argument to the call-back.
+ * @param p_timeout        Out:  The timeout instance.
+ * @return  0  if the call-back was scheduled.
+ *          -1 if an error occurred.
+ */
+static int pf_scheduler_add_timeout(
    pnet_t                  *net,
    uint32_t                delay,
+   uint32_t                period,
    const char              *p_name,
    pf_scheduler_timeout_ftn_t cb,
    void                    *arg,
    uint32_t                *p_timeout)
 {
-   uint32_t                ix_this;
-   uint32_t                ix_prev;
    uint32_t                ix_free;
    uint32_t                now = os_get_current_time_us();
 
@@ -234,11 +749,18 @@ int pf_scheduler_add(
       delay = 1;
    }
 
-   os_mutex_lock(net->scheduler_timeout_mutex);
-   /* Unlink from the free list */
-   ix_free = net->scheduler_timeout_free;
-   pf_scheduler_unlink(net, &net->scheduler_timeout_free, ix_free);
-   os_mutex_unlock(net->scheduler_timeout_mutex);
+#if PF_SCHEDULER_LOCKFREE
+   if (pf_scheduler_is_owner(net) == false)
+   {
+      ix_free = pf_scheduler_claim(net);
+   }
+   else
+#endif
+   {
+      pf_scheduler_lock(net);
+      ix_free = pf_scheduler_alloc(net);
+      pf_scheduler_unlock(net);
+   }
 
    if (ix_free >= PF_MAX_TIMEOUTS)
    {
@@ -246,75 +768,113 @@ int pf_scheduler_add(
       return -1;
    }
 
-   net->scheduler_timeouts[ix_free].in_use = true;
    net->scheduler_timeouts[ix_free].p_name = p_name;
    net->scheduler_timeouts[ix_free].cb = cb;
    net->scheduler_timeouts[ix_free].arg = arg;
    net->scheduler_timeouts[ix_free].when = now + delay;
+   net->scheduler_timeouts[ix_free].period = period;
+   net->scheduler_timeouts[ix_free].overruns = 0;
 
-   os_mutex_lock(net->scheduler_timeout_mutex);
-   if (net->scheduler_timeout_first >= PF_MAX_TIMEOUTS)
-   {
-      /* Put into empty q */
-      pf_scheduler_link_before(net, &net->scheduler_timeout_first, ix_free, PF_MAX_TIMEOUTS);
-   }
-   else if (((int32_t)(net->scheduler_timeouts[ix_free].when - net->scheduler_timeouts[net->scheduler_timeout_first].when)) <= 0)
+#if PF_SCHEDULER_LOCKFREE
+   if (pf_scheduler_is_owner(net) == false)
    {
-      /* Put first in non-empty q */
-      pf_scheduler_link_before(net, &net->scheduler_timeout_first, ix_free, net->scheduler_timeout_first);
+      /* Let the owner link it */
+      if (pf_scheduler_post(net, true, ix_free + 1, NULL) != 0)
+      {
+         CC_ATOMIC_SET32(&net->scheduler_timeouts[ix_free].claimed, 0);
+         return -1;
+      }
    }
    else
+#endif
    {
-      /* Find pos in non-empty q */
-      ix_prev = net->scheduler_timeout_first;
-      ix_this = net->scheduler_timeouts[net->scheduler_timeout_first].next;
-      while ((ix_this < PF_MAX_TIMEOUTS) &&
-             (((int32_t)(net->scheduler_timeouts[ix_free].when - net->scheduler_timeouts[ix_this].when)) > 0))
-      {
-         ix_prev = ix_this;
-         ix_this = net->scheduler_timeouts[ix_this].next;
-      }
-
-      /* Put after ix_prev */
-      pf_scheduler_link_after(net, &net->scheduler_timeout_first, ix_free, ix_prev);
+      pf_scheduler_lock(net);
+      net->scheduler_timeouts[ix_free].in_use = true;
+      pf_scheduler_enqueue(net, ix_free);
+      pf_scheduler_unlock(net);
    }
-   os_mutex_unlock(net->scheduler_timeout_mutex);
 
    *p_timeout = ix_free + 1;  /* Make sure 0 is invalid. */
 
    return 0;
 }
 
-void pf_scheduler_remove(
+int pf_scheduler_add(
+   pnet_t                  *net,
+   uint32_t                delay,
+   const char              *p_name,
+   pf_scheduler_timeout_ftn_t cb,
+   void                    *arg,
+   uint32_t                *p_timeout)
+{
+   return pf_scheduler_add_timeout(net, delay, 0, p_name, cb, arg, p_timeout);
+}
+
+int pf_scheduler_add_periodic(
+   pnet_t                  *net,
+   uint32_t                period,
+   const char              *p_name,
+   pf_scheduler_timeout_ftn_t cb,
+   void                    *arg,
+   uint32_t                *p_timeout)
+{
+   if ((period == 0) || (period > 0x80000000))
+   {
+      LOG_ERROR(PNET_LOG, "SCHEDULER(%d): Invalid period %u for %s\n", __LINE__, (unsigned)period, p_name);
+      return -1;
+   }
+
+   return pf_scheduler_add_timeout(net, period, period, p_name, cb, arg, p_timeout);
+}
+
+uint32_t pf_scheduler_get_overruns(
    pnet_t                  *net,
    const char              *p_name,
    uint32_t                timeout)
 {
-   uint16_t                      ix;
+   uint32_t                ix;
 
+   if ((timeout == 0) || (timeout > PF_MAX_TIMEOUTS))
+   {
+      return 0;
+   }
+
+   ix = timeout - 1;  /* Refer to _add() on how p_timeout is created */
+   if ((net->scheduler_timeouts[ix].p_name != p_name) ||
+       (net->scheduler_timeouts[ix].in_use == false))
+   {
+      return 0;
+   }
+
+   return net->scheduler_timeouts[ix].overruns;
+}
+
+void pf_scheduler_remove(
+   pnet_t                  *net,
+   const char              *p_name,
+   uint32_t                timeout)
+{
    if (timeout == 0)
    {
       LOG_DEBUG(PNET_LOG, "SCHEDULER(%d): timeout(%s) == 0\n", __LINE__, p_name);
    }
+   else if (timeout > PF_MAX_TIMEOUTS)
+   {
+      LOG_ERROR(PNET_LOG, "SCHEDULER(%d): timeout(%s) %u is invalid\n", __LINE__, p_name, (unsigned)timeout);
+   }
    else
    {
-      ix = timeout - 1;  /* Refer to _add() on how p_timeout is created */
-      os_mutex_lock(net->scheduler_timeout_mutex);
-
-      if (net->scheduler_timeouts[ix].p_name != p_name)
-      {
-         LOG_ERROR(PNET_LOG, "SCHEDULER(%d): Expected %s but got %s\n", __LINE__, net->scheduler_timeouts[ix].p_name, p_name);
-      }
-      else
+#if PF_SCHEDULER_LOCKFREE
+      if (pf_scheduler_is_owner(net) == false)
       {
-         pf_scheduler_unlink(net, &net->scheduler_timeout_first, ix);
-
-         /* Insert into free list. */
-         net->scheduler_timeouts[ix].in_use = false;
-         pf_scheduler_link_before(net, &net->scheduler_timeout_free, ix, net->scheduler_timeout_free);
+         (void)pf_scheduler_post(net, false, timeout, p_name);
+         return;
       }
-
-      os_mutex_unlock(net->scheduler_timeout_mutex);
+      pf_scheduler_drain(net);   /* The timeout may have been added by another thread */
+#endif
+      pf_scheduler_lock(net);
+      pf_scheduler_remove_locked(net, p_name, timeout);
+      pf_scheduler_unlock(net);
    }
 }
 
@@ -324,35 +884,70 @@ void pf_scheduler_tick(
    uint32_t                ix;
    pf_scheduler_timeout_ftn_t ftn;
    void                    *arg;
+   uint32_t                missed;
    uint32_t                pf_current_time = os_get_current_time_us();
+   uint32_t                cb_time;
    uint32_t                cnt = 0x10000000;
 
-   os_mutex_lock(net->scheduler_timeout_mutex);
+#if PF_SCHEDULER_LOCKFREE
+   net->scheduler_owner = os_thread_self();
+   pf_scheduler_drain(net);
+#endif
+   pf_scheduler_lock(net);
 
    /* Send event to all expired delay entries. */
-   while ((net->scheduler_timeout_first < PF_MAX_TIMEOUTS) &&
-          ((int32_t)(pf_current_time - net->scheduler_timeouts[net->scheduler_timeout_first].when) >= 0))
+   ix = pf_scheduler_first(net);
+   while ((ix < PF_MAX_TIMEOUTS) &&
+          ((int32_t)(pf_current_time - net->scheduler_timeouts[ix].when) >= 0))
    {
       /* Unlink from busy list */
-      ix = net->scheduler_timeout_first;
-      pf_scheduler_unlink(net, &net->scheduler_timeout_first, ix);
+      pf_scheduler_dequeue(net, ix);
 
       ftn = net->scheduler_timeouts[ix].cb;
       arg = net->scheduler_timeouts[ix].arg;
 
-      /* Insert into free list. */
-      net->scheduler_timeouts[ix].in_use = false;
-      pf_scheduler_link_before(net, &net->scheduler_timeout_free, ix, net->scheduler_timeout_free);
+      if (net->scheduler_timeouts[ix].period == 0)
+      {
+         cb_time = pf_current_time;
+
+         /* Insert into free list. */
+         pf_scheduler_free(net, ix);
+      }
+      else
+      {
+         /* Periodic call-backs get their deadline, not the time of the tick */
+         cb_time = net->scheduler_timeouts[ix].when;
+
+         /* Keep it - it is re-armed below unless removed by the call-back. */
+         net->scheduler_timeout_running = ix;
+      }
 
       /* Send event without holding the mutex. */
-      os_mutex_unlock(net->scheduler_timeout_mutex);
-      ftn(net, arg, pf_current_time);
-      os_mutex_lock(net->scheduler_timeout_mutex);
+      pf_scheduler_unlock(net);
+      ftn(net, arg, cb_time);
+      pf_scheduler_lock(net);
+
+      if (net->scheduler_timeout_running == ix)
+      {
+         net->scheduler_timeout_running = PF_MAX_TIMEOUTS;
+
+         /* Re-arm from the previous deadline to avoid drift */
+         net->scheduler_timeouts[ix].when += net->scheduler_timeouts[ix].period;
+         if ((int32_t)(pf_current_time - net->scheduler_timeouts[ix].when) >= 0)
+         {
+            /* Skip all missed deadlines */
+            missed = (pf_current_time - net->scheduler_timeouts[ix].when) / net->scheduler_timeouts[ix].period + 1;
+            net->scheduler_timeouts[ix].when += missed * net->scheduler_timeouts[ix].period;
+            net->scheduler_timeouts[ix].overruns += missed;
+         }
+         pf_scheduler_enqueue(net, ix);
+      }
 
       cnt++;
+      ix = pf_scheduler_first(net);
    }
 
-   os_mutex_unlock(net->scheduler_timeout_mutex);
+   pf_scheduler_unlock(net);
 }
 
 void pf_scheduler_show(
@@ -365,16 +960,17 @@ void pf_scheduler_show(
 
    if (net->scheduler_timeout_mutex != NULL)
    {
-      os_mutex_lock(net->scheduler_timeout_mutex);
+      pf_scheduler_lock(net);
    }
 
-   printf("%-4s  %-8s  %-6s  %-6s  %-6s  %s\n", "idx", "owner", "in_use", "next", "prev", "when");
+   printf("%-4s  %-8s  %-6s  %-6s  %-6s  %-10s  %-8s  %s\n", "idx", "owner", "in_use", "next", "prev", "when", "period", "overruns");
    for (ix = 0; ix < PF_MAX_TIMEOUTS; ix++)
    {
-      printf("[%02u]  %-8s  %-6s  %-6u  %-6u  %u\n", (unsigned)ix,
+      printf("[%02u]  %-8s  %-6s  %-6u  %-6u  %-10u  %-8u  %u\n", (unsigned)ix,
          net->scheduler_timeouts[ix].p_name, net->scheduler_timeouts[ix].in_use?"true":"false",
          (unsigned)net->scheduler_timeouts[ix].next, (unsigned)net->scheduler_timeouts[ix].prev,
-         (unsigned)net->scheduler_timeouts[ix].when);
+         (unsigned)net->scheduler_timeouts[ix].when, (unsigned)net->scheduler_timeouts[ix].period,
+         (unsigned)net->scheduler_timeouts[ix].overruns);
    }
 
    if (net->scheduler_timeout_mutex != NULL)
@@ -388,6 +984,14 @@ void pf_scheduler_show(
          ix = net->scheduler_timeouts[ix].next;
       }
 
+#if PF_SCHEDULER_BACKEND == PF_SCHEDULER_BACKEND_HEAP
+      printf("\nBusy heap:\n");
+      for (cnt = 0; cnt < net->scheduler_heap_len; cnt++)
+      {
+         ix = net->scheduler_heap[cnt];
+         printf("%u  (%u)  ", (unsigned)ix, (unsigned)net->scheduler_timeouts[ix].when);
+      }
+#else
       printf("\nBusy list:\n");
       ix = net->scheduler_timeout_first;
       cnt = 0;
@@ -396,8 +1000,15 @@ void pf_scheduler_show(
          printf("%u  (%u)  ", (unsigned)ix, (unsigned)net->scheduler_timeouts[ix].when);
          ix = net->scheduler_timeouts[ix].next;
       }
+#endif
+
+#if PF_SCHEDULER_LOCKFREE
+      printf("\nRequests: put %u  get %u  drops %u",
+         (unsigned)net->scheduler_request_put, (unsigned)net->scheduler_request_get,
+         (unsigned)net->scheduler_request_drops);
+#endif
 
-      os_mutex_unlock(net->scheduler_timeout_mutex);
+      pf_scheduler_unlock(net);
    }
 
    printf("\n");
@@ -50,6 +50,48 @@ int pf_scheduler_add(
    void                       *arg,
    uint32_t                   *p_timeout);
 
+/**
+ * Schedule a periodic call-back.
+ *
+ * The call-back is first called after one period and is then re-armed
+ * by the scheduler from the previous deadline, so execution delays do not
+ * accumulate. If a deadline has already passed when the timeout is re-armed
+ * then the missed deadlines are skipped and counted as overruns.
+ *
+ * The call-back is given the deadline it was scheduled for as its current
+ * time, so it can derive cycle counters without reading the clock.
+ *
+ * The timeout is active until removed with pf_scheduler_remove(), which may
+ * also be done from within the call-back itself.
+ * @param net              InOut: The p-net stack instance
+ * @param period        In:   The period (us). Must be > 0.
+ * @param p_name        In:   Caller/owner (for debugging).
+ * @param cb            In:   The call-back.
+ * @param arg           In:   Argument to the call-back.
+ * @param p_timeout     Out:  The timeout instance (used to remove if necessary).
+ * @return  0  if the call-back was scheduled.
+ *          -1 if an error occurred.
+ */
+int pf_scheduler_add_periodic(
+   pnet_t                     *net,
+   uint32_t                   period,
+   const char                 *p_name,
+   pf_scheduler_timeout_ftn_t cb,
+   void                       *arg,
+   uint32_t                   *p_timeout);
+
+/**
+ * Get the number of missed deadlines of a periodic timeout.
+ * @param net              InOut: The p-net stack instance
+ * @param p_name        In: Must be exactly the same address as in the _add().
+ * @param timeout       In: Time instance (see pf_scheduler_add_periodic)
+ * @return  The number of overruns. 0 (zero) if the timeout is not valid.
+ */
+uint32_t pf_scheduler_get_overruns(
+   pnet_t                     *net,
+   const char                 *p_name,
+   uint32_t                   timeout);
+
 /**
  * Stop a timeout. If it is not scheduled then ignore.
  * @param net              InOut: The p-net stack instance
@@ -22,31 +22,45 @@
 #include "pf_includes.h"
 #include "pf_block_reader.h"
 
+/*
+ * Most blocks have a fixed size part. It is bounds checked once, and then
+ * read through a cursor without further checks. After an error the cursor
+ * reads from a buffer of zeros, so that all fields read as 0 just as with
+ * pf_get_byte() after an error.
+ */
+#define PF_GET_FIXED_MAX      128
+
+static const uint8_t pf_get_zeros[PF_GET_FIXED_MAX] = { 0 };
+
+typedef struct pf_get_cursor
+{
+   const uint8_t           *p_src;
+   bool                    is_big_endian;
+} pf_get_cursor_t;
+
 /**
  * @internal
- * Extract a sequence of bytes from a buffer.
- * @param p_info           In:   The parser state.
- * @param p_pos            InOut:Position in the buffer.
- * @param dest_size        In:   Number of bytes to copy.
- * @param p_dest           Out:  Destination buffer.
+ * Check that a number of bytes is available in a buffer.
+ * Sets the error in the parser state if not. The first error is preserved.
+ * @param p_info           InOut:The parser state.
+ * @param pos              In:   Position in the buffer.
+ * @param len              In:   Number of bytes.
+ * @return  0  if the bytes are available.
+ *          -1 if an error occurred, now or earlier.
  */
-static void pf_get_mem(
+static int pf_get_check(
    pf_get_info_t           *p_info,
-   uint16_t                *p_pos,
-   uint16_t                dest_size,     /* bytes to copy */
-   void                    *p_dest)
+   uint16_t                pos,
+   uint32_t                len)
 {
+   int                     ret = -1;
+
    if (p_info->result != PF_PARSE_OK)
    {
       /* Preserve first error */
    }
-   else if (((*p_pos) + dest_size) > p_info->len)
+   else if (((uint32_t)pos + len) > p_info->len)
    {
-      /*
-       * Reached end of buffer
-       * If this is a chain of pbuff then goto the next pbuff,
-       * else this should never happen.
-       */
       LOG_DEBUG(PNET_LOG, "BR(%d): Unexpected end of input data\n", __LINE__);
       p_info->result = PF_PARSE_END_OF_INPUT;
    }
@@ -56,94 +70,168 @@ static void pf_get_mem(
    }
    else
    {
-      memcpy(p_dest, &p_info->p_buf[*p_pos], dest_size);
-      (*p_pos) += dest_size;
+      ret = 0;
    }
+
+   return ret;
 }
 
-uint8_t pf_get_byte(
+/**
+ * @internal
+ * Check and consume a part of a buffer, and set up a cursor to read it.
+ *
+ * If the part is not available then the position is not changed and the
+ * cursor reads zeros. Then at most PF_GET_FIXED_MAX bytes may be read.
+ * @param p_info           InOut:The parser state.
+ * @param p_pos            InOut:Position in the buffer.
+ * @param len              In:   Size of the part.
+ * @param p_cur            Out:  The cursor.
+ * @return  0  if the part is available.
+ *          -1 if an error occurred, now or earlier.
+ */
+static int pf_get_cursor(
    pf_get_info_t           *p_info,
-   uint16_t                *p_pos)
+   uint16_t                *p_pos,
+   uint32_t                len,
+   pf_get_cursor_t         *p_cur)
 {
-   uint8_t res = 0;
+   int                     ret = pf_get_check(p_info, *p_pos, len);
 
-   if (p_info->result != PF_PARSE_OK)
+   p_cur->is_big_endian = p_info->is_big_endian;
+   if (ret == 0)
    {
-      /* Preserve first error */
+      p_cur->p_src = &p_info->p_buf[*p_pos];
+      *p_pos += len;
    }
-   else if (*p_pos >= p_info->len)
+   else
    {
-      /* Reached end of buffer */
-      LOG_DEBUG(PNET_LOG, "BR(%d): End of buffer reached\n", __LINE__);
-      p_info->result = PF_PARSE_END_OF_INPUT;
+      p_cur->p_src = pf_get_zeros;
    }
-   else if (p_info->p_buf == NULL)
+
+   return ret;
+}
+
+static inline uint8_t pf_cur_byte(
+   pf_get_cursor_t         *p_cur)
+{
+   return *p_cur->p_src++;
+}
+
+static inline uint16_t pf_cur_uint16(
+   pf_get_cursor_t         *p_cur)
+{
+   const uint8_t           *p = p_cur->p_src;
+
+   p_cur->p_src += 2;
+   if (p_cur->is_big_endian)
    {
-      p_info->result = PF_PARSE_NULL_POINTER;
+      return ((uint16_t)p[0] << 8) | (uint16_t)p[1];
    }
    else
    {
-      res = p_info->p_buf[*p_pos];
-      (*p_pos)++;
+      return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
    }
-
-   return res;
 }
 
-uint16_t pf_get_uint16(
-   pf_get_info_t           *p_info,
-   uint16_t                *p_pos)
+static inline uint32_t pf_cur_uint32(
+   pf_get_cursor_t         *p_cur)
 {
-   uint16_t res = 0;
+   const uint8_t           *p = p_cur->p_src;
 
-   if (p_info->result != PF_PARSE_OK)
-   {
-      /* Keep first error */
-   }
-   else if (p_info->is_big_endian)
+   p_cur->p_src += 4;
+   if (p_cur->is_big_endian)
    {
-      res = ((uint16_t)pf_get_byte(p_info, p_pos) << 8) +
-            (uint16_t)pf_get_byte(p_info, p_pos);
+      return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+             ((uint32_t)p[2] << 8) | (uint32_t)p[3];
    }
    else
    {
-      res = (uint16_t)pf_get_byte(p_info, p_pos) +
-            ((uint16_t)pf_get_byte(p_info, p_pos) << 8);
+      return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+             ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
    }
+}
 
-   return res;
+static inline void pf_cur_mem(
+   pf_get_cursor_t         *p_cur,
+   uint16_t                len,
+   void                    *p_dest)
+{
+   memcpy(p_dest, p_cur->p_src, len);
+   p_cur->p_src += len;
+}
+
+static inline void pf_cur_uuid(
+   pf_get_cursor_t         *p_cur,
+   pf_uuid_t               *p_dest)
+{
+   p_dest->data1 = pf_cur_uint32(p_cur);
+   p_dest->data2 = pf_cur_uint16(p_cur);
+   p_dest->data3 = pf_cur_uint16(p_cur);
+   pf_cur_mem(p_cur, sizeof(p_dest->data4), p_dest->data4);
 }
 
 /**
  * @internal
- * Return a uint16_t from a buffer.
+ * Extract a sequence of bytes from a buffer.
  * @param p_info           In:   The parser state.
  * @param p_pos            InOut:Position in the buffer.
+ * @param dest_size        In:   Number of bytes to copy.
+ * @param p_dest           Out:  Destination buffer.
  */
-static uint32_t pf_get_uint32(
+static void pf_get_mem(
    pf_get_info_t           *p_info,
-   uint16_t                *p_pos)
+   uint16_t                *p_pos,
+   uint16_t                dest_size,     /* bytes to copy */
+   void                    *p_dest)
 {
-   uint32_t res = 0;
-
-   if (p_info->is_big_endian)
+   if (pf_get_check(p_info, *p_pos, dest_size) == 0)
    {
-      res = ((uint32_t)pf_get_byte(p_info, p_pos) << 24) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 16) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 8) +
-            (uint32_t)pf_get_byte(p_info, p_pos);
+      memcpy(p_dest, &p_info->p_buf[*p_pos], dest_size);
+      (*p_pos) += dest_size;
    }
-   else
+}
+
+uint8_t pf_get_byte(
+   pf_get_info_t           *p_info,
+   uint16_t                *p_pos)
+{
+   uint8_t res = 0;
+
+   if (pf_get_check(p_info, *p_pos, 1) == 0)
    {
-      res = (uint32_t)pf_get_byte(p_info, p_pos) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 8) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 16) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 24);
+      res = p_info->p_buf[*p_pos];
+      (*p_pos)++;
    }
 
    return res;
 }
 
+uint16_t pf_get_uint16(
+   pf_get_info_t           *p_info,
+   uint16_t                *p_pos)
+{
+   pf_get_cursor_t         cur;
+
+   (void)pf_get_cursor(p_info, p_pos, 2, &cur);
+   return pf_cur_uint16(&cur);
+}
+
+/**
+ * @internal
+ * Return a uint32_t from a buffer.
+ * @param p_info           In:   The parser state.
+ * @param p_pos            InOut:Position in the buffer.
+ */
+static uint32_t pf_get_uint32(
+   pf_get_info_t           *p_info,
+   uint16_t                *p_pos)
+{
+   pf_get_cursor_t         cur;
+
+   (void)pf_get_cursor(p_info, p_pos, 4, &cur);
+   return pf_cur_uint32(&cur);
+}
+
 /**
  * @internal
  * Extract a UUID from a buffer.
@@ -156,10 +244,10 @@ static void pf_get_uuid(
    uint16_t                *p_pos,
    pf_uuid_t               *p_dest)
 {
-   p_dest->data1 = pf_get_uint32(p_info, p_pos);
-   p_dest->data2 = pf_get_uint16(p_info, p_pos);
-   p_dest->data3 = pf_get_uint16(p_info, p_pos);
-   pf_get_mem(p_info, p_pos, sizeof(p_dest->data4), p_dest->data4);
+   pf_get_cursor_t         cur;
+
+   (void)pf_get_cursor(p_info, p_pos, 16, &cur);
+   pf_cur_uuid(&cur, p_dest);
 }
 
 /**
@@ -209,21 +297,28 @@ static void pf_get_frame_descriptor(
    uint16_t                *p_pos,
    pf_frame_descriptor_t   *p_fd)
 {
-   p_fd->slot_number = pf_get_uint16(p_info, p_pos);
-   p_fd->subslot_number = pf_get_uint16(p_info, p_pos);
-   p_fd->frame_offset = pf_get_uint16(p_info, p_pos);
+   pf_get_cursor_t         cur;
+
+   (void)pf_get_cursor(p_info, p_pos, 6, &cur);
+   p_fd->slot_number = pf_cur_uint16(&cur);
+   p_fd->subslot_number = pf_cur_uint16(&cur);
+   p_fd->frame_offset = pf_cur_uint16(&cur);
 }
 
 /**
  * @internal
  * Extract an IOCR API entry from a buffer.
+ *
+ * The frame descriptors are taken from the table of the IOCR.
  * @param p_info           In:   The parser state.
  * @param p_pos            InOut:Position in the buffer.
+ * @param p_iocr           InOut:The IOCR instance.
  * @param p_ae             Out:  Destination buffer.
  */
 static void pf_get_iocr_api_entry(
    pf_get_info_t           *p_info,
    uint16_t                *p_pos,
+   pf_iocr_t               *p_iocr,
    pf_api_entry_t          *p_ae)
 {
    uint16_t ix;
@@ -231,15 +326,44 @@ static void pf_get_iocr_api_entry(
    p_ae->api = pf_get_uint32(p_info, p_pos);
 
    p_ae->nbr_io_data = pf_get_uint16(p_info, p_pos);
-   for (ix = 0; ix < p_ae->nbr_io_data; ix++)
+   p_ae->io_data = &p_iocr->frame_desc[p_iocr->nbr_frame_desc];
+   if (p_ae->nbr_io_data > p_iocr->max_frame_desc - p_iocr->nbr_frame_desc)
    {
-      pf_get_frame_descriptor(p_info, p_pos, &p_ae->io_data[ix]);
+      LOG_DEBUG(PNET_LOG, "BR(%d): Too many IO data objects: %u\n", __LINE__, (unsigned)p_ae->nbr_io_data);
+      p_ae->nbr_io_data = 0;
+      if (p_info->result == PF_PARSE_OK)
+      {
+         p_info->result = PF_PARSE_ERROR;
+      }
+   }
+   /* Check the whole list before reading it */
+   else if (pf_get_check(p_info, *p_pos, 6 * (uint32_t)p_ae->nbr_io_data) == 0)
+   {
+      for (ix = 0; ix < p_ae->nbr_io_data; ix++)
+      {
+         pf_get_frame_descriptor(p_info, p_pos, &p_ae->io_data[ix]);
+      }
+      p_iocr->nbr_frame_desc += p_ae->nbr_io_data;
    }
 
    p_ae->nbr_iocs = pf_get_uint16(p_info, p_pos);
-   for (ix = 0; ix < p_ae->nbr_iocs; ix++)
+   p_ae->iocs = &p_iocr->frame_desc[p_iocr->nbr_frame_desc];
+   if (p_ae->nbr_iocs > p_iocr->max_frame_desc - p_iocr->nbr_frame_desc)
+   {
+      LOG_DEBUG(PNET_LOG, "BR(%d): Too many IOCS objects: %u\n", __LINE__, (unsigned)p_ae->nbr_iocs);
+      p_ae->nbr_iocs = 0;
+      if (p_info->result == PF_PARSE_OK)
+      {
+         p_info->result = PF_PARSE_ERROR;
+      }
+   }
+   else if (pf_get_check(p_info, *p_pos, 6 * (uint32_t)p_ae->nbr_iocs) == 0)
    {
-      pf_get_frame_descriptor(p_info, p_pos, &p_ae->iocs[ix]);
+      for (ix = 0; ix < p_ae->nbr_iocs; ix++)
+      {
+         pf_get_frame_descriptor(p_info, p_pos, &p_ae->iocs[ix]);
+      }
+      p_iocr->nbr_frame_desc += p_ae->nbr_iocs;
    }
 }
 
@@ -255,12 +379,14 @@ static void pf_get_exp_submodule(
    uint16_t                *p_pos,
    pf_exp_submodule_t      *p_sub)
 {
+   pf_get_cursor_t         cur;
    uint16_t                temp_u16;
 
-   p_sub->subslot_number = pf_get_uint16(p_info, p_pos);
-   p_sub->submodule_ident_number = pf_get_uint32(p_info, p_pos);
+   (void)pf_get_cursor(p_info, p_pos, 14, &cur);
+   p_sub->subslot_number = pf_cur_uint16(&cur);
+   p_sub->submodule_ident_number = pf_cur_uint32(&cur);
    /* subslot_properties */
-   temp_u16 = pf_get_uint16(p_info, p_pos);
+   temp_u16 = pf_cur_uint16(&cur);
    p_sub->submodule_properties.type = pf_get_bits(temp_u16, 0, 2);
    p_sub->submodule_properties.sharedInput = (pf_get_bits(temp_u16, 2, 1) != 0);
    p_sub->submodule_properties.reduce_input_submodule_data_length = (pf_get_bits(temp_u16, 3, 1) != 0);
@@ -268,18 +394,19 @@ static void pf_get_exp_submodule(
    p_sub->submodule_properties.discard_ioxs = (pf_get_bits(temp_u16, 5, 1) != 0);
 
    /* At least one submodule data descriptor */
-   p_sub->data_descriptor[0].data_direction = pf_get_uint16(p_info, p_pos);
-   p_sub->data_descriptor[0].submodule_data_length = pf_get_uint16(p_info, p_pos);
-   p_sub->data_descriptor[0].length_iocs = pf_get_byte(p_info, p_pos);
-   p_sub->data_descriptor[0].length_iops = pf_get_byte(p_info, p_pos);
+   p_sub->data_descriptor[0].data_direction = pf_cur_uint16(&cur);
+   p_sub->data_descriptor[0].submodule_data_length = pf_cur_uint16(&cur);
+   p_sub->data_descriptor[0].length_iocs = pf_cur_byte(&cur);
+   p_sub->data_descriptor[0].length_iops = pf_cur_byte(&cur);
    p_sub->nbr_data_descriptors = 1;
    /* May have one more */
    if (p_sub->submodule_properties.type == PNET_DIR_IO)
    {
-      p_sub->data_descriptor[1].data_direction = pf_get_uint16(p_info, p_pos);
-      p_sub->data_descriptor[1].submodule_data_length = pf_get_uint16(p_info, p_pos);
-      p_sub->data_descriptor[1].length_iocs = pf_get_byte(p_info, p_pos);
-      p_sub->data_descriptor[1].length_iops = pf_get_byte(p_info, p_pos);
+      (void)pf_get_cursor(p_info, p_pos, 6, &cur);
+      p_sub->data_descriptor[1].data_direction = pf_cur_uint16(&cur);
+      p_sub->data_descriptor[1].submodule_data_length = pf_cur_uint16(&cur);
+      p_sub->data_descriptor[1].length_iocs = pf_cur_byte(&cur);
+      p_sub->data_descriptor[1].length_iops = pf_cur_byte(&cur);
       p_sub->nbr_data_descriptors = 2;
    }
 }
@@ -291,10 +418,13 @@ void pf_get_block_header(
    uint16_t                *p_pos,
    pf_block_header_t       *p_hdr)
 {
-   p_hdr->block_type = pf_get_uint16(p_info, p_pos);
-   p_hdr->block_length = pf_get_uint16(p_info, p_pos);
-   p_hdr->block_version_high = pf_get_byte(p_info, p_pos);
-   p_hdr->block_version_low = pf_get_byte(p_info, p_pos);
+   pf_get_cursor_t         cur;
+
+   (void)pf_get_cursor(p_info, p_pos, 6, &cur);
+   p_hdr->block_type = pf_cur_uint16(&cur);
+   p_hdr->block_length = pf_cur_uint16(&cur);
+   p_hdr->block_version_high = pf_cur_byte(&cur);
+   p_hdr->block_version_low = pf_cur_byte(&cur);
 }
 
 void pf_get_ar_param(
@@ -302,17 +432,19 @@ void pf_get_ar_param(
    uint16_t                *p_pos,
    pf_ar_t                 *p_ar)
 {
+   pf_get_cursor_t cur;
    uint32_t temp_u32;
    uint16_t str_len;
 
-   p_ar->ar_param.ar_type = pf_get_uint16(p_info, p_pos);
-   pf_get_uuid(p_info, p_pos, &p_ar->ar_param.ar_uuid);
-   p_ar->ar_param.session_key = pf_get_uint16(p_info, p_pos);
-   pf_get_mem(p_info, p_pos,
+   (void)pf_get_cursor(p_info, p_pos, 52, &cur);
+   p_ar->ar_param.ar_type = pf_cur_uint16(&cur);
+   pf_cur_uuid(&cur, &p_ar->ar_param.ar_uuid);
+   p_ar->ar_param.session_key = pf_cur_uint16(&cur);
+   pf_cur_mem(&cur,
       sizeof(p_ar->ar_param.cm_initiator_mac_add), &p_ar->ar_param.cm_initiator_mac_add);
-   pf_get_uuid(p_info, p_pos, &p_ar->ar_param.cm_initiator_object_uuid);
+   pf_cur_uuid(&cur, &p_ar->ar_param.cm_initiator_object_uuid);
    /* ar_properties */
-   temp_u32 = pf_get_uint32(p_info, p_pos);
+   temp_u32 = pf_cur_uint32(&cur);
    p_ar->ar_param.ar_properties.state = pf_get_bits(temp_u32, 0, 3);
    p_ar->ar_param.ar_properties.supervisor_takeover_allowed = (pf_get_bits(temp_u32,3,1) != 0);
    p_ar->ar_param.ar_properties.parameterization_server = pf_get_bits(temp_u32,4,1);
@@ -323,10 +455,10 @@ void pf_get_ar_param(
    p_ar->ar_param.ar_properties.startup_mode = (pf_get_bits(temp_u32,30,1) != 0);
    p_ar->ar_param.ar_properties.pull_module_alarm_allowed = (pf_get_bits(temp_u32,31,1) != 0);
 
-   p_ar->ar_param.cm_initiator_activity_timeout_factor = pf_get_uint16(p_info, p_pos);
-   p_ar->ar_param.cm_initiator_udp_rt_port = pf_get_uint16(p_info, p_pos);
+   p_ar->ar_param.cm_initiator_activity_timeout_factor = pf_cur_uint16(&cur);
+   p_ar->ar_param.cm_initiator_udp_rt_port = pf_cur_uint16(&cur);
 
-   str_len = pf_get_uint16(p_info, p_pos);
+   str_len = pf_cur_uint16(&cur);
    p_ar->ar_param.cm_initiator_station_name_len = str_len;
    if (str_len > sizeof(p_ar->ar_param.cm_initiator_station_name) - 1)
    {
@@ -342,41 +474,52 @@ void pf_get_iocr_param(
    uint16_t                ix,
    pf_ar_t                 *p_ar)
 {
+   pf_get_cursor_t         cur;
    uint32_t                temp_u32;
    uint16_t                temp_u16;
    uint16_t                iy;
 
-   p_ar->iocrs[ix].param.iocr_type = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.iocr_reference = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.lt_field = pf_get_uint16(p_info, p_pos);
+   (void)pf_get_cursor(p_info, p_pos, 40, &cur);
+   p_ar->iocrs[ix].param.iocr_type = pf_cur_uint16(&cur);
+   p_ar->iocrs[ix].param.iocr_reference = pf_cur_uint16(&cur);
+   p_ar->iocrs[ix].param.lt_field = pf_cur_uint16(&cur);
    /* iocr_Properties */
-   temp_u32 = pf_get_uint32(p_info, p_pos);
+   temp_u32 = pf_cur_uint32(&cur);
    p_ar->iocrs[ix].param.iocr_properties.rt_class = pf_get_bits(temp_u32, 0, 4);
    p_ar->iocrs[ix].param.iocr_properties.reserved_1 = (pf_get_bits(temp_u32,4,9) != 0);
    p_ar->iocrs[ix].param.iocr_properties.reserved_2 = (pf_get_bits(temp_u32,13,11) != 0);
    p_ar->iocrs[ix].param.iocr_properties.reserved_3 = (pf_get_bits(temp_u32,24,8) != 0);
 
-   p_ar->iocrs[ix].param.c_sdu_length = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.frame_id = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.send_clock_factor = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.reduction_ratio = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.phase = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.sequence = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.frame_send_offset = pf_get_uint32(p_info, p_pos);
-   p_ar->iocrs[ix].param.watchdog_factor = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.data_hold_factor = pf_get_uint16(p_info, p_pos);
+   p_ar->iocrs[ix].param.c_sdu_length = pf_cur_uint16(&cur);
+   p_ar->iocrs[ix].param.frame_id = pf_cur_uint16(&cur);
+   p_ar->iocrs[ix].param.send_clock_factor = pf_cur_uint16(&cur);
+   p_ar->iocrs[ix].param.reduction_ratio = pf_cur_uint16(&cur);
+   p_ar->iocrs[ix].param.phase = pf_cur_uint16(&cur);
+   p_ar->iocrs[ix].param.sequence = pf_cur_uint16(&cur);
+   p_ar->iocrs[ix].param.frame_send_offset = pf_cur_uint32(&cur);
+   p_ar->iocrs[ix].param.watchdog_factor = pf_cur_uint16(&cur);
+   p_ar->iocrs[ix].param.data_hold_factor = pf_cur_uint16(&cur);
    /* iocr_tag_header */
-   temp_u16 = pf_get_uint16(p_info, p_pos);
+   temp_u16 = pf_cur_uint16(&cur);
    p_ar->iocrs[ix].param.iocr_tag_header.vlan_id = pf_get_bits(temp_u16, 0, 11);
    p_ar->iocrs[ix].param.iocr_tag_header.iocr_user_priority = pf_get_bits(temp_u16, 13, 3);
 
-   pf_get_mem(p_info, p_pos,
+   pf_cur_mem(&cur,
       sizeof(p_ar->iocrs[ix].param.iocr_multicast_mac_add), &p_ar->iocrs[ix].param.iocr_multicast_mac_add);
 
-   p_ar->iocrs[ix].param.nbr_apis = pf_get_uint16(p_info, p_pos);
+   p_ar->iocrs[ix].param.nbr_apis = pf_cur_uint16(&cur);
+   if (p_ar->iocrs[ix].param.nbr_apis > NELEMENTS(p_ar->iocrs[ix].param.apis))
+   {
+      LOG_DEBUG(PNET_LOG, "BR(%d): Too many IOCR APIs: %u\n", __LINE__, (unsigned)p_ar->iocrs[ix].param.nbr_apis);
+      p_ar->iocrs[ix].param.nbr_apis = 0;
+      if (p_info->result == PF_PARSE_OK)
+      {
+         p_info->result = PF_PARSE_OUT_OF_API_RESOURCES;
+      }
+   }
    for (iy = 0; iy < p_ar->iocrs[ix].param.nbr_apis; iy++)
    {
-      pf_get_iocr_api_entry(p_info, p_pos, &p_ar->iocrs[ix].param.apis[iy]);
+      pf_get_iocr_api_entry(p_info, p_pos, &p_ar->iocrs[ix], &p_ar->iocrs[ix].param.apis[iy]);
    }
 }
 
@@ -392,6 +535,7 @@ void pf_get_exp_api_module(
    pf_exp_api_t            *p_api = NULL;
    pf_exp_module_t         *p_mod = NULL;
    uint16_t                nbr_exp_api;
+   pf_get_cursor_t         cur;
 
    nbr_exp_api = pf_get_uint16(p_info, p_pos);  /* In this block */
    for (ix = 0; ix < nbr_exp_api; ix++)
@@ -432,19 +576,31 @@ void pf_get_exp_api_module(
          slot_number = pf_get_uint16(p_info, p_pos);
 
          /* Get a new module. */
-         if (p_api->nbr_modules < PNET_MAX_MODULES)
+         if (p_api->nbr_modules < p_ar->max_exp_modules)
          {
             p_mod = &p_api->modules[p_api->nbr_modules];
             p_api->nbr_modules++;
 
             p_mod->slot_number = slot_number;
-            p_mod->module_ident_number = pf_get_uint32(p_info, p_pos);
-            p_mod->module_properties = pf_get_uint16(p_info, p_pos);
-            p_mod->nbr_submodules = pf_get_uint16(p_info, p_pos);
+            (void)pf_get_cursor(p_info, p_pos, 8, &cur);
+            p_mod->module_ident_number = pf_cur_uint32(&cur);
+            p_mod->module_properties = pf_cur_uint16(&cur);
+            p_mod->nbr_submodules = pf_cur_uint16(&cur);
+            p_mod->submodules = &p_ar->exp_submodules[p_ar->nbr_exp_submodules];
+            if (p_mod->nbr_submodules > p_ar->max_exp_submodules - p_ar->nbr_exp_submodules)
+            {
+               LOG_DEBUG(PNET_LOG, "BR(%d): Too many expected submodules: %u\n", __LINE__, (unsigned)p_mod->nbr_submodules);
+               p_mod->nbr_submodules = 0;
+               if (p_info->result == PF_PARSE_OK)
+               {
+                  p_info->result = PF_PARSE_OUT_OF_EXP_SUBMODULE_RESOURCES;
+               }
+            }
             for (iy = 0; iy < p_mod->nbr_submodules; iy++)
             {
                pf_get_exp_submodule(p_info, p_pos, &p_mod->submodules[iy]);
             }
+            p_ar->nbr_exp_submodules += p_mod->nbr_submodules;
             p_api->valid = true;
          }
          else
@@ -462,26 +618,28 @@ void pf_get_alarm_cr_request(
    uint16_t                *p_pos,
    pf_ar_t                 *p_ar)
 {
+   pf_get_cursor_t         cur;
    uint32_t temp_u32;
    uint16_t temp_u16;
 
-   p_ar->alarm_cr_request.alarm_cr_type = pf_get_uint16(p_info, p_pos);
-   p_ar->alarm_cr_request.lt_field = pf_get_uint16(p_info, p_pos);
+   (void)pf_get_cursor(p_info, p_pos, 20, &cur);
+   p_ar->alarm_cr_request.alarm_cr_type = pf_cur_uint16(&cur);
+   p_ar->alarm_cr_request.lt_field = pf_cur_uint16(&cur);
    /* alarm_cr_properties */
-   temp_u32 = pf_get_uint32(p_info, p_pos);
+   temp_u32 = pf_cur_uint32(&cur);
    p_ar->alarm_cr_request.alarm_cr_properties.priority = (pf_get_bits(temp_u32, 0, 1) != 0);
    p_ar->alarm_cr_request.alarm_cr_properties.transport_udp = (pf_get_bits(temp_u32, 1, 1) != 0);
 
-   p_ar->alarm_cr_request.rta_timeout_factor = pf_get_uint16(p_info, p_pos);
-   p_ar->alarm_cr_request.rta_retries = pf_get_uint16(p_info, p_pos);
-   p_ar->alarm_cr_request.local_alarm_reference = pf_get_uint16(p_info, p_pos);
-   p_ar->alarm_cr_request.max_alarm_data_length = pf_get_uint16(p_info, p_pos);
+   p_ar->alarm_cr_request.rta_timeout_factor = pf_cur_uint16(&cur);
+   p_ar->alarm_cr_request.rta_retries = pf_cur_uint16(&cur);
+   p_ar->alarm_cr_request.local_alarm_reference = pf_cur_uint16(&cur);
+   p_ar->alarm_cr_request.max_alarm_data_length = pf_cur_uint16(&cur);
 
-   temp_u16 = pf_get_uint16(p_info, p_pos);
+   temp_u16 = pf_cur_uint16(&cur);
    p_ar->alarm_cr_request.alarm_cr_tag_header_high.vlan_id = pf_get_bits(temp_u16, 0, 12);
    p_ar->alarm_cr_request.alarm_cr_tag_header_high.alarm_user_priority = pf_get_bits(temp_u16, 13, 3);
 
-   temp_u16 = pf_get_uint16(p_info, p_pos);
+   temp_u16 = pf_cur_uint16(&cur);
    p_ar->alarm_cr_request.alarm_cr_tag_header_low.vlan_id = pf_get_bits(temp_u16, 0, 12);
    p_ar->alarm_cr_request.alarm_cr_tag_header_low.alarm_user_priority = pf_get_bits(temp_u16, 13, 3);
 }
@@ -581,16 +739,19 @@ void pf_get_control(
    uint16_t                *p_pos,
    pf_control_block_t      *p_req)
 {
+   pf_get_cursor_t         cur;
+
+   (void)pf_get_cursor(p_info, p_pos, 26, &cur);
    /* 2 padding bytes */
-   (void)pf_get_uint16(p_info, p_pos);
-   pf_get_uuid(p_info, p_pos, &p_req->ar_uuid);
-   p_req->session_key = pf_get_uint16(p_info, p_pos);
+   (void)pf_cur_uint16(&cur);
+   pf_cur_uuid(&cur, &p_req->ar_uuid);
+   p_req->session_key = pf_cur_uint16(&cur);
 
-   p_req->alarm_sequence_number = pf_get_uint16(p_info, p_pos);
+   p_req->alarm_sequence_number = pf_cur_uint16(&cur);
 
    /* Command and properties are always Big-Endian on the wire!! */
-   p_req->control_command = pf_get_uint16(p_info, p_pos);
-   p_req->control_block_properties = pf_get_uint16(p_info, p_pos);;
+   p_req->control_command = pf_cur_uint16(&cur);
+   p_req->control_block_properties = pf_cur_uint16(&cur);
 }
 
 void pf_get_ndr_data(
@@ -598,11 +759,14 @@ void pf_get_ndr_data(
    uint16_t                *p_pos,
    pf_ndr_data_t           *p_ndr)
 {
-   p_ndr->args_maximum = pf_get_uint32(p_info, p_pos);
-   p_ndr->args_length = pf_get_uint32(p_info, p_pos);
-   p_ndr->array.maximum_count = pf_get_uint32(p_info, p_pos);
-   p_ndr->array.offset = pf_get_uint32(p_info, p_pos);
-   p_ndr->array.actual_count = pf_get_uint32(p_info, p_pos);
+   pf_get_cursor_t         cur;
+
+   (void)pf_get_cursor(p_info, p_pos, 20, &cur);
+   p_ndr->args_maximum = pf_cur_uint32(&cur);
+   p_ndr->args_length = pf_cur_uint32(&cur);
+   p_ndr->array.maximum_count = pf_cur_uint32(&cur);
+   p_ndr->array.offset = pf_cur_uint32(&cur);
+   p_ndr->array.actual_count = pf_cur_uint32(&cur);
 }
 
 void pf_get_dce_rpc_header(
@@ -610,12 +774,14 @@ void pf_get_dce_rpc_header(
    uint16_t                *p_pos,
    pf_rpc_header_t         *p_rpc)
 {
+   pf_get_cursor_t         cur;
    uint8_t                 temp_uint8;
 
-   p_rpc->version = pf_get_byte(p_info, p_pos);
-   p_rpc->packet_type = pf_get_byte(p_info, p_pos) & 0x1f;  /* Only 5 LSB according to spec */
+   (void)pf_get_cursor(p_info, p_pos, 80, &cur);
+   p_rpc->version = pf_cur_byte(&cur);
+   p_rpc->packet_type = pf_cur_byte(&cur) & 0x1f;  /* Only 5 LSB according to spec */
    /* flags */
-   temp_uint8 = pf_get_byte(p_info, p_pos);
+   temp_uint8 = pf_cur_byte(&cur);
    p_rpc->flags.last_fragment = pf_get_bits(temp_uint8, PF_RPC_F_LAST_FRAGMENT, 1);
    p_rpc->flags.fragment = pf_get_bits(temp_uint8, PF_RPC_F_FRAGMENT, 1);
    p_rpc->flags.no_fack = pf_get_bits(temp_uint8, PF_RPC_F_NO_FACK, 1);
@@ -623,31 +789,32 @@ void pf_get_dce_rpc_header(
    p_rpc->flags.idempotent = pf_get_bits(temp_uint8, PF_RPC_F_IDEMPOTENT, 1);
    p_rpc->flags.broadcast = pf_get_bits(temp_uint8, PF_RPC_F_BROADCAST, 1);
    /* flags2 */
-   temp_uint8 = pf_get_byte(p_info, p_pos);
+   temp_uint8 = pf_cur_byte(&cur);
    p_rpc->flags2.cancel_pending = pf_get_bits(temp_uint8, PF_RPC_F2_CANCEL_PENDING, 1);
    /* Data repr */
-   temp_uint8 = pf_get_byte(p_info, p_pos);
+   temp_uint8 = pf_cur_byte(&cur);
    p_rpc->is_big_endian = (pf_get_bits(temp_uint8, 4, 4) == 0);
    p_info->is_big_endian = p_rpc->is_big_endian;
+   cur.is_big_endian = p_rpc->is_big_endian;
    /* Float repr  - Assume IEEE */
-   temp_uint8 = pf_get_byte(p_info, p_pos);
+   temp_uint8 = pf_cur_byte(&cur);
    /* Reserved */
-   p_rpc->reserved = pf_get_byte(p_info, p_pos);
-
-   p_rpc->serial_high = pf_get_byte(p_info, p_pos);
-   pf_get_uuid(p_info, p_pos, &p_rpc->object_uuid);
-   pf_get_uuid(p_info, p_pos, &p_rpc->interface_uuid);
-   pf_get_uuid(p_info, p_pos, &p_rpc->activity_uuid);
-   p_rpc->server_boot_time = pf_get_uint32(p_info, p_pos);
-   p_rpc->interface_version = pf_get_uint32(p_info, p_pos);
-   p_rpc->sequence_nmb = pf_get_uint32(p_info, p_pos);
-   p_rpc->opnum = pf_get_uint16(p_info, p_pos);
-   p_rpc->interface_hint = pf_get_uint16(p_info, p_pos);
-   p_rpc->activity_hint = pf_get_uint16(p_info, p_pos);
-   p_rpc->length_of_body = pf_get_uint16(p_info, p_pos);
-   p_rpc->fragment_nmb = pf_get_uint16(p_info, p_pos);
-   p_rpc->auth_protocol = pf_get_byte(p_info, p_pos);
-   p_rpc->serial_low = pf_get_byte(p_info, p_pos);
+   p_rpc->reserved = pf_cur_byte(&cur);
+
+   p_rpc->serial_high = pf_cur_byte(&cur);
+   pf_cur_uuid(&cur, &p_rpc->object_uuid);
+   pf_cur_uuid(&cur, &p_rpc->interface_uuid);
+   pf_cur_uuid(&cur, &p_rpc->activity_uuid);
+   p_rpc->server_boot_time = pf_cur_uint32(&cur);
+   p_rpc->interface_version = pf_cur_uint32(&cur);
+   p_rpc->sequence_nmb = pf_cur_uint32(&cur);
+   p_rpc->opnum = pf_cur_uint16(&cur);
+   p_rpc->interface_hint = pf_cur_uint16(&cur);
+   p_rpc->activity_hint = pf_cur_uint16(&cur);
+   p_rpc->length_of_body = pf_cur_uint16(&cur);
+   p_rpc->fragment_nmb = pf_cur_uint16(&cur);
+   p_rpc->auth_protocol = pf_cur_byte(&cur);
+   p_rpc->serial_low = pf_cur_byte(&cur);
 }
 
 void pf_get_read_request(
@@ -655,21 +822,23 @@ void pf_get_read_request(
    uint16_t                *p_pos,
    pf_iod_read_request_t   *p_req)
 {
+   pf_get_cursor_t         cur;
    uint16_t                ix;
 
-   p_req->sequence_number = pf_get_uint16(p_info, p_pos);
-   pf_get_uuid(p_info, p_pos, &p_req->ar_uuid);
-   p_req->api = pf_get_uint32(p_info, p_pos);
-   p_req->slot_number = pf_get_uint16(p_info, p_pos);
-   p_req->subslot_number = pf_get_uint16(p_info, p_pos);
-   p_req->padding[0] = pf_get_byte(p_info, p_pos);
-   p_req->padding[1] = pf_get_byte(p_info, p_pos);
-   p_req->index = pf_get_uint16(p_info, p_pos);
-   p_req->record_data_length = pf_get_uint32(p_info, p_pos);
-   pf_get_uuid(p_info, p_pos, &p_req->target_ar_uuid);
+   (void)pf_get_cursor(p_info, p_pos, 50 + sizeof(p_req->rw_padding), &cur);
+   p_req->sequence_number = pf_cur_uint16(&cur);
+   pf_cur_uuid(&cur, &p_req->ar_uuid);
+   p_req->api = pf_cur_uint32(&cur);
+   p_req->slot_number = pf_cur_uint16(&cur);
+   p_req->subslot_number = pf_cur_uint16(&cur);
+   p_req->padding[0] = pf_cur_byte(&cur);
+   p_req->padding[1] = pf_cur_byte(&cur);
+   p_req->index = pf_cur_uint16(&cur);
+   p_req->record_data_length = pf_cur_uint32(&cur);
+   pf_cur_uuid(&cur, &p_req->target_ar_uuid);
    for (ix = 0; ix < NELEMENTS(p_req->rw_padding); ix++)
    {
-      p_req->rw_padding[ix] = pf_get_byte(p_info, p_pos);
+      p_req->rw_padding[ix] = pf_cur_byte(&cur);
    }
 }
 
@@ -678,20 +847,22 @@ void pf_get_write_request(
    uint16_t                *p_pos,
    pf_iod_write_request_t  *p_req)
 {
+   pf_get_cursor_t         cur;
    uint16_t                ix;
 
-   p_req->sequence_number = pf_get_uint16(p_info, p_pos);
-   pf_get_uuid(p_info, p_pos, &p_req->ar_uuid);
-   p_req->api = pf_get_uint32(p_info, p_pos);
-   p_req->slot_number = pf_get_uint16(p_info, p_pos);
-   p_req->subslot_number = pf_get_uint16(p_info, p_pos);
-   p_req->padding[0] = pf_get_byte(p_info, p_pos);
-   p_req->padding[1] = pf_get_byte(p_info, p_pos);
-   p_req->index = pf_get_uint16(p_info, p_pos);
-   p_req->record_data_length = pf_get_uint32(p_info, p_pos);
+   (void)pf_get_cursor(p_info, p_pos, 34 + sizeof(p_req->rw_padding), &cur);
+   p_req->sequence_number = pf_cur_uint16(&cur);
+   pf_cur_uuid(&cur, &p_req->ar_uuid);
+   p_req->api = pf_cur_uint32(&cur);
+   p_req->slot_number = pf_cur_uint16(&cur);
+   p_req->subslot_number = pf_cur_uint16(&cur);
+   p_req->padding[0] = pf_cur_byte(&cur);
+   p_req->padding[1] = pf_cur_byte(&cur);
+   p_req->index = pf_cur_uint16(&cur);
+   p_req->record_data_length = pf_cur_uint32(&cur);
    for (ix = 0; ix < NELEMENTS(p_req->rw_padding); ix++)
    {
-      p_req->rw_padding[ix] = pf_get_byte(p_info, p_pos);
+      p_req->rw_padding[ix] = pf_cur_byte(&cur);
    }
 }
 
@@ -711,22 +882,24 @@ void pf_get_alarm_fixed(
    uint16_t                *p_pos,
    pf_alarm_fixed_t        *p_alarm_fixed)
 {
+   pf_get_cursor_t         cur;
    uint32_t                temp_u32;
 
+   (void)pf_get_cursor(p_info, p_pos, 10, &cur);
    /* The fixed part is not a "block" so do not expect a block header */
-   p_alarm_fixed->dst_ref = pf_get_uint16(p_info, p_pos);
-   p_alarm_fixed->src_ref = pf_get_uint16(p_info, p_pos);
+   p_alarm_fixed->dst_ref = pf_cur_uint16(&cur);
+   p_alarm_fixed->src_ref = pf_cur_uint16(&cur);
 
-   temp_u32 = pf_get_byte(p_info, p_pos);
+   temp_u32 = pf_cur_byte(&cur);
    p_alarm_fixed->pdu_type.type = pf_get_bits(temp_u32, 0, 4);
    p_alarm_fixed->pdu_type.version = pf_get_bits(temp_u32, 4, 4);
 
-   temp_u32 = pf_get_byte(p_info, p_pos);
+   temp_u32 = pf_cur_byte(&cur);
    p_alarm_fixed->add_flags.window_size = pf_get_bits(temp_u32, 0, 4);
    p_alarm_fixed->add_flags.tack = pf_get_bits(temp_u32, 4, 1);
 
-   p_alarm_fixed->send_seq_num = pf_get_uint16(p_info, p_pos);
-   p_alarm_fixed->ack_seq_nbr = pf_get_uint16(p_info, p_pos);
+   p_alarm_fixed->send_seq_num = pf_cur_uint16(&cur);
+   p_alarm_fixed->ack_seq_nbr = pf_cur_uint16(&cur);
 }
 
 void pf_get_alarm_data(
@@ -734,18 +907,20 @@ void pf_get_alarm_data(
    uint16_t                *p_pos,
    pf_alarm_data_t         *p_alarm_data)
 {
+   pf_get_cursor_t         cur;
    uint16_t                temp_u16;
 
-   p_alarm_data->alarm_type = pf_get_uint16(p_info, p_pos);
-   p_alarm_data->api_id = pf_get_uint32(p_info, p_pos);
-   p_alarm_data->slot_nbr = pf_get_uint16(p_info, p_pos);
-   p_alarm_data->subslot_nbr = pf_get_uint16(p_info, p_pos);
-   p_alarm_data->module_ident = pf_get_uint32(p_info, p_pos);
-   p_alarm_data->submodule_ident = pf_get_uint32(p_info, p_pos);
-   p_alarm_data->alarm_type = pf_get_uint16(p_info, p_pos);
+   (void)pf_get_cursor(p_info, p_pos, 22, &cur);
+   p_alarm_data->alarm_type = pf_cur_uint16(&cur);
+   p_alarm_data->api_id = pf_cur_uint32(&cur);
+   p_alarm_data->slot_nbr = pf_cur_uint16(&cur);
+   p_alarm_data->subslot_nbr = pf_cur_uint16(&cur);
+   p_alarm_data->module_ident = pf_cur_uint32(&cur);
+   p_alarm_data->submodule_ident = pf_cur_uint32(&cur);
+   p_alarm_data->alarm_type = pf_cur_uint16(&cur);
 
    /* AlarmSpecifier */
-   temp_u16 = pf_get_uint16(p_info, p_pos);
+   temp_u16 = pf_cur_uint16(&cur);
    p_alarm_data->sequence_number = pf_get_bits(temp_u16, 0, 11);
    p_alarm_data->alarm_specifier.channel_diagnosis = pf_get_bits(temp_u16, 1, 11);
    p_alarm_data->alarm_specifier.manufacturer_diagnosis = pf_get_bits(temp_u16, 1, 12);
@@ -758,16 +933,18 @@ void pf_get_alarm_ack(
    uint16_t                *p_pos,
    pf_alarm_data_t         *p_alarm_data)
 {
+   pf_get_cursor_t         cur;
    uint16_t                temp_u16;
 
-   p_alarm_data->alarm_type = pf_get_uint16(p_info, p_pos);
-   p_alarm_data->api_id = pf_get_uint32(p_info, p_pos);
-   p_alarm_data->slot_nbr = pf_get_uint16(p_info, p_pos);
-   p_alarm_data->subslot_nbr = pf_get_uint16(p_info, p_pos);
-   p_alarm_data->alarm_type = pf_get_uint16(p_info, p_pos);
+   (void)pf_get_cursor(p_info, p_pos, 14, &cur);
+   p_alarm_data->alarm_type = pf_cur_uint16(&cur);
+   p_alarm_data->api_id = pf_cur_uint32(&cur);
+   p_alarm_data->slot_nbr = pf_cur_uint16(&cur);
+   p_alarm_data->subslot_nbr = pf_cur_uint16(&cur);
+   p_alarm_data->alarm_type = pf_cur_uint16(&cur);
 
    /* AlarmSpecifier */
-   temp_u16 = pf_get_uint16(p_info, p_pos);
+   temp_u16 = pf_cur_uint16(&cur);
    p_alarm_data->sequence_number = pf_get_bits(temp_u16, 0, 11);
    p_alarm_data->alarm_specifier.channel_diagnosis = pf_get_bits(temp_u16, 1, 11);
    p_alarm_data->alarm_specifier.manufacturer_diagnosis = pf_get_bits(temp_u16, 1, 12);
@@ -780,8 +957,11 @@ void pf_get_pnio_status(
    uint16_t                *p_pos,
    pnet_pnio_status_t      *p_status)
 {
-   p_status->error_code = pf_get_byte(p_info, p_pos);
-   p_status->error_decode = pf_get_byte(p_info, p_pos);
-   p_status->error_code_1 = pf_get_byte(p_info, p_pos);
-   p_status->error_code_2 = pf_get_byte(p_info, p_pos);
+   pf_get_cursor_t         cur;
+
+   (void)pf_get_cursor(p_info, p_pos, 4, &cur);
+   p_status->error_code = pf_cur_byte(&cur);
+   p_status->error_decode = pf_cur_byte(&cur);
+   p_status->error_code_1 = pf_cur_byte(&cur);
+   p_status->error_code_2 = pf_cur_byte(&cur);
 }
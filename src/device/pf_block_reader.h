@@ -94,6 +94,8 @@ void pf_get_iocr_param(
 
 /**
  * Extract an expected API block from a buffer.
+ *
+ * The modules and submodules are stored in the tables the AR is bound to.
  * @param p_info           In:   The parser state.
  * @param p_pos            InOut:Position in the buffer.
  * @param p_ar             Out:  Contains the destination structure.
@@ -23,12 +23,93 @@
 #include "pf_block_writer.h"
 
 
+/* Position after a field did not fit. It is past the end of any buffer. */
+#define PF_PUT_POS_OVERFLOW         UINT16_MAX
+
+/**
+ * @internal
+ * Reserve room for a given number of bytes in a buffer.
+ *
+ * The capacity check is done once for a whole field or fixed size part,
+ * which is then written without further checks.
+ * A field that does not fit moves the position past the end of the buffer,
+ * so that all later fields are also skipped. See pf_put_overflow().
+ * @param len              In:   Number of bytes to write.
+ * @param res_len          In:   Size of destination buffer.
+ * @param p_bytes          In:   Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ * @return  Where to write the bytes, or NULL if they do not fit.
+ */
+static inline uint8_t *pf_put_reserve(
+   uint16_t                len,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   uint8_t                 *p_dst = NULL;
+
+   if ((p_bytes != NULL) && (((uint32_t)*p_pos + len) <= res_len))
+   {
+      p_dst = &p_bytes[*p_pos];
+      (*p_pos) += len;
+   }
+   else
+   {
+      /* Reached end of buffer */
+      LOG_DEBUG(PNET_LOG, "BW(%d): End of buffer reached\n", __LINE__);
+      *p_pos = PF_PUT_POS_OVERFLOW;
+   }
+
+   return p_dst;
+}
+
+static inline void pf_put_u16_at(
+   bool                    is_big_endian,
+   uint16_t                val,
+   uint8_t                 *p_dst)
+{
+   if (is_big_endian)
+   {
+      p_dst[0] = (uint8_t)(val >> 8);
+      p_dst[1] = (uint8_t)val;
+   }
+   else
+   {
+      p_dst[0] = (uint8_t)val;
+      p_dst[1] = (uint8_t)(val >> 8);
+   }
+}
+
+static inline void pf_put_u32_at(
+   bool                    is_big_endian,
+   uint32_t                val,
+   uint8_t                 *p_dst)
+{
+   if (is_big_endian)
+   {
+      p_dst[0] = (uint8_t)(val >> 24);
+      p_dst[1] = (uint8_t)(val >> 16);
+      p_dst[2] = (uint8_t)(val >> 8);
+      p_dst[3] = (uint8_t)val;
+   }
+   else
+   {
+      p_dst[0] = (uint8_t)val;
+      p_dst[1] = (uint8_t)(val >> 8);
+      p_dst[2] = (uint8_t)(val >> 16);
+      p_dst[3] = (uint8_t)(val >> 24);
+   }
+}
+
 /**
  * @internal
  * Insert a block header into a buffer.
+ *
+ * The block length is not known yet. It is inserted by
+ * pf_put_block_length() once the block is complete, so save the position
+ * before calling this function.
  * @param is_big_endian    In:   true if buffer is big-endian.
  * @param bh_type          In:   Block type.
- * @param bh_length        In:   Block length.
  * @param bh_ver_high      In:   Block version high.
  * @param bh_ver_low       In:   Block version low.
  * @param res_len          In:   Size of destination buffer.
@@ -38,19 +119,49 @@
 static void pf_put_block_header(
    bool                    is_big_endian,
    pf_block_type_values_t  bh_type,
-   uint16_t                bh_length,
    uint8_t                 bh_ver_high,
    uint8_t                 bh_ver_low,
    uint16_t                res_len,
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t temp_u16 = (uint16_t)bh_type;
+   uint8_t                 *p_dst = pf_put_reserve(sizeof(pf_block_header_t), res_len, p_bytes, p_pos);
 
-   pf_put_uint16(is_big_endian, temp_u16, res_len, p_bytes, p_pos);
-   pf_put_uint16(is_big_endian, (bh_length + sizeof(pf_block_header_t)) - 4, res_len, p_bytes, p_pos);     /* Always (-4)!! */
-   pf_put_byte(bh_ver_high, res_len, p_bytes, p_pos);
-   pf_put_byte(bh_ver_low, res_len, p_bytes, p_pos);
+   if (p_dst != NULL)
+   {
+      pf_put_u16_at(is_big_endian, (uint16_t)bh_type, &p_dst[0]);
+      pf_put_u16_at(is_big_endian, 0, &p_dst[2]);
+      p_dst[4] = bh_ver_high;
+      p_dst[5] = bh_ver_low;
+   }
+}
+
+/**
+ * @internal
+ * Insert the block length into a block header, when the block is complete.
+ *
+ * The length covers everything after the block_length field up to the
+ * current position, i.e. the versions and the block contents.
+ * @param is_big_endian    In:   true if buffer is big-endian.
+ * @param block_pos        In:   Position of the block header.
+ * @param res_len          In:   Size of destination buffer.
+ * @param p_bytes          InOut:Destination buffer.
+ * @param p_pos            In:   Position after the block.
+ */
+static void pf_put_block_length(
+   bool                    is_big_endian,
+   uint16_t                block_pos,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   const uint16_t          *p_pos)
+{
+   if ((p_bytes != NULL) &&
+       ((uint32_t)block_pos + sizeof(pf_block_header_t) <= *p_pos) &&
+       (*p_pos <= res_len))
+   {
+      pf_put_u16_at(is_big_endian, *p_pos - (block_pos + 4),
+         &p_bytes[block_pos + offsetof(pf_block_header_t, block_length)]);
+   }
 }
 
 /**
@@ -75,24 +186,18 @@ static void pf_put_str(
    uint16_t                *p_pos)
 {
    uint16_t                str_len = (uint16_t)strlen(p_src);
-   uint16_t                ix;
-
-   if (((*p_pos) + src_size) >= res_len)
-   {
-      /* Reached end of buffer */
-      LOG_DEBUG(PNET_LOG, "BW(%d): Output buffer is full\n", __LINE__);
-      p_bytes = NULL;
-   }
+   /* Size also includes NUL-terminator. Do not write into that pos. */
+   uint8_t                 *p_dst = pf_put_reserve(src_size - 1, res_len, p_bytes, p_pos);
 
-   if (p_bytes != NULL)
+   if (p_dst != NULL)
    {
-      memcpy(&p_bytes[*p_pos], p_src, str_len);
-      (*p_pos) += str_len;
-      /* Pad with spaces - size also includes NUL-terminator. Do not write into that pos. */
-      for (ix = str_len; ix < src_size - 1; ix++)
+      if (str_len > src_size - 1)
       {
-         pf_put_byte(' ', res_len, p_bytes, p_pos);
+         str_len = src_size - 1;
       }
+      memcpy(p_dst, p_src, str_len);
+      /* Pad with spaces */
+      memset(&p_dst[str_len], ' ', src_size - 1 - str_len);
    }
 }
 
@@ -112,14 +217,26 @@ static void pf_put_uuid(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   pf_put_uint32(is_big_endian, p_uuid->data1, res_len, p_bytes, p_pos);
-   pf_put_uint16(is_big_endian, p_uuid->data2, res_len, p_bytes, p_pos);
-   pf_put_uint16(is_big_endian, p_uuid->data3, res_len, p_bytes, p_pos);
-   pf_put_mem(p_uuid->data4, sizeof(p_uuid->data4), res_len, p_bytes, p_pos);
+   uint8_t                 *p_dst = pf_put_reserve(16, res_len, p_bytes, p_pos);
+
+   if (p_dst != NULL)
+   {
+      pf_put_u32_at(is_big_endian, p_uuid->data1, &p_dst[0]);
+      pf_put_u16_at(is_big_endian, p_uuid->data2, &p_dst[4]);
+      pf_put_u16_at(is_big_endian, p_uuid->data3, &p_dst[6]);
+      memcpy(&p_dst[8], p_uuid->data4, sizeof(p_uuid->data4));
+   }
 }
 
 /* ======================== Public functions */
 
+bool pf_put_overflow(
+   uint16_t                res_len,
+   uint16_t                pos)
+{
+   return (pos > res_len);
+}
+
 void pf_put_mem(
    const void              *p_src,
    uint16_t                src_size,      /* Bytes to copy */
@@ -127,17 +244,11 @@ void pf_put_mem(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   if (((*p_pos) + src_size) >= res_len)
-   {
-      /* Reached end of buffer */
-      LOG_DEBUG(PNET_LOG, "BW(%d): Output buffer is full\n", __LINE__);
-      p_bytes = NULL;
-   }
+   uint8_t                 *p_dst = pf_put_reserve(src_size, res_len, p_bytes, p_pos);
 
-   if (p_bytes != NULL)
+   if (p_dst != NULL)
    {
-      memcpy(&p_bytes[*p_pos], p_src, src_size);
-      (*p_pos) += src_size;
+      memcpy(p_dst, p_src, src_size);
    }
 }
 
@@ -147,17 +258,11 @@ void pf_put_byte(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   if (*p_pos >= res_len)
-   {
-      /* Reached end of buffer */
-      LOG_DEBUG(PNET_LOG, "BW(%d): End of buffer reached\n", __LINE__);
-      p_bytes = NULL;
-   }
+   uint8_t                 *p_dst = pf_put_reserve(1, res_len, p_bytes, p_pos);
 
-   if (p_bytes != NULL)
+   if (p_dst != NULL)
    {
-      p_bytes[*p_pos] = val;
-      (*p_pos)++;
+      *p_dst = val;
    }
 }
 
@@ -168,15 +273,11 @@ void pf_put_uint16(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   if (is_big_endian)
-   {
-      pf_put_byte((val >> 8) & 0xff, res_len, p_bytes, p_pos);
-      pf_put_byte(val & 0xff, res_len, p_bytes, p_pos);
-   }
-   else
+   uint8_t                 *p_dst = pf_put_reserve(2, res_len, p_bytes, p_pos);
+
+   if (p_dst != NULL)
    {
-      pf_put_byte(val & 0xff, res_len, p_bytes, p_pos);
-      pf_put_byte((val >> 8) & 0xff, res_len, p_bytes, p_pos);
+      pf_put_u16_at(is_big_endian, val, p_dst);
    }
 }
 
@@ -187,19 +288,11 @@ void pf_put_uint32(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   if (is_big_endian)
-   {
-      pf_put_byte((val >> 24) & 0xff, res_len, p_bytes, p_pos);
-      pf_put_byte((val >> 16) & 0xff, res_len, p_bytes, p_pos);
-      pf_put_byte((val >> 8) & 0xff, res_len, p_bytes, p_pos);
-      pf_put_byte(val & 0xff, res_len, p_bytes, p_pos);
-   }
-   else
+   uint8_t                 *p_dst = pf_put_reserve(4, res_len, p_bytes, p_pos);
+
+   if (p_dst != NULL)
    {
-      pf_put_byte(val & 0xff, res_len, p_bytes, p_pos);
-      pf_put_byte((val >> 8) & 0xff, res_len, p_bytes, p_pos);
-      pf_put_byte((val >> 16) & 0xff, res_len, p_bytes, p_pos);
-      pf_put_byte((val >> 24) & 0xff, res_len, p_bytes, p_pos);
+      pf_put_u32_at(is_big_endian, val, p_dst);
    }
 }
 
@@ -210,10 +303,15 @@ void pf_put_time_timestamp(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   pf_put_uint16(is_big_endian, p_time_ts->status, res_len, p_bytes, p_pos);
-   pf_put_uint16(is_big_endian, p_time_ts->sec_hi, res_len, p_bytes, p_pos);
-   pf_put_uint32(is_big_endian, p_time_ts->sec_lo, res_len, p_bytes, p_pos);
-   pf_put_uint32(is_big_endian, p_time_ts->nano_sec, res_len, p_bytes, p_pos);
+   uint8_t                 *p_dst = pf_put_reserve(12, res_len, p_bytes, p_pos);
+
+   if (p_dst != NULL)
+   {
+      pf_put_u16_at(is_big_endian, p_time_ts->status, &p_dst[0]);
+      pf_put_u16_at(is_big_endian, p_time_ts->sec_hi, &p_dst[2]);
+      pf_put_u32_at(is_big_endian, p_time_ts->sec_lo, &p_dst[4]);
+      pf_put_u32_at(is_big_endian, p_time_ts->nano_sec, &p_dst[8]);
+   }
 }
 
 void pf_put_ar_result(
@@ -224,10 +322,9 @@ void pf_put_ar_result(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
 
    pf_put_block_header(is_big_endian,
-      PF_BT_AR_BLOCK_RES, 0,                             /* Dont know block_len yet */
+      PF_BT_AR_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -239,9 +336,7 @@ void pf_put_ar_result(
    pf_put_uint16(is_big_endian, p_ar->ar_result.responder_udp_rt_port, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_iocr_result(
@@ -253,10 +348,9 @@ void pf_put_iocr_result(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
 
    pf_put_block_header(is_big_endian,
-      PF_BT_IOCR_BLOCK_RES, 0,                           /* Dont know block_len yet */
+      PF_BT_IOCR_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -265,9 +359,7 @@ void pf_put_iocr_result(
    pf_put_uint16(is_big_endian, p_ar->iocrs[ix].result.frame_id, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_alarm_cr_result(
@@ -278,10 +370,9 @@ void pf_put_alarm_cr_result(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
 
    pf_put_block_header(is_big_endian,
-      PF_BT_ALARM_CR_BLOCK_RES, 0,                       /* Dont know block_len yet */
+      PF_BT_ALARM_CR_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -290,9 +381,7 @@ void pf_put_alarm_cr_result(
    pf_put_uint16(is_big_endian, p_ar->alarm_cr_result.max_alarm_data_length, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 /**
@@ -434,13 +523,12 @@ void pf_put_ar_diff(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
    uint16_t                api_ix;
 
    if ((p_ar != NULL) && (p_ar->nbr_api_diffs > 0))
    {
       pf_put_block_header(is_big_endian,
-         PF_BT_MODULE_DIFF_BLOCK, 0,                        /* Dont know block_len yet */
+         PF_BT_MODULE_DIFF_BLOCK,
          PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
          res_len, p_bytes, p_pos);
 
@@ -452,9 +540,7 @@ void pf_put_ar_diff(
       }
 
       /* Finally insert the block length into the block header */
-      block_len = *p_pos - (block_pos + 4);
-      block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-      pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
    }
 }
 
@@ -466,19 +552,16 @@ void pf_put_ar_rpc_result(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
 
    pf_put_block_header(is_big_endian,
-      PF_BT_AR_RPC_BLOCK_RES, 0,                         /* Dont know block_len yet */
+      PF_BT_AR_RPC_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_uint16(is_big_endian, p_ar->ar_rpc_result.responder_rpc_server_port, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_ar_server_result(
@@ -489,10 +572,9 @@ void pf_put_ar_server_result(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
 
    pf_put_block_header(is_big_endian,
-      PF_BT_AR_SERVER_BLOCK, 0,                          /* Dont know block_len yet */
+      PF_BT_AR_SERVER_BLOCK,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -507,9 +589,7 @@ void pf_put_ar_server_result(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 #if PNET_OPTION_AR_VENDOR_BLOCKS
@@ -522,10 +602,9 @@ void pf_put_ar_vendor_result(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
 
    pf_put_block_header(is_big_endian,
-      PF_BT_AR_VENDOR_BLOCK_RES, 0,                      /* Dont know block_len yet */
+      PF_BT_AR_VENDOR_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -541,9 +620,7 @@ void pf_put_ar_vendor_result(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 #endif
 
@@ -854,7 +931,6 @@ void pf_put_ar_data(
    BlockHeader, NumberOfARs, (AR)*
    */
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
    uint16_t                data_pos;
    pf_device_t             *p_device = NULL;
    uint16_t                cnt;
@@ -862,7 +938,7 @@ void pf_put_ar_data(
    pf_ar_t                 *p_ar_tmp = NULL;
 
    pf_put_block_header(is_big_endian,
-      PF_BT_AR_DATA, 0,                   /* Dont know block_len yet */
+      PF_BT_AR_DATA,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW_1,
       res_len, p_bytes, p_pos);
 
@@ -874,7 +950,7 @@ void pf_put_ar_data(
       if (p_ar == NULL)
       {
          /* Count the number of ARs */
-         for (ix = 0; ix < PNET_MAX_AR; ix++)
+         for (ix = 0; ix < net->cmrpc_max_ar; ix++)
          {
             if (pf_ar_find_by_index(net, ix) != NULL)
             {
@@ -900,7 +976,7 @@ void pf_put_ar_data(
       if (p_ar == NULL)
       {
          /* Insert the ARs */
-         for (ix = 0; ix < PNET_MAX_AR; ix++)
+         for (ix = 0; ix < net->cmrpc_max_ar; ix++)
          {
             p_ar_tmp = pf_ar_find_by_index(net, ix);
             if (p_ar_tmp != NULL)
@@ -927,9 +1003,7 @@ void pf_put_ar_data(
    if (data_pos < *p_pos)
    {
       /* Finally insert the block length into the block header */
-      block_len = *p_pos - (block_pos + 4);
-      block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-      pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
    }
    else
    {
@@ -947,10 +1021,9 @@ void pf_put_control(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
 
    pf_put_block_header(is_big_endian,
-      block_type, 0,                      /* Dont know block_len yet */
+      block_type,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -966,9 +1039,7 @@ void pf_put_control(
    pf_put_uint16(is_big_endian, p_res->control_block_properties, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_pnet_status(
@@ -1046,20 +1117,17 @@ void pf_put_record_data_read(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
 
    /* Insert block header for the read operation */
    pf_put_block_header(is_big_endian,
-      block_type, 0,                      /* Dont know block_len yet */
+      block_type,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_mem(p_raw_data, raw_length, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_read_result(
@@ -1071,12 +1139,11 @@ void pf_put_read_result(
    uint16_t                *p_data_length_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
    uint16_t ix;
 
    /* Insert block header for the read operation */
    pf_put_block_header(is_big_endian,
-      PF_BT_READ_RES, 0,                      /* Dont know block_len yet */
+      PF_BT_READ_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1098,9 +1165,7 @@ void pf_put_read_result(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 /**
@@ -1174,7 +1239,7 @@ static void pf_put_ident_slot(
 
    /* Count the number of active sub-slots */
    cnt = 0;
-   for (ix = 0; ix < NELEMENTS(p_slot->subslots); ix++)
+   for (ix = 0; ix < p_slot->max_subslots; ix++)
    {
       p_subslot = &p_slot->subslots[ix];
       if (p_subslot->in_use == true)
@@ -1203,7 +1268,7 @@ static void pf_put_ident_slot(
    /* Now add the actual subslot info - if requested */
    if (stop_level > PF_DEV_FILTER_LEVEL_SLOT)
    {
-      for (ix = 0; ix < NELEMENTS(p_slot->subslots); ix++)
+      for (ix = 0; ix < p_slot->max_subslots; ix++)
       {
          p_subslot = &p_slot->subslots[ix];
          if (p_subslot->in_use == true)
@@ -1269,7 +1334,7 @@ static void pf_put_ident_api(
    {
       /* Count the number of active slots */
       cnt = 0;
-      for (ix = 0; ix < NELEMENTS(p_api->slots); ix++)
+      for (ix = 0; ix < p_api->max_slots; ix++)
       {
          p_slot = &p_api->slots[ix];
          if (p_slot->in_use == true)
@@ -1298,7 +1363,7 @@ static void pf_put_ident_api(
       if (stop_level > PF_DEV_FILTER_LEVEL_API)
       {
          /* Include slot (module) information */
-         for (ix = 0; ix < NELEMENTS(p_api->slots); ix++)
+         for (ix = 0; ix < p_api->max_slots; ix++)
          {
             p_slot = &p_api->slots[ix];
             if (p_slot->in_use == true)
@@ -1436,13 +1501,12 @@ void pf_put_ident_data(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos;
-   uint16_t                block_len = 0;
    uint16_t                data_pos;
    pf_device_t             *p_device = NULL;
 
    block_pos = *p_pos;
    pf_put_block_header(is_big_endian,
-      block_type, 0,                  /* Dont know block_len yet */
+      block_type,
       PNET_BLOCK_VERSION_HIGH, block_version_low,
       res_len, p_bytes, p_pos);
 
@@ -1456,9 +1520,7 @@ void pf_put_ident_data(
    if (data_pos < *p_pos)
    {
       /* Finally insert the block length into the block header */
-      block_len = *p_pos - (block_pos + 4);
-      block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-      pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
    }
    else
    {
@@ -1475,13 +1537,12 @@ void pf_put_im_0_filter_data(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
    pf_device_t             *p_device = NULL;
 
    /* Insert block header for the read operation */
    block_pos = *p_pos;
    pf_put_block_header(is_big_endian,
-      PF_BT_IM_0_FILTER_DATA_SUBMODULE, 0,    /* Dont know block_len yet */
+      PF_BT_IM_0_FILTER_DATA_SUBMODULE,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1497,14 +1558,12 @@ void pf_put_im_0_filter_data(
       res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 
    /* I&M0FilterDataDevice - insert only the first submodule of the DAP. */
    block_pos = *p_pos;
    pf_put_block_header(is_big_endian,
-      PF_BT_IM_0_FILTER_DATA_DEVICE, 0,   /* Dont know block_len yet */
+      PF_BT_IM_0_FILTER_DATA_DEVICE,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1516,9 +1575,7 @@ void pf_put_im_0_filter_data(
       res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_im_0(
@@ -1529,11 +1586,10 @@ void pf_put_im_0(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
 
    /* Insert block header for the read operation */
    pf_put_block_header(is_big_endian,
-      PF_BT_IM_0, 0,                      /* Dont know block_len yet */
+      PF_BT_IM_0,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1554,9 +1610,7 @@ void pf_put_im_0(
    pf_put_uint16(is_big_endian, p_im_0->im_supported, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_im_1(
@@ -1567,11 +1621,10 @@ void pf_put_im_1(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
 
    /* Insert block header for the read operation */
    pf_put_block_header(is_big_endian,
-      PF_BT_IM_1, 0,                      /* Dont know block_len yet */
+      PF_BT_IM_1,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1579,9 +1632,7 @@ void pf_put_im_1(
    pf_put_str(p_im_1->im_tag_location, sizeof(p_im_1->im_tag_location), res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_im_2(
@@ -1592,20 +1643,17 @@ void pf_put_im_2(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
 
    /* Insert block header for the read operation */
    pf_put_block_header(is_big_endian,
-      PF_BT_IM_2, 0,                      /* Dont know block_len yet */
+      PF_BT_IM_2,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_str(p_im_2, sizeof(pnet_im_2_t), res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_im_3(
@@ -1616,20 +1664,109 @@ void pf_put_im_3(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
 
    /* Insert block header for the read operation */
    pf_put_block_header(is_big_endian,
-      PF_BT_IM_3, 0,                      /* Dont know block_len yet */
+      PF_BT_IM_3,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_str(p_im_3, sizeof(pnet_im_3_t), res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
+}
+
+/**
+ * @internal
+ * Pad with zeroes until the block is Unsigned32 aligned.
+ * @param block_pos        In:   Position of the block header.
+ * @param res_len          In:   Size of destination buffer.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ */
+static void pf_put_block_padding(
+   uint16_t                block_pos,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   uint16_t                pad_len = (4 - (((*p_pos) - block_pos) % 4)) % 4;
+   uint8_t                 *p_dst = pf_put_reserve(pad_len, res_len, p_bytes, p_pos);
+
+   if (p_dst != NULL)
+   {
+      memset(p_dst, 0, pad_len);
+   }
+}
+
+void pf_put_pdport_data_real(
+   bool                    is_big_endian,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   const pnet_lldp_cfg_t   *p_lldp_cfg,
+   const pf_lldp_peer_t    *p_peers,
+   uint16_t                nbr_peers,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   uint16_t                block_pos = *p_pos;
+   uint16_t                ix;
+   uint8_t                 own_port_name_len = (uint8_t)strlen(p_lldp_cfg->port_id);
+   uint8_t                 peer_name_len;
+
+   pf_put_block_header(is_big_endian,
+      PF_BT_PDPORT_DATA_REAL,
+      PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
+      res_len, p_bytes, p_pos);
+
+   pf_put_byte(0, res_len, p_bytes, p_pos);
+   pf_put_byte(0, res_len, p_bytes, p_pos);
+   pf_put_uint16(is_big_endian, slot_nbr, res_len, p_bytes, p_pos);
+   pf_put_uint16(is_big_endian, subslot_nbr, res_len, p_bytes, p_pos);
+   pf_put_byte(own_port_name_len, res_len, p_bytes, p_pos);
+   pf_put_mem(p_lldp_cfg->port_id, own_port_name_len, res_len, p_bytes, p_pos);
+   pf_put_byte((uint8_t)nbr_peers, res_len, p_bytes, p_pos);
+   pf_put_block_padding(block_pos, res_len, p_bytes, p_pos);
+
+   for (ix = 0; ix < nbr_peers; ix++)
+   {
+      /* Only a locally assigned chassis id carries the station name */
+      if (p_peers[ix].chassis_id_subtype == PF_LLDP_SUBTYPE_CHASSIS_ID_NAME)
+      {
+         peer_name_len = p_peers[ix].chassis_id_len;
+      }
+      else
+      {
+         peer_name_len = 0;
+      }
+
+      pf_put_byte(p_peers[ix].port_id_len, res_len, p_bytes, p_pos);
+      pf_put_mem(p_peers[ix].port_id, p_peers[ix].port_id_len, res_len, p_bytes, p_pos);
+      pf_put_byte(peer_name_len, res_len, p_bytes, p_pos);
+      pf_put_mem(p_peers[ix].chassis_id, peer_name_len, res_len, p_bytes, p_pos);
+      pf_put_block_padding(block_pos, res_len, p_bytes, p_pos);
+
+      pf_put_uint32(is_big_endian, 0, res_len, p_bytes, p_pos);      /* LineDelay: Not measured */
+      pf_put_mem(p_peers[ix].mac_address.addr, sizeof(pnet_ethaddr_t), res_len, p_bytes, p_pos);
+      pf_put_block_padding(block_pos, res_len, p_bytes, p_pos);
+   }
+
+   pf_put_uint16(is_big_endian, p_lldp_cfg->mau_type, res_len, p_bytes, p_pos);
+   pf_put_block_padding(block_pos, res_len, p_bytes, p_pos);
+   pf_put_uint16(is_big_endian, 0, res_len, p_bytes, p_pos);         /* Reserved */
+   pf_put_uint16(is_big_endian, p_lldp_cfg->rtclass_3_status, res_len, p_bytes, p_pos);
+   pf_put_uint32(is_big_endian, 0, res_len, p_bytes, p_pos);         /* MulticastBoundary */
+   /* The link is known to be up only while a neighbour is heard */
+   pf_put_uint16(is_big_endian,
+      (nbr_peers > 0) ? PF_PDPORT_LINK_STATE_UP : PF_PDPORT_LINK_STATE_UNKNOWN,
+      res_len, p_bytes, p_pos);
+   pf_put_block_padding(block_pos, res_len, p_bytes, p_pos);
+   pf_put_uint32(is_big_endian, PF_PDPORT_MEDIA_TYPE_UNKNOWN, res_len, p_bytes, p_pos);
+
+   /* Finally insert the block length into the block header */
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_record_data_write(
@@ -1642,20 +1779,17 @@ void pf_put_record_data_write(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
 
    /* Insert block header for the read operation */
    pf_put_block_header(is_big_endian,
-      block_type, 0,                      /* Dont know block_len yet */
+      block_type,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_mem(p_raw_data, raw_length, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_write_result(
@@ -1666,12 +1800,11 @@ void pf_put_write_result(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
    uint16_t ix;
 
    /* Insert block header for the write operation */
    pf_put_block_header(is_big_endian,
-      PF_BT_WRITE_RES, 0,                      /* Dont know block_len yet */
+      PF_BT_WRITE_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1693,9 +1826,7 @@ void pf_put_write_result(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_log_book_data(
@@ -1706,13 +1837,12 @@ void pf_put_log_book_data(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
    uint16_t ix;
    uint16_t cnt = 0;
 
    /* Insert block header for the write operation */
    pf_put_block_header(is_big_endian,
-      PF_BT_LOG_BOOK_DATA, 0,                      /* Dont know block_len yet */
+      PF_BT_LOG_BOOK_DATA,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW_1,
       res_len, p_bytes, p_pos);
 
@@ -1747,9 +1877,7 @@ void pf_put_log_book_data(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 /**
@@ -1922,7 +2050,7 @@ static void pf_put_diag_slot(
    pf_subslot_t            *p_subslot;
 
    /* Include at least API ID information */
-   for (ix = 0; ix < NELEMENTS(p_slot->subslots); ix++)
+   for (ix = 0; ix < p_slot->max_subslots; ix++)
    {
       p_subslot = &p_slot->subslots[ix];
       if (p_subslot->in_use == true)
@@ -1979,7 +2107,7 @@ static void pf_put_diag_api(
    pf_slot_t               *p_slot;
 
    /* Include at least API ID information */
-   for (ix = 0; ix < NELEMENTS(p_api->slots); ix++)
+   for (ix = 0; ix < p_api->max_slots; ix++)
    {
       p_slot = &p_api->slots[ix];
       if (p_slot->in_use == true)
@@ -2081,13 +2209,11 @@ void pf_put_diag_data(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
    uint16_t                data_pos;
    pf_device_t             *p_device = NULL;
 
    /* Insert block header for the output block */
    pf_put_block_header(is_big_endian, PF_BT_DIAGNOSIS_DATA,
-      0,                      /* Dont know block_len yet */
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW_1,
       res_len, p_bytes, p_pos);
 
@@ -2103,9 +2229,8 @@ void pf_put_diag_data(
    /* Finally insert the block length into the block header */
    if (*p_pos > data_pos)
    {
-      block_len = *p_pos - (block_pos + 4);
-      block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-      pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      /* Finally insert the block length into the block header */
+      pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
    }
    else
    {
@@ -2157,14 +2282,12 @@ void pf_put_alarm_block(
    uint16_t                *p_pos)
 {
    uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
    uint32_t temp_u16;
    uint32_t temp_u32;
    uint16_t block_pos_2;
 
    /* Insert block header for the alarm block */
    pf_put_block_header(is_big_endian, bh_type,
-      0,                      /* Dont know block_len yet */
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -2202,7 +2325,6 @@ void pf_put_alarm_block(
 
          block_pos_2 = *p_pos;
          pf_put_block_header(is_big_endian, PF_BT_MAINTENANCE_ITEM,
-            0,                      /* Dont know block_len yet */
             PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
             res_len, p_bytes, p_pos);
 
@@ -2212,9 +2334,7 @@ void pf_put_alarm_block(
          pf_put_uint32(is_big_endian, maint_status, res_len, p_bytes, p_pos);
 
          /* Finally insert the block length into the block header */
-         block_len = *p_pos - (block_pos_2 + 4);
-         block_pos_2 += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-         pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos_2);
+         pf_put_block_length(is_big_endian, block_pos_2, res_len, p_bytes, p_pos);
       }
 
       pf_put_diag_item(is_big_endian, (pf_diag_item_t *)p_payload, res_len, p_bytes, p_pos);
@@ -2228,9 +2348,7 @@ void pf_put_alarm_block(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_substitute_data(
@@ -2247,11 +2365,9 @@ void pf_put_substitute_data(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
 
    /* Now the substitution data - this is an inner block (ToDo: Make own function) */
    pf_put_block_header(is_big_endian, PF_BT_SUBSTITUTE_VALUE,
-      0,                      /* Dont know block_len yet */
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -2261,9 +2377,8 @@ void pf_put_substitute_data(
    pf_put_mem(p_iops, iops_len, res_len, p_bytes, p_pos);
 
    /* Insert the block length into the substitution data block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   /* Finally insert the block length into the block header */
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_output_data(
@@ -2282,12 +2397,10 @@ void pf_put_output_data(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
    uint16_t                substitute_active_flag = sub_active ? 1 : 0;
 
    /* Insert block header for the output block */
    pf_put_block_header(is_big_endian, PF_BT_RECORD_OUTPUT_DATA_OBJECT,
-      0,                      /* Dont know block_len yet */
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -2310,9 +2423,7 @@ void pf_put_output_data(
    /* -------------- */
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
 
 void pf_put_input_data(
@@ -2328,11 +2439,9 @@ void pf_put_input_data(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
 
    /* Insert block header for the output block */
    pf_put_block_header(is_big_endian, PF_BT_RECORD_INPUT_DATA_OBJECT,
-      0,                      /* Dont know block_len yet */
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -2346,7 +2455,5 @@ void pf_put_input_data(
    pf_put_mem(p_data, data_len, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_length(is_big_endian, block_pos, res_len, p_bytes, p_pos);
 }
@@ -21,6 +21,22 @@ extern "C"
 {
 #endif
 
+/**
+ * Check if any field written to a buffer did not fit.
+ *
+ * A field that does not fit is not written. The position is then moved
+ * past the end of the buffer, so all later fields are skipped as well.
+ * Check this before a message is sent, so that a truncated message is
+ * never sent.
+ * @param res_len          In:   Size of destination buffer.
+ *                               Must be less than UINT16_MAX.
+ * @param pos              In:   Position in destination buffer.
+ * @return  true if the buffer overflowed.
+ */
+bool pf_put_overflow(
+   uint16_t                res_len,
+   uint16_t                pos);
+
 /**
  * Insert a sequence of bytes into a buffer.
  * @param p_src            In:   The start of the byte sequence to insert.
@@ -338,6 +354,31 @@ void pf_put_im_3(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos);
 
+/**
+ * Insert a PDPortDataReal block into a buffer.
+ *
+ * The peers are the neighbours seen in received LLDP frames.
+ * @param is_big_endian    In:   Endianness of the destination buffer.
+ * @param slot_nbr         In:   The slot number of the port.
+ * @param subslot_nbr      In:   The subslot number of the port.
+ * @param p_lldp_cfg       In:   The LLDP configuration of the port.
+ * @param p_peers          In:   The neighbours of the port.
+ * @param nbr_peers        In:   Number of neighbours in p_peers.
+ * @param res_len          In:   Size of destination buffer.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ */
+void pf_put_pdport_data_real(
+   bool                    is_big_endian,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   const pnet_lldp_cfg_t   *p_lldp_cfg,
+   const pf_lldp_peer_t    *p_peers,
+   uint16_t                nbr_peers,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos);
+
 /**
  * Insert filtered real or expected ident data into a buffer.
  *
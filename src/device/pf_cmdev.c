@@ -86,7 +86,7 @@ int pf_cmdev_cfg_traverse(
                }
                else if (p_ftn_slot != NULL)
                {
-                  for (slot_ix = 0; slot_ix < NELEMENTS(net->cmdev_device.apis[api_ix].slots); slot_ix++)
+                  for (slot_ix = 0; slot_ix < net->cmdev_device.apis[api_ix].max_slots; slot_ix++)
                   {
                      if (net->cmdev_device.apis[api_ix].slots[slot_ix].in_use == true)
                      {
@@ -96,7 +96,7 @@ int pf_cmdev_cfg_traverse(
                         }
                         else if (p_ftn_sub != NULL)
                         {
-                           for (subslot_ix = 0; subslot_ix < NELEMENTS(net->cmdev_device.apis[api_ix].slots[slot_ix].subslots); subslot_ix++)
+                           for (subslot_ix = 0; subslot_ix < net->cmdev_device.apis[api_ix].slots[slot_ix].max_subslots; subslot_ix++)
                            {
                               if (net->cmdev_device.apis[api_ix].slots[slot_ix].subslots[subslot_ix].in_use == true)
                               {
@@ -189,14 +189,14 @@ static int pf_cmdev_get_slot(
    else
    {
       ix = 0;
-      while ((ix < PNET_MAX_MODULES) &&
+      while ((ix < p_api->max_slots) &&
              ((p_api->slots[ix].in_use == false) ||
               (slot_nbr != p_api->slots[ix].slot_nbr)))
       {
          ix++;
       }
 
-      if (ix < PNET_MAX_MODULES)
+      if (ix < p_api->max_slots)
       {
          p_slot = &p_api->slots[ix];
          ret = 0;
@@ -233,14 +233,14 @@ static int pf_cmdev_get_subslot(
    else
    {
       ix = 0;
-      while ((ix < PNET_MAX_SUBMODULES) &&
+      while ((ix < p_slot->max_subslots) &&
              ((p_slot->subslots[ix].in_use == false) ||
               (subslot_nbr != p_slot->subslots[ix].subslot_nbr)))
       {
          ix++;
       }
 
-      if (ix < PNET_MAX_SUBMODULES)
+      if (ix < p_slot->max_subslots)
       {
          p_subslot = &p_slot->subslots[ix];
          ret = 0;
@@ -297,6 +297,399 @@ int pf_cmdev_get_slot_full(
    return ret;
 }
 
+/************************** Sub-slot IO index *******************************/
+
+/*
+ * A handle is made of the generation of the AR index (bits 31..16, never 0),
+ * the AR index (bits 15..12) and the index entry (bits 11..0).
+ * The generation is shared by all ARs, so a stale handle only validates
+ * again after 65535 index builds.
+ */
+#define PF_IO_HANDLE(gen, ar_ix, entry_ix)   (((uint32_t)(gen) << 16) | ((uint32_t)(ar_ix) << 12) | (entry_ix))
+#define PF_IO_HANDLE_GEN(handle)             (((handle) >> 16) & 0xffff)
+#define PF_IO_HANDLE_AR_IX(handle)           (((handle) >> 12) & 0x0f)
+#define PF_IO_HANDLE_ENTRY_IX(handle)        ((handle) & 0x0fff)
+
+CC_STATIC_ASSERT(PNET_MAX_AR <= 0x10);
+CC_STATIC_ASSERT(PF_IO_INDEX_MAX_SIZE == 0x1000);
+CC_STATIC_ASSERT(PNET_MAX_API * PNET_MAX_MODULES * PNET_MAX_SUBMODULES <= PF_IO_INDEX_MAX_SIZE);
+
+/**
+ * @internal
+ * Compare an index entry to a sub-slot address.
+ * @param p_entry          In:   The index entry.
+ * @param api_id           In:   The API identifier.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @return  <0, 0 or >0 if the entry sorts before, at or after the address.
+ */
+static int pf_cmdev_io_index_cmp(
+   const pf_io_index_t     *p_entry,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr)
+{
+   if (p_entry->api_id != api_id)
+   {
+      return (p_entry->api_id < api_id) ? -1 : 1;
+   }
+   if (p_entry->slot_nbr != slot_nbr)
+   {
+      return (p_entry->slot_nbr < slot_nbr) ? -1 : 1;
+   }
+   if (p_entry->subslot_nbr != subslot_nbr)
+   {
+      return (p_entry->subslot_nbr < subslot_nbr) ? -1 : 1;
+   }
+   return 0;
+}
+
+/**
+ * @internal
+ * Binary search for a sub-slot in the index of an AR.
+ * @param p_ar             In:   The AR instance.
+ * @param api_id           In:   The API identifier.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @param p_pos            Out:  The entry index if found, else the insert position.
+ * @return  0  if the sub-slot was found.
+ *          -1 if not.
+ */
+static int pf_cmdev_io_index_find(
+   const pf_ar_t           *p_ar,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   uint16_t                *p_pos)
+{
+   uint16_t                lo = 0;
+   uint16_t                hi = p_ar->nbr_io_index;
+   uint16_t                mid;
+   int                     cmp;
+
+   while (lo < hi)
+   {
+      mid = lo + (hi - lo) / 2;
+      cmp = pf_cmdev_io_index_cmp(&p_ar->io_index[mid], api_id, slot_nbr, subslot_nbr);
+      if (cmp == 0)
+      {
+         *p_pos = mid;
+         return 0;
+      }
+      else if (cmp < 0)
+      {
+         lo = mid + 1;
+      }
+      else
+      {
+         hi = mid;
+      }
+   }
+
+   *p_pos = lo;
+   return -1;
+}
+
+/**
+ * @internal
+ * Check that the sub-slot of an index entry is plugged and owned by the AR.
+ *
+ * The sub-slot instance is cached in the entry. It is looked up again if the
+ * sub-module has been pulled or plugged since the last call.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             In:   The AR instance.
+ * @param p_entry          InOut: The index entry.
+ * @return  true  if the AR owns the sub-slot.
+ *          false if not.
+ */
+static bool pf_cmdev_io_index_owned(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar,
+   pf_io_index_t           *p_entry)
+{
+   pf_api_t                *p_api = NULL;
+   pf_slot_t               *p_slot = NULL;
+   pf_subslot_t            *p_subslot = NULL;
+
+   if ((p_entry->p_slot == NULL) ||
+       (p_entry->p_subslot == NULL) ||
+       (p_entry->p_slot->in_use == false) ||
+       (p_entry->p_slot->slot_nbr != p_entry->slot_nbr) ||
+       (p_entry->p_subslot->in_use == false) ||
+       (p_entry->p_subslot->subslot_nbr != p_entry->subslot_nbr))
+   {
+      p_entry->p_slot = NULL;
+      p_entry->p_subslot = NULL;
+      if ((pf_cmdev_get_api(net, p_entry->api_id, &p_api) == 0) &&
+          (pf_cmdev_get_slot(p_api, p_entry->slot_nbr, &p_slot) == 0) &&
+          (pf_cmdev_get_subslot(p_slot, p_entry->subslot_nbr, &p_subslot) == 0))
+      {
+         p_entry->p_slot = p_slot;
+         p_entry->p_subslot = p_subslot;
+      }
+   }
+
+   return (p_entry->p_subslot != NULL) && (p_entry->p_subslot->p_ar == p_ar);
+}
+
+/**
+ * @internal
+ * Get the IOCR and IODATA object of an index entry.
+ * @param p_ar             In:   The AR instance.
+ * @param p_entry          In:   The index entry.
+ * @param dir              In:   PF_DIRECTION_INPUT or PF_DIRECTION_OUTPUT.
+ * @param pp_iocr          Out:  The IOCR instance.
+ * @param pp_iodata        Out:  The IODATA object instance.
+ * @return  0  if the sub-slot is part of a CR in the direction.
+ *          -1 if not.
+ */
+static int pf_cmdev_io_index_desc(
+   pf_ar_t                    *p_ar,
+   const pf_io_index_t        *p_entry,
+   pf_data_direction_values_t dir,
+   pf_iocr_t                  **pp_iocr,
+   pf_iodata_object_t         **pp_iodata)
+{
+   uint8_t                    crep;
+   uint16_t                   iodata_ix;
+
+   if (dir == PF_DIRECTION_INPUT)
+   {
+      crep = p_entry->in_crep;
+      iodata_ix = p_entry->in_iodata_ix;
+   }
+   else
+   {
+      crep = p_entry->out_crep;
+      iodata_ix = p_entry->out_iodata_ix;
+   }
+
+   if (crep == PF_IO_INDEX_NO_CR)
+   {
+      return -1;
+   }
+
+   *pp_iocr = &p_ar->iocrs[crep];
+   *pp_iodata = &p_ar->iocrs[crep].data_desc[iodata_ix];
+
+   return 0;
+}
+
+/**
+ * @internal
+ * Build the sub-slot index of an AR from its IOCR data descriptors.
+ *
+ * Any handles to a previous index of the AR become invalid.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             InOut: The AR instance.
+ */
+static void pf_cmdev_io_index_build(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar)
+{
+   uint16_t                crep;
+   uint16_t                iodata_ix;
+   uint16_t                pos;
+   pf_iocr_t               *p_iocr;
+   pf_iodata_object_t      *p_iodata;
+   pf_io_index_t           *p_entry;
+   bool                    input;
+
+   /* Bind the AR to its part of the IO index table */
+   p_ar->max_io_index = net->cmdev_max_data_desc;
+   p_ar->io_index = &net->cmdev_io_index[(p_ar - net->cmrpc_ar) * net->cmdev_max_data_desc];
+   p_ar->nbr_io_index = 0;
+
+   for (crep = 0; crep < p_ar->nbr_iocrs; crep++)
+   {
+      p_iocr = &p_ar->iocrs[crep];
+      input = (p_iocr->param.iocr_type == PF_IOCR_TYPE_INPUT) ||
+              (p_iocr->param.iocr_type == PF_IOCR_TYPE_MC_PROVIDER);
+      for (iodata_ix = 0; iodata_ix < p_iocr->nbr_data_desc; iodata_ix++)
+      {
+         p_iodata = &p_iocr->data_desc[iodata_ix];
+         if (p_iodata->in_use == false)
+         {
+            continue;
+         }
+
+         if (pf_cmdev_io_index_find(p_ar, p_iodata->api_id, p_iodata->slot_nbr, p_iodata->subslot_nbr, &pos) != 0)
+         {
+            if (p_ar->nbr_io_index >= p_ar->max_io_index)
+            {
+               LOG_ERROR(PNET_LOG, "CMDEV(%d): IO index full\n", __LINE__);
+               continue;
+            }
+
+            /* Keep the index sorted */
+            memmove(&p_ar->io_index[pos + 1], &p_ar->io_index[pos],
+               (p_ar->nbr_io_index - pos) * sizeof(p_ar->io_index[0]));
+            p_ar->nbr_io_index++;
+
+            p_entry = &p_ar->io_index[pos];
+            memset(p_entry, 0, sizeof(*p_entry));
+            p_entry->api_id = p_iodata->api_id;
+            p_entry->slot_nbr = p_iodata->slot_nbr;
+            p_entry->subslot_nbr = p_iodata->subslot_nbr;
+            p_entry->in_crep = PF_IO_INDEX_NO_CR;
+            p_entry->out_crep = PF_IO_INDEX_NO_CR;
+         }
+
+         /* The first CR in each direction wins, as in a linear search */
+         p_entry = &p_ar->io_index[pos];
+         if ((input == true) && (p_entry->in_crep == PF_IO_INDEX_NO_CR))
+         {
+            p_entry->in_crep = (uint8_t)crep;
+            p_entry->in_iodata_ix = iodata_ix;
+         }
+         else if ((input == false) && (p_entry->out_crep == PF_IO_INDEX_NO_CR))
+         {
+            p_entry->out_crep = (uint8_t)crep;
+            p_entry->out_iodata_ix = iodata_ix;
+         }
+      }
+   }
+
+   for (pos = 0; pos < p_ar->nbr_io_index; pos++)
+   {
+      (void)pf_cmdev_io_index_owned(net, p_ar, &p_ar->io_index[pos]);
+   }
+
+   net->cmdev_io_index_gen++;
+   if (net->cmdev_io_index_gen == 0)
+   {
+      net->cmdev_io_index_gen = 1;
+   }
+   p_ar->io_index_gen = net->cmdev_io_index_gen;
+}
+
+/**
+ * @internal
+ * Find the AR and index entry owning a sub-slot.
+ * @param net              InOut: The p-net stack instance
+ * @param api_id           In:   The API identifier.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @param pp_ar            Out:  The AR instance.
+ * @param p_entry_ix       Out:  The index entry.
+ * @return  0  if the sub-slot was found.
+ *          -1 if not.
+ */
+static int pf_cmdev_io_index_lookup(
+   pnet_t                  *net,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   pf_ar_t                 **pp_ar,
+   uint16_t                *p_entry_ix)
+{
+   pf_ar_t                 *p_ar;
+   uint16_t                ix;
+   uint16_t                pos;
+
+   for (ix = 0; ix < net->cmrpc_max_ar; ix++)
+   {
+      p_ar = &net->cmrpc_ar[ix];
+      if ((p_ar->in_use == true) &&
+          (p_ar->io_index_gen != 0) &&
+          (pf_cmdev_io_index_find(p_ar, api_id, slot_nbr, subslot_nbr, &pos) == 0) &&
+          (pf_cmdev_io_index_owned(net, p_ar, &p_ar->io_index[pos]) == true))
+      {
+         *pp_ar = p_ar;
+         *p_entry_ix = pos;
+         return 0;
+      }
+   }
+
+   return -1;
+}
+
+int pf_cmdev_get_io_desc(
+   pnet_t                     *net,
+   uint32_t                   api_id,
+   uint16_t                   slot_nbr,
+   uint16_t                   subslot_nbr,
+   pf_data_direction_values_t dir,
+   pf_ar_t                    **pp_ar,
+   pf_iocr_t                  **pp_iocr,
+   pf_iodata_object_t         **pp_iodata)
+{
+   int                        ret = -1;
+   pf_ar_t                    *p_ar = NULL;
+   uint16_t                   entry_ix;
+
+   if (pf_cmdev_io_index_lookup(net, api_id, slot_nbr, subslot_nbr, &p_ar, &entry_ix) == 0)
+   {
+      if (pf_cmdev_io_index_desc(p_ar, &p_ar->io_index[entry_ix], dir, pp_iocr, pp_iodata) == 0)
+      {
+         *pp_ar = p_ar;
+         ret = 0;
+      }
+   }
+
+   return ret;
+}
+
+int pf_cmdev_get_io_handle(
+   pnet_t                  *net,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   pnet_io_handle_t        *p_handle)
+{
+   int                     ret = -1;
+   pf_ar_t                 *p_ar = NULL;
+   uint16_t                entry_ix;
+
+   if (pf_cmdev_io_index_lookup(net, api_id, slot_nbr, subslot_nbr, &p_ar, &entry_ix) == 0)
+   {
+      *p_handle = PF_IO_HANDLE(p_ar->io_index_gen, p_ar - net->cmrpc_ar, entry_ix);
+      ret = 0;
+   }
+   else
+   {
+      LOG_DEBUG(PNET_LOG, "CMDEV(%d): No AR for api %u slot %u subslot %u\n", __LINE__,
+         (unsigned)api_id, (unsigned)slot_nbr, (unsigned)subslot_nbr);
+   }
+
+   return ret;
+}
+
+int pf_cmdev_get_io_desc_by_handle(
+   pnet_t                     *net,
+   pnet_io_handle_t           handle,
+   pf_data_direction_values_t dir,
+   pf_ar_t                    **pp_ar,
+   pf_iocr_t                  **pp_iocr,
+   pf_iodata_object_t         **pp_iodata)
+{
+   int                        ret = -1;
+   pf_ar_t                    *p_ar;
+   pf_io_index_t              *p_entry;
+   uint16_t                   ar_ix = PF_IO_HANDLE_AR_IX(handle);
+   uint16_t                   entry_ix = PF_IO_HANDLE_ENTRY_IX(handle);
+
+   if (ar_ix < net->cmrpc_max_ar)
+   {
+      p_ar = &net->cmrpc_ar[ar_ix];
+      if ((p_ar->in_use == true) &&
+          (p_ar->io_index_gen != 0) &&
+          (p_ar->io_index_gen == PF_IO_HANDLE_GEN(handle)) &&
+          (entry_ix < p_ar->nbr_io_index))
+      {
+         p_entry = &p_ar->io_index[entry_ix];
+         if ((pf_cmdev_io_index_owned(net, p_ar, p_entry) == true) &&
+             (pf_cmdev_io_index_desc(p_ar, p_entry, dir, pp_iocr, pp_iodata) == 0))
+         {
+            *pp_ar = p_ar;
+            ret = 0;
+         }
+      }
+   }
+
+   return ret;
+}
+
 int pf_cmdev_get_diag_item(
    pnet_t                  *net,
    uint16_t                item_ix,
@@ -304,7 +697,7 @@ int pf_cmdev_get_diag_item(
 {
    int                     ret = -1;
 
-   if (item_ix < NELEMENTS(net->cmdev_device.diag_items))
+   if (item_ix < net->cmdev_device.max_diag_items)
    {
       *pp_item = &net->cmdev_device.diag_items[item_ix];
 
@@ -346,7 +739,7 @@ void pf_cmdev_free_diag(
    pnet_t                  *net,
    uint16_t                item_ix)
 {
-   if (item_ix < NELEMENTS(net->cmdev_device.diag_items))
+   if (item_ix < net->cmdev_device.max_diag_items)
    {
       /* Put it first in the free list. */
       net->cmdev_device.diag_items[item_ix].in_use = false;
@@ -400,6 +793,9 @@ static int pf_cmdev_new_api(
          p_api = &net->cmdev_device.apis[ix];
 
          memset(p_api, 0, sizeof(*p_api));
+         p_api->max_slots = net->cmdev_max_slots;
+         p_api->slots = &net->cmdev_slots[ix * net->cmdev_max_slots];
+         memset(p_api->slots, 0, p_api->max_slots * sizeof(*p_api->slots));
          p_api->api_id = api_id;
          p_api->in_use = true;
 
@@ -418,6 +814,7 @@ static int pf_cmdev_new_api(
  * @internal
  * Instantiate a new slot structure.
  * If the slot number already exists the the operation fails.
+ * @param net              InOut: The p-net stack instance
  * @param p_api            In:   The API instance.
  * @param slot_nbr         In:   The slot number.
  * @param pp_slot          Out:  The new slot instance.
@@ -425,6 +822,7 @@ static int pf_cmdev_new_api(
  *          -1 if an error occurred.
  */
 static int pf_cmdev_new_slot(
+   pnet_t                  *net,
    pf_api_t                *p_api,
    uint16_t                slot_nbr,
    pf_slot_t               **pp_slot)
@@ -445,17 +843,20 @@ static int pf_cmdev_new_slot(
    else
    {
       ix = 0;
-      while ((ix < PNET_MAX_MODULES) &&
+      while ((ix < p_api->max_slots) &&
              (p_api->slots[ix].in_use == true))
       {
          ix++;
       }
 
-      if (ix < PNET_MAX_MODULES)
+      if (ix < p_api->max_slots)
       {
          p_slot = &p_api->slots[ix];
 
          memset(p_slot, 0, sizeof(*p_slot));
+         p_slot->max_subslots = net->cmdev_max_subslots;
+         p_slot->subslots = &net->cmdev_subslots[(p_slot - net->cmdev_slots) * net->cmdev_max_subslots];
+         memset(p_slot->subslots, 0, p_slot->max_subslots * sizeof(*p_slot->subslots));
          p_slot->slot_nbr = slot_nbr;
          p_slot->in_use = true;
 
@@ -499,13 +900,13 @@ static int pf_cmdev_new_subslot(
    else
    {
       ix = 0;
-      while ((ix < PNET_MAX_SUBMODULES) &&
+      while ((ix < p_slot->max_subslots) &&
              (p_slot->subslots[ix].in_use == true))
       {
          ix++;
       }
 
-      if (ix < PNET_MAX_SUBMODULES)
+      if (ix < p_slot->max_subslots)
       {
          p_subslot = &p_slot->subslots[ix];
 
@@ -553,7 +954,7 @@ int pf_cmdev_plug_module(
          p_slot->plug_state = PF_MOD_PLUG_WRONG_MODULE;
       }
    }
-   else if (pf_cmdev_new_slot(p_api, slot_nbr, &p_slot) != 0)
+   else if (pf_cmdev_new_slot(net, p_api, slot_nbr, &p_slot) != 0)
    {
       /* Out of slot resources */
       LOG_ERROR(PNET_LOG, "CMDEV(%d): Out of slot resources for api %u slot %u\n", __LINE__, (unsigned)api_id, (unsigned)slot_nbr);
@@ -743,7 +1144,7 @@ int pf_cmdev_pull_module(
    {
       ret = 0; /* Assume all OK */
       ix = 0;
-      while ((ix < PNET_MAX_SUBMODULES) && (ret == 0))
+      while ((ix < p_slot->max_subslots) && (ret == 0))
       {
          if ((p_slot->subslots[ix].in_use == true) &&
              (pf_cmdev_pull_submodule(net, api_id, slot_nbr, p_slot->subslots[ix].subslot_nbr) != 0))
@@ -783,9 +1184,9 @@ static void pf_device_clear(
 
    for (api_ix = 0; api_ix < NELEMENTS(net->cmdev_device.apis); api_ix++)
    {
-      for (slot_ix = 0; slot_ix < NELEMENTS(net->cmdev_device.apis[api_ix].slots); slot_ix++)
+      for (slot_ix = 0; slot_ix < net->cmdev_device.apis[api_ix].max_slots; slot_ix++)
       {
-         for (sub_ix = 0; sub_ix < NELEMENTS(net->cmdev_device.apis[api_ix].slots[slot_ix].subslots); sub_ix++)
+         for (sub_ix = 0; sub_ix < net->cmdev_device.apis[api_ix].slots[slot_ix].max_subslots; sub_ix++)
          {
             if (net->cmdev_device.apis[api_ix].slots[slot_ix].subslots[sub_ix].p_ar == p_ar)
             {
@@ -935,7 +1336,7 @@ void pf_cmdev_show(
 static int pf_cmdev_cfg_dev_show(
    pf_device_t             *p_dev)
 {
-   printf("The device can use max %u APIs, and %u diag items.\n", (unsigned)PNET_MAX_API, (unsigned)PNET_MAX_DIAG_ITEMS);
+   printf("The device can use max %u APIs, and %u diag items.\n", (unsigned)PNET_MAX_API, (unsigned)p_dev->max_diag_items);
    printf("The device has %u diag_items_free.\n", (unsigned)p_dev->diag_items_free);
 
    return 0;
@@ -951,7 +1352,7 @@ static int pf_cmdev_cfg_api_show(
    pf_api_t                *p_api)
 {
    printf("device api_id         = %u\n", (unsigned)p_api->api_id);
-   printf("   Each API can use max %u slots (each with max %u subslots).\n", (unsigned)PNET_MAX_MODULES, (unsigned)PNET_MAX_SUBMODULES);
+   printf("   Each API can use max %u slots.\n", (unsigned)p_api->max_slots);
 
    return 0;
 }
@@ -968,6 +1369,7 @@ static int pf_cmdev_cfg_slot_show(
    printf("   slot_nbr           = %u\n", (unsigned)p_slot->slot_nbr);
    printf("   in_use             = %u\n", (unsigned)p_slot->in_use);
    printf("   plug_state         = %s\n", pf_cmdev_mod_plug_state_to_string(p_slot->plug_state));
+   printf("   max_subslots       = %u\n", (unsigned)p_slot->max_subslots);
    printf("   AR                 = %p\n", p_slot->p_ar);
    printf("   module_ident       = %u\n", (unsigned)p_slot->module_ident_number);
    printf("   exp_mod_ident      = %u\n", (unsigned)p_slot->exp_module_ident_number);
@@ -1035,14 +1437,16 @@ void pf_cmdev_init(
 
       memset(&net->cmdev_device, 0, sizeof(net->cmdev_device));
       net->cmdev_device.diag_mutex = os_mutex_create();
+      net->cmdev_device.diag_items = net->cmdev_diag_items;
+      net->cmdev_device.max_diag_items = net->cmdev_max_diag_items;
 
       /* Create a list of free diag items. */
       net->cmdev_device.diag_items_free = 0;
-      for (ix = 0; ix < NELEMENTS(net->cmdev_device.diag_items) - 1; ix++)
+      for (ix = 0; ix < net->cmdev_device.max_diag_items - 1; ix++)
       {
          net->cmdev_device.diag_items[ix].next = ix + 1;
       }
-      net->cmdev_device.diag_items[NELEMENTS(net->cmdev_device.diag_items) - 1].next = PF_DIAG_IX_NULL;
+      net->cmdev_device.diag_items[net->cmdev_device.max_diag_items - 1].next = PF_DIAG_IX_NULL;
 
       (void)pf_diag_init();
 
@@ -1618,6 +2022,49 @@ static int pf_cmdev_get_exp_sub_data_descriptor(
    return ret;
 }
 
+/**
+ * @internal
+ * Check if there is room for the data descriptor of a sub-slot in an IOCR.
+ *
+ * A sub-slot that already has a data descriptor re-uses it.
+ * @param p_iocr           In:   The IOCR instance.
+ * @param iodata_cnt       In:   Number of data descriptors used so far.
+ * @param api_id           In:   The API identifier.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @return  true  if the data descriptor fits.
+ *          false if the IOCR table is full.
+ */
+static bool pf_cmdev_iocr_data_desc_fits(
+   const pf_iocr_t         *p_iocr,
+   uint16_t                iodata_cnt,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr)
+{
+   uint16_t                iy;
+
+   if (iodata_cnt < p_iocr->max_data_desc)
+   {
+      return true;
+   }
+
+   for (iy = 0; iy < iodata_cnt; iy++)
+   {
+      if ((p_iocr->data_desc[iy].api_id == api_id) &&
+          (p_iocr->data_desc[iy].slot_nbr == slot_nbr) &&
+          (p_iocr->data_desc[iy].subslot_nbr == subslot_nbr))
+      {
+         return true;
+      }
+   }
+
+   LOG_ERROR(PNET_LOG, "CMDEV(%d): api %u slot %u subslot %u: No room for more than %u submodules in IOCR\n", __LINE__,
+      (unsigned)api_id, (unsigned)slot_nbr, (unsigned)subslot_nbr, (unsigned)p_iocr->max_data_desc);
+
+   return false;
+}
+
 /**
  * @internal
  * Collect iodata object IOCS information from IOCR param and expected (sub-)modules.
@@ -1671,6 +2118,11 @@ static int pf_cmdev_iocr_setup_iocs(
          {
             LOG_ERROR(PNET_LOG, "CMDEV(%d): api %u exp slot %u subslot %u and dir %u not found\n", __LINE__, (unsigned)api_id, (unsigned)slot_nbr, (unsigned)subslot_nbr, (unsigned)dir);
          }
+         else if (pf_cmdev_iocr_data_desc_fits(p_iocr, iodata_cnt, api_id, slot_nbr, subslot_nbr) == false)
+         {
+            pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_IOCR_BLOCK_REQ, 27);
+            ret = -1;
+         }
          else
          {
             LOG_INFO(PNET_LOG, "CMDEV(%d) (%u,%u,%u) dir %u, dlen %u iopslen %u IOCSlen %u\n", __LINE__,
@@ -1698,7 +2150,7 @@ static int pf_cmdev_iocr_setup_iocs(
                p_iodata->in_use = true;
                iodata_cnt++;
 
-               p_iodata->api_id = api_ix;
+               p_iodata->api_id = api_id;
                p_iodata->slot_nbr = slot_nbr;
                p_iodata->subslot_nbr = subslot_nbr;
 
@@ -1792,6 +2244,11 @@ static int pf_cmdev_iocr_setup_data_iops(
          {
             LOG_ERROR(PNET_LOG, "CMDEV(%d): api %u exp slot %u subslot %u and dir %u not found\n", __LINE__, (unsigned)api_id, (unsigned)slot_nbr, (unsigned)subslot_nbr, (unsigned)dir);
          }
+         else if (pf_cmdev_iocr_data_desc_fits(p_iocr, iodata_cnt, api_id, slot_nbr, subslot_nbr) == false)
+         {
+            pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_IOCR_BLOCK_REQ, 23);
+            ret = -1;
+         }
          else
          {
             LOG_INFO(PNET_LOG, "CMDEV(%d) (%u,%u,%u) dir %u, dlen %u iopslen %u IOCSlen %u\n", __LINE__,
@@ -1880,6 +2337,7 @@ static int pf_cmdev_iocr_setup_data_iops(
 /**
  * @internal
  * Collect iodata object IOCS, data and IOPS information from IOCR param and expected (sub-)modules.
+ * @param net              InOut: The p-net stack instance
  * @param p_ar             InOut:The AR instance.
  * @param crep             In:   The IOCR index.
  * @param p_stat           Out:  Detailed error information.
@@ -1887,6 +2345,7 @@ static int pf_cmdev_iocr_setup_data_iops(
  *          -1 if an error occurred.
  */
 static int pf_cmdev_iocr_setup_desc(
+   pnet_t                  *net,
    pf_ar_t                 *p_ar,
    uint32_t                crep,
    pnet_result_t           *p_stat)
@@ -1904,6 +2363,11 @@ static int pf_cmdev_iocr_setup_desc(
    p_iocr->out_length = 0;
    p_iocr->nbr_data_desc = 0;
 
+   /* Bind the IOCR to its part of the data descriptor table */
+   p_iocr->max_data_desc = net->cmdev_max_data_desc;
+   p_iocr->data_desc = &net->cmdev_data_desc[
+      (((p_ar - net->cmrpc_ar) * PNET_MAX_CR) + crep) * net->cmdev_max_data_desc];
+
    p_iocr_param = &p_iocr->param;
 
    if ((p_iocr_param->iocr_type == PF_IOCR_TYPE_INPUT) ||
@@ -3107,7 +3571,7 @@ static int pf_cmdev_check_apdu(
          /* Build internal data structure for each IOCR */
          for (ix = 0; ix < p_ar->nbr_iocrs; ix++)
          {
-            if ((ret == 0) && (pf_cmdev_iocr_setup_desc(p_ar, ix, p_stat) != 0))
+            if ((ret == 0) && (pf_cmdev_iocr_setup_desc(net, p_ar, ix, p_stat) != 0))
             {
                ret = -1;
             }
@@ -3120,6 +3584,12 @@ static int pf_cmdev_check_apdu(
          ret = pf_cmdev_check_iocr_apis(p_ar, p_stat);
       }
 
+      if (ret == 0)
+      {
+         /* Index the sub-slots for the cyclic data API */
+         pf_cmdev_io_index_build(net, p_ar);
+      }
+
       if (ret == 0)
       {
          if ((p_ar->ar_param.ar_properties.device_access == false) &&
@@ -3211,9 +3681,10 @@ static int pf_cmdev_generate_submodule_diff(
          {
             slot_nbr = p_ar->exp_apis[exp_api_ix].modules[exp_mod_ix].slot_number;
 
-            /* In case an error is found */
+            /* In case an error is found. The submodule diffs use the same place as the expected submodules. */
             p_ar->api_diffs[nbr_api_diffs].module_diffs[nbr_mod_diffs].slot_number = slot_nbr;
-            p_ar->api_diffs[nbr_api_diffs].module_diffs[nbr_mod_diffs].submodule_diffs[nbr_sub_diffs].submodule_state.format_indicator = true;
+            p_ar->api_diffs[nbr_api_diffs].module_diffs[nbr_mod_diffs].submodule_diffs =
+               &p_ar->submodule_diffs[p_ar->exp_apis[exp_api_ix].modules[exp_mod_ix].submodules - p_ar->exp_submodules];
 
             if (pf_cmdev_get_slot(p_cfg_api, slot_nbr, &p_cfg_slot) != 0)
             {
@@ -210,6 +210,68 @@ int pf_cmdev_get_subslot_full(
    uint16_t                subslot_nbr,
    pf_subslot_t            **pp_subslot);
 
+/**
+ * Find the AR, IOCR and IODATA object instances for a sub-slot.
+ *
+ * Uses the index built at connect time in each AR. Only the AR that owns the
+ * sub-slot is considered.
+ * @param net              InOut: The p-net stack instance
+ * @param api_id           In:   The API identifier.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @param dir              In:   PF_DIRECTION_INPUT for the INPUT (PPM) CR.
+ *                               PF_DIRECTION_OUTPUT for the OUTPUT (CPM) CR.
+ * @param pp_ar            Out:  The AR instance.
+ * @param pp_iocr          Out:  The IOCR instance.
+ * @param pp_iodata        Out:  The IODATA object instance.
+ * @return  0  if the sub-slot was found.
+ *          -1 if an error occurred.
+ */
+int pf_cmdev_get_io_desc(
+   pnet_t                     *net,
+   uint32_t                   api_id,
+   uint16_t                   slot_nbr,
+   uint16_t                   subslot_nbr,
+   pf_data_direction_values_t dir,
+   pf_ar_t                    **pp_ar,
+   pf_iocr_t                  **pp_iocr,
+   pf_iodata_object_t         **pp_iodata);
+
+/**
+ * Get a handle to the cyclic data of a sub-slot.
+ * @param net              InOut: The p-net stack instance
+ * @param api_id           In:   The API identifier.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @param p_handle         Out:  The handle.
+ * @return  0  if the sub-slot was found.
+ *          -1 if an error occurred.
+ */
+int pf_cmdev_get_io_handle(
+   pnet_t                  *net,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   pnet_io_handle_t        *p_handle);
+
+/**
+ * Find the AR, IOCR and IODATA object instances for a sub-slot handle.
+ * @param net              InOut: The p-net stack instance
+ * @param handle           In:   Handle from pf_cmdev_get_io_handle().
+ * @param dir              In:   PF_DIRECTION_INPUT or PF_DIRECTION_OUTPUT.
+ * @param pp_ar            Out:  The AR instance.
+ * @param pp_iocr          Out:  The IOCR instance.
+ * @param pp_iodata        Out:  The IODATA object instance.
+ * @return  0  if the handle is valid.
+ *          -1 if the handle is invalid or no longer valid.
+ */
+int pf_cmdev_get_io_desc_by_handle(
+   pnet_t                     *net,
+   pnet_io_handle_t           handle,
+   pf_data_direction_values_t dir,
+   pf_ar_t                    **pp_ar,
+   pf_iocr_t                  **pp_iocr,
+   pf_iodata_object_t         **pp_iodata);
 
 /* Not used */
 /**
@@ -153,6 +153,8 @@ int pf_cmina_set_default_cfg(
 
       /* Init the temp values */
       net->cmina_temp_dcp_ase = net->cmina_perm_dcp_ase;
+      pf_dcp_identify_invalidate(net);
+      pf_lldp_invalidate(net);
 
 
       ret = 0;
@@ -468,7 +470,7 @@ int pf_cmina_dcp_set_ind(
          {
             /* Any connection active ? */
             found = false;
-            for (ix = 0; ix < PNET_MAX_AR; ix++)
+            for (ix = 0; ix < net->cmrpc_max_ar; ix++)
             {
                p_ar = pf_ar_find_by_index(net, ix);
                if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -490,7 +492,7 @@ int pf_cmina_dcp_set_ind(
          {
             /* Any connection active ? */
             found = false;
-            for (ix = 0; ix < PNET_MAX_AR; ix++)
+            for (ix = 0; ix < net->cmrpc_max_ar; ix++)
             {
                p_ar = pf_ar_find_by_index(net, ix);
                if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -515,7 +517,7 @@ int pf_cmina_dcp_set_ind(
          {
             /* Any connection active ?? */
             found = false;
-            for (ix = 0; ix < PNET_MAX_AR; ix++)
+            for (ix = 0; ix < net->cmrpc_max_ar; ix++)
             {
                p_ar = pf_ar_find_by_index(net, ix);
                if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -551,6 +553,10 @@ int pf_cmina_dcp_set_ind(
       }
    }
 
+   /* Any of the values in the Identify response and LLDP may have changed */
+   pf_dcp_identify_invalidate(net);
+   pf_lldp_invalidate(net);
+
    return ret;
 }
 
@@ -56,6 +56,9 @@ int pf_cmrdr_rm_read_ind(
    uint8_t                 iops_len = 0;
    uint16_t                data_len = 0;
    bool                    new_flag = false;
+   pnet_cfg_t              *p_cfg = NULL;
+   pf_lldp_peer_t          peers[PNET_MAX_LLDP_PEERS];
+   uint16_t                nbr_peers = 0;
 
    read_result.sequence_number = p_read_request->sequence_number;
    read_result.ar_uuid = p_read_request->ar_uuid;
@@ -393,11 +396,9 @@ int pf_cmrdr_rm_read_ind(
          break;
 
       case PF_IDX_SUB_PDPORT_DATA_REAL:
-         /* ToDo: Implement properly when LLDP is done */
          /*
           * BlockHeader, Padding, Padding, SlotNumber, SubslotNumber, LengthOwnPortName, OwnPortName,
           * NumberOfPeers, [Padding*] a,
-          * ToDo: Find out where the closing paran goes. It is missing in the spec!!
           * [LengthPeerPortName, PeerPortName, LengthPeerStationName, PeerStationName, [Padding*] a,
           *  LineDelay e, PeerMACAddress b, [Padding*] a ]*, MAUType c, [Padding*] a, Reserved d,
           *  RTClass3_PortStatus, MulticastBoundary, LinkState, [Padding*] a, MediaType
@@ -406,7 +407,14 @@ int pf_cmrdr_rm_read_ind(
           * c See Table 641
           * d The number of reserved octets shall be 2.
           * e The local calculated LineDelay shall be used.
+          *
+          * The peers are served from the LLDP neighbour table.
+          * ToDo: Map the subslot to its port when there is more than one port.
           */
+         pf_fspm_get_cfg(net, &p_cfg);
+         nbr_peers = pf_lldp_get_peers(net, 0, peers, NELEMENTS(peers));
+         pf_put_pdport_data_real(true, p_read_request->slot_number, p_read_request->subslot_number,
+            &p_cfg->lldp_cfg, peers, nbr_peers, res_size, p_res, p_pos);
          ret = 0;
          break;
       case PF_IDX_SUB_PDPORT_DATA_CHECK:
@@ -34,6 +34,8 @@
  *
  * The socket net->cmrpc_rpcreq_socket is used for RPC requests (connects etc)
  *
+ * The sockets are only read when the OSAL has signalled that data has
+ * arrived, see pf_cmrpc_socket_watch(). Then they are read until empty.
  */
 
 #ifdef UNIT_TEST
@@ -42,6 +44,7 @@
 #define os_udp_open mock_os_udp_open
 #define os_udp_close mock_os_udp_close
 #define os_udp_recvfrom mock_os_udp_recvfrom
+#define os_udp_set_callback mock_os_udp_set_callback
 #endif
 
 #include <string.h>
@@ -56,6 +59,7 @@
 #include "pf_block_writer.h"
 
 static const pf_uuid_t     implicit_ar = {0,0,0,{0,0,0,0,0,0,0,0}};
+static const char          *rsp_sync_name = "rpc_frag";
 
 /**************** Diagnostic strings *****************************************/
 
@@ -162,7 +166,7 @@ void pf_cmrpc_show(
 
    if (level & 0x0800)
    {
-      for (ix = 0; ix < PF_MAX_SESSION; ix++)
+      for (ix = 0; ix < net->cmrpc_max_session; ix++)
       {
          p_sess = &net->cmrpc_session_info[ix];
          printf("Session ID            = %u\n", (unsigned)p_sess->ix);
@@ -191,7 +195,7 @@ void pf_cmrpc_show(
 
    if (level & 0x1000)
    {
-      for (ar_ix = 0; ar_ix < PNET_MAX_AR; ar_ix++)
+      for (ar_ix = 0; ar_ix < net->cmrpc_max_ar; ar_ix++)
       {
          p_ar = pf_ar_find_by_index(net, ar_ix);
          printf("AR in use             = %s\n", p_ar->in_use ? "YES" : "NO");
@@ -282,13 +286,13 @@ static int pf_session_allocate(
    pf_session_info_t       *p_sess = NULL;
 
    os_mutex_lock(net->p_cmrpc_rpc_mutex);
-   while ((ix < NELEMENTS(net->cmrpc_session_info)) &&
+   while ((ix < net->cmrpc_max_session) &&
          (net->cmrpc_session_info[ix].in_use == true))
    {
       ix++;
    }
 
-   if (ix < NELEMENTS(net->cmrpc_session_info))
+   if (ix < net->cmrpc_max_session)
    {
       p_sess = &net->cmrpc_session_info[ix];
       memset(p_sess, 0, sizeof(*p_sess));
@@ -323,18 +327,40 @@ static int pf_session_allocate(
    return ret;
 }
 
+/**
+ * @internal
+ * Stop sending a fragmented response.
+ * @param net              InOut: The p-net stack instance
+ * @param p_sess           InOut: The session instance.
+ */
+static void pf_cmrpc_rsp_stop(
+   pnet_t                  *net,
+   pf_session_info_t       *p_sess)
+{
+   if (p_sess->rsp_timeout != 0)
+   {
+      pf_scheduler_remove(net, rsp_sync_name, p_sess->rsp_timeout);
+      p_sess->rsp_timeout = 0;
+   }
+   p_sess->rsp_in_progress = false;
+   p_sess->rsp_len = 0;
+}
+
 /**
  * @internal
  * Free the session_info.
+ * @param net              InOut: The p-net stack instance
  * @param p_sess           In:   The session instance.
  */
 static void pf_session_release(
+   pnet_t                  *net,
    pf_session_info_t       *p_sess)
 {
    if (p_sess != NULL)
    {
       if (p_sess->in_use == true)
       {
+         pf_cmrpc_rsp_stop(net, p_sess);
          LOG_INFO(PF_RPC_LOG, "RPC(%d): Released session ix %u\n", __LINE__, (unsigned)p_sess->ix);
          memset(p_sess, 0, sizeof(*p_sess));
          p_sess->in_use = false;
@@ -368,13 +394,13 @@ static int pf_session_locate_by_uuid(
    uint16_t ix;
 
    ix = 0;
-   while ((ix < NELEMENTS(net->cmrpc_session_info)) &&
+   while ((ix < net->cmrpc_max_session) &&
           ((net->cmrpc_session_info[ix].in_use == false) ||
            (memcmp(p_uuid, &net->cmrpc_session_info[ix].activity_uuid, sizeof(*p_uuid)) != 0)))
    {
       ix++;
    }
-   if (ix < NELEMENTS(net->cmrpc_session_info))
+   if (ix < net->cmrpc_max_session)
    {
       *pp_sess = &net->cmrpc_session_info[ix];
       ret = 0;
@@ -403,14 +429,14 @@ static int pf_session_locate_by_ar(
    uint16_t ix;
 
    ix = 0;
-   while ((ix < NELEMENTS(net->cmrpc_session_info)) &&
+   while ((ix < net->cmrpc_max_session) &&
           ((net->cmrpc_session_info[ix].in_use == false) ||
            (net->cmrpc_session_info[ix].from_me == false) ||
            (net->cmrpc_session_info[ix].p_ar != p_ar)))
    {
       ix++;
    }
-   if (ix < NELEMENTS(net->cmrpc_session_info))
+   if (ix < net->cmrpc_max_session)
    {
       *pp_sess = &net->cmrpc_session_info[ix];
       ret = 0;
@@ -419,6 +445,42 @@ static int pf_session_locate_by_ar(
    return ret;
 }
 
+/**
+ * @internal
+ * Bind a cleared AR to its slices of the runtime-sized tables.
+ *
+ * The modules of each expected API, and the module diffs, have a fixed
+ * slice. Submodules are taken in order from one slice per AR, as the
+ * connect request lists them module by module. The frame descriptors of
+ * each IOCR are taken in the same way, for its I/O data and its IOCS.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             InOut: The AR instance.
+ */
+static void pf_ar_bind(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar)
+{
+   uint16_t                ar_ix = p_ar - net->cmrpc_ar;
+   uint16_t                ix;
+
+   p_ar->max_exp_modules = net->cmdev_max_slots;
+   for (ix = 0; ix < NELEMENTS(p_ar->exp_apis); ix++)
+   {
+      p_ar->exp_apis[ix].modules = &net->cmrpc_exp_modules[((ar_ix * PNET_MAX_API) + ix) * p_ar->max_exp_modules];
+      p_ar->api_diffs[ix].module_diffs = &net->cmrpc_module_diffs[((ar_ix * PNET_MAX_API) + ix) * p_ar->max_exp_modules];
+   }
+
+   p_ar->max_exp_submodules = net->cmdev_max_data_desc;
+   p_ar->exp_submodules = &net->cmrpc_exp_submodules[ar_ix * p_ar->max_exp_submodules];
+   p_ar->submodule_diffs = &net->cmrpc_submodule_diffs[ar_ix * p_ar->max_exp_submodules];
+
+   for (ix = 0; ix < NELEMENTS(p_ar->iocrs); ix++)
+   {
+      p_ar->iocrs[ix].max_frame_desc = 2 * net->cmdev_max_data_desc;
+      p_ar->iocrs[ix].frame_desc = &net->cmrpc_frame_desc[((ar_ix * PNET_MAX_CR) + ix) * p_ar->iocrs[ix].max_frame_desc];
+   }
+}
+
 /**
  * @internal
  * Allocate and clear a new AR.
@@ -434,15 +496,16 @@ static int pf_ar_allocate(
    int                     ret = -1;
    uint16_t                ix = 0;
    os_mutex_lock(net->p_cmrpc_rpc_mutex);
-   while ((ix < NELEMENTS(net->cmrpc_ar)) &&
+   while ((ix < net->cmrpc_max_ar) &&
          (net->cmrpc_ar[ix].in_use == true))
    {
       ix++;
    }
 
-   if (ix < NELEMENTS(net->cmrpc_ar))
+   if (ix < net->cmrpc_max_ar)
    {
       memset(&net->cmrpc_ar[ix], 0, sizeof(net->cmrpc_ar[ix]));
+      pf_ar_bind(net, &net->cmrpc_ar[ix]);
       net->cmrpc_ar[ix].in_use = true;
 
       *pp_ar = &net->cmrpc_ar[ix];
@@ -451,7 +514,7 @@ static int pf_ar_allocate(
    }
    os_mutex_unlock(net->p_cmrpc_rpc_mutex);
 
-   if (ix < PNET_MAX_AR)
+   if (ix < net->cmrpc_max_ar)
    {
       net->cmrpc_ar[ix].arep = ix + 1;      /* Avoid AREP == 0 */
       LOG_INFO(PF_RPC_LOG, "RPC(%d): Allocate AR %u\n", __LINE__, ix);
@@ -505,7 +568,7 @@ static int pf_ar_find_by_uuid(
    pf_cmdev_state_values_t cmdev_state;
 
    ix = 0;
-   while ((ix < NELEMENTS(net->cmrpc_ar)) &&
+   while ((ix < net->cmrpc_max_ar) &&
           ((net->cmrpc_ar[ix].in_use == false) ||
            ((pf_cmdev_get_state(&net->cmrpc_ar[ix], &cmdev_state) == 0) &&
             (cmdev_state == PF_CMDEV_STATE_POWER_ON)) ||
@@ -513,7 +576,7 @@ static int pf_ar_find_by_uuid(
    {
       ix++;
    }
-   if (ix < NELEMENTS(net->cmrpc_ar))
+   if (ix < net->cmrpc_max_ar)
    {
       *pp_ar = &net->cmrpc_ar[ix];
       ret = 0;
@@ -526,7 +589,7 @@ pf_ar_t *pf_ar_find_by_index(
    pnet_t                  *net,
    uint16_t                ix)
 {
-   if (ix < NELEMENTS(net->cmrpc_ar))
+   if (ix < net->cmrpc_max_ar)
    {
       return &net->cmrpc_ar[ix];
    }
@@ -545,7 +608,7 @@ int pf_ar_find_by_arep(
    if (arep > 0)
    {
       ix = arep - 1;    /* Convert to index */
-      if ((ix < NELEMENTS(net->cmrpc_ar)) &&
+      if ((ix < net->cmrpc_max_ar) &&
           (net->cmrpc_ar[ix].in_use == true))
       {
          *pp_ar = &net->cmrpc_ar[ix];
@@ -1084,7 +1147,7 @@ static int pf_cmrpc_rm_connect_ind(
    {
       /* Connect failed: Terminate session - free all resources */
       LOG_INFO(PF_RPC_LOG, "RPC(%d): Connect failed - Free all!\n", __LINE__);
-      pf_session_release(p_sess);
+      pf_session_release(net, p_sess);
       pf_ar_release(p_ar);
    }
 
@@ -1645,7 +1708,7 @@ static int pf_cmrpc_rm_read_ind(
 
          start_pos = *p_res_pos;    /* Start of blocks - save for last */
 
-         if (pf_cmrdr_rm_read_ind(net, p_ar, &read_request, &p_sess->rpc_result, res_size, p_res, p_res_pos) == 0)
+         if (pf_cmrdr_rm_read_ind(net, p_ar, &read_request, &p_sess->rpc_result, res_len, p_res, p_res_pos) == 0)
          {
             ret = pf_cmsm_rm_read_ind(net, p_ar, &read_request);
          }
@@ -1654,6 +1717,14 @@ static int pf_cmrpc_rm_read_ind(
             LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Error from pf_cmrdr_rm_read_ind\n", __LINE__);
          }
 
+         if (pf_put_overflow(res_len, *p_res_pos))
+         {
+            /* The record does not fit. Answer with an error instead. */
+            LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Read response does not fit in %u bytes\n", __LINE__, (unsigned)res_len);
+            pf_set_error(&p_sess->rpc_result, PNET_ERROR_CODE_READ, PNET_ERROR_DECODE_PNIORW, PNET_ERROR_CODE_1_RES_RESOURCE_UNAVAILABLE, 0);
+            *p_res_pos = start_pos;
+         }
+
          /* Insert the actual operation result */
          pf_put_pnet_status(p_sess->get_info.is_big_endian, &p_sess->rpc_result.pnio_status, res_len, p_res, &status_pos);
 
@@ -1961,6 +2032,63 @@ static int pf_cmrpc_rm_write_ind(
    return ret;
 }
 
+/**
+ * @internal
+ * Called by the OSAL when a socket has received data.
+ * @param id               In:   The socket.
+ * @param arg              InOut: The p-net stack instance.
+ */
+static void pf_cmrpc_socket_ready(
+   uint32_t                id,
+   void                    *arg)
+{
+   pnet_t                  *net = (pnet_t *)arg;
+
+   CC_ATOMIC_SET32(&net->cmrpc_rx_ready, 1);
+}
+
+/**
+ * @internal
+ * Ask the OSAL to signal when a socket has received data.
+ *
+ * If it is not supported then all sockets are polled in pf_cmrpc_periodic().
+ * The socket is read at the next pf_cmrpc_periodic() in any case, in case
+ * data arrived before the callback was installed.
+ * @param net              InOut: The p-net stack instance
+ * @param socket           In:   The socket.
+ */
+static void pf_cmrpc_socket_watch(
+   pnet_t                  *net,
+   int                     socket)
+{
+   if (socket < 0)
+   {
+      return;
+   }
+   if (os_udp_set_callback(socket, pf_cmrpc_socket_ready, net) != 0)
+   {
+      if (net->cmrpc_rx_poll == false)
+      {
+         LOG_INFO(PF_RPC_LOG, "CMRPC(%d): No socket callback. Polling RPC sockets\n", __LINE__);
+      }
+      net->cmrpc_rx_poll = true;
+   }
+   CC_ATOMIC_SET32(&net->cmrpc_rx_ready, 1);
+}
+
+/**
+ * @internal
+ * Re-open the global RPC socket.
+ * @param net              InOut: The p-net stack instance
+ */
+static void pf_cmrpc_rpcreq_socket_reopen(
+   pnet_t                  *net)
+{
+   os_udp_close(net->cmrpc_rpcreq_socket);
+   net->cmrpc_rpcreq_socket = os_udp_open(OS_IPADDR_ANY, OS_PF_RPC_SERVER_PORT);
+   pf_cmrpc_socket_watch(net, net->cmrpc_rpcreq_socket);
+}
+
 /**
  * @internal
  * Take a DCE RPC request and create a DCE RPC response.
@@ -2135,23 +2263,31 @@ int pf_cmrpc_rm_ccontrol_req(
       pf_put_uint32(rpc_req.is_big_endian, ndr_data.array.offset, sizeof(p_sess->buffer), p_sess->buffer, &hdr_pos);
       pf_put_uint32(rpc_req.is_big_endian, ndr_data.array.actual_count, sizeof(p_sess->buffer), p_sess->buffer, &hdr_pos);
 
-      p_sess->socket = os_udp_socket();
-      if (p_sess->socket > 0)
+      if (pf_put_overflow(sizeof(p_sess->buffer), pos))
+      {
+         LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): CControl request does not fit in buffer\n", __LINE__);
+      }
+      else
       {
-         if (os_udp_sendto(p_sess->socket, p_sess->ip_addr, p_sess->port, p_sess->buffer, pos) == pos)
+         p_sess->socket = os_udp_socket();
+         if (p_sess->socket > 0)
          {
-            LOG_INFO(PF_RPC_LOG, "os_udp_sendto success!!\n");
-            ret = 0;
+            pf_cmrpc_socket_watch(net, p_sess->socket);
+            if (os_udp_sendto(p_sess->socket, p_sess->ip_addr, p_sess->port, p_sess->buffer, pos) == pos)
+            {
+               LOG_INFO(PF_RPC_LOG, "os_udp_sendto success!!\n");
+               ret = 0;
+            }
+            else
+            {
+               LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): os_udp_sendto failed\n", __LINE__);
+            }
          }
          else
          {
-            LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): os_udp_sendto failed\n", __LINE__);
+            LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): os_udp_socket failed: %d\n", __LINE__, (int)p_sess->socket);
          }
       }
-      else
-      {
-         LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): os_udp_socket failed: %d\n", __LINE__, (int)p_sess->socket);
-      }
    }
 
    return ret;
@@ -2269,7 +2405,7 @@ static int pf_cmrpc_rm_ccontrol_cnf(
             /* Only if result is OK */
             if (pf_cmpbe_rm_ccontrol_cnf(p_ar, &ccontrol_io, &p_sess->rpc_result) == 0)
             {
-               pf_session_release(p_sess);
+               pf_session_release(net, p_sess);
                ret = 0;
             }
             else
@@ -2329,6 +2465,206 @@ static int pf_cmrpc_rpc_response(
    return ret;
 }
 
+/**
+ * @internal
+ * Insert the next fragment of a fragmented response into a buffer.
+ *
+ * The response body is in the session buffer. All fragments but the last
+ * ask the client for a FACK, which triggers the next fragment.
+ * @param p_sess           InOut: The session instance.
+ * @param res_size         In:   The size of the output buffer.
+ * @param p_res            Out:  The output buffer.
+ * @param p_res_pos        InOut:Position in the output buffer.
+ */
+static void pf_cmrpc_put_rsp_fragment(
+   pf_session_info_t       *p_sess,
+   uint16_t                res_size,
+   uint8_t                 *p_res,
+   uint16_t                *p_res_pos)
+{
+   pf_rpc_header_t         *p_rpc = &p_sess->rsp_header;
+   uint16_t                length_of_body_pos;
+   uint16_t                len = p_sess->rsp_len - p_sess->rsp_pos;
+
+   if (len > PF_RPC_MAX_FRAGMENT_BODY)
+   {
+      len = PF_RPC_MAX_FRAGMENT_BODY;
+   }
+
+   p_rpc->flags.fragment = true;
+   p_rpc->flags.last_fragment = ((p_sess->rsp_pos + len) >= p_sess->rsp_len);
+   p_rpc->flags.no_fack = p_rpc->flags.last_fragment;
+   p_rpc->length_of_body = len;
+
+   pf_put_dce_rpc_header(p_rpc, res_size, p_res, p_res_pos, &length_of_body_pos);
+   if ((*p_res_pos + len) <= res_size)
+   {
+      memcpy(&p_res[*p_res_pos], &p_sess->buffer[p_sess->rsp_pos], len);
+      *p_res_pos += len;
+   }
+
+   LOG_DEBUG(PF_RPC_LOG, "CMRPC(%d): Sent response fragment %u, %u of %u bytes\n", __LINE__,
+      (unsigned)p_rpc->fragment_nmb, (unsigned)(p_sess->rsp_pos + len), (unsigned)p_sess->rsp_len);
+
+   p_sess->rsp_pos += len;
+   p_rpc->fragment_nmb++;
+   if (p_rpc->flags.last_fragment == true)
+   {
+      p_sess->rsp_in_progress = false;
+   }
+}
+
+/**
+ * @internal
+ * Move a fragmented response back, so that a fragment is sent again.
+ *
+ * All fragments but the last are PF_RPC_MAX_FRAGMENT_BODY bytes long.
+ * @param p_sess           InOut: The session instance.
+ * @param fragment_nmb     In:   The fragment to send next.
+ * @return  0  if the fragment exists.
+ *          -1 if it is past the end of the response.
+ */
+static int pf_cmrpc_rewind_rsp(
+   pf_session_info_t       *p_sess,
+   uint16_t                fragment_nmb)
+{
+   int                     ret = -1;
+   uint32_t                pos = (uint32_t)fragment_nmb * PF_RPC_MAX_FRAGMENT_BODY;
+
+   if (pos < p_sess->rsp_len)
+   {
+      p_sess->rsp_header.fragment_nmb = fragment_nmb;
+      p_sess->rsp_pos = (uint16_t)pos;
+      p_sess->rsp_in_progress = true;
+      ret = 0;
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Send the last response fragment again when its FACK did not arrive.
+ *
+ * This is a callback for the scheduler. Arguments should fulfill pf_scheduler_timeout_ftn_t
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param arg              In:   The session instance.
+ * @param current_time     In:   Not used.
+ */
+static void pf_cmrpc_rsp_timeout(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                current_time)
+{
+   pf_session_info_t       *p_sess = (pf_session_info_t *)arg;
+   uint16_t                pos = 0;
+
+   p_sess->rsp_timeout = 0;
+   if ((p_sess->in_use == true) && (p_sess->rsp_in_progress == true))
+   {
+      if (p_sess->rsp_retries > 0)
+      {
+         p_sess->rsp_retries--;
+         LOG_INFO(PF_RPC_LOG, "CMRPC(%d): No FACK for fragment %u. Sending it again.\n", __LINE__,
+            (unsigned)(p_sess->rsp_header.fragment_nmb - 1));
+         (void)pf_cmrpc_rewind_rsp(p_sess, p_sess->rsp_header.fragment_nmb - 1);
+         pf_cmrpc_put_rsp_fragment(p_sess, sizeof(net->cmrpc_dcerpc_rsp_frame), net->cmrpc_dcerpc_rsp_frame, &pos);
+         os_udp_sendto(net->cmrpc_rpcreq_socket, p_sess->ip_addr, p_sess->port, net->cmrpc_dcerpc_rsp_frame, pos);
+
+         if (pf_scheduler_add(net, PF_RPC_FRAGMENT_TIMEOUT,
+            rsp_sync_name, pf_cmrpc_rsp_timeout, p_sess, &p_sess->rsp_timeout) != 0)
+         {
+            p_sess->rsp_timeout = 0;
+            LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Error from pf_scheduler_add\n", __LINE__);
+         }
+      }
+      else
+      {
+         LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): No FACK for fragment %u. Giving up.\n", __LINE__,
+            (unsigned)(p_sess->rsp_header.fragment_nmb - 1));
+         pf_cmrpc_rsp_stop(net, p_sess);
+      }
+   }
+}
+
+/**
+ * @internal
+ * Wait for the FACK of the response fragment that was just inserted.
+ * @param net              InOut: The p-net stack instance
+ * @param p_sess           InOut: The session instance.
+ */
+static void pf_cmrpc_rsp_timer_start(
+   pnet_t                  *net,
+   pf_session_info_t       *p_sess)
+{
+   if (p_sess->rsp_timeout != 0)
+   {
+      pf_scheduler_remove(net, rsp_sync_name, p_sess->rsp_timeout);
+      p_sess->rsp_timeout = 0;
+   }
+
+   /* The last fragment is not acknowledged */
+   if (p_sess->rsp_in_progress == true)
+   {
+      if (pf_scheduler_add(net, PF_RPC_FRAGMENT_TIMEOUT,
+         rsp_sync_name, pf_cmrpc_rsp_timeout, p_sess, &p_sess->rsp_timeout) != 0)
+      {
+         p_sess->rsp_timeout = 0;
+         LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Error from pf_scheduler_add\n", __LINE__);
+      }
+   }
+}
+
+/**
+ * @internal
+ * Split a response into fragments if its body does not fit in one datagram.
+ *
+ * The body is moved to the session buffer and the first fragment replaces
+ * the response in the output buffer.
+ * @param net              InOut: The p-net stack instance
+ * @param p_sess           InOut: The session instance.
+ * @param p_rpc_res        In:   The RPC header of the response.
+ * @param start_pos        In:   Position of the response body.
+ * @param res_size         In:   The size of the output buffer.
+ * @param p_res            InOut:The output buffer.
+ * @param p_res_pos        InOut:Position in the output buffer.
+ */
+static void pf_cmrpc_fragment_rsp(
+   pnet_t                  *net,
+   pf_session_info_t       *p_sess,
+   pf_rpc_header_t         *p_rpc_res,
+   uint16_t                start_pos,
+   uint16_t                res_size,
+   uint8_t                 *p_res,
+   uint16_t                *p_res_pos)
+{
+   uint16_t                body_len = *p_res_pos - start_pos;
+
+   if (body_len <= PF_RPC_MAX_FRAGMENT_BODY)
+   {
+      /* Fits in one datagram */
+   }
+   else if ((p_sess->in_use == false) || (body_len > sizeof(p_sess->buffer)))
+   {
+      LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Can not fragment response of %u bytes\n", __LINE__, (unsigned)body_len);
+   }
+   else
+   {
+      memcpy(p_sess->buffer, &p_res[start_pos], body_len);
+      p_sess->rsp_header = *p_rpc_res;
+      p_sess->rsp_header.fragment_nmb = 0;
+      p_sess->rsp_len = body_len;
+      p_sess->rsp_pos = 0;
+      p_sess->rsp_retries = PF_RPC_FRAGMENT_RETRIES;
+      p_sess->rsp_in_progress = true;
+
+      *p_res_pos = 0;
+      pf_cmrpc_put_rsp_fragment(p_sess, res_size, p_res, p_res_pos);
+      pf_cmrpc_rsp_timer_start(net, p_sess);
+   }
+}
+
 /**
  * @internal
  * Handle one DCE RPC message.
@@ -2371,6 +2707,26 @@ static int pf_cmrpc_dce_packet(
    /* This function also sets get_info.is_big_endian */
    pf_get_dce_rpc_header(&get_info, &req_pos, &rpc_req);
 
+   if (rpc_req.packet_type == PF_RPC_PT_FRAG_ACK)
+   {
+      /*
+       * The client has received the response up to this fragment. Send the
+       * next one. A FACK for an earlier fragment than the last one sent
+       * means that the later fragments were lost, so they are sent again.
+       */
+      if ((pf_session_locate_by_uuid(net, &rpc_req.activity_uuid, &p_sess) == 0) &&
+          (p_sess->rsp_len > 0) &&
+          (rpc_req.fragment_nmb < p_sess->rsp_header.fragment_nmb) &&
+          (pf_cmrpc_rewind_rsp(p_sess, rpc_req.fragment_nmb + 1) == 0))
+      {
+         p_sess->rsp_retries = PF_RPC_FRAGMENT_RETRIES;
+         pf_cmrpc_put_rsp_fragment(p_sess, *p_res_len, p_res, &res_pos);
+         pf_cmrpc_rsp_timer_start(net, p_sess);
+      }
+      *p_res_len = res_pos;
+      return 0;
+   }
+
    /* Find the session or allocate a new one */
    pf_session_locate_by_uuid(net, &rpc_req.activity_uuid, &p_sess);
    if (p_sess == NULL)
@@ -2388,6 +2744,9 @@ static int pf_cmrpc_dce_packet(
       p_sess->get_info = get_info;
       memset(&p_sess->rpc_result, 0, sizeof(p_sess->rpc_result));
 
+      /* A new request cancels an unfinished fragmented response */
+      pf_cmrpc_rsp_stop(net, p_sess);
+
       /* Handle RPC fragments: */
       if (rpc_req.flags.fragment == false)
       {
@@ -2501,7 +2860,7 @@ static int pf_cmrpc_dce_packet(
             ret = pf_cmrpc_rpc_request(net, p_sess, req_pos, &rpc_req, *p_res_len, p_res, &res_pos);
             if (rpc_req.opnum == PF_RPC_DEV_OPNUM_RELEASE)
             {
-               pf_session_release(p_sess);
+               pf_session_release(net, p_sess);
             }
 
             /*
@@ -2512,6 +2871,18 @@ static int pf_cmrpc_dce_packet(
 
             /* Insert the real value of length_of_body in the rpc header */
             pf_put_uint16(rpc_res.is_big_endian, (uint16_t)(res_pos - start_pos), *p_res_len, p_res, &length_of_body_pos);
+
+            if (pf_put_overflow(*p_res_len, res_pos))
+            {
+               /* Do not send a truncated response */
+               LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Response does not fit in %u bytes\n", __LINE__, (unsigned)*p_res_len);
+               res_pos = 0;
+            }
+            else if (rpc_req.opnum != PF_RPC_DEV_OPNUM_RELEASE)
+            {
+               /* The session still exists unless this was a release */
+               pf_cmrpc_fragment_rsp(net, p_sess, &rpc_res, start_pos, *p_res_len, p_res, &res_pos);
+            }
             break;
          case PF_RPC_PT_RESPONSE:
             ret = pf_cmrpc_rpc_response(net, p_sess, req_pos, &rpc_req);
@@ -2567,24 +2938,36 @@ void pf_cmrpc_periodic(
    uint16_t                ix;
    bool                    is_release = false;
 
-   /* Poll for RPC session confirmations */
-   for (ix = 0; ix < NELEMENTS(net->cmrpc_session_info); ix++)
+   /* Nothing has arrived since the sockets were emptied */
+   if ((net->cmrpc_rx_poll == false) && (CC_ATOMIC_GET32(&net->cmrpc_rx_ready) == 0))
    {
-      if ((net->cmrpc_session_info[ix].in_use == true) && (net->cmrpc_session_info[ix].from_me == true))
+      return;
+   }
+   CC_ATOMIC_SET32(&net->cmrpc_rx_ready, 0);
+
+   /* Read RPC session confirmations */
+   for (ix = 0; ix < net->cmrpc_max_session; ix++)
+   {
+      while ((net->cmrpc_session_info[ix].in_use == true) && (net->cmrpc_session_info[ix].from_me == true))
       {
          dcerpc_req_len = os_udp_recvfrom(net->cmrpc_session_info[ix].socket, &dcerpc_addr, &dcerpc_port, net->cmrpc_dcerpc_req_frame, sizeof(net->cmrpc_dcerpc_req_frame));
-         if (dcerpc_req_len > 0)
+         if (dcerpc_req_len <= 0)
          {
-            dcerpc_resp_len = sizeof(net->cmrpc_dcerpc_rsp_frame);
-            (void)pf_cmrpc_dce_packet(net, dcerpc_addr, dcerpc_port, net->cmrpc_dcerpc_req_frame, dcerpc_req_len, net->cmrpc_dcerpc_rsp_frame, &dcerpc_resp_len, &is_release);
+            break;
          }
+         dcerpc_resp_len = sizeof(net->cmrpc_dcerpc_rsp_frame);
+         (void)pf_cmrpc_dce_packet(net, dcerpc_addr, dcerpc_port, net->cmrpc_dcerpc_req_frame, dcerpc_req_len, net->cmrpc_dcerpc_rsp_frame, &dcerpc_resp_len, &is_release);
       }
    }
 
-   /* Poll RPC requests */
-   dcerpc_req_len = os_udp_recvfrom(net->cmrpc_rpcreq_socket, &dcerpc_addr, &dcerpc_port, net->cmrpc_dcerpc_req_frame, sizeof(net->cmrpc_dcerpc_req_frame));
-   if (dcerpc_req_len > 0)
+   /* Read RPC requests */
+   for (;;)
    {
+      dcerpc_req_len = os_udp_recvfrom(net->cmrpc_rpcreq_socket, &dcerpc_addr, &dcerpc_port, net->cmrpc_dcerpc_req_frame, sizeof(net->cmrpc_dcerpc_req_frame));
+      if (dcerpc_req_len <= 0)
+      {
+         break;
+      }
       dcerpc_resp_len = sizeof(net->cmrpc_dcerpc_rsp_frame);
       (void)pf_cmrpc_dce_packet(net, dcerpc_addr, dcerpc_port, net->cmrpc_dcerpc_req_frame, dcerpc_req_len, net->cmrpc_dcerpc_rsp_frame, &dcerpc_resp_len, &is_release);
       if (dcerpc_resp_len != 0)
@@ -2597,8 +2980,9 @@ void pf_cmrpc_periodic(
       }
       if (is_release == true)
       {
-         os_udp_close(net->cmrpc_rpcreq_socket);
-         net->cmrpc_rpcreq_socket = os_udp_open(OS_IPADDR_ANY, OS_PF_RPC_SERVER_PORT);
+         /* The new socket is read at the next call */
+         pf_cmrpc_rpcreq_socket_reopen(net);
+         break;
       }
    }
 }
@@ -2609,10 +2993,12 @@ void pf_cmrpc_init(
    if (net->p_cmrpc_rpc_mutex == NULL)
    {
       net->p_cmrpc_rpc_mutex = os_mutex_create();
-      memset(net->cmrpc_ar, 0, sizeof(net->cmrpc_ar));
-      memset(net->cmrpc_session_info, 0, sizeof(net->cmrpc_session_info));
+      memset(net->cmrpc_ar, 0, net->cmrpc_max_ar * sizeof(*net->cmrpc_ar));
+      memset(net->cmrpc_session_info, 0, net->cmrpc_max_session * sizeof(*net->cmrpc_session_info));
 
+      net->cmrpc_rx_poll = false;
       net->cmrpc_rpcreq_socket = os_udp_open(OS_IPADDR_ANY, OS_PF_RPC_SERVER_PORT);
+      pf_cmrpc_socket_watch(net, net->cmrpc_rpcreq_socket);
    }
 
    /* Save for later (put it into each session */
@@ -2627,8 +3013,8 @@ void pf_cmrpc_exit(
    if (net->p_cmrpc_rpc_mutex != NULL)
    {
       os_mutex_destroy(net->p_cmrpc_rpc_mutex);
-      memset(net->cmrpc_ar, 0, sizeof(net->cmrpc_ar));
-      memset(net->cmrpc_session_info, 0, sizeof(net->cmrpc_session_info));
+      memset(net->cmrpc_ar, 0, net->cmrpc_max_ar * sizeof(*net->cmrpc_ar));
+      memset(net->cmrpc_session_info, 0, net->cmrpc_max_session * sizeof(*net->cmrpc_session_info));
    }
 }
 
@@ -2649,7 +3035,7 @@ int pf_cmrpc_cmdev_state_ind(
       while (pf_session_locate_by_ar(net, p_ar, &p_sess) == 0)
       {
          os_udp_close(p_sess->socket);
-         pf_session_release(p_sess);
+         pf_session_release(net, p_sess);
       }
 
       if (p_ar != NULL)    /* CheckAREP */
@@ -2658,11 +3044,9 @@ int pf_cmrpc_cmdev_state_ind(
          {
             if (p_ar->p_sess->release_in_progress == false)
             {
-               pf_session_release(p_ar->p_sess);
+               pf_session_release(net, p_ar->p_sess);
 
-               /* Re-open the global RPC socket. */
-               os_udp_close(net->cmrpc_rpcreq_socket);
-               net->cmrpc_rpcreq_socket = os_udp_open(OS_IPADDR_ANY, OS_PF_RPC_SERVER_PORT);
+               pf_cmrpc_rpcreq_socket_reopen(net);
             }
          }
          else
@@ -28,6 +28,153 @@
 #include "pf_includes.h"
 #include "pf_block_reader.h"
 
+/**
+ * @internal
+ * Reserve room for a table in the block allocated by pnet_alloc().
+ * @param p_size           InOut:The size of the block so far.
+ * @param table_size       In:   The size of the table.
+ * @return  the offset of the table from the start of the stack instance.
+ */
+static size_t pnet_alloc_table(
+   size_t                  *p_size,
+   size_t                  table_size)
+{
+   size_t                  offset = *p_size;
+
+   *p_size += PF_CACHE_ALIGN(table_size);
+
+   return offset;
+}
+
+/**
+ * @internal
+ * Allocate the stack instance and its runtime-sized tables.
+ *
+ * Everything is taken from one block, so the footprint is known after init
+ * and the instance is freed with a single call. The instance and each table
+ * start on a cache line of their own. The whole block is cleared, as the
+ * receive thread may look at the instance before all of it is set up.
+ * @param p_cfg            In:   Profinet configuration.
+ * @return  the stack instance, or NULL if out of memory or if the
+ *          configuration is out of range.
+ */
+static pnet_t* pnet_alloc(
+   const pnet_cfg_t        *p_cfg)
+{
+   pnet_t                  *net = NULL;
+   uint8_t                 *p_mem;
+   uint16_t                max_ar = p_cfg->max_ar;
+   uint16_t                max_slots = p_cfg->max_slots;
+   uint16_t                max_subslots = p_cfg->max_subslots;
+   uint32_t                max_data_desc = p_cfg->max_submodules;
+   uint16_t                max_diag_items = p_cfg->max_diag_items;
+   size_t                  size;
+   size_t                  ar_offset;
+   size_t                  session_offset;
+   size_t                  data_desc_offset;
+   size_t                  io_index_offset;
+   size_t                  diag_item_offset;
+   size_t                  slot_offset;
+   size_t                  subslot_offset;
+   size_t                  exp_module_offset;
+   size_t                  module_diff_offset;
+   size_t                  exp_submodule_offset;
+   size_t                  submodule_diff_offset;
+   size_t                  frame_desc_offset;
+
+   if (max_ar == 0)
+   {
+      max_ar = PNET_MAX_AR;
+   }
+   if (max_slots == 0)
+   {
+      max_slots = PNET_MAX_MODULES;
+   }
+   if (max_subslots == 0)
+   {
+      max_subslots = PNET_MAX_SUBMODULES;
+   }
+   if (max_data_desc == 0)
+   {
+      max_data_desc = (uint32_t)PNET_MAX_API * max_slots * max_subslots;
+   }
+   if (max_diag_items == 0)
+   {
+      max_diag_items = PNET_MAX_DIAG_ITEMS;
+   }
+
+   if (max_ar > PNET_MAX_AR)
+   {
+      LOG_ERROR(PNET_LOG, "API(%d): max_ar %u is larger than %u\n", __LINE__,
+         (unsigned)max_ar, (unsigned)PNET_MAX_AR);
+   }
+   else if (max_data_desc > PF_IO_INDEX_MAX_SIZE)
+   {
+      LOG_ERROR(PNET_LOG, "API(%d): max_submodules %u is larger than %u. Set it, or reduce max_slots or max_subslots.\n", __LINE__,
+         (unsigned)max_data_desc, (unsigned)PF_IO_INDEX_MAX_SIZE);
+   }
+   else if (max_diag_items == PF_DIAG_IX_NULL)
+   {
+      LOG_ERROR(PNET_LOG, "API(%d): max_diag_items %u is too large\n", __LINE__,
+         (unsigned)max_diag_items);
+   }
+   else
+   {
+      size = PF_CACHE_ALIGN(sizeof(*net));
+      ar_offset = pnet_alloc_table(&size, (size_t)max_ar * sizeof(pf_ar_t));
+      session_offset = pnet_alloc_table(&size, (size_t)PF_MAX_SESSION(max_ar) * sizeof(pf_session_info_t));
+      data_desc_offset = pnet_alloc_table(&size, (size_t)max_ar * PNET_MAX_CR * max_data_desc * sizeof(pf_iodata_object_t));
+      io_index_offset = pnet_alloc_table(&size, (size_t)max_ar * max_data_desc * sizeof(pf_io_index_t));
+      diag_item_offset = pnet_alloc_table(&size, (size_t)max_diag_items * sizeof(pf_diag_item_t));
+      slot_offset = pnet_alloc_table(&size, (size_t)PNET_MAX_API * max_slots * sizeof(pf_slot_t));
+      subslot_offset = pnet_alloc_table(&size, (size_t)PNET_MAX_API * max_slots * max_subslots * sizeof(pf_subslot_t));
+      exp_module_offset = pnet_alloc_table(&size, (size_t)max_ar * PNET_MAX_API * max_slots * sizeof(pf_exp_module_t));
+      module_diff_offset = pnet_alloc_table(&size, (size_t)max_ar * PNET_MAX_API * max_slots * sizeof(pf_module_diff_t));
+      exp_submodule_offset = pnet_alloc_table(&size, (size_t)max_ar * max_data_desc * sizeof(pf_exp_submodule_t));
+      submodule_diff_offset = pnet_alloc_table(&size, (size_t)max_ar * max_data_desc * sizeof(pf_submodule_diff_t));
+      frame_desc_offset = pnet_alloc_table(&size, (size_t)max_ar * PNET_MAX_CR * 2 * max_data_desc * sizeof(pf_frame_descriptor_t));
+
+      p_mem = os_malloc(PF_CACHE_LINE_SIZE - 1 + size);
+      if (p_mem == NULL)
+      {
+         LOG_ERROR(PNET_LOG, "API(%d): Out of memory, %u bytes needed\n", __LINE__,
+            (unsigned)(PF_CACHE_LINE_SIZE - 1 + size));
+      }
+      else
+      {
+         net = (pnet_t *)PF_CACHE_ALIGN((uintptr_t)p_mem);
+         memset(net, 0, size);
+         net->p_mem = p_mem;
+         net->mem_size = PF_CACHE_LINE_SIZE - 1 + size;
+
+         net->cmrpc_max_ar = max_ar;
+         net->cmrpc_ar = (pf_ar_t *)((uint8_t *)net + ar_offset);
+         net->cmrpc_max_session = PF_MAX_SESSION(max_ar);
+         net->cmrpc_session_info = (pf_session_info_t *)((uint8_t *)net + session_offset);
+         net->cmdev_max_data_desc = (uint16_t)max_data_desc;
+         net->cmdev_data_desc = (pf_iodata_object_t *)((uint8_t *)net + data_desc_offset);
+         net->cmdev_io_index = (pf_io_index_t *)((uint8_t *)net + io_index_offset);
+         net->cmdev_max_diag_items = max_diag_items;
+         net->cmdev_diag_items = (pf_diag_item_t *)((uint8_t *)net + diag_item_offset);
+         net->cmdev_max_slots = max_slots;
+         net->cmdev_max_subslots = max_subslots;
+         net->cmdev_slots = (pf_slot_t *)((uint8_t *)net + slot_offset);
+         net->cmdev_subslots = (pf_subslot_t *)((uint8_t *)net + subslot_offset);
+         net->cmrpc_exp_modules = (pf_exp_module_t *)((uint8_t *)net + exp_module_offset);
+         net->cmrpc_module_diffs = (pf_module_diff_t *)((uint8_t *)net + module_diff_offset);
+         net->cmrpc_exp_submodules = (pf_exp_submodule_t *)((uint8_t *)net + exp_submodule_offset);
+         net->cmrpc_submodule_diffs = (pf_submodule_diff_t *)((uint8_t *)net + submodule_diff_offset);
+         net->cmrpc_frame_desc = (pf_frame_descriptor_t *)((uint8_t *)net + frame_desc_offset);
+
+         LOG_INFO(PNET_LOG, "API(%d): Allocated %u bytes, %u ARs, %u slots with %u subslots, %u submodules per AR, %u diag items\n", __LINE__,
+            (unsigned)net->mem_size, (unsigned)max_ar, (unsigned)max_slots, (unsigned)max_subslots,
+            (unsigned)max_data_desc, (unsigned)max_diag_items);
+      }
+   }
+
+   return net;
+}
+
 pnet_t* pnet_init(
    const char              *netif,
    uint32_t                tick_us,
@@ -35,7 +182,7 @@ pnet_t* pnet_init(
 {
    pnet_t                  *net;
 
-   net = os_malloc(sizeof(*net));
+   net = pnet_alloc(p_cfg);
    if (net == NULL)
    {
       return NULL;
@@ -51,20 +198,22 @@ pnet_t* pnet_init(
    pf_cpm_init(net);
    pf_ppm_init(net);
    pf_alarm_init(net);
+   pf_lldp_rx_init(net);
+   pf_eth_init(net);
 
    /* pnet_cm_init_req */
    pf_fspm_init(net, p_cfg);    /* Init cfg */
 
    /* Initialize everything (and the DCP protocol) */
-   /* First initialize the network interface */
+   /* First initialize the network interface. Frames may arrive at once. */
    net->eth_handle = os_eth_init(netif, pf_eth_recv, (void*)net);
    if (net->eth_handle == NULL)
    {
-       free(net);
+       os_mutex_destroy(net->lldp_mutex);
+       free(net->p_mem);
        return NULL;
    }
 
-   pf_eth_init(net);
    pf_scheduler_init(net, tick_us);
    pf_cmina_init(net);  /* Read from permanent pool */
 
@@ -90,6 +239,12 @@ void pnet_handle_periodic(
    pf_scheduler_tick(net);
 }
 
+size_t pnet_get_footprint(
+   pnet_t                  *net)
+{
+   return net->mem_size;
+}
+
 void pnet_show(
    pnet_t                  *net,
    unsigned                level)
@@ -103,6 +258,12 @@ void pnet_show(
       if (level & 0x2000)
       {
          printf("\n");
+         printf("Memory footprint         : %u bytes\n", (unsigned)net->mem_size);
+         printf("ARs                      : %u\n", (unsigned)net->cmrpc_max_ar);
+         printf("Slots per API            : %u\n", (unsigned)net->cmdev_max_slots);
+         printf("Subslots per slot        : %u\n", (unsigned)net->cmdev_max_subslots);
+         printf("Submodules per AR        : %u\n", (unsigned)net->cmdev_max_data_desc);
+         printf("Diag items               : %u\n", (unsigned)net->cmdev_max_diag_items);
          pf_cmina_show(net);
          printf("\n");
       }
@@ -191,6 +352,61 @@ int pnet_output_set_iocs(
    return pf_ppm_set_iocs(net, api, slot, subslot, &iocs, iocs_len);
 }
 
+int pnet_io_handle_get(
+   pnet_t                  *net,
+   uint32_t                api,
+   uint16_t                slot,
+   uint16_t                subslot,
+   pnet_io_handle_t        *p_handle)
+{
+   return pf_cmdev_get_io_handle(net, api, slot, subslot, p_handle);
+}
+
+int pnet_io_input_set_data_and_iops(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_data,
+   uint16_t                data_len,
+   uint8_t                 iops)
+{
+   uint8_t                 iops_len = 1;
+
+   return pf_ppm_io_set_data_and_iops(net, handle, p_data, data_len, &iops, iops_len);
+}
+
+int pnet_io_input_get_iocs(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 *p_iocs)
+{
+   uint8_t                 iocs_len = 1;
+
+   return pf_cpm_io_get_iocs(net, handle, p_iocs, &iocs_len);
+}
+
+int pnet_io_output_get_data_and_iops(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   bool                    *p_new_flag,
+   uint8_t                 *p_data,
+   uint16_t                *p_data_len,
+   uint8_t                 *p_iops)
+{
+   uint8_t                 iops_len = 1;
+
+   return pf_cpm_io_get_data_and_iops(net, handle, p_new_flag, p_data, p_data_len, p_iops, &iops_len);
+}
+
+int pnet_io_output_set_iocs(
+   pnet_t                  *net,
+   pnet_io_handle_t        handle,
+   uint8_t                 iocs)
+{
+   uint8_t                 iocs_len = 1;
+
+   return pf_ppm_io_set_iocs(net, handle, &iocs, iocs_len);
+}
+
 int pnet_plug_module(
    pnet_t                  *net,
    uint32_t                api,
@@ -240,7 +456,7 @@ int pnet_set_state(
    uint16_t                cr_ix;
    pf_ar_t                 *p_ar = NULL;
 
-   for (ar_ix = 0; ar_ix < PNET_MAX_AR; ar_ix++)
+   for (ar_ix = 0; ar_ix < net->cmrpc_max_ar; ar_ix++)
    {
       p_ar = pf_ar_find_by_index(net, ar_ix);
       if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -267,7 +483,7 @@ int pnet_set_redundancy_state(
    uint16_t                cr_ix;
    pf_ar_t                 *p_ar = NULL;
 
-   for (ar_ix = 0; ar_ix < PNET_MAX_AR; ar_ix++)
+   for (ar_ix = 0; ar_ix < net->cmrpc_max_ar; ar_ix++)
    {
       p_ar = pf_ar_find_by_index(net, ar_ix);
       if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -294,7 +510,7 @@ int pnet_set_provider_state(
    uint16_t                cr_ix;
    pf_ar_t                 *p_ar = NULL;
 
-   for (ar_ix = 0; ar_ix < PNET_MAX_AR; ar_ix++)
+   for (ar_ix = 0; ar_ix < net->cmrpc_max_ar; ar_ix++)
    {
       p_ar = pf_ar_find_by_index(net, ar_ix);
       if ((p_ar != NULL) && (p_ar->in_use == true))
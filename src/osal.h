@@ -130,6 +130,15 @@ os_thread_t * os_thread_create (const char * name, int priority,
 
 void os_thread_destroy(os_thread_t *thread);
 
+/**
+ * Get an identifier of the calling thread.
+ *
+ * The identifier is opaque and is only intended for comparisons.
+ *
+ * @return  The identifier of the calling thread. Never NULL.
+ */
+void * os_thread_self (void);
+
 /********************** Mutex ************************************************/
 
 os_mutex_t * os_mutex_create (void);
@@ -218,6 +227,30 @@ int os_udp_recvfrom(uint32_t id,
       int size);
 void os_udp_close(uint32_t id);
 
+/**
+ * Callback for a UDP socket that has received data. It may be called from
+ * another thread than the one that reads the socket, and should only signal
+ * that thread.
+ */
+typedef void (os_udp_callback_t)(uint32_t id, void *arg);
+
+/**
+ * Call a function when a UDP socket has received data, instead of polling
+ * it with os_udp_recvfrom().
+ *
+ * The function is called when data arrives on an empty socket. Read the
+ * socket until os_udp_recvfrom() returns 0 or less to be called again.
+ * os_udp_close() removes the callback.
+ *
+ * @param id            In: The socket.
+ * @param callback      In: Function to call, or NULL to remove it.
+ * @param arg           InOut: User argument passed to the callback
+ *
+ * @return  0 on success, or -1 if not supported. The socket must then be
+ *          polled.
+ */
+int os_udp_set_callback(uint32_t id, os_udp_callback_t *callback, void *arg);
+
 
 /**************************** IP *********************************************/
 
@@ -60,6 +60,15 @@ static inline void cc_assert (int exp)
 #define CC_ATOMIC_SET32(p, v) __atomic_store_n ((p), (v), __ATOMIC_SEQ_CST)
 #define CC_ATOMIC_SET64(p, v) __atomic_store_n ((p), (v), __ATOMIC_SEQ_CST)
 
+#define CC_ATOMIC_CAS32(p, e, d)                \
+({                                              \
+   uint32_t _e = (e);                           \
+   __atomic_compare_exchange_n ((p), &_e, (d),  \
+      false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);\
+})
+
+#define CC_ATOMIC_XCHG_PTR(p, v) __atomic_exchange_n ((p), (v), __ATOMIC_SEQ_CST)
+
 #define CC_ASSERT(exp)        cc_assert (exp)
 #ifdef __cplusplus
 #define CC_STATIC_ASSERT(exp) static_assert (exp, "")
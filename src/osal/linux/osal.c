@@ -34,6 +34,12 @@
 #include <unistd.h>
 
 #include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#if defined (USE_LOCKFREE_MBOX)
+#include <linux/futex.h>
+#endif
 
 /* Priority of timer callback thread (if USE_SCHED_FIFO is set) */
 #define TIMER_PRIO        5
@@ -41,10 +47,8 @@
 #define USECS_PER_SEC     (1 * 1000 * 1000)
 #define NSECS_PER_SEC     (1 * 1000 * 1000 * 1000)
 
-void os_log (int type, const char * fmt, ...)
+static void os_log_prefix (int type)
 {
-   va_list list;
-
    switch(LOG_LEVEL_GET (type))
    {
    case LOG_LEVEL_DEBUG:   printf ("[DEBUG] "); break;
@@ -53,6 +57,187 @@ void os_log (int type, const char * fmt, ...)
    case LOG_LEVEL_ERROR:   printf ("[ERROR] "); break;
    default: break;
    }
+}
+
+#if defined (USE_ASYNC_LOG)
+
+/*
+ * Deferred logging. os_log() formats the message into a fixed size record
+ * of a lock-free ring and returns. It never blocks and never makes a system
+ * call. A low priority thread writes the records to stdout. When the ring is
+ * full the message is dropped and counted.
+ *
+ * The message is formatted by the caller, as "%s" arguments often point to
+ * buffers that are gone by the time the drain thread runs.
+ */
+
+#define OS_LOG_RING_SIZE      256   /* Power of two */
+#define OS_LOG_RECORD_SIZE    160   /* Longer messages are truncated */
+#define OS_LOG_DRAIN_PERIOD   10    /* ms */
+#define OS_LOG_PRIO           1
+
+typedef struct os_log_record
+{
+   uint64_t seq;
+   uint32_t time_us;
+   int type;
+   char text[OS_LOG_RECORD_SIZE];
+} os_log_record_t;
+
+static os_log_record_t os_log_ring[OS_LOG_RING_SIZE];
+static uint64_t        os_log_w = 0;
+static uint64_t        os_log_r = 0;
+static uint32_t        os_log_written = 0;
+static uint32_t        os_log_dropped = 0;
+static uint32_t        os_log_truncated = 0;
+static os_thread_t *   os_log_thread = NULL;
+static pthread_once_t  os_log_once = PTHREAD_ONCE_INIT;
+
+static void os_log_drain (void * arg)
+{
+   os_log_record_t * rec;
+   uint32_t dropped;
+   uint32_t reported = 0;
+
+   for (;;)
+   {
+      rec = &os_log_ring[os_log_r & (OS_LOG_RING_SIZE - 1)];
+      if (__atomic_load_n (&rec->seq, __ATOMIC_ACQUIRE) == os_log_r + 1)
+      {
+         os_log_prefix (rec->type);
+         printf ("%u.%06u: %s", (unsigned)(rec->time_us / USECS_PER_SEC),
+            (unsigned)(rec->time_us % USECS_PER_SEC), rec->text);
+
+         __atomic_store_n (&rec->seq, os_log_r + OS_LOG_RING_SIZE, __ATOMIC_RELEASE);
+         os_log_r++;
+         __atomic_add_fetch (&os_log_written, 1, __ATOMIC_RELEASE);
+         continue;
+      }
+
+      dropped = __atomic_load_n (&os_log_dropped, __ATOMIC_RELAXED);
+      if (dropped != reported)
+      {
+         printf ("[WARN ] %u log messages dropped\n", (unsigned)(dropped - reported));
+         reported = dropped;
+      }
+      fflush (stdout);
+      os_usleep (OS_LOG_DRAIN_PERIOD * 1000);
+   }
+}
+
+static void os_log_init (void)
+{
+   uint32_t ix;
+
+   for (ix = 0; ix < OS_LOG_RING_SIZE; ix++)
+   {
+      os_log_ring[ix].seq = ix;
+   }
+   /* Without the thread, messages are written directly */
+   os_log_thread = os_thread_create ("os_log", OS_LOG_PRIO, 4096, os_log_drain, NULL);
+}
+
+static os_log_record_t * os_log_claim (uint64_t * p_pos)
+{
+   os_log_record_t * rec;
+   uint64_t pos = __atomic_load_n (&os_log_w, __ATOMIC_RELAXED);
+   int64_t diff;
+
+   for (;;)
+   {
+      rec = &os_log_ring[pos & (OS_LOG_RING_SIZE - 1)];
+      diff = (int64_t)(__atomic_load_n (&rec->seq, __ATOMIC_ACQUIRE) - pos);
+      if (diff == 0)
+      {
+         if (__atomic_compare_exchange_n (&os_log_w, &pos, pos + 1, true,
+               __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+         {
+            *p_pos = pos;
+            return rec;
+         }
+      }
+      else if (diff < 0)
+      {
+         return NULL;   /* Full */
+      }
+      else
+      {
+         pos = __atomic_load_n (&os_log_w, __ATOMIC_RELAXED);
+      }
+   }
+}
+
+void os_log (int type, const char * fmt, ...)
+{
+   va_list list;
+   os_log_record_t * rec;
+   uint64_t pos;
+   int len;
+
+   pthread_once (&os_log_once, os_log_init);
+
+   if (os_log_thread == NULL)
+   {
+      os_log_prefix (type);
+      va_start (list, fmt);
+      vprintf (fmt, list);
+      va_end (list);
+      fflush (stdout);
+      return;
+   }
+
+   rec = os_log_claim (&pos);
+   if (rec == NULL)
+   {
+      __atomic_add_fetch (&os_log_dropped, 1, __ATOMIC_RELAXED);
+      return;
+   }
+
+   rec->time_us = os_get_current_time_us();
+   rec->type = type;
+   va_start (list, fmt);
+   len = vsnprintf (rec->text, sizeof(rec->text), fmt, list);
+   va_end (list);
+   if (len >= (int)sizeof(rec->text))
+   {
+      rec->text[sizeof(rec->text) - 2] = '\n';
+      __atomic_add_fetch (&os_log_truncated, 1, __ATOMIC_RELAXED);
+   }
+
+   __atomic_store_n (&rec->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+void os_log_flush (void)
+{
+   uint32_t target;
+
+   pthread_once (&os_log_once, os_log_init);
+   if (os_log_thread != NULL)
+   {
+      target = (uint32_t)__atomic_load_n (&os_log_w, __ATOMIC_ACQUIRE);
+      while ((int32_t)(__atomic_load_n (&os_log_written, __ATOMIC_ACQUIRE) - target) < 0)
+      {
+         os_usleep (1000);
+      }
+   }
+   fflush (stdout);
+}
+
+void os_log_get_stats (os_log_stats_t * p_stats)
+{
+   p_stats->records = (uint32_t)__atomic_load_n (&os_log_w, __ATOMIC_RELAXED);
+   p_stats->written = __atomic_load_n (&os_log_written, __ATOMIC_RELAXED);
+   p_stats->dropped = __atomic_load_n (&os_log_dropped, __ATOMIC_RELAXED);
+   p_stats->truncated = __atomic_load_n (&os_log_truncated, __ATOMIC_RELAXED);
+}
+
+#else
+
+void os_log (int type, const char * fmt, ...)
+{
+   va_list list;
+
+   os_log_prefix (type);
 
    va_start (list, fmt);
    vprintf (fmt, list);
@@ -60,6 +245,18 @@ void os_log (int type, const char * fmt, ...)
    fflush (stdout);
 }
 
+void os_log_flush (void)
+{
+   fflush (stdout);
+}
+
+void os_log_get_stats (os_log_stats_t * p_stats)
+{
+   memset (p_stats, 0, sizeof(*p_stats));
+}
+
+#endif
+
 void * os_malloc (size_t size)
 {
    return malloc (size);
@@ -91,6 +288,11 @@ os_thread_t * os_thread_create (const char * name, int priority,
    return thread;
 }
 
+void * os_thread_self (void)
+{
+   return (void *)(uintptr_t)pthread_self();
+}
+
 os_mutex_t * os_mutex_create (void)
 {
    int result;
@@ -300,14 +502,236 @@ void os_event_destroy (os_event_t * event)
    free (event);
 }
 
+#if defined (USE_LOCKFREE_MBOX)
+
+/*
+ * Lock-free mailbox. This is the bounded MPMC ring by D. Vyukov: each slot
+ * carries a sequence number telling whether it is free for the writer at
+ * position w or holds a message for the reader at position r.
+ *
+ * A thread that finds the mailbox empty (fetch) or full (post) sets waiters
+ * and sleeps on the futex word. The other side only makes a system call if
+ * it is the one to clear waiters, which wakes all sleeping threads.
+ */
+
+static bool os_mbox_try_post (os_mbox_t * mbox, void * msg)
+{
+   os_mbox_slot_t * slot;
+   uint64_t pos = __atomic_load_n (&mbox->w, __ATOMIC_RELAXED);
+   int64_t diff;
+
+   for (;;)
+   {
+      slot = &mbox->slot[pos % mbox->size];
+      diff = (int64_t)(__atomic_load_n (&slot->seq, __ATOMIC_ACQUIRE) - pos);
+      if (diff == 0)
+      {
+         if (__atomic_compare_exchange_n (&mbox->w, &pos, pos + 1, true,
+               __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+         {
+            break;
+         }
+      }
+      else if (diff < 0)
+      {
+         return false;  /* Full */
+      }
+      else
+      {
+         pos = __atomic_load_n (&mbox->w, __ATOMIC_RELAXED);
+      }
+   }
+
+   slot->msg = msg;
+   __atomic_store_n (&slot->seq, pos + 1, __ATOMIC_RELEASE);
+   return true;
+}
+
+static bool os_mbox_try_fetch (os_mbox_t * mbox, void ** msg)
+{
+   os_mbox_slot_t * slot;
+   uint64_t pos = __atomic_load_n (&mbox->r, __ATOMIC_RELAXED);
+   int64_t diff;
+
+   for (;;)
+   {
+      slot = &mbox->slot[pos % mbox->size];
+      diff = (int64_t)(__atomic_load_n (&slot->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+      if (diff == 0)
+      {
+         if (__atomic_compare_exchange_n (&mbox->r, &pos, pos + 1, true,
+               __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+         {
+            break;
+         }
+      }
+      else if (diff < 0)
+      {
+         return false;  /* Empty */
+      }
+      else
+      {
+         pos = __atomic_load_n (&mbox->r, __ATOMIC_RELAXED);
+      }
+   }
+
+   *msg = slot->msg;
+   __atomic_store_n (&slot->seq, pos + mbox->size, __ATOMIC_RELEASE);
+   return true;
+}
+
+static void os_mbox_wake (os_mbox_t * mbox)
+{
+   /* Pairs with the fence in os_mbox_wait() */
+   __atomic_thread_fence (__ATOMIC_SEQ_CST);
+   if ((__atomic_load_n (&mbox->waiters, __ATOMIC_RELAXED) != 0) &&
+       (__atomic_exchange_n (&mbox->waiters, 0, __ATOMIC_SEQ_CST) != 0))
+   {
+      __atomic_fetch_add (&mbox->futex, 1, __ATOMIC_SEQ_CST);
+      syscall (SYS_futex, &mbox->futex, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+   }
+}
+
+/* Returns 1 on timeout */
+static int os_mbox_wait (
+   os_mbox_t * mbox,
+   bool (*try_op) (os_mbox_t *, void *),
+   void * arg,
+   uint32_t time)
+{
+   struct timespec ts;
+   uint64_t nsec = (uint64_t)time * 1000 * 1000;
+   uint32_t val;
+   int error = 0;
+
+   if (time == 0)
+   {
+      return 1;
+   }
+
+   if (time != OS_WAIT_FOREVER)
+   {
+      clock_gettime (CLOCK_MONOTONIC, &ts);
+      nsec += ts.tv_nsec;
+
+      ts.tv_sec += nsec / NSECS_PER_SEC;
+      ts.tv_nsec = nsec % NSECS_PER_SEC;
+   }
+
+   for (;;)
+   {
+      val = __atomic_load_n (&mbox->futex, __ATOMIC_SEQ_CST);
+      __atomic_store_n (&mbox->waiters, 1, __ATOMIC_SEQ_CST);
+      __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+      /* A stale waiters flag only costs one extra wake-up call */
+      if (try_op (mbox, arg) == true)
+      {
+         return 0;
+      }
+      if (error)
+      {
+         return 1;
+      }
+
+      /* Absolute CLOCK_MONOTONIC timeout */
+      if ((syscall (SYS_futex, &mbox->futex, FUTEX_WAIT_BITSET_PRIVATE, val,
+            (time == OS_WAIT_FOREVER) ? NULL : &ts, NULL, FUTEX_BITSET_MATCH_ANY) != 0) &&
+          (errno == ETIMEDOUT))
+      {
+         error = 1;  /* Try once more */
+      }
+   }
+}
+
+static bool os_mbox_try_post_op (os_mbox_t * mbox, void * arg)
+{
+   return os_mbox_try_post (mbox, *(void **)arg);
+}
+
+static bool os_mbox_try_fetch_op (os_mbox_t * mbox, void * arg)
+{
+   return os_mbox_try_fetch (mbox, (void **)arg);
+}
+
+os_mbox_t * os_mbox_create (size_t size)
+{
+   os_mbox_t * mbox;
+   size_t ix;
+
+   if (posix_memalign ((void **)&mbox, 64, sizeof(*mbox) + size * sizeof(os_mbox_slot_t)) != 0)
+   {
+      return NULL;
+   }
+
+   mbox->w       = 0;
+   mbox->r       = 0;
+   mbox->futex   = 0;
+   mbox->waiters = 0;
+   mbox->size    = size;
+   for (ix = 0; ix < size; ix++)
+   {
+      mbox->slot[ix].seq = ix;
+      mbox->slot[ix].msg = NULL;
+   }
+
+   return mbox;
+}
+
+int os_mbox_fetch (os_mbox_t * mbox, void ** msg, uint32_t time)
+{
+   int error = 0;
+
+   if (os_mbox_try_fetch (mbox, msg) == false)
+   {
+      error = os_mbox_wait (mbox, os_mbox_try_fetch_op, msg, time);
+   }
+
+   if (error == 0)
+   {
+      /* A poster may be waiting for room */
+      os_mbox_wake (mbox);
+   }
+
+   return error;
+}
+
+int os_mbox_post (os_mbox_t * mbox, void * msg, uint32_t time)
+{
+   int error = 0;
+
+   if (os_mbox_try_post (mbox, msg) == false)
+   {
+      error = os_mbox_wait (mbox, os_mbox_try_post_op, &msg, time);
+   }
+
+   if (error == 0)
+   {
+      os_mbox_wake (mbox);
+   }
+
+   return error;
+}
+
+void os_mbox_destroy (os_mbox_t * mbox)
+{
+   free (mbox);
+}
+
+#else
+
 os_mbox_t * os_mbox_create (size_t size)
 {
    os_mbox_t * mbox;
    pthread_mutexattr_t attr;
+   pthread_condattr_t cattr;
 
    mbox = (os_mbox_t *)malloc (sizeof(*mbox) + size * sizeof(void *));
 
-   pthread_cond_init (&mbox->cond, NULL);
+   /* The timeouts are computed on CLOCK_MONOTONIC */
+   pthread_condattr_init (&cattr);
+   pthread_condattr_setclock (&cattr, CLOCK_MONOTONIC);
+   pthread_cond_init (&mbox->cond, &cattr);
    pthread_mutexattr_init (&attr);
    pthread_mutexattr_setprotocol (&attr, PTHREAD_PRIO_INHERIT);
    pthread_mutex_init (&mbox->mutex, &attr);
@@ -423,27 +847,53 @@ void os_mbox_destroy (os_mbox_t * mbox)
    free (mbox);
 }
 
-static void os_timer_thread (void * arg)
+#endif
+
+/* Absolute CLOCK_MONOTONIC time, us from now */
+static void os_deadline (struct timespec * ts, uint32_t us)
 {
-   os_timer_t * timer = arg;
-   sigset_t sigset;
-   siginfo_t si;
-   struct timespec tmo;
+   uint64_t nsec;
+
+   clock_gettime (CLOCK_MONOTONIC, ts);
+   nsec = (uint64_t)ts->tv_nsec + (uint64_t)us * 1000;
+   ts->tv_sec += nsec / NSECS_PER_SEC;
+   ts->tv_nsec = nsec % NSECS_PER_SEC;
+}
 
-   timer->thread_id = (pid_t)syscall (SYS_gettid);
+/* Arm a timerfd with absolute deadlines. The kernel adds the interval to the
+ * previous deadline, not to the time the timer was read. */
+static int os_timerfd_start (int fd, uint32_t us, bool oneshot)
+{
+   struct itimerspec its;
 
-   /* Add SIGALRM */
-   sigemptyset (&sigset);
-   sigprocmask (SIG_BLOCK, &sigset, NULL);
-   sigaddset(&sigset, SIGALRM);
+   os_deadline (&its.it_value, us);
+   its.it_interval.tv_sec = (oneshot) ? 0 : us / USECS_PER_SEC;
+   its.it_interval.tv_nsec = (oneshot) ? 0 : (us % USECS_PER_SEC) * 1000;
+   return timerfd_settime (fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
 
-   tmo.tv_sec = 0;
-   tmo.tv_nsec = 500 * 1000 * 1000;
+static void os_timerfd_stop (int fd)
+{
+   struct itimerspec its;
+
+   memset (&its, 0, sizeof(its));
+   timerfd_settime (fd, 0, &its, NULL);
+}
+
+static void os_timer_thread (void * arg)
+{
+   os_timer_t * timer = arg;
+   struct pollfd pfd;
+   uint64_t expirations;
+
+   pfd.fd = timer->fd;
+   pfd.events = POLLIN;
 
    while (!timer->exit)
    {
-      int sig = sigtimedwait (&sigset, &si, &tmo);
-      if (sig == SIGALRM)
+      /* Check the exit flag at least every 500 ms */
+      if ((poll (&pfd, 1, 500) == 1) &&
+          (read (timer->fd, &expirations, sizeof(expirations)) == sizeof(expirations)))
       {
          if (timer->fn)
             timer->fn (timer, timer->arg);
@@ -455,44 +905,31 @@ os_timer_t * os_timer_create (uint32_t us, void (*fn) (os_timer_t *, void * arg)
                               void * arg, bool oneshot)
 {
    os_timer_t * timer;
-   struct sigevent sev;
-   sigset_t sigset;
-
-   /* Block SIGALRM in calling thread */
-   sigemptyset (&sigset);
-   sigaddset (&sigset, SIGALRM);
-   sigprocmask (SIG_BLOCK, &sigset, NULL);
 
    timer = (os_timer_t *)malloc (sizeof(*timer));
 
    timer->exit      = false;
-   timer->thread_id = 0;
    timer->fn        = fn;
    timer->arg       = arg;
    timer->us        = us;
    timer->oneshot   = oneshot;
 
+   timer->fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   if (timer->fd < 0)
+   {
+      free (timer);
+      return NULL;
+   }
+
    /* Create timer thread */
    timer->thread = os_thread_create ("os_timer", TIMER_PRIO, 1024,
                                      os_timer_thread,timer);
    if (timer->thread == NULL)
-      return NULL;
-
-   /* Wait until timer thread sets its (kernel) thread id */
-   do
    {
-      sched_yield();
-   } while (timer->thread_id == 0);
-
-   /* Create timer */
-   sev.sigev_notify = SIGEV_THREAD_ID;
-   sev.sigev_value.sival_ptr = timer;
-   sev._sigev_un._tid = timer->thread_id;
-   sev.sigev_signo = SIGALRM;
-   sev.sigev_notify_attributes = NULL;
-
-   if (timer_create (CLOCK_MONOTONIC, &sev, &timer->timerid) == -1)
+      close (timer->fd);
+      free (timer);
       return NULL;
+   }
 
    return timer;
 }
@@ -504,49 +941,309 @@ void os_timer_set (os_timer_t * timer, uint32_t us)
 
 void os_timer_start (os_timer_t * timer)
 {
-   struct itimerspec its;
-
-   /* Start timer */
-   its.it_value.tv_sec = 0;
-   its.it_value.tv_nsec = 1000 * timer->us;
-   its.it_interval.tv_sec = (timer->oneshot) ? 0 : its.it_value.tv_sec;
-   its.it_interval.tv_nsec = (timer->oneshot) ? 0 : its.it_value.tv_nsec;
-   timer_settime (timer->timerid, 0, &its, NULL);
+   os_timerfd_start (timer->fd, timer->us, timer->oneshot);
 }
 
 void os_timer_stop (os_timer_t * timer)
 {
-   struct itimerspec its;
-
-   /* Stop timer */
-   its.it_value.tv_sec = 0;
-   its.it_value.tv_nsec = 0;
-   its.it_interval.tv_sec = 0;
-   its.it_interval.tv_nsec = 0;
-   timer_settime (timer->timerid, 0, &its, NULL);
+   os_timerfd_stop (timer->fd);
 }
 
 void os_timer_destroy (os_timer_t * timer)
 {
    timer->exit = true;
    pthread_join (*timer->thread, NULL);
-   timer_delete (timer->timerid);
+   close (timer->fd);
+   free (timer->thread);
    free (timer);
 }
 
+os_loop_t * os_loop_create (void)
+{
+   os_loop_t * loop;
+   struct epoll_event ev;
+   int ix;
+
+   loop = (os_loop_t *)calloc (1, sizeof(*loop));
+   if (loop == NULL)
+      return NULL;
+
+   for (ix = 0; ix < OS_LOOP_MAX_FDS; ix++)
+   {
+      loop->fds[ix].fd = -1;
+   }
+
+   loop->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+   loop->timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   if ((loop->epoll_fd < 0) || (loop->timer_fd < 0))
+   {
+      goto error;
+   }
+
+   ev.events = EPOLLIN;
+   ev.data.u32 = OS_LOOP_MAX_FDS;      /* The tick */
+   if (epoll_ctl (loop->epoll_fd, EPOLL_CTL_ADD, loop->timer_fd, &ev) != 0)
+   {
+      goto error;
+   }
+
+   return loop;
+
+error:
+   if (loop->epoll_fd >= 0)
+      close (loop->epoll_fd);
+   if (loop->timer_fd >= 0)
+      close (loop->timer_fd);
+   free (loop);
+   return NULL;
+}
+
+int os_loop_set_tick (os_loop_t * loop, uint32_t us, os_loop_fn_t * fn, void * arg)
+{
+   loop->tick_fn = fn;
+   loop->tick_arg = arg;
+
+   if (us == 0)
+   {
+      os_timerfd_stop (loop->timer_fd);
+      return 0;
+   }
+   return os_timerfd_start (loop->timer_fd, us, false);
+}
+
+int os_loop_add_fd (os_loop_t * loop, int fd, os_loop_fn_t * fn, void * arg)
+{
+   struct epoll_event ev;
+   int ix;
+
+   for (ix = 0; ix < OS_LOOP_MAX_FDS; ix++)
+   {
+      if (loop->fds[ix].fd == -1)
+      {
+         /* Edge triggered: Called when data arrives, not while there is data */
+         ev.events = EPOLLIN | EPOLLET;
+         ev.data.u32 = ix;
+         if (epoll_ctl (loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
+         {
+            return -1;
+         }
+         loop->fds[ix].fd = fd;
+         loop->fds[ix].fn = fn;
+         loop->fds[ix].arg = arg;
+         return 0;
+      }
+   }
+
+   return -1;
+}
+
+void os_loop_remove_fd (os_loop_t * loop, int fd)
+{
+   int ix;
+
+   for (ix = 0; ix < OS_LOOP_MAX_FDS; ix++)
+   {
+      if (loop->fds[ix].fd == fd)
+      {
+         epoll_ctl (loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+         loop->fds[ix].fd = -1;
+      }
+   }
+}
+
+int os_loop_run_once (os_loop_t * loop, uint32_t time)
+{
+   struct epoll_event ev[OS_LOOP_MAX_FDS + 1];
+   uint64_t expirations;
+   uint32_t ix;
+   int n;
+
+   do
+   {
+      n = epoll_wait (loop->epoll_fd, ev, NELEMENTS (ev),
+            (time == OS_WAIT_FOREVER) ? -1 : (int)time);
+   } while ((n < 0) && (errno == EINTR));
+
+   if (n < 0)
+   {
+      return -1;
+   }
+   if (n == 0)
+   {
+      return 1;
+   }
+
+   for (ix = 0; ix < (uint32_t)n; ix++)
+   {
+      if (ev[ix].data.u32 == OS_LOOP_MAX_FDS)
+      {
+         if (read (loop->timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+         {
+            loop->ticks++;
+            loop->missed_ticks += (uint32_t)(expirations - 1);
+            if (loop->tick_fn != NULL)
+            {
+               loop->tick_fn (loop->tick_arg);
+            }
+         }
+      }
+      else if (loop->fds[ev[ix].data.u32].fd != -1)
+      {
+         loop->fds[ev[ix].data.u32].fn (loop->fds[ev[ix].data.u32].arg);
+      }
+   }
+
+   return 0;
+}
+
+void os_loop_destroy (os_loop_t * loop)
+{
+   close (loop->timer_fd);
+   close (loop->epoll_fd);
+   free (loop);
+}
+
 uint32_t    os_buf_alloc_cnt = 0; /* Count outstanding buffers */
 
+#if OS_BUF_POOL_SIZE > 0
+
+CC_STATIC_ASSERT (OS_BUF_POOL_SIZE < 0xffff);
+
+#define OS_BUF_POOL_NONE   0xffff
+
+/* Pool entries are cache line aligned, to avoid false sharing between
+ * buffers used by different threads */
+typedef struct os_buf_pool_entry
+{
+   os_buf_t    buf;
+   uint32_t    next;
+   uint8_t     payload[OS_BUF_MAX_SIZE];
+} __attribute__((aligned (64))) os_buf_pool_entry_t;
+
+static os_buf_pool_entry_t os_buf_pool[OS_BUF_POOL_SIZE];
+
+/* Free list head: Pop count in the upper half (avoids ABA), index in the lower */
+static uint32_t   os_buf_pool_free = OS_BUF_POOL_NONE;
+static uint32_t   os_buf_pool_unused = 0;      /* Never used entries start here */
+static uint32_t   os_buf_pool_in_use = 0;
+static uint32_t   os_buf_pool_high_water = 0;
+static uint32_t   os_buf_pool_exhausted = 0;
+
+static os_buf_t * os_buf_pool_get (void)
+{
+   uint32_t head = CC_ATOMIC_GET32 (&os_buf_pool_free);
+   uint32_t ix;
+   uint32_t in_use;
+   uint32_t high_water;
+
+   while (true)
+   {
+      ix = head & 0xffff;
+      if (ix == OS_BUF_POOL_NONE)
+      {
+         /* Free list empty - take a never used entry. The counter stops
+          * at the pool size, so it never wraps */
+         ix = CC_ATOMIC_GET32 (&os_buf_pool_unused);
+         if (ix >= OS_BUF_POOL_SIZE)
+         {
+            __atomic_fetch_add (&os_buf_pool_exhausted, 1, __ATOMIC_SEQ_CST);
+            return NULL;
+         }
+         if (CC_ATOMIC_CAS32 (&os_buf_pool_unused, ix, ix + 1) == true)
+         {
+            break;
+         }
+      }
+      else if (CC_ATOMIC_CAS32 (&os_buf_pool_free, head,
+            ((head + 0x10000) & 0xffff0000) | os_buf_pool[ix].next) == true)
+      {
+         break;
+      }
+      head = CC_ATOMIC_GET32 (&os_buf_pool_free);
+   }
+
+   in_use = __atomic_add_fetch (&os_buf_pool_in_use, 1, __ATOMIC_SEQ_CST);
+   high_water = CC_ATOMIC_GET32 (&os_buf_pool_high_water);
+   while ((in_use > high_water) &&
+          (CC_ATOMIC_CAS32 (&os_buf_pool_high_water, high_water, in_use) == false))
+   {
+      high_water = CC_ATOMIC_GET32 (&os_buf_pool_high_water);
+   }
+
+   return &os_buf_pool[ix].buf;
+}
+
+static bool os_buf_pool_put (os_buf_t * p)
+{
+   os_buf_pool_entry_t * p_entry = (os_buf_pool_entry_t *)p;
+   uint32_t head;
+   uint32_t ix;
+
+   if (((uintptr_t)p_entry < (uintptr_t)&os_buf_pool[0]) ||
+       ((uintptr_t)p_entry >= (uintptr_t)&os_buf_pool[OS_BUF_POOL_SIZE]))
+   {
+      return false;
+   }
+
+   ix = p_entry - &os_buf_pool[0];
+   do
+   {
+      head = CC_ATOMIC_GET32 (&os_buf_pool_free);
+      p_entry->next = head & 0xffff;
+   } while (CC_ATOMIC_CAS32 (&os_buf_pool_free, head, (head & 0xffff0000) | ix) == false);
+
+   __atomic_sub_fetch (&os_buf_pool_in_use, 1, __ATOMIC_SEQ_CST);
+
+   return true;
+}
+
+void os_buf_pool_get_stats (os_buf_pool_stats_t * p_stats)
+{
+   p_stats->size = OS_BUF_POOL_SIZE;
+   p_stats->in_use = CC_ATOMIC_GET32 (&os_buf_pool_in_use);
+   p_stats->high_water = CC_ATOMIC_GET32 (&os_buf_pool_high_water);
+   p_stats->exhausted = CC_ATOMIC_GET32 (&os_buf_pool_exhausted);
+}
+
+#else
+
+void os_buf_pool_get_stats (os_buf_pool_stats_t * p_stats)
+{
+   memset (p_stats, 0, sizeof (*p_stats));
+}
+
+#endif
+
 os_buf_t * os_buf_alloc(uint16_t length)
 {
-   os_buf_t *p = malloc(sizeof(os_buf_t) + length);
+   os_buf_t *p = NULL;
+
+#if OS_BUF_POOL_SIZE > 0
+   if (length <= OS_BUF_MAX_SIZE)
+   {
+      p = os_buf_pool_get();
+   }
+#endif
+
+   if (p == NULL)
+   {
+      p = malloc(sizeof(os_buf_t) + length);
+      if (p != NULL)
+      {
+         p->payload = (void *)((uint8_t *)p + sizeof(os_buf_t));  /* Payload follows header struct */
+      }
+   }
+#if OS_BUF_POOL_SIZE > 0
+   else
+   {
+      p->payload = ((os_buf_pool_entry_t *)p)->payload;
+   }
+#endif
 
    if (p != NULL)
    {
-#if 1
-      p->payload = (void *)((uint8_t *)p + sizeof(os_buf_t));  /* Payload follows header struct */
       p->len = length;
-#endif
-      os_buf_alloc_cnt++;
+      __atomic_add_fetch (&os_buf_alloc_cnt, 1, __ATOMIC_SEQ_CST);
    }
    else
    {
@@ -558,8 +1255,13 @@ os_buf_t * os_buf_alloc(uint16_t length)
 
 void os_buf_free(os_buf_t *p)
 {
-   free(p);
-   os_buf_alloc_cnt--;
+#if OS_BUF_POOL_SIZE > 0
+   if (os_buf_pool_put(p) == false)
+#endif
+   {
+      free(p);
+   }
+   __atomic_sub_fetch (&os_buf_alloc_cnt, 1, __ATOMIC_SEQ_CST);
    return;
 }
 
@@ -13,6 +13,8 @@
  * full license information.
  ********************************************************************/
 
+#define _GNU_SOURCE
+
 #include "options.h"
 #include "osal.h"
 #include "osal_sys.h"
@@ -25,14 +27,63 @@
 #include <sys/socket.h>
 #include <string.h>
 #include <sys/ioctl.h>
-#include <netpacket/packet.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING   23       /* Linux 4.20 */
+#endif
+#if defined (USE_PACKET_MMAP)
+#include <poll.h>
+#include <sys/mman.h>
+
+/* Both rings use TPACKET_V2. Each received frame is handed to user space,
+ * and back to the kernel, on its own. A block only sets the granularity of
+ * the ring memory. */
+#define OS_ETH_RING_BLOCK_SIZE   (1 << 16)
+#define OS_ETH_RING_FRAME_SIZE   2048
+#define OS_ETH_RX_BLOCK_NR       8
+#define OS_ETH_TX_BLOCK_NR       2
+#define OS_ETH_RX_FRAME_NR       ((OS_ETH_RING_BLOCK_SIZE / OS_ETH_RING_FRAME_SIZE) * OS_ETH_RX_BLOCK_NR)
+#define OS_ETH_TX_FRAME_NR       ((OS_ETH_RING_BLOCK_SIZE / OS_ETH_RING_FRAME_SIZE) * OS_ETH_TX_BLOCK_NR)
+#define OS_ETH_TX_DATA_OFFSET    (TPACKET2_HDRLEN - sizeof(struct sockaddr_ll))
+#endif
+
 
+/* Kernel filter for the RX socket. Accept Profinet and LLDP frames, with
+ * or without a VLAN tag, and drop everything else before it is copied to
+ * user space. */
+static struct sock_filter os_eth_rx_filter_code[] =
+{
+   BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),                        /* Ethertype */
+   BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, OS_ETHTYPE_VLAN, 0, 1),
+   BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 16),                        /* Ethertype after VLAN tag */
+   BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, OS_ETHTYPE_PROFINET, 1, 0),
+   BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, OS_ETHTYPE_LLDP, 0, 1),
+   BPF_STMT(BPF_RET | BPF_K, 0xFFFF),                             /* Accept */
+   BPF_STMT(BPF_RET | BPF_K, 0),                                  /* Drop */
+};
+
+static const struct sock_fprog os_eth_rx_filter =
+{
+   .len = NELEMENTS(os_eth_rx_filter_code),
+   .filter = os_eth_rx_filter_code,
+};
+
+#if defined (USE_PACKET_MMAP)
 
 /**
  * @internal
- * Run a thread that listens to incoming raw Ethernet sockets.
+ * Run a thread that listens to incoming raw Ethernet frames in a memory
+ * mapped ring.
  * Delegate the actual work to thread_arg->callback
  *
+ * Each frame is copied from the ring to a buffer before it is passed to the
+ * callback, as the stack may keep received buffers for a long time (CPM).
+ * The ring slot is then given back to the kernel. All frames that are ready
+ * are handled before the thread sleeps in poll() again.
+ *
  * This is a function to be passed into os_thread_create()
  * Do not change the argument types.
  *
@@ -42,36 +93,239 @@ static void os_eth_task(
    void *                  thread_arg)
 {
    os_eth_handle_t         *eth_handle = thread_arg;
-   ssize_t                 readlen;
+   struct pollfd           pfd;
+   struct tpacket2_hdr     *p_frame;
+   struct sockaddr_ll      *p_sll;
+   uint32_t                frame = 0;
+   uint32_t                cnt;
+   bool                    outgoing;
    int                     handled = 0;
 
    os_buf_t *p = os_buf_alloc(OS_BUF_MAX_SIZE);
    assert(p != NULL);
 
+   pfd.fd = eth_handle->socket;
+   pfd.events = POLLIN | POLLERR;
+   pfd.revents = 0;
+
    while (1)
    {
-      readlen = recv(eth_handle->socket, p->payload, p->len, 0);
-      if(readlen == -1)
-         continue;
-      p->len = readlen;
+      cnt = 0;
+      p_frame = (struct tpacket2_hdr *)(eth_handle->rx_ring + frame * OS_ETH_RING_FRAME_SIZE);
+      while ((CC_ATOMIC_GET32(&p_frame->tp_status) & TP_STATUS_USER) != 0)
+      {
+         cnt++;
 
-      if (eth_handle->callback != NULL)
+         /* Our own frames, if PACKET_IGNORE_OUTGOING is not supported */
+         p_sll = (struct sockaddr_ll *)((uint8_t *)p_frame + TPACKET_ALIGN(sizeof(struct tpacket2_hdr)));
+         outgoing = (p_sll->sll_pkttype == PACKET_OUTGOING);
+         if (outgoing == true)
+         {
+            eth_handle->stats.rx_outgoing++;
+         }
+         else
+         {
+            p->len = p_frame->tp_snaplen;
+            if (p->len > OS_BUF_MAX_SIZE)
+            {
+               p->len = OS_BUF_MAX_SIZE;
+            }
+            memcpy(p->payload, (uint8_t *)p_frame + p_frame->tp_mac, p->len);
+         }
+
+         /* Give the slot back to the kernel */
+         CC_ATOMIC_SET32(&p_frame->tp_status, TP_STATUS_KERNEL);
+         frame = (frame + 1) % OS_ETH_RX_FRAME_NR;
+
+         if (outgoing == false)
+         {
+            if (eth_handle->callback != NULL)
+            {
+               handled = eth_handle->callback(eth_handle->arg, p);
+            }
+            else
+            {
+               handled = 0;
+            }
+
+            if (handled == 1)
+            {
+               p = os_buf_alloc(OS_BUF_MAX_SIZE);
+               assert(p != NULL);
+            }
+            else
+            {
+               eth_handle->stats.rx_unhandled++;
+            }
+         }
+
+         p_frame = (struct tpacket2_hdr *)(eth_handle->rx_ring + frame * OS_ETH_RING_FRAME_SIZE);
+      }
+
+      if (cnt > 0)
       {
-         handled = eth_handle->callback(eth_handle->arg, p);
+         eth_handle->stats.rx_calls++;
+         eth_handle->stats.rx_frames += cnt;
+         if (cnt > eth_handle->stats.rx_batch_max)
+         {
+            eth_handle->stats.rx_batch_max = cnt;
+         }
       }
-      else
+
+      if (poll(&pfd, 1, -1) < 0)
       {
-         handled = 0;
+         eth_handle->stats.rx_errors++;
       }
+   }
+}
 
-      if (handled == 1)
+/**
+ * @internal
+ * Set up the receive and transmit rings.
+ *
+ * Both rings belong to the receive socket, and are mapped as one area with
+ * the transmit ring after the receive ring.
+ * @param handle           InOut: The Ethernet handle. The socket must be open.
+ * @return  0  if the rings could be mapped.
+ *          -1 if an error occurred.
+ */
+static int os_eth_ring_init(
+   os_eth_handle_t         *handle)
+{
+   int                     version = TPACKET_V2;
+   struct tpacket_req      rx_req;
+   struct tpacket_req      tx_req;
+
+   memset(&rx_req, 0, sizeof(rx_req));
+   rx_req.tp_block_size = OS_ETH_RING_BLOCK_SIZE;
+   rx_req.tp_block_nr = OS_ETH_RX_BLOCK_NR;
+   rx_req.tp_frame_size = OS_ETH_RING_FRAME_SIZE;
+   rx_req.tp_frame_nr = OS_ETH_RX_FRAME_NR;
+
+   memset(&tx_req, 0, sizeof(tx_req));
+   tx_req.tp_block_size = OS_ETH_RING_BLOCK_SIZE;
+   tx_req.tp_block_nr = OS_ETH_TX_BLOCK_NR;
+   tx_req.tp_frame_size = OS_ETH_RING_FRAME_SIZE;
+   tx_req.tp_frame_nr = OS_ETH_TX_FRAME_NR;
+
+   if ((setsockopt(handle->socket, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) ||
+       (setsockopt(handle->socket, SOL_PACKET, PACKET_RX_RING, &rx_req, sizeof(rx_req)) != 0) ||
+       (setsockopt(handle->socket, SOL_PACKET, PACKET_TX_RING, &tx_req, sizeof(tx_req)) != 0))
+   {
+      LOG_ERROR(PF_ETH_LOG, "ETH(%d): PACKET_RX_RING/PACKET_TX_RING failed: %s\n", __LINE__, strerror(errno));
+      return -1;
+   }
+   handle->rx_ring = mmap(NULL, OS_ETH_RING_BLOCK_SIZE * (OS_ETH_RX_BLOCK_NR + OS_ETH_TX_BLOCK_NR),
+      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, handle->socket, 0);
+   if (handle->rx_ring == MAP_FAILED)
+   {
+      LOG_ERROR(PF_ETH_LOG, "ETH(%d): Ring mmap failed: %s\n", __LINE__, strerror(errno));
+      return -1;
+   }
+   handle->tx_ring = handle->rx_ring + OS_ETH_RING_BLOCK_SIZE * OS_ETH_RX_BLOCK_NR;
+   handle->tx_frame = 0;
+   handle->tx_lock = os_mutex_create();
+
+   return 0;
+}
+
+#else
+
+/**
+ * @internal
+ * Run a thread that listens to incoming raw Ethernet sockets.
+ * Delegate the actual work to thread_arg->callback
+ *
+ * Up to OS_ETH_RX_BATCH frames are read by each recvmmsg() call, into a
+ * ring of buffers. Buffers consumed by the callback are replaced by new
+ * ones, the others are reused for the next call.
+ *
+ * This is a function to be passed into os_thread_create()
+ * Do not change the argument types.
+ *
+ * @param thread_arg     InOut: Will be converted to os_eth_handle_t
+ */
+static void os_eth_task(
+   void *                  thread_arg)
+{
+   os_eth_handle_t         *eth_handle = thread_arg;
+   int                     cnt;
+   int                     ix;
+   int                     handled = 0;
+   os_buf_t                *p[OS_ETH_RX_BATCH];
+   struct iovec            iov[OS_ETH_RX_BATCH];
+   struct sockaddr_ll      sll[OS_ETH_RX_BATCH];
+   struct mmsghdr          msgs[OS_ETH_RX_BATCH];
+
+   memset(msgs, 0, sizeof(msgs));
+   for (ix = 0; ix < OS_ETH_RX_BATCH; ix++)
+   {
+      p[ix] = os_buf_alloc(OS_BUF_MAX_SIZE);
+      assert(p[ix] != NULL);
+      msgs[ix].msg_hdr.msg_iov = &iov[ix];
+      msgs[ix].msg_hdr.msg_iovlen = 1;
+      msgs[ix].msg_hdr.msg_name = &sll[ix];
+   }
+
+   while (1)
+   {
+      for (ix = 0; ix < OS_ETH_RX_BATCH; ix++)
+      {
+         iov[ix].iov_base = p[ix]->payload;
+         iov[ix].iov_len = OS_BUF_MAX_SIZE;
+         msgs[ix].msg_hdr.msg_namelen = sizeof(sll[ix]);
+      }
+
+      /* Block for the first frame, then take what is already queued */
+      cnt = recvmmsg(eth_handle->socket, msgs, OS_ETH_RX_BATCH, MSG_WAITFORONE, NULL);
+      if (cnt <= 0)
       {
-         p = os_buf_alloc(OS_BUF_MAX_SIZE);
-         assert(p != NULL);
+         eth_handle->stats.rx_errors++;
+         continue;
+      }
+
+      eth_handle->stats.rx_calls++;
+      eth_handle->stats.rx_frames += cnt;
+      if ((uint32_t)cnt > eth_handle->stats.rx_batch_max)
+      {
+         eth_handle->stats.rx_batch_max = cnt;
+      }
+
+      for (ix = 0; ix < cnt; ix++)
+      {
+         /* Our own frames, if PACKET_IGNORE_OUTGOING is not supported */
+         if (sll[ix].sll_pkttype == PACKET_OUTGOING)
+         {
+            eth_handle->stats.rx_outgoing++;
+            continue;
+         }
+
+         p[ix]->len = msgs[ix].msg_len;
+
+         if (eth_handle->callback != NULL)
+         {
+            handled = eth_handle->callback(eth_handle->arg, p[ix]);
+         }
+         else
+         {
+            handled = 0;
+         }
+
+         if (handled == 1)
+         {
+            p[ix] = os_buf_alloc(OS_BUF_MAX_SIZE);
+            assert(p[ix] != NULL);
+         }
+         else
+         {
+            eth_handle->stats.rx_unhandled++;
+         }
       }
    }
 }
 
+#endif
+
 os_eth_handle_t* os_eth_init(
    const char              *if_name,
    os_eth_callback_t       *callback,
@@ -85,9 +339,25 @@ os_eth_handle_t* os_eth_init(
    struct timeval          timeout;
 
    handle = malloc(sizeof(os_eth_handle_t));
+   memset(&handle->stats, 0, sizeof(handle->stats));
    handle->arg = arg;
    handle->callback = callback;
-   handle->socket = socket(PF_PACKET, SOCK_RAW, htons(OS_ETHTYPE_PROFINET));
+   /* Receive all protocols, and let the kernel filter out everything but
+    * Profinet and LLDP */
+   handle->socket = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+   if (setsockopt(handle->socket, SOL_SOCKET, SO_ATTACH_FILTER, &os_eth_rx_filter, sizeof(os_eth_rx_filter)) != 0)
+   {
+      /* Still works, but all frames on the interface reach user space */
+      LOG_ERROR(PF_ETH_LOG, "ETH(%d): SO_ATTACH_FILTER failed: %s\n", __LINE__, strerror(errno));
+   }
+
+   /* Do not receive the frames we send ourselves. Older kernels do not
+    * support this, so the receive thread also drops them. */
+   i = 1;
+   if (setsockopt(handle->socket, SOL_PACKET, PACKET_IGNORE_OUTGOING, &i, sizeof(i)) != 0)
+   {
+      LOG_INFO(PF_ETH_LOG, "ETH(%d): PACKET_IGNORE_OUTGOING not supported\n", __LINE__);
+   }
 
    timeout.tv_sec = 0;
    timeout.tv_usec = 1;
@@ -109,13 +379,17 @@ os_eth_handle_t* os_eth_init(
    ifr.ifr_flags = ifr.ifr_flags | IFF_PROMISC | IFF_BROADCAST;
    ioctl(handle->socket, SIOCSIFFLAGS, &ifr);
 
-   /* bind socket to protocol, in this case Profinet */
+   /* bind socket to the interface, the filter selects Profinet and LLDP */
    sll.sll_family = AF_PACKET;
    sll.sll_ifindex = ifindex;
-   sll.sll_protocol = htons(OS_ETHTYPE_PROFINET);
+   sll.sll_protocol = htons(ETH_P_ALL);
    bind(handle->socket, (struct sockaddr *)&sll, sizeof(sll));
 
+#if defined (USE_PACKET_MMAP)
+   if ((handle->socket > -1) && (os_eth_ring_init(handle) == 0))
+#else
    if (handle->socket > -1)
+#endif
    {
       handle->thread = os_thread_create ("os_eth_task", 10,
               4096, os_eth_task, handle);
@@ -132,7 +406,59 @@ int os_eth_send(
    os_eth_handle_t      *handle,
    os_buf_t             *buf)
 {
+#if defined (USE_PACKET_MMAP)
+   struct tpacket2_hdr  *p_hdr;
+   uint32_t             status;
+   int                  ret = -1;
+
+   if (buf->len > OS_ETH_RING_FRAME_SIZE - OS_ETH_TX_DATA_OFFSET)
+   {
+      return -1;
+   }
+
+   os_mutex_lock(handle->tx_lock);
+   p_hdr = (struct tpacket2_hdr *)(handle->tx_ring + handle->tx_frame * OS_ETH_RING_FRAME_SIZE);
+   status = CC_ATOMIC_GET32(&p_hdr->tp_status);
+   if ((status == TP_STATUS_AVAILABLE) || (status == TP_STATUS_WRONG_FORMAT))
+   {
+      memcpy((uint8_t *)p_hdr + OS_ETH_TX_DATA_OFFSET, buf->payload, buf->len);
+      p_hdr->tp_len = buf->len;
+      CC_ATOMIC_SET32(&p_hdr->tp_status, TP_STATUS_SEND_REQUEST);
+      handle->tx_frame = (handle->tx_frame + 1) % OS_ETH_TX_FRAME_NR;
+      ret = buf->len;
+   }
+   else
+   {
+      handle->stats.tx_ring_full++;
+   }
+   os_mutex_unlock(handle->tx_lock);
+
+   /* Tell the kernel to send all queued frames */
+   if (send(handle->socket, NULL, 0, MSG_DONTWAIT) < 0)
+   {
+      ret = -1;
+   }
+
+   return ret;
+#else
    int ret = send(handle->socket, buf->payload, buf->len, 0);
 
    return ret;
+#endif
+}
+
+void os_eth_get_stats(
+   os_eth_handle_t         *handle,
+   os_eth_stats_t          *p_stats)
+{
+   struct tpacket_stats    kstats;
+   socklen_t               len = sizeof(kstats);
+
+   /* The kernel counters are reset when read */
+   if (getsockopt(handle->socket, SOL_PACKET, PACKET_STATISTICS, &kstats, &len) == 0)
+   {
+      handle->stats.rx_dropped += kstats.tp_drops;
+   }
+
+   *p_stats = handle->stats;
 }
@@ -34,6 +34,8 @@ extern "C"
 
 #define OS_BUF_MAX_SIZE 1522
 
+#define OS_LOOP_MAX_FDS 8
+
 typedef pthread_t os_thread_t;
 typedef pthread_mutex_t os_mutex_t;
 
@@ -51,6 +53,25 @@ typedef struct os_event
    uint32_t flags;
 } os_event_t;
 
+#if defined (USE_LOCKFREE_MBOX)
+typedef struct os_mbox_slot
+{
+   uint64_t seq;
+   void * msg;
+} os_mbox_slot_t;
+
+/* Bounded ring with one sequence number per slot. Threads only enter the
+ * kernel when the mailbox is empty (fetch) or full (post). */
+typedef struct os_mbox
+{
+   uint64_t w __attribute__((aligned (64)));
+   uint64_t r __attribute__((aligned (64)));
+   uint32_t futex __attribute__((aligned (64)));   /* Bumped to wake waiters */
+   uint32_t waiters;                               /* Non-zero if any thread sleeps */
+   uint32_t size;
+   os_mbox_slot_t slot[];
+} os_mbox_t;
+#else
 typedef struct os_mbox
 {
    pthread_cond_t cond;
@@ -61,12 +82,12 @@ typedef struct os_mbox
    size_t size;
    void * msg[];
 } os_mbox_t;
+#endif
 
 typedef struct os_timer
 {
-   timer_t timerid;
+   int fd;                       /* timerfd */
    os_thread_t * thread;
-   pid_t thread_id;
    bool exit;
    void(*fn) (struct os_timer *, void * arg);
    void * arg;
@@ -80,6 +101,149 @@ typedef struct os_buf
    uint16_t len;
 } os_buf_t;
 
+typedef struct os_buf_pool_stats
+{
+   uint32_t size;          /* Number of buffers in the pool */
+   uint32_t in_use;        /* Pool buffers currently allocated */
+   uint32_t high_water;    /* Max pool buffers allocated at the same time */
+   uint32_t exhausted;     /* Allocations done with malloc() as the pool was empty */
+} os_buf_pool_stats_t;
+
+/**
+ * Get the statistics of the frame buffer pool.
+ *
+ * Buffers up to OS_BUF_MAX_SIZE bytes are taken from a pool of
+ * OS_BUF_POOL_SIZE preallocated buffers. Larger buffers, and all buffers
+ * when the pool is empty, are allocated with malloc().
+ *
+ * @param p_stats          Out:  The pool statistics.
+ */
+void os_buf_pool_get_stats (os_buf_pool_stats_t * p_stats);
+
+typedef struct os_log_stats
+{
+   uint32_t records;       /* Messages put in the log ring */
+   uint32_t written;       /* Messages written to stdout by the log thread */
+   uint32_t dropped;       /* Messages lost as the log ring was full */
+   uint32_t truncated;     /* Messages cut to the record size */
+} os_log_stats_t;
+
+/**
+ * Get the statistics of the deferred log (USE_ASYNC_LOG).
+ *
+ * All counters are zero when messages are written directly by os_log().
+ *
+ * @param p_stats          Out:  The log statistics.
+ */
+void os_log_get_stats (os_log_stats_t * p_stats);
+
+/**
+ * Wait until all messages logged so far have been written to stdout.
+ */
+void os_log_flush (void);
+
+typedef void (os_loop_fn_t) (void * arg);
+
+/**
+ * Event loop for one thread, based on epoll.
+ *
+ * It calls a function at a fixed tick interval, using a timerfd with
+ * absolute deadlines, and a function for each registered file descriptor
+ * that has become readable. This replaces a timer thread that wakes the
+ * main thread with os_event_set() on every tick.
+ */
+typedef struct os_loop
+{
+   int epoll_fd;
+   int timer_fd;
+   os_loop_fn_t * tick_fn;
+   void * tick_arg;
+   uint32_t ticks;               /* Number of tick calls */
+   uint32_t missed_ticks;        /* Ticks lost as the loop was too late */
+   struct
+   {
+      int fd;                    /* -1 if unused */
+      os_loop_fn_t * fn;
+      void * arg;
+   } fds[OS_LOOP_MAX_FDS];
+} os_loop_t;
+
+/**
+ * Create an event loop.
+ *
+ * @return  The loop, or NULL on error.
+ */
+os_loop_t * os_loop_create (void);
+
+/**
+ * Call a function periodically from the loop.
+ *
+ * The first call is made one interval from now. Deadlines are absolute, so
+ * the ticks do not drift if a call is late. Missed deadlines are counted and
+ * only result in one call.
+ *
+ * @param loop             InOut: The loop.
+ * @param us               In:   Tick interval in microseconds. 0 to stop.
+ * @param fn               In:   Function to call every tick.
+ * @param arg              In:   Argument to fn.
+ * @return  0  on success.
+ *          -1 on error.
+ */
+int os_loop_set_tick (os_loop_t * loop, uint32_t us, os_loop_fn_t * fn, void * arg);
+
+/**
+ * Call a function from the loop when a file descriptor becomes readable.
+ *
+ * The function is called when data arrives, not for as long as there is
+ * unread data. It need not read the file descriptor itself.
+ *
+ * @param loop             InOut: The loop.
+ * @param fd               In:   The file descriptor, for instance a socket.
+ * @param fn               In:   Function to call.
+ * @param arg              In:   Argument to fn.
+ * @return  0  on success.
+ *          -1 on error or if OS_LOOP_MAX_FDS are already registered.
+ */
+int os_loop_add_fd (os_loop_t * loop, int fd, os_loop_fn_t * fn, void * arg);
+
+/**
+ * Stop calling the function registered for a file descriptor.
+ *
+ * @param loop             InOut: The loop.
+ * @param fd               In:   The file descriptor.
+ */
+void os_loop_remove_fd (os_loop_t * loop, int fd);
+
+/**
+ * Wait for the next tick or file descriptor event and call the functions.
+ *
+ * @param loop             InOut: The loop.
+ * @param time             In:   Max time to wait in ms, or OS_WAIT_FOREVER.
+ * @return  0  if any function was called.
+ *          1  on timeout.
+ *          -1 on error.
+ */
+int os_loop_run_once (os_loop_t * loop, uint32_t time);
+
+/**
+ * Destroy an event loop. The registered file descriptors are not closed.
+ *
+ * @param loop             InOut: The loop.
+ */
+void os_loop_destroy (os_loop_t * loop);
+
+/**
+ * Dispatch the callbacks of os_udp_set_callback() from an event loop.
+ *
+ * Set the loop before pnet_init(). Without a loop, os_udp_set_callback()
+ * fails and the stack polls its sockets. The sockets use slots of the loop,
+ * see OS_LOOP_MAX_FDS. The callbacks must be set from the thread that runs
+ * the loop, or before the loop runs.
+ *
+ * @param loop             InOut: The loop, or NULL to stop dispatching.
+ */
+void os_udp_set_loop (os_loop_t * loop);
+
 /**
  * The prototype of raw Ethernet reception call-back functions.
  * *
@@ -93,14 +257,48 @@ typedef int (os_eth_callback_t)(
    void                    *arg,
    os_buf_t                *p_buf);
 
+typedef struct os_eth_stats
+{
+   uint32_t                rx_calls;      /* Receive system calls returning frames */
+   uint32_t                rx_frames;     /* Received frames */
+   uint32_t                rx_batch_max;  /* Max frames received by one system call */
+   uint32_t                rx_unhandled;  /* Frames not handled by the callback */
+   uint32_t                rx_outgoing;   /* Own sent frames, dropped */
+   uint32_t                rx_errors;     /* Failed receive system calls */
+   uint32_t                rx_dropped;    /* Frames dropped by the kernel */
+   uint32_t                tx_ring_full;  /* Frames not sent as the TX ring was full */
+} os_eth_stats_t;
+
 typedef struct os_eth_handle
 {
    os_eth_callback_t       *callback;
    void                    *arg;
    int                     socket;
    os_thread_t             *thread;
+   os_eth_stats_t          stats;         /* Updated by the receive thread */
+#if defined (USE_PACKET_MMAP)
+   uint8_t                 *rx_ring;      /* TPACKET_V2 frames */
+   uint8_t                 *tx_ring;      /* TPACKET_V2 frames, after rx_ring */
+   uint32_t                tx_frame;      /* Next frame to use in tx_ring */
+   os_mutex_t              *tx_lock;
+#endif
 } os_eth_handle_t;
 
+/**
+ * Get the receive statistics of a raw Ethernet socket.
+ *
+ * The receive thread reads up to OS_ETH_RX_BATCH frames per system call.
+ * With USE_PACKET_MMAP rx_calls counts the wake-ups of the receive thread
+ * instead.
+ * rx_frames / rx_calls is the average batch size.
+ *
+ * @param handle           In:   The Ethernet handle.
+ * @param p_stats          Out:  The statistics.
+ */
+void os_eth_get_stats(
+   os_eth_handle_t         *handle,
+   os_eth_stats_t          *p_stats);
+
 #ifdef __cplusplus
 }
 #endif
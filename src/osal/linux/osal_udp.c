@@ -18,6 +18,58 @@
 #include <stdio.h>
 #include <unistd.h>
 
+/* Sockets with a callback are dispatched by the event loop of the
+ * application, see os_udp_set_loop() */
+static struct
+{
+   os_loop_t            *loop;
+   struct
+   {
+      int                  fd;      /* -1 if unused */
+      os_udp_callback_t    *callback;
+      void                 *arg;
+   } watch[OS_LOOP_MAX_FDS];
+} os_udp_watch;
+
+static void os_udp_watch_ready(void *arg)
+{
+   int                     ix = (int)(intptr_t)arg;
+
+   if (os_udp_watch.watch[ix].fd != -1)
+   {
+      os_udp_watch.watch[ix].callback(os_udp_watch.watch[ix].fd, os_udp_watch.watch[ix].arg);
+   }
+}
+
+static void os_udp_watch_remove(int fd)
+{
+   int                     ix;
+
+   for (ix = 0; ix < OS_LOOP_MAX_FDS; ix++)
+   {
+      if (os_udp_watch.watch[ix].fd == fd)
+      {
+         os_loop_remove_fd(os_udp_watch.loop, fd);
+         os_udp_watch.watch[ix].fd = -1;
+      }
+   }
+}
+
+void os_udp_set_loop(os_loop_t *loop)
+{
+   int                     ix;
+
+   for (ix = 0; ix < OS_LOOP_MAX_FDS; ix++)
+   {
+      if ((os_udp_watch.loop != NULL) && (os_udp_watch.watch[ix].fd != -1))
+      {
+         os_loop_remove_fd(os_udp_watch.loop, os_udp_watch.watch[ix].fd);
+      }
+      os_udp_watch.watch[ix].fd = -1;
+   }
+   os_udp_watch.loop = loop;
+}
+
 int os_udp_socket(void)
 {
    return socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
@@ -100,7 +152,47 @@ int os_udp_recvfrom(uint32_t id,
    return len;
 }
 
+int os_udp_set_callback(uint32_t id, os_udp_callback_t *callback, void *arg)
+{
+   int                     ret = -1;
+   int                     ix;
+
+   if (os_udp_watch.loop == NULL)
+   {
+      return -1;
+   }
+
+   os_udp_watch_remove(id);
+   if (callback == NULL)
+   {
+      ret = 0;
+   }
+   else
+   {
+      for (ix = 0; ix < OS_LOOP_MAX_FDS; ix++)
+      {
+         if (os_udp_watch.watch[ix].fd == -1)
+         {
+            os_udp_watch.watch[ix].callback = callback;
+            os_udp_watch.watch[ix].arg = arg;
+            if (os_loop_add_fd(os_udp_watch.loop, id, os_udp_watch_ready, (void *)(intptr_t)ix) == 0)
+            {
+               os_udp_watch.watch[ix].fd = id;
+               ret = 0;
+            }
+            break;
+         }
+      }
+   }
+
+   return ret;
+}
+
 void os_udp_close(uint32_t id)
 {
+   if (os_udp_watch.loop != NULL)
+   {
+      os_udp_watch_remove(id);
+   }
    close(id);
 }
@@ -68,6 +68,27 @@ extern "C"
    int_unlock();                                \
 })
 
+#define CC_ATOMIC_CAS32(p, e, d)                \
+({                                              \
+   bool ok;                                     \
+   int_lock();                                  \
+   ok = (*p == (e));                            \
+   if (ok)                                      \
+      *p = (d);                                 \
+   int_unlock();                                \
+   ok;                                          \
+})
+
+#define CC_ATOMIC_XCHG_PTR(p, v)                \
+({                                              \
+   void *old;                                   \
+   int_lock();                                  \
+   old = *p;                                    \
+   *p = (v);                                    \
+   int_unlock();                                \
+   old;                                         \
+})
+
 #define CC_ASSERT(exp) ASSERT (exp)
 #define CC_STATIC_ASSERT(exp) _Static_assert (exp, "")
 
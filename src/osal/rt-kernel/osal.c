@@ -100,6 +100,11 @@ os_thread_t * os_thread_create (const char * name, int priority,
    return task_spawn (name, entry, priority, stacksize, arg);
 }
 
+void * os_thread_self (void)
+{
+   return task_self();
+}
+
 /********************** Mutex ************************************************/
 
 os_mutex_t * os_mutex_create (void)
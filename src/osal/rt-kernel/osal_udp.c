@@ -96,6 +96,12 @@ int os_udp_recvfrom(uint32_t id,
    return len;
 }
 
+int os_udp_set_callback(uint32_t id, os_udp_callback_t *callback, void *arg)
+{
+   /* Not supported. The socket is polled */
+   return -1;
+}
+
 void os_udp_close(uint32_t id)
 {
    close(id);
@@ -243,6 +243,8 @@ typedef enum pf_block_type_values
    PF_BT_PRMBEGIN_REQ                  = 0x0118,
    PF_BT_SUBMODULE_PRMBEGIN_REQ        = 0x0119,
 
+   PF_BT_PDPORT_DATA_REAL              = 0x020F,
+
    PF_BT_MAINTENANCE_ITEM              = 0x0f00,
 
    /* Output from a PROFINET device */
@@ -626,11 +628,21 @@ typedef struct pf_alarm_err
     */
 } pf_alarm_err_t;
 
-#define PF_MAX_SESSION                    (2*(PNET_MAX_AR) + 1)               /* 2 per ar, and one spare. */
+#define PF_MAX_SESSION(max_ar)            (2*(max_ar) + 1)                    /* 2 per ar, and one spare. */
+
+/*
+ * DCE RPC over UDP. A response body that does not fit in one UDP datagram
+ * is sent in fragments of at most PF_RPC_MAX_FRAGMENT_BODY bytes.
+ */
+#define PF_RPC_HEADER_SIZE                80
+#define PF_RPC_MAX_UDP_PAYLOAD            1464                                /* Fits a 1500 byte MTU */
+#define PF_RPC_MAX_FRAGMENT_BODY          ((PF_RPC_MAX_UDP_PAYLOAD) - (PF_RPC_HEADER_SIZE))
+#define PF_RPC_FRAGMENT_TIMEOUT           (1000*1000)                         /* us, to wait for a FACK */
+#define PF_RPC_FRAGMENT_RETRIES           3
+#define PF_MAX_SESSION_BUFFER_SIZE        4500
 
 /*
- * Keep this value small as it define the number of entries in the
- * frame id map and all entries are probed until a match is found.
+ * Number of entries in the frame id map.
  *
  * Each input CR may have 2 frameIds (for RTC3)
  * Add space for DCP:     0xfefc..0xfeff.
@@ -638,6 +650,20 @@ typedef struct pf_alarm_err
  */
 #define PF_ETH_MAX_MAP                    ((PNET_MAX_API) * (PNET_MAX_AR) * (PNET_MAX_CR) * 2 + 4 + 2)
 
+/*
+ * Number of slots in the frame id hash table (open addressing).
+ * The hash is frame_id modulo the table size, so consecutive cyclic
+ * frame ids never collide with each other.
+ */
+#define PF_ETH_HASH_SIZE                  (2 * (PF_ETH_MAX_MAP) + 1)
+
+/*
+ * The DCP Identify response is kept pre-serialized in the stack instance.
+ * AliasNameValue = LLDP_PortID "." LLDP_ChassisID
+ */
+#define PF_DCP_IDENT_FRAME_SIZE           1500
+#define PF_DCP_ALIAS_NAME_SIZE            (240 + 1 + 240 + 1)
+
 /**
  * The scheduler is used by both the CPM and PPM machines.
  * The DCP uses the scheduler for responding to multi-cast messages.
@@ -645,6 +671,21 @@ typedef struct pf_alarm_err
  */
 #define PF_MAX_TIMEOUTS                   (2 * (PNET_MAX_AR) * (PNET_MAX_CR) + 10)
 
+/**
+ * Scheduler timeout queue implementations (see PF_SCHEDULER_BACKEND).
+ *
+ * LIST: Sorted doubly-linked list. Insert is O(n).
+ * HEAP: Indexed binary min-heap. Insert and remove are O(log n).
+ */
+#define PF_SCHEDULER_BACKEND_LIST         0
+#define PF_SCHEDULER_BACKEND_HEAP         1
+
+/**
+ * Number of queued add/remove requests from other threads than the tick
+ * thread (PF_SCHEDULER_LOCKFREE only). Must be a power of 2.
+ */
+#define PF_SCHEDULER_MAX_REQUESTS         32
+
 #define PF_CMINA_FS_HELLO_RETRY           3
 #define PF_CMINA_FS_HELLO_INTERVAL        (3*1000)     /* ms => 3s. Default is 30ms */
 
@@ -688,16 +729,36 @@ typedef void (*pf_scheduler_timeout_ftn_t)(
 typedef struct pf_scheduler_timeouts
 {
    const char                    *p_name; /* For debugging only */
-   bool                          in_use;  /* For debugging only */
+   bool                          in_use;  /* In busy queue */
 
    uint32_t                      when;    /* absolute time of timeout */
    uint32_t                      next;    /* Next in list */
    uint32_t                      prev;    /* Previous in list */
+   uint32_t                      heap_pos; /* Position in busy heap (HEAP backend) */
+   uint32_t                      period;  /* Re-arm interval. 0 (zero) if not periodic */
+   uint32_t                      overruns; /* Number of missed periodic deadlines */
+#if PF_SCHEDULER_LOCKFREE
+   uint32_t                      claimed; /* Allocated (atomic). May still be in free list */
+#endif
 
    pf_scheduler_timeout_ftn_t    cb;      /* Call-back to call on timeout */
    void                          *arg;    /* call-back argument */
 } pf_scheduler_timeouts_t;
 
+#if PF_SCHEDULER_LOCKFREE
+/**
+ * Add or remove request posted to the tick thread by another thread.
+ * An add request refers to an already claimed and filled in timeout.
+ */
+typedef struct pf_scheduler_request
+{
+   uint32_t                      seq;     /* Queue cell sequence number (atomic) */
+   bool                          add;     /* true for add, false for remove */
+   uint32_t                      timeout; /* Timeout instance (see pf_scheduler_add) */
+   const char                    *p_name; /* Owner (remove only) */
+} pf_scheduler_request_t;
+#endif
+
 /**
  * This is the prototype for the Profinet frame handler.
  *
@@ -718,12 +779,53 @@ typedef int (*pf_eth_frame_handler_t)(
 typedef struct pf_eth_frame_id_map
 {
    bool                    in_use;
+   uint32_t                gen;           /* Odd while the entry is being changed */
    uint16_t                frame_id;
    pf_eth_frame_handler_t  frame_handler;
    void                    *p_arg;
 } pf_eth_frame_id_map_t;
 
 
+/*
+ * A DCP Identify response waiting for its response delay to expire.
+ * Identified by the requester MAC address and the xid of the request.
+ */
+typedef struct pf_dcp_response
+{
+   bool                    in_use;
+   pnet_ethaddr_t          dest;
+   uint32_t                xid;        /* As in the frame */
+   uint32_t                timeout;
+   os_buf_t                *p_buf;
+} pf_dcp_response_t;
+
+/*
+ * A neighbour learned from received LLDP frames.
+ * The chassis id and port id are kept as received, i.e. not terminated.
+ */
+#define PF_LLDP_ID_SIZE                   255
+#define PF_LLDP_SUBTYPE_CHASSIS_ID_NAME   7        /* Locally assigned name */
+
+/* PDPortDataReal values */
+#define PF_PDPORT_LINK_STATE_UP           0x0001   /* Port state unknown, link up */
+#define PF_PDPORT_LINK_STATE_UNKNOWN      0x0004   /* Port state unknown, link unknown */
+#define PF_PDPORT_MEDIA_TYPE_UNKNOWN      0
+
+typedef struct pf_lldp_peer
+{
+   bool                    in_use;
+   uint16_t                ttl_left;               /* Seconds */
+   pnet_ethaddr_t          mac_address;            /* Interface MAC address of the peer */
+   uint8_t                 chassis_id_subtype;
+   uint8_t                 chassis_id_len;
+   uint8_t                 chassis_id[PF_LLDP_ID_SIZE];
+   uint8_t                 port_id_subtype;
+   uint8_t                 port_id_len;
+   uint8_t                 port_id[PF_LLDP_ID_SIZE];
+   bool                    has_ip_address;
+   os_ipaddr_t             ip_address;
+} pf_lldp_peer_t;
+
 /*
  * Each struct in pf_cmina_dcp_ase_t is carefully laid out in order to use
  * strncmp/memcmp in the DCP identity request and strncpy/memcpy in the
@@ -961,9 +1063,9 @@ typedef struct pf_api_entry
 {
    uint32_t                api;
    uint16_t                nbr_io_data;
-   pf_frame_descriptor_t   io_data[PNET_MAX_MODULES * PNET_MAX_SUBMODULES];
+   pf_frame_descriptor_t   *io_data;                     /* In the frame_desc table of the IOCR */
    uint16_t                nbr_iocs;
-   pf_frame_descriptor_t   iocs[PNET_MAX_MODULES * PNET_MAX_SUBMODULES];
+   pf_frame_descriptor_t   *iocs;                        /* In the frame_desc table of the IOCR */
 } pf_api_entry_t;
 
 typedef struct pf_iocr_tag_header
@@ -1037,7 +1139,7 @@ typedef struct pf_exp_module
    uint16_t                module_properties;            /** Reserved - currently unused */
 
    uint16_t                nbr_submodules;
-   pf_exp_submodule_t      submodules[PNET_MAX_SUBMODULES];
+   pf_exp_submodule_t      *submodules;                  /* In the exp_submodules table of the AR */
 } pf_exp_module_t;
 
 typedef struct pf_exp_api
@@ -1045,7 +1147,7 @@ typedef struct pf_exp_api
    bool                    valid;
    uint32_t                api;
    uint16_t                nbr_modules;
-   pf_exp_module_t         modules[PNET_MAX_MODULES];
+   pf_exp_module_t         *modules;                     /* [max_exp_modules of the AR] */
 } pf_exp_api_t;
 
 typedef struct pf_submodule_state
@@ -1073,14 +1175,14 @@ typedef struct pf_module_diff
    uint32_t                module_ident_number;
    uint16_t                module_state;                 /** pf_module_state_values_t */
    uint16_t                nbr_submodule_diffs;
-   pf_submodule_diff_t     submodule_diffs[PNET_MAX_SUBMODULES];
+   pf_submodule_diff_t     *submodule_diffs;             /* In the submodule_diffs table of the AR */
 } pf_module_diff_t;
 
 typedef struct pf_api_diff
 {
    uint32_t                api;
    uint16_t                nbr_module_diffs;
-   pf_module_diff_t        module_diffs[PNET_MAX_MODULES];
+   pf_module_diff_t        *module_diffs;                /* [max_exp_modules of the AR] */
 } pf_api_diff_t;
 
 typedef struct pf_parameter_server_properties
@@ -1247,9 +1349,10 @@ typedef struct pf_ppm
    bool                    first_transmit;
 
    void                    *p_send_buffer;
-   bool                    new_buf;             /* New data to be sent */
 
    uint16_t                cycle;
+   uint16_t                cycle_step;          /* Cycle counter increment per send */
+   uint32_t                cycle_deadline;      /* Deadline of the latest send */
    uint8_t                 transfer_status;
    uint8_t                 data_status;
    uint16_t                buffer_length;
@@ -1258,7 +1361,17 @@ typedef struct pf_ppm
    uint16_t                data_status_offset;
    uint16_t                transfer_status_offset;
 
-   uint8_t                 buffer_data[1500];   /* Max */
+   /* Triple buffer of the PROFINET data (see pf_ppm.c) */
+   uint8_t                 buffer_data[3][1500];   /* Max */
+   uint32_t                buffer_write;        /* Owned by the application */
+   uint32_t                buffer_send;         /* Owned by pf_ppm_send */
+   uint32_t                buffer_ready;        /* Latest published buffer + new flag */
+   uint16_t                write_start;         /* Changed range of the application buffer */
+   uint16_t                write_end;
+   uint16_t                dirty_start[3];      /* Range changed by each published buffer */
+   uint16_t                dirty_end[3];
+   uint16_t                stale_start[3];      /* Range where each buffer lags the application data */
+   uint16_t                stale_end[3];        /* (only used by the application) */
 
    uint32_t                trx_cnt;
 
@@ -1285,8 +1398,11 @@ typedef struct pf_cpm
    uint16_t                data_hold_factor;
 
    void                    *p_buffer_app;       /* Owned by app */
-   void                    *p_buffer_cpm;       /* owned by cpm */
-   bool                    new_buf;             /* New data to be received */
+   void                    *p_buffer_cpm;       /* Newest unread buffer, or NULL. Exchanged atomically */
+   uint32_t                put_cnt;             /* Buffers handed over to the app */
+   uint32_t                put_overwrite_cnt;   /* Buffers replaced before the app read them */
+   uint32_t                get_new_cnt;         /* App reads that found a new buffer */
+   uint32_t                get_old_cnt;         /* App reads that found no new buffer */
    uint16_t                frame_id_pos;        /* Handles VLAN in ETH header */
 
    uint8_t                 data_status;
@@ -1352,7 +1468,12 @@ typedef struct pf_iocr
    uint16_t                out_length;
 
    uint16_t                nbr_data_desc;
-   pf_iodata_object_t      data_desc[PNET_MAX_API * PNET_MAX_MODULES * PNET_MAX_SUBMODULES];
+   uint16_t                max_data_desc;
+   pf_iodata_object_t      *data_desc;                   /* Runtime-sized, bound when the IOCR is set up */
+
+   uint16_t                nbr_frame_desc;
+   uint16_t                max_frame_desc;
+   pf_frame_descriptor_t   *frame_desc;                  /* Runtime-sized, bound when the AR is allocated */
 
    pf_iocr_param_t         param;                        /* From connect.req */
    pf_iocr_result_t        result;                       /* From connect.ind */
@@ -1397,12 +1518,6 @@ typedef enum pf_apmr_state_values
    PF_APMR_STATE_WCNF
 } pf_apmr_state_values_t;
 
-typedef struct pf_apmr_msg
-{
-   uint16_t                         frame_id_pos;
-   os_buf_t                         *p_buf;
-} pf_apmr_msg_t;
-
 /*
  * This type contains all the information needed for one
  * APMS/APMR pair.
@@ -1426,14 +1541,22 @@ typedef struct pf_apmx
    uint16_t                exp_seq_count;
    uint16_t                exp_seq_count_o;
 
-   /* The receive queue */
+   /* The receive queue, of received frame buffers */
    os_mbox_t               *p_alarm_q;
-   /* The messages sent via the mailbox */
-   pf_apmr_msg_t           apmr_msg[PNET_MAX_ALARMS];
-   uint16_t                apmr_msg_nbr;
+   uint32_t                apmr_drop_cnt;                /* Lost because the queue was full */
+
+   /* Transmit frames, with the Ethernet header in place */
+   os_buf_t                *p_tack_frame;                /* For PDUs with TACK */
+   os_buf_t                *p_frame;                     /* For other PDUs */
 
-   /* Latest sent alarm */
+   /* Latest sent alarm. Points to p_tack_frame until ACKed. */
    os_buf_t                *p_rta;
+   uint32_t                rta_send_time;                /* When p_rta was first sent, in us */
+
+   /* Time from sending an alarm PDU with TACK until it is ACKed, in us */
+   uint32_t                rtt_cnt;
+   uint32_t                rtt_last;
+   uint32_t                rtt_max;
 
    uint16_t                vlan_prio;
    uint16_t                block_type_alarm_notify;
@@ -1521,7 +1644,7 @@ typedef struct pf_session_info
     * According to the services spec the maximum supported write record data size is 4068 bytes.
     * Allow for some overhead.
     */
-   uint8_t                 buffer[4500];           /* Send/Receive buffer */
+   uint8_t                 buffer[PF_MAX_SESSION_BUFFER_SIZE];   /* Send/Receive buffer */
    uint16_t                buf_len;
 
    pf_get_info_t           get_info;
@@ -1532,11 +1655,46 @@ typedef struct pf_session_info
    /* These are used while collecting the fragments */
    uint16_t                fragment_nbr;
 
+   /*
+    * These are used while sending a fragmented response.
+    * The response body is kept in buffer. One fragment is sent at a time,
+    * the next when the client has acknowledged it with a FACK.
+    * A fragment that is not acknowledged in time is sent again.
+    */
+   bool                    rsp_in_progress;
+   pf_rpc_header_t         rsp_header;             /* Header of the next fragment */
+   uint16_t                rsp_len;                /* Length of the response body, 0 if none */
+   uint16_t                rsp_pos;                /* Start of the next fragment */
+   uint16_t                rsp_retries;            /* Retransmissions left for the last fragment */
+   uint32_t                rsp_timeout;            /* Retransmit timer, 0 if not running */
+
    /* This item is used to handle dcontrol re-runs */
    uint32_t                dcontrol_sequence_nmb;      /* From dcontrol request */
    pnet_result_t           dcontrol_result;
 } pf_session_info_t;
 
+#define PF_IO_INDEX_MAX_SIZE              0x1000         /* Entries an IO handle can address */
+#define PF_IO_INDEX_NO_CR                 0xff
+
+/*
+ * One entry per sub-slot in the IOCRs of an AR, sorted on (api, slot, subslot).
+ * in_crep refers to the first INPUT or MC_PROVIDER CR containing the sub-slot
+ * and out_crep to the first OUTPUT or MC_CONSUMER CR.
+ * Built at connect time by pf_cmdev.
+ */
+typedef struct pf_io_index
+{
+   uint32_t                api_id;
+   uint16_t                slot_nbr;
+   uint16_t                subslot_nbr;
+   struct pf_slot          *p_slot;
+   struct pf_subslot       *p_subslot;
+   uint8_t                 in_crep;                      /* PF_IO_INDEX_NO_CR if none */
+   uint8_t                 out_crep;                     /* PF_IO_INDEX_NO_CR if none */
+   uint16_t                in_iodata_ix;
+   uint16_t                out_iodata_ix;
+} pf_io_index_t;
+
 typedef struct pf_ar
 {
    bool                    in_use;
@@ -1571,6 +1729,18 @@ typedef struct pf_ar
    uint16_t                nbr_iocrs;                    /* From connect.req */
    pf_iocr_t               iocrs[PNET_MAX_CR];
 
+   uint16_t                io_index_gen;                 /* 0 if no index */
+   uint16_t                nbr_io_index;
+   uint16_t                max_io_index;
+   pf_io_index_t           *io_index;                    /* Runtime-sized, bound when the index is built */
+
+   /* The tables below are runtime-sized, and bound when the AR is allocated */
+   uint16_t                max_exp_modules;              /* Per API */
+   uint16_t                nbr_exp_submodules;
+   uint16_t                max_exp_submodules;
+   pf_exp_submodule_t      *exp_submodules;
+   pf_submodule_diff_t     *submodule_diffs;             /* Same layout as exp_submodules */
+
    uint16_t                nbr_exp_apis;
    pf_exp_api_t            exp_apis[PNET_MAX_API];       /* From connect.req */
 
@@ -1800,7 +1970,8 @@ typedef struct pf_slot
    uint32_t                exp_module_ident_number;
    uint32_t                module_ident_number;
    pf_mod_plug_state_t     plug_state;
-   pf_subslot_t            subslots[PNET_MAX_SUBMODULES];
+   uint16_t                max_subslots;
+   pf_subslot_t            *subslots;                    /* [max_subslots], bound when the slot is created */
 
    /* Run-time information */
    pf_ar_t                 *p_ar;
@@ -1812,7 +1983,8 @@ typedef struct pf_api
    bool                    in_use;
    uint32_t                api_id;
 
-   pf_slot_t               slots[PNET_MAX_MODULES];
+   uint16_t                max_slots;
+   pf_slot_t               *slots;                       /* [max_slots], bound when the API is created */
 
    pf_ar_t                 *p_ar;
 } pf_api_t;
@@ -1834,7 +2006,8 @@ typedef struct pf_device
     * It is used instead of dynamic memory to avoid fragmentation.
     */
    os_mutex_t              *diag_mutex;      /* Protect the diag items */
-   pf_diag_item_t          diag_items[PNET_MAX_DIAG_ITEMS];
+   pf_diag_item_t          *diag_items;      /* [max_diag_items] */
+   uint16_t                max_diag_items;
    uint16_t                diag_items_free;  /* Head of the unused list */
 } pf_device_t;
 
@@ -1947,8 +2120,14 @@ typedef struct pf_log_book
 } pf_log_book_t;
 
 
+/* The stack instance and its runtime-sized tables are cache line aligned */
+#define PF_CACHE_LINE_SIZE                64
+#define PF_CACHE_ALIGN(x)                 (((x) + PF_CACHE_LINE_SIZE - 1) & ~((size_t)PF_CACHE_LINE_SIZE - 1))
+
 struct pnet
 {
+   void                                *p_mem;                    /* Start of the allocated block */
+   size_t                              mem_size;                  /* Size of the allocated block */
    uint32_t                            os_buf_alloc_cnt;
    bool                                global_alarm_enable;
    os_mutex_t                          *cpm_buf_lock;
@@ -1957,18 +2136,57 @@ struct pnet
    atomic_int                          ppm_instance_cnt;
    uint16_t                            dcp_global_block_qualifier;
    pnet_ethaddr_t                      dcp_sam;
-   bool                                dcp_delayed_response_waiting;
    uint32_t                            dcp_timeout;
    uint32_t                            dcp_sam_timeout;
+   pf_dcp_response_t                   dcp_responses[PNET_MAX_DCP_RESPONSES];
+   uint32_t                            dcp_response_drop_cnt;
+   bool                                dcp_ident_valid;
+   uint16_t                            dcp_ident_len;
+   uint16_t                            dcp_ident_name_len;
+   uint16_t                            dcp_ident_alias_len;
+   uint16_t                            dcp_ident_delay_seed;
+   char                                dcp_ident_alias[PF_DCP_ALIAS_NAME_SIZE];  /* Terminated */
+   uint8_t                             dcp_ident_frame[PF_DCP_IDENT_FRAME_SIZE];
+   os_mutex_t                          *lldp_mutex;
+   os_buf_t                            *lldp_frame[PNET_MAX_PORT];
+   bool                                lldp_frame_valid;
+   uint32_t                            lldp_timeout;
+   uint32_t                            lldp_age_timeout;
+   pf_lldp_peer_t                      lldp_peers[PNET_MAX_PORT][PNET_MAX_LLDP_PEERS];
+   uint32_t                            lldp_rx_drop_cnt;
    os_eth_handle_t                     *eth_handle;
    pf_eth_frame_id_map_t               eth_id_map[PF_ETH_MAX_MAP];
+   uint32_t                            eth_id_hash[PF_ETH_HASH_SIZE];
+   uint32_t                            eth_id_hash_gen;           /* Odd while hash slots are moved */
    volatile pf_scheduler_timeouts_t    scheduler_timeouts[PF_MAX_TIMEOUTS];
    volatile uint32_t                   scheduler_timeout_first;
    volatile uint32_t                   scheduler_timeout_free;
+   volatile uint32_t                   scheduler_timeout_running;
+#if PF_SCHEDULER_BACKEND == PF_SCHEDULER_BACKEND_HEAP
+   volatile uint32_t                   scheduler_heap[PF_MAX_TIMEOUTS];
+   volatile uint32_t                   scheduler_heap_len;
+#endif
    os_mutex_t                          *scheduler_timeout_mutex;
+#if PF_SCHEDULER_LOCKFREE
+   void                                *scheduler_owner;
+   pf_scheduler_request_t              scheduler_requests[PF_SCHEDULER_MAX_REQUESTS];
+   uint32_t                            scheduler_request_put;
+   uint32_t                            scheduler_request_get;
+   uint32_t                            scheduler_request_drops;
+#endif
    uint32_t                            scheduler_tick_interval;
    bool                                cmdev_initialized;
    pf_device_t                         cmdev_device;
+   uint16_t                            cmdev_io_index_gen;
+   uint16_t                            cmdev_max_data_desc;       /* Per IOCR */
+   pf_iodata_object_t                  *cmdev_data_desc;          /* [cmrpc_max_ar][PNET_MAX_CR][cmdev_max_data_desc] */
+   pf_io_index_t                       *cmdev_io_index;           /* [cmrpc_max_ar][cmdev_max_data_desc] */
+   uint16_t                            cmdev_max_diag_items;
+   pf_diag_item_t                      *cmdev_diag_items;         /* [cmdev_max_diag_items] */
+   uint16_t                            cmdev_max_slots;           /* Per API */
+   uint16_t                            cmdev_max_subslots;        /* Per slot */
+   pf_slot_t                           *cmdev_slots;              /* [PNET_MAX_API][cmdev_max_slots] */
+   pf_subslot_t                        *cmdev_subslots;           /* [PNET_MAX_API][cmdev_max_slots][cmdev_max_subslots] */
    pf_cmina_dcp_ase_t                  cmina_perm_dcp_ase;
    pf_cmina_dcp_ase_t                  cmina_temp_dcp_ase;
    pf_cmina_state_values_t             cmina_state;
@@ -1979,11 +2197,20 @@ struct pnet
    bool                                cmina_commit_ip_suite;
    os_mutex_t                          *p_cmrpc_rpc_mutex;
    uint32_t                            cmrpc_session_number;
-   pf_ar_t                             cmrpc_ar[PNET_MAX_AR];
-   pf_session_info_t                   cmrpc_session_info[PF_MAX_SESSION];
+   uint16_t                            cmrpc_max_ar;
+   uint16_t                            cmrpc_max_session;
+   pf_ar_t                             *cmrpc_ar;                 /* [cmrpc_max_ar] */
+   pf_session_info_t                   *cmrpc_session_info;       /* [cmrpc_max_session] */
+   pf_exp_module_t                     *cmrpc_exp_modules;        /* [cmrpc_max_ar][PNET_MAX_API][cmdev_max_slots] */
+   pf_module_diff_t                    *cmrpc_module_diffs;       /* [cmrpc_max_ar][PNET_MAX_API][cmdev_max_slots] */
+   pf_exp_submodule_t                  *cmrpc_exp_submodules;     /* [cmrpc_max_ar][cmdev_max_data_desc] */
+   pf_submodule_diff_t                 *cmrpc_submodule_diffs;    /* [cmrpc_max_ar][cmdev_max_data_desc] */
+   pf_frame_descriptor_t               *cmrpc_frame_desc;         /* [cmrpc_max_ar][PNET_MAX_CR][2 * cmdev_max_data_desc] */
    int                                 cmrpc_rpcreq_socket;
+   bool                                cmrpc_rx_poll;             /* A socket has no callback */
+   uint32_t                            cmrpc_rx_ready;            /* Set from the OSAL callback */
    uint8_t                             cmrpc_dcerpc_req_frame[1500];
-   uint8_t                             cmrpc_dcerpc_rsp_frame[1500];
+   uint8_t                             cmrpc_dcerpc_rsp_frame[PF_RPC_HEADER_SIZE + PF_MAX_SESSION_BUFFER_SIZE];   /* Before fragmentation */
    pf_cmsu_state_values_t              cmsu_state;
    pf_cmwrr_state_values_t             cmwrr_state;
    const pnet_cfg_t                    *p_fspm_default_cfg;
@@ -23,9 +23,11 @@ uint8_t pnet_log_level;
 uint8_t     mock_os_eth_send_copy[1500];
 uint16_t    mock_os_eth_send_len;
 uint16_t    mock_os_eth_send_count;
+os_buf_t    *mock_os_eth_init_frame;
 
 uint16_t    mock_os_udp_sendto_len;
 uint16_t    mock_os_udp_sendto_count;
+uint8_t     mock_os_udp_sendto_copy[1500];
 
 uint16_t    mock_os_set_led_count;
 bool        mock_os_set_led_on;
@@ -33,6 +35,9 @@ bool        mock_os_set_led_on;
 uint8_t     mock_os_udp_recvfrom_buffer[1500];
 uint16_t    mock_os_udp_recvfrom_length;
 uint16_t    mock_os_udp_recvfrom_count;
+uint32_t    mock_os_udp_recvfrom_calls;
+os_udp_callback_t *mock_os_udp_callback;
+void        *mock_os_udp_callback_arg;
 
 os_mutex_t  *mock_mutex;
 
@@ -51,11 +56,15 @@ void mock_clear(void)
    memset(mock_os_udp_recvfrom_buffer, 0, sizeof(mock_os_udp_recvfrom_buffer));
    mock_os_udp_recvfrom_length = 0;
    mock_os_udp_recvfrom_count = 0;
+   mock_os_udp_recvfrom_calls = 0;
 }
 
 void mock_init(void)
 {
    mock_mutex = os_mutex_create();
+   mock_os_eth_init_frame = NULL;
+   mock_os_udp_callback = NULL;
+   mock_os_udp_callback_arg = NULL;
    mock_clear();
 }
 
@@ -68,6 +77,15 @@ os_eth_handle_t* mock_os_eth_init(
 
    handle = (os_eth_handle_t*)calloc(1, sizeof(os_eth_handle_t));
 
+   /* The receive thread may deliver a frame before os_eth_init() returns */
+   if (mock_os_eth_init_frame != NULL)
+   {
+      if (callback(arg, mock_os_eth_init_frame) == 1)
+      {
+         mock_os_eth_init_frame = NULL;
+      }
+   }
+
    return handle;
 }
 
@@ -121,6 +139,7 @@ int mock_os_udp_sendto(
    int                     size)
 {
    int                     len = size;
+   memcpy(mock_os_udp_sendto_copy, data, MIN(len, (int)sizeof(mock_os_udp_sendto_copy)));
    mock_os_udp_sendto_len = len;
    mock_os_udp_sendto_count++;
    return len;
@@ -135,6 +154,12 @@ void mock_set_os_udp_recvfrom_buffer(
    mock_os_udp_recvfrom_length = len;
    mock_os_udp_recvfrom_count++;
    os_mutex_unlock(mock_mutex);
+
+   /* Signal the stack, as the OSAL does when data arrives */
+   if (mock_os_udp_callback != NULL)
+   {
+      mock_os_udp_callback(0, mock_os_udp_callback_arg);
+   }
 }
 
 int mock_os_udp_recvfrom(
@@ -147,6 +172,7 @@ int mock_os_udp_recvfrom(
    int                     len;
 
    os_mutex_lock(mock_mutex);
+   mock_os_udp_recvfrom_calls++;
    memcpy(data, mock_os_udp_recvfrom_buffer, mock_os_udp_recvfrom_length);
    len = mock_os_udp_recvfrom_length;
    mock_os_udp_recvfrom_length = 0;
@@ -160,6 +186,16 @@ void mock_os_udp_close(
 {
 }
 
+int mock_os_udp_set_callback(
+   uint32_t                id,
+   os_udp_callback_t       *callback,
+   void                    *arg)
+{
+   mock_os_udp_callback = callback;
+   mock_os_udp_callback_arg = arg;
+   return 0;
+}
+
 void mock_os_get_button(
    uint16_t                id,
    bool                    *p_pressed)
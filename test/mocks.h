@@ -31,9 +31,12 @@ extern "C"
 extern uint8_t     mock_os_eth_send_copy[1500];
 extern uint16_t    mock_os_eth_send_len;
 extern uint16_t    mock_os_eth_send_count;
+extern os_buf_t    *mock_os_eth_init_frame;   /* Received as the Ethernet interface is opened */
 
 extern uint16_t    mock_os_udp_sendto_len;
 extern uint16_t    mock_os_udp_sendto_count;
+extern uint8_t     mock_os_udp_sendto_copy[1500];
+extern uint32_t    mock_os_udp_recvfrom_calls;
 
 extern uint16_t    mock_os_set_led_count;
 extern bool        mock_os_set_led_on;
@@ -61,6 +64,7 @@ int mock_os_udp_recvfrom(uint32_t id,
       uint8_t * data,
       int size);
 void mock_os_udp_close(uint32_t id);
+int mock_os_udp_set_callback(uint32_t id, os_udp_callback_t *callback, void *arg);
 int mock_os_set_ip_suite(
    os_ipaddr_t             *p_ipaddr,
    os_ipaddr_t             *p_netmask,
@@ -20,16 +20,93 @@
 #include "mocks.h"
 #include "test_util.h"
 
+#define TICK_INTERVAL_US            1000           /* us */
+#define FRAME_ID_ALARM_HIGH         0xfc01
+#define FRAME_ID_ALARM_LOW          0xfe01
+#define ALARM_HEADER_SIZE           20             /* DA, SA, VLAN tag, LT and FrameID */
+
+static int test_recv_rta(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   uint8_t                 pdu_type,
+   uint8_t                 add_flags,
+   uint16_t                send_seq_num)
+{
+   os_buf_t                *p_buf;
+   uint8_t                 *p_frame;
+
+   p_buf = os_buf_alloc(64);
+   if (p_buf == NULL)
+   {
+      return -1;
+   }
+   p_frame = (uint8_t *)p_buf->payload;
+   memset(p_frame, 0, 64);
+   p_frame[12] = OS_ETHTYPE_VLAN >> 8;
+   p_frame[13] = OS_ETHTYPE_VLAN & 0xff;
+   p_frame[16] = OS_ETHTYPE_PROFINET >> 8;
+   p_frame[17] = OS_ETHTYPE_PROFINET & 0xff;
+   p_frame[18] = frame_id >> 8;
+   p_frame[19] = frame_id & 0xff;
+   p_frame[24] = pdu_type;
+   p_frame[25] = add_flags;
+   p_frame[26] = send_seq_num >> 8;
+   p_frame[27] = send_seq_num & 0xff;
+
+   return pf_eth_recv(net, p_buf);
+}
+
+static int test_recv_alarm(
+   pnet_t                  *net,
+   uint16_t                frame_id)
+{
+   os_buf_t                *p_buf;
+   uint8_t                 *p_frame;
+
+   p_buf = os_buf_alloc(64);
+   if (p_buf == NULL)
+   {
+      return -1;
+   }
+   p_frame = (uint8_t *)p_buf->payload;
+   memset(p_frame, 0, 64);
+   p_frame[12] = OS_ETHTYPE_VLAN >> 8;
+   p_frame[13] = OS_ETHTYPE_VLAN & 0xff;
+   p_frame[16] = OS_ETHTYPE_PROFINET >> 8;
+   p_frame[17] = OS_ETHTYPE_PROFINET & 0xff;
+   p_frame[18] = frame_id >> 8;
+   p_frame[19] = frame_id & 0xff;
+
+   return pf_eth_recv(net, p_buf);
+}
+
 // Test fixture
 
 class AlarmTest : public ::testing::Test
 {
 protected:
    virtual void SetUp() {
-      memset (&net, 0, sizeof(net));
+      memset (&cfg, 0, sizeof(cfg));
+      memset (&sess, 0, sizeof(sess));
+      memset (&ar, 0, sizeof(ar));
+      net = (pnet_t *)calloc(1, sizeof(*net));
+      net->cmrpc_ar = &ar;
+      net->cmrpc_max_ar = 1;
+      net->p_fspm_default_cfg = &cfg;
+      net->global_alarm_enable = true;
+      pf_eth_init(net);
+      pf_scheduler_init(net, TICK_INTERVAL_US);
+   };
+
+   virtual void TearDown() {
+      os_mutex_destroy(net->scheduler_timeout_mutex);
+      free(net);
    };
 
-   pnet_cfg_t net;
+   pnet_cfg_t cfg;
+   pf_session_info_t sess;
+   pf_ar_t ar;
+   pnet_t *net;
 };
 
 // Tests
@@ -37,3 +114,148 @@ protected:
 TEST_F (AlarmTest, AlarmRunTest)
 {
 }
+
+TEST_F (AlarmTest, AlarmQueueShouldDropWhenFullAndDrain)
+{
+   pf_ar_t                 *p_ar = &net->cmrpc_ar[0];
+   os_buf_pool_stats_t     before;
+   os_buf_pool_stats_t     stats;
+   uint16_t                ix;
+
+   p_ar->in_use = true;
+   p_ar->p_sess = &sess;
+   p_ar->alarm_cr_request.rta_timeout_factor = 1;
+   ASSERT_EQ(pf_alarm_activate(net, p_ar), 0);
+   os_buf_pool_get_stats(&before);
+
+   /* Overfill the high priority queue */
+   for (ix = 0; ix < PNET_MAX_ALARMS + 2; ix++)
+   {
+      EXPECT_EQ(test_recv_alarm(net, FRAME_ID_ALARM_HIGH), 1);
+   }
+   EXPECT_EQ(p_ar->apmx[1].apmr_drop_cnt, 2u);
+   EXPECT_EQ(p_ar->apmx[0].apmr_drop_cnt, 0u);
+
+   /* Drain it. The PDUs are not valid, so they are just freed. */
+   for (ix = 0; ix < PNET_MAX_ALARMS; ix += PNET_MAX_ALARM_DRAIN)
+   {
+      pf_alarm_periodic(net);
+   }
+   os_buf_pool_get_stats(&stats);
+   if (before.size - before.in_use >= PNET_MAX_ALARMS + 2)
+   {
+      /* All buffers came from the pool, and all are back */
+      EXPECT_EQ(stats.in_use, before.in_use);
+   }
+
+   /* There is room for a full queue again */
+   for (ix = 0; ix < PNET_MAX_ALARMS; ix++)
+   {
+      EXPECT_EQ(test_recv_alarm(net, FRAME_ID_ALARM_HIGH), 1);
+   }
+   EXPECT_EQ(test_recv_alarm(net, FRAME_ID_ALARM_LOW), 1);
+   EXPECT_EQ(p_ar->apmx[1].apmr_drop_cnt, 2u);
+   EXPECT_EQ(p_ar->apmx[0].apmr_drop_cnt, 0u);
+
+   /* Closing frees the frames still in the queues */
+   EXPECT_EQ(pf_alarm_close(net, p_ar), 0);
+   EXPECT_EQ(p_ar->apmx[0].p_alarm_q, nullptr);
+   EXPECT_EQ(p_ar->apmx[1].p_alarm_q, nullptr);
+   os_buf_pool_get_stats(&stats);
+   if (before.size - before.in_use >= PNET_MAX_ALARMS + 2)
+   {
+      /* The transmit frames of the APMX are also freed */
+      EXPECT_LT(stats.in_use, before.in_use);
+   }
+}
+
+TEST_F (AlarmTest, AlarmFramesShouldBeReusedAndRetransmitted)
+{
+   pf_ar_t                 *p_ar = &net->cmrpc_ar[0];
+   pf_apmx_t               *p_apmx = &p_ar->apmx[1];
+   const uint8_t           initiator_mac[] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+   const uint8_t           own_mac[] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+   uint8_t                 tack_pdu[sizeof(mock_os_eth_send_copy)];
+   uint16_t                tack_len;
+   os_buf_t                *p_tack_frame;
+   os_buf_t                *p_frame;
+   os_buf_pool_stats_t     before;
+   os_buf_pool_stats_t     stats;
+   uint8_t                 *p_buf;
+
+   memcpy(cfg.eth_addr.addr, own_mac, sizeof(own_mac));
+   memcpy(p_ar->ar_param.cm_initiator_mac_add.addr, initiator_mac, sizeof(initiator_mac));
+   p_ar->in_use = true;
+   p_ar->p_sess = &sess;
+   p_ar->alarm_cr_request.rta_timeout_factor = 1;
+   p_ar->alarm_cr_request.rta_retries = 3;
+   ASSERT_EQ(pf_alarm_activate(net, p_ar), 0);
+   p_apmx->timeout_us = 10 * TICK_INTERVAL_US;
+   p_tack_frame = p_apmx->p_tack_frame;
+   p_frame = p_apmx->p_frame;
+   ASSERT_NE(p_tack_frame, nullptr);
+   ASSERT_NE(p_frame, nullptr);
+
+   /* The Ethernet header is written once, when the AR is activated */
+   p_buf = (uint8_t *)p_tack_frame->payload;
+   EXPECT_EQ(memcmp(&p_buf[0], initiator_mac, sizeof(initiator_mac)), 0);
+   EXPECT_EQ(memcmp(&p_buf[6], own_mac, sizeof(own_mac)), 0);
+   EXPECT_EQ(p_buf[12], OS_ETHTYPE_VLAN >> 8);
+   EXPECT_EQ(p_buf[16], OS_ETHTYPE_PROFINET >> 8);
+   EXPECT_EQ(p_buf[18], FRAME_ID_ALARM_HIGH >> 8);
+   EXPECT_EQ(p_buf[19], FRAME_ID_ALARM_HIGH & 0xff);
+   EXPECT_EQ(memcmp(p_frame->payload, p_tack_frame->payload, ALARM_HEADER_SIZE), 0);
+
+   os_buf_pool_get_stats(&before);
+   mock_os_eth_send_count = 0;
+
+   /* A TACK PDU is kept in its frame until acknowledged */
+   EXPECT_EQ(pf_alarm_send_process(net, p_ar, 0, 1, 1, 0, 0, NULL), 0);
+   EXPECT_EQ(mock_os_eth_send_count, 1);
+   EXPECT_EQ(p_apmx->p_rta, p_tack_frame);
+   EXPECT_EQ(p_apmx->apms_state, PF_APMS_STATE_WTACK);
+   tack_len = mock_os_eth_send_len;
+   memcpy(tack_pdu, mock_os_eth_send_copy, tack_len);
+   EXPECT_EQ(memcmp(tack_pdu, p_tack_frame->payload, ALARM_HEADER_SIZE), 0);
+   EXPECT_EQ(tack_pdu[18], FRAME_ID_ALARM_HIGH >> 8);
+   EXPECT_EQ(tack_pdu[19], FRAME_ID_ALARM_HIGH & 0xff);
+   EXPECT_EQ(tack_pdu[24], (PF_ALARM_PDU_TYPE_VERSION_1 << 4) | PF_RTA_PDU_TYPE_DATA);
+
+   /* The controller repeats its last DATA PDU. The ACK uses the other frame. */
+   EXPECT_EQ(test_recv_rta(net, FRAME_ID_ALARM_HIGH,
+      (PF_ALARM_PDU_TYPE_VERSION_1 << 4) | PF_RTA_PDU_TYPE_DATA, 0x11, 0xfffe), 1);
+   pf_alarm_periodic(net);
+   EXPECT_EQ(mock_os_eth_send_count, 2);
+   EXPECT_EQ(mock_os_eth_send_copy[24], (PF_ALARM_PDU_TYPE_VERSION_1 << 4) | PF_RTA_PDU_TYPE_ACK);
+   EXPECT_EQ(memcmp(mock_os_eth_send_copy, p_frame->payload, mock_os_eth_send_len), 0);
+   EXPECT_EQ(memcmp(mock_os_eth_send_copy, tack_pdu, ALARM_HEADER_SIZE), 0);
+
+   /* An out of sequence DATA PDU is NACKed, also from the other frame */
+   EXPECT_EQ(test_recv_rta(net, FRAME_ID_ALARM_HIGH,
+      (PF_ALARM_PDU_TYPE_VERSION_1 << 4) | PF_RTA_PDU_TYPE_DATA, 0x11, 5), 1);
+   pf_alarm_periodic(net);
+   EXPECT_EQ(mock_os_eth_send_count, 3);
+   EXPECT_EQ(mock_os_eth_send_copy[24], (PF_ALARM_PDU_TYPE_VERSION_1 << 4) | PF_RTA_PDU_TYPE_NACK);
+   EXPECT_EQ(memcmp(mock_os_eth_send_copy, p_frame->payload, mock_os_eth_send_len), 0);
+
+   /* The unacknowledged PDU is retransmitted unchanged on timeout */
+   EXPECT_EQ(p_apmx->p_rta, p_tack_frame);
+   EXPECT_EQ(p_tack_frame->len, tack_len);
+   EXPECT_EQ(memcmp(p_tack_frame->payload, tack_pdu, tack_len), 0);
+   os_usleep(2 * p_apmx->timeout_us);
+   pf_scheduler_tick(net);
+   EXPECT_EQ(mock_os_eth_send_count, 4);
+   EXPECT_EQ(mock_os_eth_send_len, tack_len);
+   EXPECT_EQ(memcmp(mock_os_eth_send_copy, tack_pdu, tack_len), 0);
+   EXPECT_EQ(p_apmx->retry, 2);
+   EXPECT_NE(p_apmx->timeout_id, UINT32_MAX);
+
+   /* No frame buffers were allocated to send */
+   os_buf_pool_get_stats(&stats);
+   EXPECT_EQ(stats.in_use, before.in_use);
+   EXPECT_EQ(stats.exhausted, before.exhausted);
+   EXPECT_EQ(p_apmx->p_tack_frame, p_tack_frame);
+   EXPECT_EQ(p_apmx->p_frame, p_frame);
+
+   EXPECT_EQ(pf_alarm_close(net, p_ar), 0);
+}
@@ -0,0 +1,183 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "pf_includes.h"
+#include "pf_block_reader.h"
+
+#include <gtest/gtest.h>
+
+#include "mocks.h"
+#include "test_util.h"
+
+// Test fixture
+
+class BlockReaderTest : public ::testing::Test
+{
+protected:
+   virtual void SetUp() {
+      memset (&info, 0, sizeof(info));
+      memset (&ar, 0, sizeof(ar));
+      memset (exp_modules, 0, sizeof(exp_modules));
+      memset (exp_submodules, 0, sizeof(exp_submodules));
+      ar.exp_apis[0].modules = exp_modules;
+      ar.max_exp_modules = NELEMENTS(exp_modules);
+      ar.exp_submodules = exp_submodules;
+      ar.max_exp_submodules = NELEMENTS(exp_submodules);
+      info.result = PF_PARSE_OK;
+      info.is_big_endian = true;
+   };
+
+   void set_buffer(uint8_t *p_buf, uint16_t len)
+   {
+      info.p_buf = p_buf;
+      info.len = len;
+   }
+
+   pf_get_info_t           info;
+   pf_ar_t                 ar;
+   pf_exp_module_t         exp_modules[4];
+   pf_exp_submodule_t      exp_submodules[4];
+};
+
+// Tests
+
+TEST_F (BlockReaderTest, BlockReaderEndianness)
+{
+   uint8_t                 buf[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+   pf_block_header_t       hdr;
+   uint16_t                pos = 0;
+
+   set_buffer(buf, sizeof(buf));
+   pf_get_block_header(&info, &pos, &hdr);
+   EXPECT_EQ(info.result, PF_PARSE_OK);
+   EXPECT_EQ(pos, 6);
+   EXPECT_EQ(hdr.block_type, 0x0102);
+   EXPECT_EQ(hdr.block_length, 0x0304);
+   EXPECT_EQ(hdr.block_version_high, 0x05);
+   EXPECT_EQ(hdr.block_version_low, 0x06);
+
+   info.is_big_endian = false;
+   pos = 0;
+   pf_get_block_header(&info, &pos, &hdr);
+   EXPECT_EQ(info.result, PF_PARSE_OK);
+   EXPECT_EQ(hdr.block_type, 0x0201);
+   EXPECT_EQ(hdr.block_length, 0x0403);
+
+   pos = 1;
+   EXPECT_EQ(pf_get_uint16(&info, &pos), 0x0302);
+   EXPECT_EQ(pf_get_byte(&info, &pos), 0x04);
+   EXPECT_EQ(pos, 4);
+}
+
+TEST_F (BlockReaderTest, BlockReaderTruncatedInput)
+{
+   uint8_t                 buf[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+   pf_block_header_t       hdr;
+   uint16_t                pos = 0;
+
+   /* A truncated block is rejected as a whole */
+   set_buffer(buf, sizeof(buf));
+   memset(&hdr, 0xff, sizeof(hdr));
+   pf_get_block_header(&info, &pos, &hdr);
+   EXPECT_EQ(info.result, PF_PARSE_END_OF_INPUT);
+   EXPECT_EQ(pos, 0);
+   EXPECT_EQ(hdr.block_type, 0);
+   EXPECT_EQ(hdr.block_length, 0);
+   EXPECT_EQ(hdr.block_version_high, 0);
+   EXPECT_EQ(hdr.block_version_low, 0);
+
+   /* The first error is kept */
+   set_buffer(NULL, sizeof(buf));
+   EXPECT_EQ(pf_get_byte(&info, &pos), 0);
+   EXPECT_EQ(pf_get_uint16(&info, &pos), 0);
+   EXPECT_EQ(info.result, PF_PARSE_END_OF_INPUT);
+   EXPECT_EQ(pos, 0);
+}
+
+TEST_F (BlockReaderTest, BlockReaderNullBuffer)
+{
+   pf_block_header_t       hdr;
+   uint16_t                pos = 0;
+
+   set_buffer(NULL, 10);
+   pf_get_block_header(&info, &pos, &hdr);
+   EXPECT_EQ(info.result, PF_PARSE_NULL_POINTER);
+   EXPECT_EQ(pos, 0);
+}
+
+TEST_F (BlockReaderTest, BlockReaderTooManySubmodules)
+{
+   uint8_t                 buf[] =
+   {
+      0x00, 0x01,                   /* NumberOfAPIs */
+      0x00, 0x00, 0x00, 0x00,       /* API */
+      0x00, 0x01,                   /* SlotNumber */
+      0x00, 0x00, 0x00, 0x32,       /* ModuleIdentNumber */
+      0x00, 0x00,                   /* ModuleProperties */
+      0x10, 0x00,                   /* NumberOfSubmodules */
+   };
+   uint16_t                pos = 0;
+
+   set_buffer(buf, sizeof(buf));
+   pf_get_exp_api_module(&info, &pos, &ar);
+   EXPECT_EQ(info.result, PF_PARSE_OUT_OF_EXP_SUBMODULE_RESOURCES);
+   EXPECT_EQ(ar.nbr_exp_apis, 1);
+   EXPECT_EQ(ar.exp_apis[0].nbr_modules, 1);
+   EXPECT_EQ(ar.exp_apis[0].modules[0].module_ident_number, 0x32u);
+   EXPECT_EQ(ar.exp_apis[0].modules[0].nbr_submodules, 0);
+}
+
+TEST_F (BlockReaderTest, BlockReaderSubmodulesShareArTable)
+{
+   uint8_t                 buf[] =
+   {
+      0x00, 0x02,                   /* NumberOfAPIs */
+      0x00, 0x00, 0x00, 0x00,       /* API */
+      0x00, 0x01,                   /* SlotNumber */
+      0x00, 0x00, 0x00, 0x32,       /* ModuleIdentNumber */
+      0x00, 0x00,                   /* ModuleProperties */
+      0x00, 0x02,                   /* NumberOfSubmodules */
+      0x00, 0x01,                   /* SubslotNumber */
+      0x00, 0x00, 0x00, 0x01,       /* SubmoduleIdentNumber */
+      0x00, 0x00,                   /* SubmoduleProperties, no I/O */
+      0x00, 0x01, 0x00, 0x00,       /* DataDescription, input, length 0 */
+      0x01, 0x01,                   /* LengthIOCS, LengthIOPS */
+      0x00, 0x02,                   /* SubslotNumber */
+      0x00, 0x00, 0x00, 0x02,       /* SubmoduleIdentNumber */
+      0x00, 0x00,                   /* SubmoduleProperties, no I/O */
+      0x00, 0x01, 0x00, 0x00,       /* DataDescription, input, length 0 */
+      0x01, 0x01,                   /* LengthIOCS, LengthIOPS */
+      0x00, 0x00, 0x00, 0x00,       /* API */
+      0x00, 0x02,                   /* SlotNumber */
+      0x00, 0x00, 0x00, 0x33,       /* ModuleIdentNumber */
+      0x00, 0x00,                   /* ModuleProperties */
+      0x00, 0x02,                   /* NumberOfSubmodules */
+   };
+   uint16_t                pos = 0;
+
+   /* The second module does not fit in what is left of the table */
+   ar.max_exp_submodules = 3;
+   set_buffer(buf, sizeof(buf));
+   pf_get_exp_api_module(&info, &pos, &ar);
+   EXPECT_EQ(info.result, PF_PARSE_OUT_OF_EXP_SUBMODULE_RESOURCES);
+   EXPECT_EQ(ar.nbr_exp_apis, 1);
+   EXPECT_EQ(ar.exp_apis[0].nbr_modules, 2);
+   EXPECT_EQ(ar.exp_apis[0].modules[0].submodules, &exp_submodules[0]);
+   EXPECT_EQ(ar.exp_apis[0].modules[0].nbr_submodules, 2);
+   EXPECT_EQ(ar.exp_apis[0].modules[0].submodules[1].submodule_ident_number, 2u);
+   EXPECT_EQ(ar.exp_apis[0].modules[1].submodules, &exp_submodules[2]);
+   EXPECT_EQ(ar.exp_apis[0].modules[1].nbr_submodules, 0);
+   EXPECT_EQ(ar.nbr_exp_submodules, 2);
+}
@@ -0,0 +1,184 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "pf_includes.h"
+#include "pf_block_writer.h"
+
+#include <gtest/gtest.h>
+
+#include "mocks.h"
+#include "test_util.h"
+
+// Test fixture
+
+class BlockWriterTest : public ::testing::Test
+{
+protected:
+   virtual void SetUp() {
+      memset (buf, 0xaa, sizeof(buf));
+   };
+
+   uint8_t                 buf[64];
+};
+
+// Tests
+
+TEST_F (BlockWriterTest, BlockWriterBlockLength)
+{
+   pf_control_block_t      ctrl;
+   uint16_t                pos = 2;
+
+   memset(&ctrl, 0, sizeof(ctrl));
+   ctrl.session_key = 0x1234;
+   ctrl.control_command = 0x0008;
+
+   pf_put_control(true, PF_BT_PRMEND_RES, &ctrl, sizeof(buf), buf, &pos);
+   EXPECT_EQ(pos, 2 + 6 + 26);
+
+   /* Block header with the length of the versions and the contents */
+   EXPECT_EQ(buf[2], PF_BT_PRMEND_RES >> 8);
+   EXPECT_EQ(buf[3], PF_BT_PRMEND_RES & 0xff);
+   EXPECT_EQ(buf[4], 0x00);
+   EXPECT_EQ(buf[5], 2 + 26);
+   EXPECT_EQ(buf[6], PNET_BLOCK_VERSION_HIGH);
+   EXPECT_EQ(buf[7], PNET_BLOCK_VERSION_LOW);
+
+   EXPECT_EQ(buf[26], 0x12);
+   EXPECT_EQ(buf[27], 0x34);
+   EXPECT_EQ(buf[30], 0x00);
+   EXPECT_EQ(buf[31], 0x08);
+}
+
+TEST_F (BlockWriterTest, BlockWriterEndianness)
+{
+   uint16_t                pos = 0;
+
+   pf_put_uint32(true, 0x01020304, sizeof(buf), buf, &pos);
+   pf_put_uint32(false, 0x01020304, sizeof(buf), buf, &pos);
+   pf_put_uint16(true, 0x0506, sizeof(buf), buf, &pos);
+   pf_put_uint16(false, 0x0506, sizeof(buf), buf, &pos);
+   EXPECT_EQ(pos, 12);
+
+   EXPECT_EQ(buf[0], 0x01);
+   EXPECT_EQ(buf[3], 0x04);
+   EXPECT_EQ(buf[4], 0x04);
+   EXPECT_EQ(buf[7], 0x01);
+   EXPECT_EQ(buf[8], 0x05);
+   EXPECT_EQ(buf[9], 0x06);
+   EXPECT_EQ(buf[10], 0x06);
+   EXPECT_EQ(buf[11], 0x05);
+}
+
+TEST_F (BlockWriterTest, BlockWriterBufferFull)
+{
+   uint16_t                pos = 3;
+
+   /* Fields that exactly fill the buffer are written */
+   pf_put_uint16(true, 0x0102, 6, buf, &pos);
+   EXPECT_EQ(pos, 5);
+   pf_put_byte(0x03, 6, buf, &pos);
+   EXPECT_EQ(pos, 6);
+   EXPECT_FALSE(pf_put_overflow(6, pos));
+   EXPECT_EQ(buf[5], 0x03);
+   memset(buf, 0xaa, sizeof(buf));
+
+   /* A field that does not fit is not written at all */
+   pos = 3;
+   pf_put_uint32(true, 0x01020304, 6, buf, &pos);
+   EXPECT_TRUE(pf_put_overflow(6, pos));
+   EXPECT_EQ(buf[3], 0xaa);
+   EXPECT_EQ(buf[4], 0xaa);
+   EXPECT_EQ(buf[5], 0xaa);
+
+   /* Neither are later fields that would fit in the gap */
+   pf_put_uint16(true, 0x0102, 6, buf, &pos);
+   pf_put_byte(0x03, 6, buf, &pos);
+   pf_put_mem("x", 1, 6, buf, &pos);
+   EXPECT_TRUE(pf_put_overflow(6, pos));
+   EXPECT_EQ(buf[3], 0xaa);
+   EXPECT_EQ(buf[4], 0xaa);
+   EXPECT_EQ(buf[5], 0xaa);
+   EXPECT_EQ(buf[6], 0xaa);
+}
+
+TEST_F (BlockWriterTest, BlockWriterPdportDataReal)
+{
+   pnet_lldp_cfg_t         lldp_cfg;
+   pf_lldp_peer_t          peer;
+   uint16_t                pos = 0;
+
+   memset(&lldp_cfg, 0, sizeof(lldp_cfg));
+   strcpy(lldp_cfg.port_id, "p1");
+   lldp_cfg.mau_type = 0x0010;
+   memset(&peer, 0, sizeof(peer));
+   peer.in_use = true;
+   peer.port_id_len = 2;
+   memcpy(peer.port_id, "pp", 2);
+   peer.chassis_id_subtype = PF_LLDP_SUBTYPE_CHASSIS_ID_NAME;
+   peer.chassis_id_len = 2;
+   memcpy(peer.chassis_id, "cc", 2);
+   peer.mac_address.addr[0] = 0x02;
+   peer.mac_address.addr[5] = 0x01;
+
+   pf_put_pdport_data_real(true, 0, 0x8001, &lldp_cfg, &peer, 1, sizeof(buf), buf, &pos);
+   EXPECT_EQ(pos, 56);
+   EXPECT_EQ(buf[0], PF_BT_PDPORT_DATA_REAL >> 8);
+   EXPECT_EQ(buf[1], PF_BT_PDPORT_DATA_REAL & 0xff);
+   EXPECT_EQ(buf[3], 56 - 4);
+   EXPECT_EQ(buf[10], 0x80);
+   EXPECT_EQ(buf[11], 0x01);
+   EXPECT_EQ(buf[12], 2);                    /* LengthOwnPortName */
+   EXPECT_EQ(buf[15], 1);                    /* NumberOfPeers */
+
+   /* Each peer starts and ends Unsigned32 aligned */
+   EXPECT_EQ(buf[16], 2);                    /* LengthPeerPortName */
+   EXPECT_EQ(buf[19], 2);                    /* LengthPeerStationName */
+   EXPECT_EQ(buf[22], 0x00);                 /* Padding */
+   EXPECT_EQ(buf[28], 0x02);                 /* PeerMACAddress */
+   EXPECT_EQ(buf[33], 0x01);
+   EXPECT_EQ(buf[36], 0x00);                 /* MAUType */
+   EXPECT_EQ(buf[37], 0x10);
+   EXPECT_EQ(buf[49], PF_PDPORT_LINK_STATE_UP);
+}
+
+TEST_F (BlockWriterTest, BlockWriterPdportDataRealPeerState)
+{
+   pnet_lldp_cfg_t         lldp_cfg;
+   pf_lldp_peer_t          peer;
+   uint16_t                pos = 0;
+
+   memset(&lldp_cfg, 0, sizeof(lldp_cfg));
+   strcpy(lldp_cfg.port_id, "p1");
+   memset(&peer, 0, sizeof(peer));
+   peer.in_use = true;
+   peer.port_id_len = 2;
+   memcpy(peer.port_id, "pp", 2);
+   peer.chassis_id_subtype = 4;              /* MAC address, not a name */
+   peer.chassis_id_len = 6;
+   memset(peer.chassis_id, 0xcc, 6);
+
+   pf_put_pdport_data_real(true, 0, 0x8001, &lldp_cfg, &peer, 1, sizeof(buf), buf, &pos);
+   EXPECT_EQ(pos, 52);
+   EXPECT_EQ(buf[19], 0);                    /* LengthPeerStationName */
+   EXPECT_EQ(buf[20], 0x00);                 /* LineDelay */
+   EXPECT_EQ(buf[45], PF_PDPORT_LINK_STATE_UP);
+
+   /* Without a neighbour the link state is not known */
+   pos = 0;
+   pf_put_pdport_data_real(true, 0, 0x8001, &lldp_cfg, &peer, 0, sizeof(buf), buf, &pos);
+   EXPECT_EQ(pos, 36);
+   EXPECT_EQ(buf[15], 0);                    /* NumberOfPeers */
+   EXPECT_EQ(buf[29], PF_PDPORT_LINK_STATE_UNKNOWN);
+}
@@ -23,6 +23,7 @@
  *  pnet_input_get_iocs()
  *  pnet_input_set_data_and_iops()
  *  pnet_output_set_iocs()
+ *  pnet_io_handle_get()
  *  pnet_create_log_book_entry()
  *  pnet_diag_add()
  *
@@ -278,6 +279,11 @@ protected:
       pnet_default_cfg.ip_gateway.b = 168;
       pnet_default_cfg.ip_gateway.c = 1;
       pnet_default_cfg.ip_gateway.d = 1;
+      pnet_default_cfg.max_ar = 0;         /* Compile-time maximum */
+      pnet_default_cfg.max_slots = 0;      /* Compile-time maximum */
+      pnet_default_cfg.max_subslots = 0;   /* Compile-time maximum */
+      pnet_default_cfg.max_submodules = 0; /* Compile-time maximum */
+      pnet_default_cfg.max_diag_items = 0; /* Compile-time maximum */
 
       pnet_default_cfg.im_0_data.vendor_id_hi = 0x00;
       pnet_default_cfg.im_0_data.vendor_id_lo = 0x01;
@@ -667,7 +673,7 @@ static uint16_t                  seq_nbr = 0;
 
 void test_read(test_reads_t *p_the_test)
 {
-   pf_ar_t                 *p_ar;
+   pf_ar_t                 *p_ar = NULL;
    uint8_t                 buffer[1500];
    uint16_t                pos = 0;
    uint16_t                idx = p_the_test->idx;
@@ -708,7 +714,9 @@ TEST_F (CmrdrTest, CmrdrRunTest)
          0x33,       /* Slot 1, subslot 1 Data */
    };
    uint8_t                 iops = PNET_IOXS_BAD;
+   uint8_t                 iops_len;
    uint8_t                 iocs = PNET_IOXS_BAD;
+   pnet_io_handle_t        handle = 0;
    uint32_t                ix;
    uint16_t                ch_properties = 0;
 
@@ -770,6 +778,14 @@ TEST_F (CmrdrTest, CmrdrRunTest)
    EXPECT_EQ(in_len, 1);
    EXPECT_EQ(iocs, PNET_IOXS_GOOD);
 
+   /* Nothing new until the next frame, but the last data is still there */
+   in_len = sizeof(in_data);
+   ret = pnet_output_get_data_and_iops(g_pnet, 0, 1, 1, &new_flag, in_data, &in_len, &iops);
+   EXPECT_EQ(ret, 0);
+   EXPECT_EQ(new_flag, false);
+   EXPECT_EQ(in_len, 1);
+   EXPECT_EQ(in_data[0], 0x23);
+
    EXPECT_EQ(state_calls, 4);
    EXPECT_EQ(cmdev_state, PNET_EVENT_DATA);
 
@@ -784,6 +800,42 @@ TEST_F (CmrdrTest, CmrdrRunTest)
    EXPECT_EQ(state_calls, 4);
    EXPECT_EQ(cmdev_state, PNET_EVENT_DATA);
 
+   /* Both updates are in the application buffer */
+   in_len = sizeof(in_data);
+   iops_len = sizeof(iops);
+   ret = pf_ppm_get_data_and_iops(g_pnet, 0, 1, 1, in_data, &in_len, &iops, &iops_len);
+   EXPECT_EQ(ret, 0);
+   EXPECT_EQ(in_len, 1);
+   EXPECT_EQ(in_data[0], out_data[0]);
+   EXPECT_EQ(iops, PNET_IOXS_GOOD);
+
+   /* Same calls through a sub-slot handle */
+   EXPECT_NE(pnet_io_handle_get(g_pnet, 0, 1, 2, &handle), 0);
+   ret = pnet_io_handle_get(g_pnet, 0, 1, 1, &handle);
+   EXPECT_EQ(ret, 0);
+   EXPECT_NE(handle, 0u);
+   in_len = sizeof(in_data);
+   ret = pnet_io_output_get_data_and_iops(g_pnet, handle, &new_flag, in_data, &in_len, &iops);
+   EXPECT_EQ(ret, 0);
+   EXPECT_EQ(new_flag, false);
+   EXPECT_EQ(in_len, 1);
+   EXPECT_EQ(in_data[0], 0x23);
+   iocs = 77;
+   ret = pnet_io_input_get_iocs(g_pnet, handle, &iocs);
+   EXPECT_EQ(ret, 0);
+   EXPECT_EQ(iocs, PNET_IOXS_GOOD);
+   out_data[0] = 0x44;
+   ret = pnet_io_input_set_data_and_iops(g_pnet, handle, out_data, sizeof(out_data), PNET_IOXS_GOOD);
+   EXPECT_EQ(ret, 0);
+   ret = pnet_io_output_set_iocs(g_pnet, handle, PNET_IOXS_GOOD);
+   EXPECT_EQ(ret, 0);
+   in_len = sizeof(in_data);
+   iops_len = sizeof(iops);
+   ret = pf_ppm_get_data_and_iops(g_pnet, 0, 1, 1, in_data, &in_len, &iops, &iops_len);
+   EXPECT_EQ(ret, 0);
+   EXPECT_EQ(in_data[0], 0x44);
+   EXPECT_NE(pnet_io_input_set_data_and_iops(g_pnet, handle ^ 0x01000000, out_data, sizeof(out_data), PNET_IOXS_GOOD), 0);
+
    /* Setup some record for the reader */
 
    /* Send data to avoid timeout */
@@ -818,6 +870,10 @@ TEST_F (CmrdrTest, CmrdrRunTest)
    EXPECT_EQ(release_calls, 1);
    EXPECT_EQ(state_calls, 5);
    EXPECT_EQ(cmdev_state, PNET_EVENT_ABORT);
+
+   /* The handle is gone with the AR */
+   ret = pnet_io_input_set_data_and_iops(g_pnet, handle, out_data, sizeof(out_data), PNET_IOXS_GOOD);
+   EXPECT_EQ(ret, -1);
    printf("Line %d\n", __LINE__);
 }
 
@@ -58,6 +58,9 @@ static uint16_t            data_cycle_ctr = 0x0;
 
 static pnet_t              *g_pnet;
 
+#define TEST_LARGE_RECORD_IDX 0x0001
+static uint8_t             large_record[3000];
+
 /**
  * This is just a simple example on how the application can maintain its list of supported APIs, modules and submodules.
  * If modules are supported in all slots > 0, then this is clearly overkill.
@@ -300,6 +303,11 @@ protected:
       pnet_default_cfg.ip_gateway.b = 168;
       pnet_default_cfg.ip_gateway.c = 1;
       pnet_default_cfg.ip_gateway.d = 1;
+      pnet_default_cfg.max_ar = 0;         /* Compile-time maximum */
+      pnet_default_cfg.max_slots = 0;      /* Compile-time maximum */
+      pnet_default_cfg.max_subslots = 0;   /* Compile-time maximum */
+      pnet_default_cfg.max_submodules = 0; /* Compile-time maximum */
+      pnet_default_cfg.max_diag_items = 0; /* Compile-time maximum */
 
       pnet_default_cfg.im_0_data.vendor_id_hi = 0x00;
       pnet_default_cfg.im_0_data.vendor_id_lo = 0x01;
@@ -422,6 +430,11 @@ static int my_read_ind(
    printf("Callback on read\n");
    printf("  API: %u Slot: %u Subslot: %u Index: %u Sequence: %u\n", api, slot, subslot, idx, sequence_number);
    read_calls++;
+   if ((idx == TEST_LARGE_RECORD_IDX) && (*p_read_length >= sizeof(large_record)))
+   {
+      *pp_read_data = large_record;
+      *p_read_length = sizeof(large_record);
+   }
    return 0;
 }
 static int my_write_ind(
@@ -968,141 +981,147 @@ TEST_F (CmrpcTest, CmrpcConnectReleaseTest)
    EXPECT_EQ(mock_os_udp_sendto_len, 132);
 }
 
-TEST_F(CmrpcTest, CmrpcConnectionTimeoutTest)
+TEST_F (CmrpcTest, CmrpcIdleSocketsAreNotRead)
 {
-   int                     ret;
-   bool                    new_flag = false;
-   uint8_t                 in_data[10];
-   uint16_t                in_len = sizeof(in_data);
-   uint8_t                 out_data[] = {
-         0x33,       /* Slot 1, subslot 1 Data */
-   };
-   uint8_t                 iops = PNET_IOXS_BAD;
-   uint32_t                ix;
+   uint32_t                calls;
 
-   printf("Line %d\n", __LINE__);
-   mock_set_os_udp_recvfrom_buffer(connect_req, sizeof(connect_req));
+   /* The sockets are read once after they are opened */
    os_usleep(TEST_UDP_DELAY);
-   EXPECT_EQ(state_calls, 1);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_STARTUP);
-   EXPECT_EQ(connect_calls, 1);
-   EXPECT_GT(mock_os_eth_send_count, 0);
+   calls = mock_os_udp_recvfrom_calls;
+   EXPECT_GT(calls, 0u);
 
-   printf("Line %d\n", __LINE__);
-   mock_set_os_udp_recvfrom_buffer(write_req, sizeof(write_req));
    os_usleep(TEST_UDP_DELAY);
+   EXPECT_EQ(mock_os_udp_recvfrom_calls, calls);
 
-   EXPECT_EQ(state_calls, 1);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_STARTUP);
-   EXPECT_EQ(connect_calls, 1);
-
-   printf("Line %d\n", __LINE__);
-   mock_set_os_udp_recvfrom_buffer(prm_end_req, sizeof(prm_end_req));
+   /* Read until empty when data has arrived */
+   mock_set_os_udp_recvfrom_buffer(connect_req, sizeof(connect_req));
    os_usleep(TEST_UDP_DELAY);
-
-   EXPECT_EQ(state_calls, 2);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_PRMEND);
    EXPECT_EQ(connect_calls, 1);
+   EXPECT_EQ(mock_os_udp_sendto_count, 1);
+   EXPECT_EQ(mock_os_udp_recvfrom_calls, calls + 2);
+}
 
-   printf("Line %d\n", __LINE__);
-   /* Simulate application calling APPL_RDY */
-   ret = pnet_application_ready(g_pnet, main_arep);
-   EXPECT_EQ(ret, 0);
-   EXPECT_EQ(state_calls, 3);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_APPLRDY);
+TEST_F (CmrpcTest, CmrpcFragmentedReadResponse)
+{
+   uint8_t                 read_req[sizeof(read_im0_req)];
+   uint8_t                 fack[PF_RPC_HEADER_SIZE];
+   uint16_t                body_len;
+   uint16_t                total_len = 0;
+   uint16_t                frag_nbr;
+   uint16_t                sent = 2;
 
-   printf("Line %d\n", __LINE__);
-   mock_set_os_udp_recvfrom_buffer(appl_rdy_rsp, sizeof(appl_rdy_rsp));
+   mock_set_os_udp_recvfrom_buffer(connect_req, sizeof(connect_req));
    os_usleep(TEST_UDP_DELAY);
-   EXPECT_EQ(state_calls, 3);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_APPLRDY);
-
-   printf("Line %d\n", __LINE__);
-   /* Send a couple of data packets to move pf_cpm to RUN state */
-   for (ix = 0; ix < 100; ix++)
-   {
-      send_data(g_pnet, data_packet, sizeof(data_packet));
-   }
+   EXPECT_EQ(connect_calls, 1);
 
-   EXPECT_EQ(state_calls, 4);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_DATA);
+   /* Read an application record that does not fit in one datagram */
+   memcpy(read_req, read_im0_req, sizeof(read_req));
+   read_req[134] = TEST_LARGE_RECORD_IDX >> 8;
+   read_req[135] = TEST_LARGE_RECORD_IDX & 0xff;
+   mock_set_os_udp_recvfrom_buffer(read_req, sizeof(read_req));
+   os_usleep(TEST_UDP_DELAY);
+   EXPECT_EQ(read_calls, 1);
 
-   printf("Line %d\n", __LINE__);
-   /* Read data just to see that it works */
-   in_len = sizeof(in_data);
-   ret = pnet_output_get_data_and_iops(g_pnet, 0, 1, 1, &new_flag, in_data, &in_len, &iops);
-   EXPECT_EQ(ret, 0);
-   EXPECT_EQ(new_flag, true);
-   EXPECT_EQ(in_len, 1);
-   EXPECT_EQ(iops, PNET_IOXS_GOOD);
+   /* The FACK repeats the request header with the fragment number */
+   memcpy(fack, read_req, sizeof(fack));
+   fack[1] = PF_RPC_PT_FRAG_ACK;
+   fack[2] = 0;
+   fack[74] = 0;
+   fack[75] = 0;
 
-   printf("Line %d\n", __LINE__);
-   /* Send new data to move PPM to RUN state */
-   ret = pnet_input_set_data_and_iops(g_pnet, 0, 1, 1, out_data, sizeof(out_data), PNET_IOXS_GOOD);
-   EXPECT_EQ(ret, 0);
+   for (frag_nbr = 0; frag_nbr < 10; frag_nbr++)
+   {
+      ASSERT_EQ(mock_os_udp_sendto_count, sent);
+      ASSERT_LE(mock_os_udp_sendto_len, PF_RPC_MAX_UDP_PAYLOAD);
+
+      /* Big-endian header: flags, length_of_body, fragment_nmb */
+      EXPECT_EQ(mock_os_udp_sendto_copy[1], PF_RPC_PT_RESPONSE);
+      EXPECT_NE(mock_os_udp_sendto_copy[2] & BIT(PF_RPC_F_FRAGMENT), 0);
+      body_len = (mock_os_udp_sendto_copy[74] << 8) | mock_os_udp_sendto_copy[75];
+      EXPECT_EQ(body_len + PF_RPC_HEADER_SIZE, mock_os_udp_sendto_len);
+      EXPECT_EQ((mock_os_udp_sendto_copy[76] << 8) | mock_os_udp_sendto_copy[77], frag_nbr);
+      total_len += body_len;
+
+      if ((mock_os_udp_sendto_copy[2] & BIT(PF_RPC_F_LAST_FRAGMENT)) != 0)
+      {
+         EXPECT_NE(mock_os_udp_sendto_copy[2] & BIT(PF_RPC_F_NO_FACK), 0);
+         break;
+      }
+      EXPECT_EQ(mock_os_udp_sendto_copy[2] & BIT(PF_RPC_F_NO_FACK), 0);
+      EXPECT_EQ(body_len, PF_RPC_MAX_FRAGMENT_BODY);
 
-   /* Wait for timeout in CPM */
-   os_usleep(TEST_TIMEOUT_DELAY);
+      /* A repeated FACK for the previous fragment means this one was lost */
+      if (frag_nbr > 0)
+      {
+         fack[77] = frag_nbr - 1;
+         mock_set_os_udp_recvfrom_buffer(fack, sizeof(fack));
+         os_usleep(TEST_UDP_DELAY);
+         sent++;
+         ASSERT_EQ(mock_os_udp_sendto_count, sent);
+         EXPECT_EQ((mock_os_udp_sendto_copy[76] << 8) | mock_os_udp_sendto_copy[77], frag_nbr);
+         EXPECT_EQ((mock_os_udp_sendto_copy[74] << 8) | mock_os_udp_sendto_copy[75], body_len);
+      }
 
-   EXPECT_EQ(release_calls, 0);
-   EXPECT_EQ(state_calls, 5);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_ABORT);
-   printf("Line %d\n", __LINE__);
+      fack[77] = frag_nbr;
+      mock_set_os_udp_recvfrom_buffer(fack, sizeof(fack));
+      os_usleep(TEST_UDP_DELAY);
+      sent++;
+   }
 
-   mock_set_os_udp_recvfrom_buffer(release_req, sizeof(release_req));
-   os_usleep(TEST_UDP_DELAY);
+   /* PNIO status, NDR header, read result block and the record */
+   EXPECT_EQ(frag_nbr, 2);
+   EXPECT_EQ(total_len, 4 + 16 + 64 + sizeof(large_record));
 
-   EXPECT_EQ(release_calls, 0);
-   EXPECT_EQ(state_calls, 5);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_ABORT);
+   /* No more fragments, and the last one is not sent again */
+   fack[77] = frag_nbr;
+   mock_set_os_udp_recvfrom_buffer(fack, sizeof(fack));
+   os_usleep(PF_RPC_FRAGMENT_TIMEOUT + TEST_UDP_DELAY);
+   EXPECT_EQ(mock_os_udp_sendto_count, sent);
 }
 
-/**
- *  Replicate startup with a Siemens S7-1200 controller
- */
-TEST_F (CmrpcTest, CmrpcSiemensConnectTest)
+TEST_F (CmrpcTest, CmrpcFragmentRetransmit)
 {
-   EXPECT_EQ(mock_os_udp_sendto_len, 0);
+   uint8_t                 read_req[sizeof(read_im0_req)];
+   uint8_t                 fack[PF_RPC_HEADER_SIZE];
+   uint8_t                 first[PF_RPC_MAX_UDP_PAYLOAD];
+   uint16_t                first_len;
 
-   printf("\nGenerating mock connection request\n");
-   mock_set_os_udp_recvfrom_buffer(connect_req_siemens, sizeof(connect_req_siemens));
+   mock_set_os_udp_recvfrom_buffer(connect_req, sizeof(connect_req));
    os_usleep(TEST_UDP_DELAY);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_STARTUP);
-   EXPECT_EQ(state_calls, 1);
    EXPECT_EQ(connect_calls, 1);
-   EXPECT_EQ(write_calls, 0);
-   EXPECT_EQ(read_calls, 0);
-   EXPECT_EQ(ccontrol_calls, 0);
-   EXPECT_EQ(dcontrol_calls, 0);
-   EXPECT_GT(mock_os_eth_send_count, 0);
-   EXPECT_EQ(mock_os_udp_sendto_count, 1);
-   EXPECT_EQ(mock_os_udp_sendto_len, 178);  // Actual value. OK in Wireshark (232 bytes)
 
-   printf("\nGenerating mock write request\n");
-   mock_set_os_udp_recvfrom_buffer(write_req_siemens, sizeof(write_req_siemens));
+   memcpy(read_req, read_im0_req, sizeof(read_req));
+   read_req[134] = TEST_LARGE_RECORD_IDX >> 8;
+   read_req[135] = TEST_LARGE_RECORD_IDX & 0xff;
+   mock_set_os_udp_recvfrom_buffer(read_req, sizeof(read_req));
    os_usleep(TEST_UDP_DELAY);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_STARTUP);
-   EXPECT_EQ(state_calls, 1);
-   EXPECT_EQ(connect_calls, 1);
-   EXPECT_EQ(write_calls, 2);
-   EXPECT_EQ(read_calls, 0);
-   EXPECT_EQ(ccontrol_calls, 0);
-   EXPECT_EQ(dcontrol_calls, 0);
-   EXPECT_EQ(mock_os_udp_sendto_count, 2);
-   EXPECT_EQ(mock_os_udp_sendto_len, 356);  // Actual value. OK in Wireshark (398 bytes)
-
-   printf("\nGenerating mock parameter end request\n");
-   mock_set_os_udp_recvfrom_buffer(prm_end_req_siemens, sizeof(prm_end_req_siemens));
+   ASSERT_EQ(mock_os_udp_sendto_count, 2);
+   first_len = mock_os_udp_sendto_len;
+   ASSERT_LE(first_len, sizeof(first));
+   memcpy(first, mock_os_udp_sendto_copy, first_len);
+
+   /* The FACK is lost. The fragment is sent again, unchanged. */
+   os_usleep(PF_RPC_FRAGMENT_TIMEOUT);
+   ASSERT_EQ(mock_os_udp_sendto_count, 3);
+   EXPECT_EQ(mock_os_udp_sendto_len, first_len);
+   EXPECT_EQ(memcmp(mock_os_udp_sendto_copy, first, first_len), 0);
+
+   /* The FACK arrives. The next fragment is sent. */
+   memcpy(fack, read_req, sizeof(fack));
+   fack[1] = PF_RPC_PT_FRAG_ACK;
+   fack[2] = 0;
+   fack[74] = 0;
+   fack[75] = 0;
+   fack[77] = 0;
+   mock_set_os_udp_recvfrom_buffer(fack, sizeof(fack));
    os_usleep(TEST_UDP_DELAY);
-   EXPECT_EQ(cmdev_state, PNET_EVENT_PRMEND);
-   EXPECT_EQ(state_calls, 2);
-   EXPECT_EQ(connect_calls, 1);
-   EXPECT_EQ(write_calls, 2);
-   EXPECT_EQ(read_calls, 0);
-   EXPECT_EQ(ccontrol_calls, 0);
-   EXPECT_EQ(dcontrol_calls, 1);
-   EXPECT_EQ(mock_os_udp_sendto_count, 3);
-   EXPECT_EQ(mock_os_udp_sendto_len, 132);  // 20 bytes longer than sent from faulty application
+   ASSERT_EQ(mock_os_udp_sendto_count, 4);
+   EXPECT_EQ((mock_os_udp_sendto_copy[76] << 8) | mock_os_udp_sendto_copy[77], 1);
+
+   /* No FACK at all. The stack gives up after a number of retries. */
+   os_usleep((PF_RPC_FRAGMENT_RETRIES + 1) * PF_RPC_FRAGMENT_TIMEOUT + TEST_UDP_DELAY);
+   EXPECT_EQ(mock_os_udp_sendto_count, 4 + PF_RPC_FRAGMENT_RETRIES);
+   EXPECT_EQ((mock_os_udp_sendto_copy[76] << 8) | mock_os_udp_sendto_copy[77], 1);
 }
 
 TEST_F (CmrpcTest, CmrpcConnectFragmentTest)
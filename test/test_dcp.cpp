@@ -271,6 +271,17 @@ protected:
       pnet_default_cfg.ip_gateway.b = 168;
       pnet_default_cfg.ip_gateway.c = 1;
       pnet_default_cfg.ip_gateway.d = 1;
+      pnet_default_cfg.max_ar = 0;         /* Compile-time maximum */
+      pnet_default_cfg.max_slots = 0;      /* Compile-time maximum */
+      pnet_default_cfg.max_subslots = 0;   /* Compile-time maximum */
+      pnet_default_cfg.max_submodules = 0; /* Compile-time maximum */
+      pnet_default_cfg.max_diag_items = 0; /* Compile-time maximum */
+      pnet_default_cfg.eth_addr.addr[0] = 0x12;
+      pnet_default_cfg.eth_addr.addr[1] = 0x34;
+      pnet_default_cfg.eth_addr.addr[2] = 0x00;
+      pnet_default_cfg.eth_addr.addr[3] = 0x78;
+      pnet_default_cfg.eth_addr.addr[4] = 0x90;
+      pnet_default_cfg.eth_addr.addr[5] = 0xab;
 
       pnet_default_cfg.im_0_data.vendor_id_hi = 0x00;
       pnet_default_cfg.im_0_data.vendor_id_lo = 0x01;
@@ -604,3 +615,128 @@ TEST_F (DcpTest, DcpRunTest)
    EXPECT_EQ(read_calls, 0);
    EXPECT_EQ(write_calls, 0);
 }
+
+TEST_F (DcpTest, DcpIdentifyTest)
+{
+   os_buf_t                *p_buf;
+   uint8_t                 ident_all_req[sizeof(ident_req)];
+   uint16_t                ident_len;
+   int                     ret;
+
+   /* Identify All, xid 0x07 */
+   memset(ident_all_req, 0, sizeof(ident_all_req));
+   memcpy(ident_all_req, ident_req, 16);
+   ident_all_req[16] = 0x05;
+   ident_all_req[21] = 0x07;
+   ident_all_req[23] = 0x01;
+   ident_all_req[25] = 0x04;
+   ident_all_req[26] = 0xff;
+   ident_all_req[27] = 0xff;
+
+   /* Also stops the HELLO messages */
+   p_buf = os_buf_alloc(1500);
+   memcpy(p_buf->payload, set_name_req, sizeof(set_name_req));
+   ret = pf_eth_recv(g_pnet, p_buf);
+   EXPECT_EQ(ret, 1);
+   os_usleep(50*1000);
+   mock_clear();
+
+   /* Filter on another name of station */
+   p_buf = os_buf_alloc(1500);
+   memcpy(p_buf->payload, ident_req, sizeof(ident_req));
+   ((uint8_t *)p_buf->payload)[32] = 'x';
+   ret = pf_eth_recv(g_pnet, p_buf);
+   EXPECT_EQ(ret, 1);
+   os_usleep(50*1000);
+   EXPECT_EQ(mock_os_eth_send_count, 0);
+
+   /* Filter on our name of station */
+   p_buf = os_buf_alloc(1500);
+   memcpy(p_buf->payload, ident_req, sizeof(ident_req));
+   ret = pf_eth_recv(g_pnet, p_buf);
+   EXPECT_EQ(ret, 1);
+   os_usleep(50*1000);
+   EXPECT_EQ(mock_os_eth_send_count, 1);
+   EXPECT_EQ(memcmp(mock_os_eth_send_copy, &ident_req[6], 6), 0);
+   EXPECT_EQ(mock_os_eth_send_copy[14], 0xfe);
+   EXPECT_EQ(mock_os_eth_send_copy[15], 0xff);
+   EXPECT_EQ(mock_os_eth_send_copy[16], 0x05);
+   EXPECT_EQ(mock_os_eth_send_copy[17], 0x01);
+   EXPECT_EQ(mock_os_eth_send_copy[21], 0x02);
+   ident_len = mock_os_eth_send_len;
+
+   /* The cached response is reused with a new xid */
+   p_buf = os_buf_alloc(1500);
+   memcpy(p_buf->payload, ident_all_req, sizeof(ident_all_req));
+   ret = pf_eth_recv(g_pnet, p_buf);
+   EXPECT_EQ(ret, 1);
+   os_usleep(50*1000);
+   EXPECT_EQ(mock_os_eth_send_count, 2);
+   EXPECT_EQ(mock_os_eth_send_copy[21], 0x07);
+   EXPECT_EQ(mock_os_eth_send_len, ident_len);
+
+   /* A new name of station is seen in the next response */
+   p_buf = os_buf_alloc(1500);
+   memcpy(p_buf->payload, set_name_req, sizeof(set_name_req));
+   ((uint8_t *)p_buf->payload)[32 + 12] = 'x';
+   ((uint8_t *)p_buf->payload)[29] = 0x0f;
+   ((uint8_t *)p_buf->payload)[25] = 0x13;
+   ret = pf_eth_recv(g_pnet, p_buf);
+   EXPECT_EQ(ret, 1);
+   os_usleep(50*1000);
+   mock_clear();
+
+   p_buf = os_buf_alloc(1500);
+   memcpy(p_buf->payload, ident_all_req, sizeof(ident_all_req));
+   ret = pf_eth_recv(g_pnet, p_buf);
+   EXPECT_EQ(ret, 1);
+   os_usleep(50*1000);
+   EXPECT_EQ(mock_os_eth_send_count, 1);
+   EXPECT_EQ(mock_os_eth_send_len, ident_len + 2);
+   EXPECT_EQ(strcmp(g_pnet->cmina_temp_dcp_ase.name_of_station, "rt-labs-demox"), 0);
+}
+
+TEST_F (DcpTest, DcpIdentifyConcurrentTest)
+{
+   os_buf_t                *p_buf;
+   uint8_t                 ident_all_req[sizeof(ident_req)];
+   uint8_t                 xid;
+   int                     ret;
+
+   /* Identify All, response delay factor 10 gives 50 ms delay for this MAC */
+   memset(ident_all_req, 0, sizeof(ident_all_req));
+   memcpy(ident_all_req, ident_req, 16);
+   ident_all_req[16] = 0x05;
+   ident_all_req[23] = 10;
+   ident_all_req[25] = 0x04;
+   ident_all_req[26] = 0xff;
+   ident_all_req[27] = 0xff;
+
+   /* Also stops the HELLO messages */
+   p_buf = os_buf_alloc(1500);
+   memcpy(p_buf->payload, set_name_req, sizeof(set_name_req));
+   ret = pf_eth_recv(g_pnet, p_buf);
+   EXPECT_EQ(ret, 1);
+   os_usleep(50*1000);
+   mock_clear();
+
+   /* One more request than there are response slots, and one repeated request */
+   for (xid = 1; xid <= PNET_MAX_DCP_RESPONSES + 1; xid++)
+   {
+      p_buf = os_buf_alloc(1500);
+      ident_all_req[21] = xid;
+      memcpy(p_buf->payload, ident_all_req, sizeof(ident_all_req));
+      ret = pf_eth_recv(g_pnet, p_buf);
+      EXPECT_EQ(ret, 1);
+   }
+   p_buf = os_buf_alloc(1500);
+   ident_all_req[21] = 1;
+   memcpy(p_buf->payload, ident_all_req, sizeof(ident_all_req));
+   ret = pf_eth_recv(g_pnet, p_buf);
+   EXPECT_EQ(ret, 1);
+   EXPECT_EQ(mock_os_eth_send_count, 0);
+
+   os_usleep(200*1000);
+   EXPECT_EQ(mock_os_eth_send_count, PNET_MAX_DCP_RESPONSES);
+   EXPECT_EQ(g_pnet->dcp_response_drop_cnt, 1u);
+}
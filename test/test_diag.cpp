@@ -287,6 +287,11 @@ protected:
       pnet_default_cfg.ip_gateway.b = 168;
       pnet_default_cfg.ip_gateway.c = 1;
       pnet_default_cfg.ip_gateway.d = 1;
+      pnet_default_cfg.max_ar = 0;         /* Compile-time maximum */
+      pnet_default_cfg.max_slots = 0;      /* Compile-time maximum */
+      pnet_default_cfg.max_subslots = 0;   /* Compile-time maximum */
+      pnet_default_cfg.max_submodules = 0; /* Compile-time maximum */
+      pnet_default_cfg.max_diag_items = 0; /* Compile-time maximum */
 
       pnet_default_cfg.im_0_data.vendor_id_hi = 0x00;
       pnet_default_cfg.im_0_data.vendor_id_lo = 0x01;
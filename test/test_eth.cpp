@@ -20,16 +20,60 @@
 #include "mocks.h"
 #include "test_util.h"
 
+static uint16_t            handled_frame_id;
+static void                *handled_arg;
+static uint16_t            handled_cnt;
+
+static int test_frame_handler(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   os_buf_t                *p_buf,
+   uint16_t                frame_id_pos,
+   void                    *p_arg)
+{
+   handled_frame_id = frame_id;
+   handled_arg = p_arg;
+   handled_cnt++;
+   return 1;
+}
+
+static int test_recv(
+   pnet_t                  *net,
+   uint16_t                frame_id)
+{
+   uint8_t                 frame[64];
+   os_buf_t                buf;
+
+   memset(frame, 0, sizeof(frame));
+   frame[12] = OS_ETHTYPE_PROFINET >> 8;
+   frame[13] = OS_ETHTYPE_PROFINET & 0xff;
+   frame[14] = frame_id >> 8;
+   frame[15] = frame_id & 0xff;
+   buf.payload = frame;
+   buf.len = sizeof(frame);
+
+   return pf_eth_recv(net, &buf);
+}
+
 // Test fixture
 
 class EthTest : public ::testing::Test
 {
 protected:
    virtual void SetUp() {
-      memset (&net, 0, sizeof(net));
+      net = (pnet_t *)calloc(1, sizeof(*net));
+      pf_eth_init(net);
+
+      handled_frame_id = 0;
+      handled_arg = NULL;
+      handled_cnt = 0;
    };
 
-   pnet_cfg_t net;
+   virtual void TearDown() {
+      free(net);
+   };
+
+   pnet_t *net;
 };
 
 // Tests
@@ -37,3 +81,98 @@ protected:
 TEST_F (EthTest, EthRunTest)
 {
 }
+
+TEST_F (EthTest, EthFrameIdMapDispatch)
+{
+   uint16_t                ix;
+
+   /* Fill the map with consecutive cyclic frame ids and a few others */
+   for (ix = 0; ix < PF_ETH_MAX_MAP - 2; ix++)
+   {
+      pf_eth_frame_id_map_add(net, 0x8000 + ix, test_frame_handler, (void *)(uintptr_t)(ix + 1));
+   }
+   pf_eth_frame_id_map_add(net, 0xfefe, test_frame_handler, (void *)0xfefe);
+
+   EXPECT_EQ(0, test_recv(net, 0x7fff));
+   EXPECT_EQ(0, handled_cnt);
+
+   for (ix = 0; ix < PF_ETH_MAX_MAP - 2; ix++)
+   {
+      EXPECT_EQ(1, test_recv(net, 0x8000 + ix));
+      EXPECT_EQ(0x8000 + ix, handled_frame_id);
+      EXPECT_EQ((void *)(uintptr_t)(ix + 1), handled_arg);
+   }
+   EXPECT_EQ(1, test_recv(net, 0xfefe));
+   EXPECT_EQ((void *)0xfefe, handled_arg);
+
+   /* Removed ids are no longer dispatched, the others still are */
+   pf_eth_frame_id_map_remove(net, 0x8001);
+   EXPECT_EQ(0, test_recv(net, 0x8001));
+   EXPECT_EQ(1, test_recv(net, 0x8002));
+   EXPECT_EQ((void *)3, handled_arg);
+   EXPECT_EQ(1, test_recv(net, 0xfefe));
+
+   /* The entry can be reused for another frame id */
+   pf_eth_frame_id_map_add(net, 0xbbff, test_frame_handler, (void *)0xbbff);
+   EXPECT_EQ(1, test_recv(net, 0xbbff));
+   EXPECT_EQ((void *)0xbbff, handled_arg);
+
+   /* Repeated add and remove does not exhaust the table */
+   for (ix = 0; ix < 1000; ix++)
+   {
+      pf_eth_frame_id_map_add(net, 0xc000 + (ix % 100), test_frame_handler, NULL);
+      pf_eth_frame_id_map_remove(net, 0xc000 + (ix % 100));
+   }
+   EXPECT_EQ(0, test_recv(net, 0xc000));
+   EXPECT_EQ(1, test_recv(net, 0x8000));
+   EXPECT_EQ((void *)1, handled_arg);
+}
+
+TEST_F (EthTest, EthFrameIdMapRemoveShouldFreeSlots)
+{
+   uint16_t                ix;
+   uint16_t                cycle;
+   uint16_t                used;
+
+   /* Frame ids with the same home slot form one probe sequence */
+   for (ix = 0; ix < 4; ix++)
+   {
+      pf_eth_frame_id_map_add(net, 0x8000 + ix * PF_ETH_HASH_SIZE, test_frame_handler, (void *)(uintptr_t)(ix + 1));
+   }
+   pf_eth_frame_id_map_add(net, 0x8001, test_frame_handler, (void *)5);
+
+   /* Removing from the middle keeps the rest of the sequence reachable */
+   pf_eth_frame_id_map_remove(net, 0x8000 + PF_ETH_HASH_SIZE);
+   EXPECT_EQ(0, test_recv(net, 0x8000 + PF_ETH_HASH_SIZE));
+   EXPECT_EQ(1, test_recv(net, 0x8000 + 3 * PF_ETH_HASH_SIZE));
+   EXPECT_EQ((void *)4, handled_arg);
+   EXPECT_EQ(1, test_recv(net, 0x8001));
+   EXPECT_EQ((void *)5, handled_arg);
+
+   /* Connect and release cycles with changing frame ids leave nothing behind */
+   for (cycle = 0; cycle < 100; cycle++)
+   {
+      for (ix = 0; ix < 10; ix++)
+      {
+         pf_eth_frame_id_map_add(net, 0x9000 + cycle * 7 + ix * 3, test_frame_handler, NULL);
+      }
+      for (ix = 0; ix < 10; ix++)
+      {
+         pf_eth_frame_id_map_remove(net, 0x9000 + cycle * 7 + ix * 3);
+      }
+   }
+   pf_eth_frame_id_map_remove(net, 0x8000);
+   pf_eth_frame_id_map_remove(net, 0x8000 + 2 * PF_ETH_HASH_SIZE);
+   pf_eth_frame_id_map_remove(net, 0x8000 + 3 * PF_ETH_HASH_SIZE);
+   pf_eth_frame_id_map_remove(net, 0x8001);
+
+   used = 0;
+   for (ix = 0; ix < PF_ETH_HASH_SIZE; ix++)
+   {
+      if (net->eth_id_hash[ix] != 0)
+      {
+         used++;
+      }
+   }
+   EXPECT_EQ(0, used);
+}
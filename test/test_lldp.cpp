@@ -172,6 +172,19 @@ static void test_periodic(os_timer_t *p_timer, void *p_arg)
    pnet_handle_periodic(g_pnet);
 }
 
+static const uint8_t lldp_peer_frame[] =
+{
+   0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e,             /* Destination */
+   0x02, 0x00, 0x00, 0x00, 0x00, 0x01,             /* Source */
+   0x88, 0xcc,                                     /* LLDP */
+   0x02, 0x07, 0x07, 'p', 'e', 'e', 'r', '-', '1', /* Chassis ID, locally assigned */
+   0x04, 0x06, 0x07, 'p', 'o', 'r', 't', '2',      /* Port ID, locally assigned */
+   0x06, 0x02, 0x00, 0x02,                         /* TTL 2 s */
+   0x10, 0x0c, 0x05, 0x01, 0xc0, 0xa8, 0x01, 0x05, /* Management address 192.168.1.5 */
+   0x02, 0x00, 0x00, 0x00, 0x01, 0x00,
+   0x00, 0x00,                                     /* End */
+};
+
 class LldpTest : public ::testing::Test
 {
 protected:
@@ -188,6 +201,13 @@ protected:
       os_timer_start(periodic_timer);
    };
 
+   virtual void TearDown()
+   {
+      /* Stop driving this instance, so it does not read the mocked
+       * sockets of the next test */
+      os_timer_destroy(periodic_timer);
+   };
+
    pnet_cfg_t pnet_default_cfg;
 
    void counter_reset()
@@ -239,7 +259,13 @@ protected:
 
       strcpy(pnet_default_cfg.lldp_cfg.chassis_id, "rt-labs demo system"); /* Is this a valid name? '-' allowed?*/
       strcpy(pnet_default_cfg.lldp_cfg.port_id, "port-001");
-      pnet_default_cfg.lldp_cfg.ttl = 20; /* seconds */
+      pnet_default_cfg.eth_addr.addr[0] = 0x12;
+      pnet_default_cfg.eth_addr.addr[1] = 0x34;
+      pnet_default_cfg.eth_addr.addr[2] = 0x00;
+      pnet_default_cfg.eth_addr.addr[3] = 0x78;
+      pnet_default_cfg.eth_addr.addr[4] = 0x90;
+      pnet_default_cfg.eth_addr.addr[5] = 0xab;
+      pnet_default_cfg.lldp_cfg.ttl = 4; /* seconds, gives a 1 s transmit interval */
       pnet_default_cfg.lldp_cfg.rtclass_2_status = 0;
       pnet_default_cfg.lldp_cfg.rtclass_3_status = 0;
       pnet_default_cfg.lldp_cfg.cap_aneg = 3; /* Supported (0x01) + enabled (0x02) */
@@ -261,6 +287,11 @@ protected:
       pnet_default_cfg.ip_gateway.b = 168;
       pnet_default_cfg.ip_gateway.c = 1;
       pnet_default_cfg.ip_gateway.d = 1;
+      pnet_default_cfg.max_ar = 0;         /* Compile-time maximum */
+      pnet_default_cfg.max_slots = 0;      /* Compile-time maximum */
+      pnet_default_cfg.max_subslots = 0;   /* Compile-time maximum */
+      pnet_default_cfg.max_submodules = 0; /* Compile-time maximum */
+      pnet_default_cfg.max_diag_items = 0; /* Compile-time maximum */
 
       pnet_default_cfg.im_0_data.vendor_id_hi = 0x00;
       pnet_default_cfg.im_0_data.vendor_id_lo = 0x01;
@@ -487,3 +518,84 @@ TEST_F(LldpTest, LldpInitTest)
    EXPECT_EQ(0, read_calls);
    EXPECT_EQ(0, write_calls);
 }
+
+TEST_F(LldpTest, LldpPeriodicTest)
+{
+   uint8_t                 frame[1500];
+   uint16_t                len;
+   uint8_t                 ip_suite[12] = { 0 };
+   uint8_t                 block_error;
+   uint32_t                ip_addr = 0xc0a80102;
+   static const uint8_t    ip_bytes[] = { 0xc0, 0xa8, 0x01, 0x02 };
+   bool                    found = false;
+   uint16_t                ix;
+
+   EXPECT_EQ(mock_os_eth_send_count, 1);
+   len = mock_os_eth_send_len;
+   memcpy(frame, mock_os_eth_send_copy, len);
+
+   /* The same frame is sent again at the transmit interval */
+   os_usleep(1500*1000);
+   EXPECT_EQ(mock_os_eth_send_count, 2);
+   EXPECT_EQ(mock_os_eth_send_len, len);
+   EXPECT_EQ(memcmp(mock_os_eth_send_copy, frame, len), 0);
+
+   /* A new IP address is seen in the next frame */
+   memcpy(ip_suite, &ip_addr, sizeof(ip_addr));
+   EXPECT_EQ(pf_cmina_dcp_set_ind(g_pnet, PF_DCP_OPT_IP, PF_DCP_SUB_IP_PAR, 0,
+      sizeof(ip_suite), ip_suite, &block_error), 0);
+   pf_lldp_send(g_pnet);
+   EXPECT_EQ(mock_os_eth_send_count, 3);
+   EXPECT_EQ(mock_os_eth_send_len, len);
+   for (ix = 0; ix + sizeof(ip_bytes) <= len; ix++)
+   {
+      if (memcmp(&mock_os_eth_send_copy[ix], ip_bytes, sizeof(ip_bytes)) == 0)
+      {
+         found = true;
+      }
+   }
+   EXPECT_TRUE(found);
+}
+
+TEST_F(LldpTest, LldpNeighbourTest)
+{
+   os_buf_t                *p_buf;
+   pf_lldp_peer_t          peers[PNET_MAX_LLDP_PEERS];
+   int                     ret;
+
+   p_buf = os_buf_alloc(1500);
+   memcpy(p_buf->payload, lldp_peer_frame, sizeof(lldp_peer_frame));
+   p_buf->len = sizeof(lldp_peer_frame);
+   ret = pf_eth_recv(g_pnet, p_buf);
+   EXPECT_EQ(ret, 1);
+
+   EXPECT_EQ(pf_lldp_get_peers(g_pnet, 0, peers, NELEMENTS(peers)), 1);
+   EXPECT_EQ(peers[0].chassis_id_len, 6);
+   EXPECT_EQ(memcmp(peers[0].chassis_id, "peer-1", 6), 0);
+   EXPECT_EQ(peers[0].port_id_len, 5);
+   EXPECT_EQ(memcmp(peers[0].port_id, "port2", 5), 0);
+   EXPECT_EQ(memcmp(peers[0].mac_address.addr, &lldp_peer_frame[6], sizeof(pnet_ethaddr_t)), 0);
+   EXPECT_TRUE(peers[0].has_ip_address);
+
+   /* The neighbour is removed when its TTL expires */
+   os_usleep(3500*1000);
+   EXPECT_EQ(pf_lldp_get_peers(g_pnet, 0, peers, NELEMENTS(peers)), 0);
+}
+
+TEST_F(LldpTest, LldpNeighbourAtInitTest)
+{
+   pnet_t                  *net;
+   os_buf_t                *p_buf;
+   pf_lldp_peer_t          peers[PNET_MAX_LLDP_PEERS];
+
+   /* A frame received as soon as the interface is opened is not lost */
+   p_buf = os_buf_alloc(1500);
+   memcpy(p_buf->payload, lldp_peer_frame, sizeof(lldp_peer_frame));
+   p_buf->len = sizeof(lldp_peer_frame);
+   mock_os_eth_init_frame = p_buf;
+
+   net = pnet_init("en1", TICK_INTERVAL_US, &pnet_default_cfg);
+   ASSERT_NE(net, nullptr);
+   EXPECT_EQ(mock_os_eth_init_frame, nullptr);
+   EXPECT_EQ(pf_lldp_get_peers(net, 0, peers, NELEMENTS(peers)), 1);
+}
@@ -20,8 +20,12 @@
  */
 
 #include "osal.h"
+#include "options.h"
+#include "log.h"
 #include <gtest/gtest.h>
 
+#include <unistd.h>
+
 static int expired_calls;
 static void * expired_arg;
 static void expired (os_timer_t * timer, void * arg)
@@ -141,6 +145,50 @@ TEST (Osal, PostToFullMBoxShouldTimeout)
    os_mbox_destroy (mbox);
 }
 
+#define MBOX_TEST_MSGS 20000
+
+static void mbox_producer (void * arg)
+{
+   uintptr_t * p_arg = (uintptr_t *)arg;
+   os_mbox_t * mbox = (os_mbox_t *)p_arg[0];
+   uintptr_t id = p_arg[1];
+   uintptr_t ix;
+
+   for (ix = 1; ix <= MBOX_TEST_MSGS; ix++)
+   {
+      os_mbox_post (mbox, (void *)((id << 24) | ix), OS_WAIT_FOREVER);
+   }
+}
+
+TEST (Osal, MboxShouldPassMessagesBetweenThreads)
+{
+   os_mbox_t * mbox = os_mbox_create(4);
+   uintptr_t producer[2][2] = {{(uintptr_t)mbox, 1}, {(uintptr_t)mbox, 2}};
+   uintptr_t last[3] = {0, 0, 0};
+   uintptr_t value;
+   void * msg;
+   int ix;
+   int tmo;
+
+   os_thread_create ("mbox1", 5, 4096, mbox_producer, producer[0]);
+   os_thread_create ("mbox2", 5, 4096, mbox_producer, producer[1]);
+
+   for (ix = 0; ix < 2 * MBOX_TEST_MSGS; ix++)
+   {
+      tmo = os_mbox_fetch (mbox, &msg, 1000);
+      ASSERT_EQ (0, tmo);
+      value = (uintptr_t)msg;
+      ASSERT_TRUE ((value >> 24) == 1 || (value >> 24) == 2);
+      /* Messages from each producer arrive in order */
+      EXPECT_EQ (last[value >> 24] + 1, value & 0xffffff);
+      last[value >> 24] = value & 0xffffff;
+   }
+   /* Also lets the producers return from their last post */
+   EXPECT_EQ (1, os_mbox_fetch (mbox, &msg, 10));
+
+   os_mbox_destroy (mbox);
+}
+
 TEST (Osal, CyclicTimer)
 {
    int t0, t1;
@@ -183,3 +231,195 @@ TEST (Osal, OneshotTimer)
 
    os_timer_destroy (timer);
 }
+
+static int loop_ticks;
+static int loop_reads;
+static void loop_tick (void * arg)
+{
+   loop_ticks++;
+}
+
+static void loop_read (void * arg)
+{
+   int * fds = (int *)arg;
+   char c;
+
+   if (read (fds[0], &c, 1) == 1)
+   {
+      loop_reads++;
+   }
+}
+
+TEST (Osal, LoopShouldCallTickAndFdFunctions)
+{
+   os_loop_t * loop;
+   int fds[2];
+   int t0;
+
+   loop_ticks = 0;
+   loop_reads = 0;
+   loop = os_loop_create();
+   ASSERT_TRUE (loop != NULL);
+   ASSERT_EQ (0, pipe (fds));
+
+   // Nothing registered yet
+   EXPECT_EQ (1, os_loop_run_once (loop, 10));
+
+   // Readable file descriptor
+   EXPECT_EQ (0, os_loop_add_fd (loop, fds[0], loop_read, fds));
+   EXPECT_EQ (1, write (fds[1], "x", 1));
+   EXPECT_EQ (0, os_loop_run_once (loop, 100));
+   EXPECT_EQ (1, loop_reads);
+   EXPECT_EQ (1, os_loop_run_once (loop, 10));
+
+   // Ticks at 10 ms
+   EXPECT_EQ (0, os_loop_set_tick (loop, 10 * 1000, loop_tick, NULL));
+   t0 = os_get_current_time_us();
+   while (loop_ticks < 20)
+   {
+      EXPECT_EQ (0, os_loop_run_once (loop, 100));
+   }
+   EXPECT_NEAR (200 * 1000, os_get_current_time_us() - t0, 10 * 1000);
+   EXPECT_EQ (20u, loop->ticks);
+
+   // Stopped
+   EXPECT_EQ (0, os_loop_set_tick (loop, 0, NULL, NULL));
+   os_loop_remove_fd (loop, fds[0]);
+   EXPECT_EQ (1, write (fds[1], "x", 1));
+   EXPECT_EQ (1, os_loop_run_once (loop, 30));
+   EXPECT_EQ (20, loop_ticks);
+   EXPECT_EQ (1, loop_reads);
+
+   os_loop_destroy (loop);
+   close (fds[0]);
+   close (fds[1]);
+}
+
+static int udp_calls;
+static void udp_ready (uint32_t id, void * arg)
+{
+   udp_calls++;
+}
+
+TEST (Osal, UdpCallbackShouldBeCalledFromLoop)
+{
+   const os_ipaddr_t localhost = 0x7f000001;
+   const os_ipport_t port = 40123;
+   os_loop_t * loop;
+   os_ipaddr_t addr;
+   os_ipport_t from_port;
+   uint8_t data[4];
+   int id;
+
+   udp_calls = 0;
+   loop = os_loop_create();
+   ASSERT_TRUE (loop != NULL);
+   id = os_udp_open (localhost, port);
+   ASSERT_GE (id, 0);
+
+   // No loop to dispatch from
+   EXPECT_EQ (-1, os_udp_set_callback (id, udp_ready, NULL));
+
+   os_udp_set_loop (loop);
+   EXPECT_EQ (0, os_udp_set_callback (id, udp_ready, NULL));
+   EXPECT_EQ (1, os_udp_sendto (id, localhost, port, (const uint8_t *)"x", 1));
+   EXPECT_EQ (0, os_loop_run_once (loop, 100));
+   EXPECT_EQ (1, udp_calls);
+
+   // Called when data arrives, not while it is unread
+   EXPECT_EQ (1, os_loop_run_once (loop, 10));
+   EXPECT_EQ (1, os_udp_recvfrom (id, &addr, &from_port, data, sizeof(data)));
+
+   os_udp_close (id);
+   os_udp_set_loop (NULL);
+   os_loop_destroy (loop);
+}
+
+#if OS_BUF_POOL_SIZE > 0
+TEST (Osal, BufAllocShouldUsePoolFirst)
+{
+   os_buf_pool_stats_t before;
+   os_buf_pool_stats_t stats;
+   os_buf_t * p_buf[OS_BUF_POOL_SIZE + 1];
+   os_buf_t * p_large;
+   uint16_t cnt;
+   uint16_t ix;
+
+   os_buf_pool_get_stats (&before);
+   EXPECT_EQ ((uint32_t)OS_BUF_POOL_SIZE, before.size);
+
+   // Drain the pool (other tests may hold some buffers) and one more
+   cnt = 0;
+   do
+   {
+      p_buf[cnt] = os_buf_alloc (1500);
+      ASSERT_TRUE (p_buf[cnt] != NULL);
+      EXPECT_EQ (1500, p_buf[cnt]->len);
+      memset (p_buf[cnt]->payload, 0xa5, 1500);
+      cnt++;
+      os_buf_pool_get_stats (&stats);
+   } while ((stats.exhausted == before.exhausted) && (cnt < NELEMENTS (p_buf)));
+
+   EXPECT_EQ (before.exhausted + 1, stats.exhausted);
+   EXPECT_EQ (stats.size, stats.in_use);
+   EXPECT_EQ (stats.size, stats.high_water);
+
+   // Larger buffers are not taken from the pool
+   p_large = os_buf_alloc (OS_BUF_MAX_SIZE + 1);
+   ASSERT_TRUE (p_large != NULL);
+   os_buf_free (p_large);
+
+   for (ix = 0; ix < cnt; ix++)
+   {
+      os_buf_free (p_buf[ix]);
+   }
+   os_buf_pool_get_stats (&stats);
+   EXPECT_EQ (before.in_use, stats.in_use);
+
+   // Freed buffers are reused, if other tests left any room in the pool
+   before = stats;
+   p_buf[0] = os_buf_alloc (64);
+   os_buf_pool_get_stats (&stats);
+   if (before.in_use < before.size)
+   {
+      EXPECT_EQ (before.in_use + 1, stats.in_use);
+      EXPECT_EQ (before.exhausted, stats.exhausted);
+   }
+   else
+   {
+      EXPECT_EQ (before.in_use, stats.in_use);
+      EXPECT_EQ (before.exhausted + 1, stats.exhausted);
+   }
+   EXPECT_EQ (64, p_buf[0]->len);
+   os_buf_free (p_buf[0]);
+}
+#endif
+
+TEST (Osal, LogShouldCountDeferredMessages)
+{
+   os_log_stats_t before;
+   os_log_stats_t stats;
+   char long_text[300];
+   int ix;
+
+   memset (long_text, 'x', sizeof(long_text) - 1);
+   long_text[sizeof(long_text) - 1] = '\0';
+
+   os_log_get_stats (&before);
+   for (ix = 0; ix < 10; ix++)
+   {
+      os_log (LOG_LEVEL_INFO, "Log test %d\n", ix);
+   }
+   os_log (LOG_LEVEL_INFO, "%s\n", long_text);
+   os_log_flush();
+   os_log_get_stats (&stats);
+
+#if defined (USE_ASYNC_LOG)
+   EXPECT_EQ (before.records + 11, stats.records + stats.dropped - before.dropped);
+   EXPECT_EQ (stats.records, stats.written);
+   EXPECT_EQ (before.truncated + 1, stats.truncated);
+#else
+   EXPECT_EQ (0u, stats.records);
+   EXPECT_EQ (0u, stats.dropped);
+#endif
+}
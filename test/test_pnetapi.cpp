@@ -288,6 +288,11 @@ protected:
       pnet_default_cfg.ip_gateway.b = 168;
       pnet_default_cfg.ip_gateway.c = 1;
       pnet_default_cfg.ip_gateway.d = 1;
+      pnet_default_cfg.max_ar = 0;         /* Compile-time maximum */
+      pnet_default_cfg.max_slots = 0;      /* Compile-time maximum */
+      pnet_default_cfg.max_subslots = 0;   /* Compile-time maximum */
+      pnet_default_cfg.max_submodules = 0; /* Compile-time maximum */
+      pnet_default_cfg.max_diag_items = 0; /* Compile-time maximum */
 
       pnet_default_cfg.im_0_data.vendor_id_hi = 0x00;
       pnet_default_cfg.im_0_data.vendor_id_lo = 0x01;
@@ -889,3 +894,71 @@ TEST_F(PnetapiTest, PnetapiShowTest)
    EXPECT_EQ(state_calls, 2);
    EXPECT_EQ(cmdev_state, PNET_EVENT_ABORT);
 }
+
+TEST_F(PnetapiTest, PnetapiFootprintTest)
+{
+   size_t                  table_size;
+   pnet_cfg_t              cfg;
+
+   /* The instance and the tables come from one cache aligned block */
+   EXPECT_EQ((uintptr_t)g_pnet % PF_CACHE_LINE_SIZE, 0u);
+   EXPECT_EQ((uintptr_t)g_pnet->cmrpc_ar % PF_CACHE_LINE_SIZE, 0u);
+   EXPECT_EQ((uintptr_t)g_pnet->cmrpc_session_info % PF_CACHE_LINE_SIZE, 0u);
+   EXPECT_EQ((uintptr_t)g_pnet->cmdev_data_desc % PF_CACHE_LINE_SIZE, 0u);
+   EXPECT_EQ((uintptr_t)g_pnet->cmdev_io_index % PF_CACHE_LINE_SIZE, 0u);
+   EXPECT_EQ((uintptr_t)g_pnet->cmdev_diag_items % PF_CACHE_LINE_SIZE, 0u);
+   EXPECT_EQ(g_pnet->cmrpc_max_ar, PNET_MAX_AR);
+   EXPECT_EQ(g_pnet->cmrpc_max_session, 2 * PNET_MAX_AR + 1);
+   EXPECT_EQ(g_pnet->cmdev_max_data_desc, PNET_MAX_API * PNET_MAX_MODULES * PNET_MAX_SUBMODULES);
+   EXPECT_EQ(g_pnet->cmdev_max_diag_items, PNET_MAX_DIAG_ITEMS);
+   EXPECT_EQ(g_pnet->cmdev_device.diag_items, g_pnet->cmdev_diag_items);
+   EXPECT_EQ(g_pnet->cmdev_max_slots, PNET_MAX_MODULES);
+   EXPECT_EQ(g_pnet->cmdev_max_subslots, PNET_MAX_SUBMODULES);
+   EXPECT_EQ(g_pnet->cmdev_device.apis[0].slots, &g_pnet->cmdev_slots[0]);
+   EXPECT_EQ(g_pnet->cmdev_device.apis[0].max_slots, PNET_MAX_MODULES);
+
+   table_size = sizeof(pnet_t) +
+      PNET_MAX_AR * sizeof(pf_ar_t) +
+      (2 * PNET_MAX_AR + 1) * sizeof(pf_session_info_t) +
+      PNET_MAX_AR * PNET_MAX_CR * g_pnet->cmdev_max_data_desc * sizeof(pf_iodata_object_t) +
+      PNET_MAX_AR * g_pnet->cmdev_max_data_desc * sizeof(pf_io_index_t) +
+      PNET_MAX_DIAG_ITEMS * sizeof(pf_diag_item_t) +
+      PNET_MAX_API * PNET_MAX_MODULES * sizeof(pf_slot_t) +
+      PNET_MAX_API * PNET_MAX_MODULES * PNET_MAX_SUBMODULES * sizeof(pf_subslot_t) +
+      PNET_MAX_AR * PNET_MAX_API * PNET_MAX_MODULES * (sizeof(pf_exp_module_t) + sizeof(pf_module_diff_t)) +
+      PNET_MAX_AR * g_pnet->cmdev_max_data_desc * (sizeof(pf_exp_submodule_t) + sizeof(pf_submodule_diff_t)) +
+      PNET_MAX_AR * PNET_MAX_CR * 2 * g_pnet->cmdev_max_data_desc * sizeof(pf_frame_descriptor_t);
+   EXPECT_GE(pnet_get_footprint(g_pnet), table_size);
+   EXPECT_LT(pnet_get_footprint(g_pnet), table_size + 14 * PF_CACHE_LINE_SIZE);
+
+   /* The IOCRs use the table after a connect */
+   mock_set_os_udp_recvfrom_buffer(connect_req, sizeof(connect_req));
+   os_usleep(TEST_UDP_DELAY);
+   EXPECT_EQ(connect_calls, 1);
+   EXPECT_EQ(g_pnet->cmrpc_ar[0].iocrs[0].data_desc, &g_pnet->cmdev_data_desc[0]);
+   EXPECT_EQ(g_pnet->cmrpc_ar[0].iocrs[1].data_desc, &g_pnet->cmdev_data_desc[g_pnet->cmdev_max_data_desc]);
+   EXPECT_GT(g_pnet->cmrpc_ar[0].iocrs[0].nbr_data_desc, 0);
+   EXPECT_EQ(g_pnet->cmrpc_ar[0].io_index, &g_pnet->cmdev_io_index[0]);
+   EXPECT_EQ(g_pnet->cmrpc_ar[0].max_io_index, g_pnet->cmdev_max_data_desc);
+   EXPECT_GT(g_pnet->cmrpc_ar[0].nbr_io_index, 0);
+
+   /* So do the expected configuration and the plugged modules */
+   EXPECT_EQ(g_pnet->cmrpc_ar[0].exp_apis[0].modules, &g_pnet->cmrpc_exp_modules[0]);
+   EXPECT_EQ(g_pnet->cmrpc_ar[0].exp_apis[0].modules[0].submodules, &g_pnet->cmrpc_exp_submodules[0]);
+   EXPECT_EQ(g_pnet->cmrpc_ar[0].nbr_exp_submodules, g_pnet->cmrpc_ar[0].iocrs[0].nbr_data_desc);
+   EXPECT_EQ(g_pnet->cmrpc_ar[0].iocrs[0].param.apis[0].io_data, &g_pnet->cmrpc_frame_desc[0]);
+   EXPECT_EQ(g_pnet->cmrpc_ar[0].iocrs[1].frame_desc, &g_pnet->cmrpc_frame_desc[2 * g_pnet->cmdev_max_data_desc]);
+   EXPECT_EQ(g_pnet->cmdev_device.apis[0].slots[0].subslots, &g_pnet->cmdev_subslots[0]);
+   EXPECT_EQ(g_pnet->cmdev_device.apis[0].slots[1].subslots, &g_pnet->cmdev_subslots[PNET_MAX_SUBMODULES]);
+   /* Limits out of range are rejected */
+   cfg = pnet_default_cfg;
+   cfg.max_ar = PNET_MAX_AR + 1;
+   EXPECT_EQ(pnet_init("en1", TICK_INTERVAL_US, &cfg), (pnet_t *)NULL);
+   cfg = pnet_default_cfg;
+   cfg.max_diag_items = PF_DIAG_IX_NULL;
+   EXPECT_EQ(pnet_init("en1", TICK_INTERVAL_US, &cfg), (pnet_t *)NULL);
+   cfg = pnet_default_cfg;
+   cfg.max_slots = 64;
+   cfg.max_subslots = 65;
+   EXPECT_EQ(pnet_init("en1", TICK_INTERVAL_US, &cfg), (pnet_t *)NULL);
+}
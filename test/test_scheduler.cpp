@@ -20,20 +20,215 @@
 #include "mocks.h"
 #include "test_util.h"
 
+#define TICK_INTERVAL_US   1000           /* us */
+
+static const char          *test_sync_name = "test";
+
+static uint16_t            calls;
+static uintptr_t           call_order[PF_MAX_TIMEOUTS];
+
+static void test_timeout(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                current_time)
+{
+   if (calls < NELEMENTS(call_order))
+   {
+      call_order[calls] = (uintptr_t)arg;
+   }
+   calls++;
+}
+
 // Test fixture
 
 class SchedulerTest : public ::testing::Test
 {
 protected:
    virtual void SetUp() {
-      memset (&net, 0, sizeof(net));
+      net = (pnet_t *)calloc(1, sizeof(*net));
+      pf_scheduler_init(net, TICK_INTERVAL_US);
+
+      calls = 0;
+      memset(call_order, 0, sizeof(call_order));
    };
 
-   pnet_cfg_t net;
+   virtual void TearDown() {
+      os_mutex_destroy(net->scheduler_timeout_mutex);
+      free(net);
+   };
+
+   pnet_t *net;
 };
 
 // Tests
 
-TEST_F (SchedulerTest, ShedulerRunTest)
+TEST_F (SchedulerTest, SchedulerRunsCallbacksInExpiryOrder)
+{
+   uint32_t                timeout[5];
+   const uint32_t          delay[5] = { 4000, 1000, 5000, 2000, 3000 };
+   uint16_t                ix;
+
+   for (ix = 0; ix < NELEMENTS(delay); ix++)
+   {
+      EXPECT_EQ(0, pf_scheduler_add(net, delay[ix], test_sync_name,
+         test_timeout, (void *)(uintptr_t)delay[ix], &timeout[ix]));
+      EXPECT_NE(0u, timeout[ix]);
+   }
+
+   pf_scheduler_tick(net);
+   EXPECT_EQ(0, calls);
+
+   os_usleep(6000);
+   pf_scheduler_tick(net);
+
+   EXPECT_EQ(5, calls);
+   EXPECT_EQ(1000u, call_order[0]);
+   EXPECT_EQ(2000u, call_order[1]);
+   EXPECT_EQ(3000u, call_order[2]);
+   EXPECT_EQ(4000u, call_order[3]);
+   EXPECT_EQ(5000u, call_order[4]);
+}
+
+TEST_F (SchedulerTest, SchedulerRemove)
+{
+   uint32_t                timeout[3];
+   uint16_t                ix;
+
+   for (ix = 0; ix < NELEMENTS(timeout); ix++)
+   {
+      EXPECT_EQ(0, pf_scheduler_add(net, 1000 * (ix + 1), test_sync_name,
+         test_timeout, (void *)(uintptr_t)ix, &timeout[ix]));
+   }
+
+   /* Remove the middle one, and a wrong owner which shall be ignored */
+   pf_scheduler_remove(net, test_sync_name, timeout[1]);
+   pf_scheduler_remove(net, "other", timeout[2]);
+
+   os_usleep(4000);
+   pf_scheduler_tick(net);
+
+   EXPECT_EQ(2, calls);
+   EXPECT_EQ(0u, call_order[0]);
+   EXPECT_EQ(2u, call_order[1]);
+
+   /* Removing an expired timeout shall be harmless */
+   pf_scheduler_remove(net, test_sync_name, timeout[0]);
+   pf_scheduler_remove(net, test_sync_name, 0);
+   pf_scheduler_remove(net, test_sync_name, PF_MAX_TIMEOUTS + 1);
+
+   /* All resources shall be available again */
+   for (ix = 0; ix < PF_MAX_TIMEOUTS; ix++)
+   {
+      EXPECT_EQ(0, pf_scheduler_add(net, 1000, test_sync_name,
+         test_timeout, NULL, &timeout[0]));
+   }
+   EXPECT_EQ(-1, pf_scheduler_add(net, 1000, test_sync_name,
+      test_timeout, NULL, &timeout[0]));
+}
+
+static uint32_t            periodic_timeout;
+static uint16_t            periodic_stop_after;
+
+static uint32_t            periodic_time[3];
+
+static void test_periodic_timeout(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                current_time)
 {
+   if (calls < NELEMENTS(periodic_time))
+   {
+      periodic_time[calls] = current_time;
+   }
+   calls++;
+   if (calls >= periodic_stop_after)
+   {
+      pf_scheduler_remove(net, test_sync_name, periodic_timeout);
+   }
+}
+
+TEST_F (SchedulerTest, SchedulerPeriodic)
+{
+   uint16_t                ix;
+
+   periodic_stop_after = 3;
+   EXPECT_EQ(-1, pf_scheduler_add_periodic(net, 0, test_sync_name,
+      test_periodic_timeout, NULL, &periodic_timeout));
+   EXPECT_EQ(0, pf_scheduler_add_periodic(net, 1000, test_sync_name,
+      test_periodic_timeout, NULL, &periodic_timeout));
+
+   for (ix = 0; ix < 10; ix++)
+   {
+      os_usleep(1000);
+      pf_scheduler_tick(net);
+   }
+
+   /* Removed by the call-back itself after 3 calls */
+   EXPECT_EQ(3, calls);
+   EXPECT_EQ(0u, pf_scheduler_get_overruns(net, test_sync_name, periodic_timeout));
+
+   /* The call-back gets its deadlines, which are exactly one period apart */
+   EXPECT_EQ(1000u, periodic_time[1] - periodic_time[0]);
+   EXPECT_EQ(1000u, periodic_time[2] - periodic_time[1]);
+}
+
+TEST_F (SchedulerTest, SchedulerPeriodicOverrun)
+{
+   periodic_stop_after = 100;
+   EXPECT_EQ(0, pf_scheduler_add_periodic(net, 1000, test_sync_name,
+      test_periodic_timeout, NULL, &periodic_timeout));
+
+   /* Miss a number of deadlines. They shall be skipped, not bursted. */
+   os_usleep(5500);
+   pf_scheduler_tick(net);
+   pf_scheduler_tick(net);
+
+   EXPECT_EQ(1, calls);
+   EXPECT_GE(pf_scheduler_get_overruns(net, test_sync_name, periodic_timeout), 4u);
+   EXPECT_EQ(0u, pf_scheduler_get_overruns(net, "other", periodic_timeout));
+
+   pf_scheduler_remove(net, test_sync_name, periodic_timeout);
+   os_usleep(2000);
+   pf_scheduler_tick(net);
+   EXPECT_EQ(1, calls);
+}
+
+static pnet_t              *thread_net;
+static uint32_t            thread_remove_timeout;
+static uint32_t            thread_add_timeout;
+static volatile bool       thread_done;
+
+static void test_add_remove_thread(
+   void                    *arg)
+{
+   (void)pf_scheduler_add(thread_net, 1000, test_sync_name,
+      test_timeout, (void *)2, &thread_add_timeout);
+   pf_scheduler_remove(thread_net, test_sync_name, thread_remove_timeout);
+   thread_done = true;
+}
+
+TEST_F (SchedulerTest, SchedulerAddRemoveFromOtherThread)
+{
+   uint16_t                ix;
+
+   EXPECT_EQ(0, pf_scheduler_add(net, 1000, test_sync_name,
+      test_timeout, (void *)1, &thread_remove_timeout));
+
+   thread_net = net;
+   thread_add_timeout = 0;
+   thread_done = false;
+   os_thread_create("test", 5, 4096, test_add_remove_thread, NULL);
+   for (ix = 0; (ix < 1000) && (thread_done == false); ix++)
+   {
+      os_usleep(1000);
+   }
+   ASSERT_TRUE(thread_done);
+   EXPECT_NE(0u, thread_add_timeout);
+
+   /* Requests from other threads are applied by the next tick */
+   os_usleep(2000);
+   pf_scheduler_tick(net);
+   pf_scheduler_tick(net);
+   EXPECT_EQ(1, calls);
+   EXPECT_EQ(2u, call_order[0]);
 }